@@ -0,0 +1,497 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+/*
+ * Benchmark of the main ingest, slicing and copy paths of caterva.
+ *
+ * Every case is run over a sweep of shapes (ndim, chunkshape and blockshape), itemsizes, codecs
+ * and number of threads. Each result is printed as a JSON object in its own line (JSON Lines), so
+ * that the results of different versions can be compared with any tool.
+ *
+ * Usage: caterva_bench [--quick] [--repeats N] [--nops N] [--output FILE]
+ */
+
+#include <caterva.h>
+#include <string.h>
+
+#define BENCH_URLPATH "bench_caterva.b2frame"
+
+typedef struct {
+    int8_t ndim;
+    int64_t shape[CATERVA_MAX_DIM];
+    int32_t chunkshape[CATERVA_MAX_DIM];
+    int32_t blockshape[CATERVA_MAX_DIM];
+} bench_shapes_t;
+
+// About 4 M items each. The second shape of every ndim has blocks spanning whole chunk rows.
+static const bench_shapes_t bench_shapes[] = {
+    {1, {4194304}, {262144}, {16384}},
+    {1, {4194304}, {1048576}, {1048576}},
+    {2, {2048, 2048}, {256, 256}, {64, 64}},
+    {2, {2048, 2048}, {128, 2048}, {16, 2048}},
+    {3, {160, 160, 160}, {40, 40, 40}, {10, 10, 10}},
+    {3, {160, 160, 160}, {16, 160, 160}, {2, 160, 160}},
+};
+
+static const uint8_t bench_itemsizes[] = {4, 8};
+
+static const struct {
+    int code;
+    const char *name;
+} bench_codecs[] = {
+    {BLOSC_BLOSCLZ, "blosclz"},
+    {BLOSC_LZ4, "lz4"},
+    {BLOSC_ZSTD, "zstd"},
+};
+
+static const int bench_nthreads[] = {1, 4};
+
+typedef struct {
+    FILE *output;
+    int repeats;
+    //!< Number of times the operations on the whole array are measured.
+    int nops;
+    //!< Number of slices measured in the slicing cases.
+    uint64_t seed;
+    //!< The state of the random generator used to place the slices.
+    const bench_shapes_t *shapes;
+    uint8_t itemsize;
+    int codec;
+    int nthreads;
+    caterva_ctx_t *ctx;
+    caterva_params_t params;
+    caterva_storage_t storage;
+    uint8_t *buffer;
+    //!< The source data.
+    int64_t nbytes;
+    //!< The size (in bytes) of the source data.
+    double *samples;
+    //!< The latencies (in seconds) of the case being measured.
+} bench_t;
+
+
+static int64_t bench_random(bench_t *bench, int64_t n) {
+    // 64-bit LCG (Knuth's MMIX), so that the positions are the same in every platform
+    bench->seed = bench->seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (int64_t) ((bench->seed >> 33) % (uint64_t) n);
+}
+
+static void bench_print_shape(FILE *output, const char *name, int8_t ndim, const int64_t *shape) {
+    fprintf(output, "\"%s\": [", name);
+    for (int i = 0; i < ndim; ++i) {
+        fprintf(output, i == 0 ? "%lld" : ", %lld", (long long) shape[i]);
+    }
+    fprintf(output, "], ");
+}
+
+static int bench_compare(const void *a, const void *b) {
+    double da = *(const double *) a;
+    double db = *(const double *) b;
+    return (da > db) - (da < db);
+}
+
+// Print the statistics of `nsamples` latencies of an operation processing `nbytes` bytes
+static void bench_report(bench_t *bench, const char *name, int nsamples, int64_t nbytes,
+                         double cratio) {
+    double *samples = bench->samples;
+    qsort(samples, (size_t) nsamples, sizeof(double), bench_compare);
+    double total = 0;
+    for (int i = 0; i < nsamples; ++i) {
+        total += samples[i];
+    }
+    double p50 = samples[nsamples / 2];
+    double p90 = samples[(nsamples * 9) / 10];
+    double p99 = samples[(nsamples * 99) / 100];
+
+    int64_t shape[CATERVA_MAX_DIM];
+    int64_t chunkshape[CATERVA_MAX_DIM];
+    int64_t blockshape[CATERVA_MAX_DIM];
+    const bench_shapes_t *shapes = bench->shapes;
+    for (int i = 0; i < shapes->ndim; ++i) {
+        shape[i] = shapes->shape[i];
+        chunkshape[i] = shapes->chunkshape[i];
+        blockshape[i] = shapes->blockshape[i];
+    }
+
+    const char *codec = NULL;
+    for (size_t i = 0; i < sizeof(bench_codecs) / sizeof(bench_codecs[0]); ++i) {
+        if (bench_codecs[i].code == bench->codec) {
+            codec = bench_codecs[i].name;
+        }
+    }
+
+    FILE *output = bench->output;
+    fprintf(output, "{\"version\": \"%s\", \"case\": \"%s\", ", CATERVA_VERSION_STRING, name);
+    fprintf(output, "\"ndim\": %d, ", shapes->ndim);
+    bench_print_shape(output, "shape", shapes->ndim, shape);
+    bench_print_shape(output, "chunkshape", shapes->ndim, chunkshape);
+    bench_print_shape(output, "blockshape", shapes->ndim, blockshape);
+    fprintf(output, "\"itemsize\": %d, \"codec\": \"%s\", \"nthreads\": %d, ", bench->itemsize,
+            codec, bench->nthreads);
+    fprintf(output, "\"nsamples\": %d, \"nbytes\": %lld, \"gbps\": %.4f, ", nsamples,
+            (long long) nbytes, (double) nbytes / p50 / 1e9);
+    fprintf(output, "\"mean_us\": %.3f, \"p50_us\": %.3f, \"p90_us\": %.3f, \"p99_us\": %.3f, ",
+            total / nsamples * 1e6, p50 * 1e6, p90 * 1e6, p99 * 1e6);
+    fprintf(output, "\"cratio\": %.3f}\n", cratio);
+    fflush(output);
+}
+
+static double bench_cratio(caterva_array_t *array) {
+    if (array->storage != CATERVA_STORAGE_BLOSC || array->sc->cbytes == 0) {
+        return 1;
+    }
+    return (double) array->sc->nbytes / (double) array->sc->cbytes;
+}
+
+
+static int bench_from_buffer(bench_t *bench) {
+    double cratio = 1;
+    for (int i = 0; i < bench->repeats; ++i) {
+        caterva_array_t *array;
+        blosc_timestamp_t t0, t1;
+        blosc_set_timestamp(&t0);
+        CATERVA_ERROR(caterva_from_buffer(bench->ctx, bench->buffer, bench->nbytes,
+                                          &bench->params, &bench->storage, &array));
+        blosc_set_timestamp(&t1);
+        bench->samples[i] = blosc_elapsed_secs(t0, t1);
+        cratio = bench_cratio(array);
+        CATERVA_ERROR(caterva_free(bench->ctx, &array));
+    }
+    bench_report(bench, "from_buffer", bench->repeats, bench->nbytes, cratio);
+
+    return CATERVA_SUCCEED;
+}
+
+static int bench_append(bench_t *bench, caterva_array_t *src) {
+    // Extract the chunks beforehand, so that only the appends are measured
+    uint8_t *chunks = malloc((size_t) bench->nbytes);
+    int64_t *chunksizes = malloc((size_t) src->nchunks * sizeof(int64_t));
+    if (chunks == NULL || chunksizes == NULL) {
+        free(chunks);
+        free(chunksizes);
+        CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+    }
+    caterva_iter_t *iter;
+    CATERVA_ERROR(caterva_iter_new(bench->ctx, src, 0, &iter));
+    caterva_iter_region_t region;
+    bool done;
+    int64_t offset = 0;
+    int64_t nchunks = 0;
+    while (caterva_iter_next(iter, &region, &done) == CATERVA_SUCCEED && !done) {
+        memcpy(&chunks[offset], region.buffer, (size_t) region.buffersize);
+        offset += region.buffersize;
+        chunksizes[nchunks++] = region.buffersize;
+    }
+    CATERVA_ERROR(caterva_iter_free(&iter));
+
+    double cratio = 1;
+    for (int i = 0; i < bench->repeats; ++i) {
+        caterva_array_t *array;
+        blosc_timestamp_t t0, t1;
+        blosc_set_timestamp(&t0);
+        CATERVA_ERROR(caterva_empty(bench->ctx, &bench->params, &bench->storage, &array));
+        offset = 0;
+        for (int64_t n = 0; n < nchunks; ++n) {
+            CATERVA_ERROR(caterva_append(bench->ctx, array, &chunks[offset], chunksizes[n]));
+            offset += chunksizes[n];
+        }
+        blosc_set_timestamp(&t1);
+        bench->samples[i] = blosc_elapsed_secs(t0, t1);
+        cratio = bench_cratio(array);
+        CATERVA_ERROR(caterva_free(bench->ctx, &array));
+    }
+    bench_report(bench, "append", bench->repeats, bench->nbytes, cratio);
+
+    free(chunks);
+    free(chunksizes);
+    return CATERVA_SUCCEED;
+}
+
+typedef enum {
+    BENCH_SLICE_ALIGNED,
+    //!< Slices covering exactly one chunk.
+    BENCH_SLICE_UNALIGNED,
+    //!< Slices with the shape of a chunk, but shifted half a chunk.
+    BENCH_SLICE_ITEM,
+    //!< Slices of a single item.
+} bench_slice_t;
+
+static int bench_get_slice_buffer(bench_t *bench, caterva_array_t *src, bench_slice_t kind) {
+    const bench_shapes_t *shapes = bench->shapes;
+    int64_t slice_nbytes = bench->itemsize;
+    for (int i = 0; i < shapes->ndim; ++i) {
+        slice_nbytes *= kind == BENCH_SLICE_ITEM ? 1 : shapes->chunkshape[i];
+    }
+    uint8_t *slice = malloc((size_t) slice_nbytes);
+    CATERVA_ERROR_NULL(slice);
+
+    for (int n = 0; n < bench->nops; ++n) {
+        int64_t start[CATERVA_MAX_DIM];
+        int64_t stop[CATERVA_MAX_DIM];
+        int64_t shape[CATERVA_MAX_DIM];
+        for (int i = 0; i < shapes->ndim; ++i) {
+            int64_t chunkshape = shapes->chunkshape[i];
+            switch (kind) {
+                case BENCH_SLICE_ALIGNED:
+                    start[i] = bench_random(bench, shapes->shape[i] / chunkshape) * chunkshape;
+                    shape[i] = chunkshape;
+                    break;
+                case BENCH_SLICE_UNALIGNED:
+                    start[i] = bench_random(bench, shapes->shape[i] / chunkshape) * chunkshape +
+                               chunkshape / 2;
+                    shape[i] = chunkshape;
+                    if (start[i] + shape[i] > shapes->shape[i]) {
+                        start[i] = shapes->shape[i] - shape[i];
+                    }
+                    break;
+                default:
+                    start[i] = bench_random(bench, shapes->shape[i]);
+                    shape[i] = 1;
+            }
+            stop[i] = start[i] + shape[i];
+        }
+        blosc_timestamp_t t0, t1;
+        blosc_set_timestamp(&t0);
+        CATERVA_ERROR(caterva_get_slice_buffer(bench->ctx, src, start, stop, shape, slice,
+                                               slice_nbytes));
+        blosc_set_timestamp(&t1);
+        bench->samples[n] = blosc_elapsed_secs(t0, t1);
+    }
+
+    const char *names[] = {"get_slice_buffer_aligned", "get_slice_buffer_unaligned",
+                           "get_slice_buffer_item"};
+    bench_report(bench, names[kind], bench->nops, slice_nbytes, bench_cratio(src));
+
+    free(slice);
+    return CATERVA_SUCCEED;
+}
+
+static int bench_get_slice(bench_t *bench, caterva_array_t *src) {
+    // The central half (in every dimension) of the array
+    const bench_shapes_t *shapes = bench->shapes;
+    int64_t start[CATERVA_MAX_DIM];
+    int64_t stop[CATERVA_MAX_DIM];
+    caterva_storage_t storage = bench->storage;
+    int64_t nbytes = bench->itemsize;
+    for (int i = 0; i < shapes->ndim; ++i) {
+        start[i] = shapes->shape[i] / 4;
+        stop[i] = start[i] + shapes->shape[i] / 2;
+        nbytes *= stop[i] - start[i];
+        if (storage.properties.blosc.chunkshape[i] > stop[i] - start[i]) {
+            storage.properties.blosc.chunkshape[i] = (int32_t) (stop[i] - start[i]);
+        }
+        if (storage.properties.blosc.blockshape[i] > storage.properties.blosc.chunkshape[i]) {
+            storage.properties.blosc.blockshape[i] = storage.properties.blosc.chunkshape[i];
+        }
+    }
+
+    double cratio = 1;
+    for (int i = 0; i < bench->repeats; ++i) {
+        caterva_array_t *array;
+        blosc_timestamp_t t0, t1;
+        blosc_set_timestamp(&t0);
+        CATERVA_ERROR(caterva_get_slice(bench->ctx, src, start, stop, &storage, &array));
+        blosc_set_timestamp(&t1);
+        bench->samples[i] = blosc_elapsed_secs(t0, t1);
+        cratio = bench_cratio(array);
+        CATERVA_ERROR(caterva_free(bench->ctx, &array));
+    }
+    bench_report(bench, "get_slice", bench->repeats, nbytes, cratio);
+
+    return CATERVA_SUCCEED;
+}
+
+static int bench_copy(bench_t *bench, caterva_array_t *src, bool rechunk) {
+    caterva_storage_t storage = bench->storage;
+    if (rechunk) {
+        // Half the chunkshape in every dimension, so that every chunk has to be rebuilt
+        for (int i = 0; i < bench->shapes->ndim; ++i) {
+            int32_t *chunkshape = &storage.properties.blosc.chunkshape[i];
+            int32_t *blockshape = &storage.properties.blosc.blockshape[i];
+            *chunkshape = *chunkshape > 1 ? *chunkshape / 2 : 1;
+            *blockshape = *blockshape > *chunkshape ? *chunkshape : *blockshape;
+        }
+    }
+
+    double cratio = 1;
+    for (int i = 0; i < bench->repeats; ++i) {
+        caterva_array_t *array;
+        blosc_timestamp_t t0, t1;
+        blosc_set_timestamp(&t0);
+        CATERVA_ERROR(caterva_copy(bench->ctx, src, &storage, &array));
+        blosc_set_timestamp(&t1);
+        bench->samples[i] = blosc_elapsed_secs(t0, t1);
+        cratio = bench_cratio(array);
+        CATERVA_ERROR(caterva_free(bench->ctx, &array));
+    }
+    bench_report(bench, rechunk ? "copy_rechunk" : "copy_schunk", bench->repeats, bench->nbytes,
+                 cratio);
+
+    return CATERVA_SUCCEED;
+}
+
+static int bench_open(bench_t *bench, bool mmap) {
+    caterva_storage_t storage = bench->storage;
+    storage.properties.blosc.urlpath = BENCH_URLPATH;
+    storage.properties.blosc.sequencial = true;
+    remove(BENCH_URLPATH);
+    caterva_array_t *array;
+    CATERVA_ERROR(caterva_from_buffer(bench->ctx, bench->buffer, bench->nbytes, &bench->params,
+                                      &storage, &array));
+    double cratio = bench_cratio(array);
+    CATERVA_ERROR(caterva_free(bench->ctx, &array));
+
+    uint8_t *dest = malloc((size_t) bench->nbytes);
+    CATERVA_ERROR_NULL(dest);
+    for (int i = 0; i < bench->repeats; ++i) {
+        blosc_timestamp_t t0, t1;
+        blosc_set_timestamp(&t0);
+        if (mmap) {
+            CATERVA_ERROR(caterva_open_mmap(bench->ctx, BENCH_URLPATH, CATERVA_ACCESS_SEQUENTIAL,
+                                            &array));
+        } else {
+            CATERVA_ERROR(caterva_open(bench->ctx, BENCH_URLPATH, &array));
+        }
+        CATERVA_ERROR(caterva_to_buffer(bench->ctx, array, dest, bench->nbytes));
+        blosc_set_timestamp(&t1);
+        bench->samples[i] = blosc_elapsed_secs(t0, t1);
+        CATERVA_ERROR(caterva_free(bench->ctx, &array));
+    }
+    bench_report(bench, mmap ? "open_mmap_read" : "open_read", bench->repeats, bench->nbytes,
+                 cratio);
+
+    free(dest);
+    remove(BENCH_URLPATH);
+    return CATERVA_SUCCEED;
+}
+
+
+static int bench_run(bench_t *bench) {
+    const bench_shapes_t *shapes = bench->shapes;
+
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.compcodec = bench->codec;
+    cfg.nthreads = bench->nthreads;
+    CATERVA_ERROR(caterva_ctx_new(&cfg, &bench->ctx));
+
+    memset(&bench->params, 0, sizeof(caterva_params_t));
+    bench->params.itemsize = bench->itemsize;
+    bench->params.ndim = shapes->ndim;
+    memset(&bench->storage, 0, sizeof(caterva_storage_t));
+    bench->storage.backend = CATERVA_STORAGE_BLOSC;
+    bench->nbytes = bench->itemsize;
+    for (int i = 0; i < shapes->ndim; ++i) {
+        bench->params.shape[i] = shapes->shape[i];
+        bench->storage.properties.blosc.chunkshape[i] = shapes->chunkshape[i];
+        bench->storage.properties.blosc.blockshape[i] = shapes->blockshape[i];
+        bench->nbytes *= shapes->shape[i];
+    }
+
+    // A smooth ramp with some noise in the low bits, compressible but not trivially
+    bench->buffer = malloc((size_t) bench->nbytes);
+    CATERVA_ERROR_NULL(bench->buffer);
+    int64_t nitems = bench->nbytes / bench->itemsize;
+    for (int64_t i = 0; i < nitems; ++i) {
+        if (bench->itemsize == 4) {
+            ((float *) bench->buffer)[i] = (float) i + (float) bench_random(bench, 16) / 64;
+        } else {
+            ((double *) bench->buffer)[i] = (double) i + (double) bench_random(bench, 16) / 64;
+        }
+    }
+
+    caterva_array_t *src;
+    CATERVA_ERROR(caterva_from_buffer(bench->ctx, bench->buffer, bench->nbytes, &bench->params,
+                                      &bench->storage, &src));
+
+    CATERVA_ERROR(bench_from_buffer(bench));
+    CATERVA_ERROR(bench_append(bench, src));
+    CATERVA_ERROR(bench_get_slice_buffer(bench, src, BENCH_SLICE_ALIGNED));
+    CATERVA_ERROR(bench_get_slice_buffer(bench, src, BENCH_SLICE_UNALIGNED));
+    CATERVA_ERROR(bench_get_slice_buffer(bench, src, BENCH_SLICE_ITEM));
+    CATERVA_ERROR(bench_get_slice(bench, src));
+    CATERVA_ERROR(bench_copy(bench, src, false));
+    CATERVA_ERROR(bench_copy(bench, src, true));
+    CATERVA_ERROR(bench_open(bench, false));
+    CATERVA_ERROR(bench_open(bench, true));
+
+    CATERVA_ERROR(caterva_free(bench->ctx, &src));
+    free(bench->buffer);
+    CATERVA_ERROR(caterva_ctx_free(&bench->ctx));
+
+    return CATERVA_SUCCEED;
+}
+
+int main(int argc, char **argv) {
+    bench_t bench = {0};
+    bench.output = stdout;
+    bench.repeats = 5;
+    bench.nops = 200;
+    bool quick = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+            bench.repeats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--nops") == 0 && i + 1 < argc) {
+            bench.nops = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            bench.output = fopen(argv[++i], "w");
+            if (bench.output == NULL) {
+                fprintf(stderr, "Can not open %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Usage: %s [--quick] [--repeats N] [--nops N] [--output FILE]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (bench.repeats < 1 || bench.nops < 1) {
+        fprintf(stderr, "The number of repeats and operations must be positive\n");
+        return 1;
+    }
+    bench.samples = malloc((size_t) (bench.repeats > bench.nops ? bench.repeats : bench.nops) *
+                           sizeof(double));
+
+    // The quick sweep only covers one shape per ndim, one itemsize, one codec and 1 thread
+    size_t nshapes = sizeof(bench_shapes) / sizeof(bench_shapes[0]);
+    size_t nitemsizes = quick ? 1 : sizeof(bench_itemsizes) / sizeof(bench_itemsizes[0]);
+    size_t ncodecs = quick ? 1 : sizeof(bench_codecs) / sizeof(bench_codecs[0]);
+    size_t nnthreads = quick ? 1 : sizeof(bench_nthreads) / sizeof(bench_nthreads[0]);
+
+    int rc = CATERVA_SUCCEED;
+    for (size_t s = 0; s < nshapes; s += quick ? 2 : 1) {
+        for (size_t it = 0; it < nitemsizes; ++it) {
+            for (size_t c = 0; c < ncodecs; ++c) {
+                for (size_t t = 0; t < nnthreads; ++t) {
+                    bench.seed = 0;
+                    bench.shapes = &bench_shapes[s];
+                    bench.itemsize = bench_itemsizes[quick ? 1 : it];
+                    bench.codec = bench_codecs[quick ? 1 : c].code;
+                    bench.nthreads = bench_nthreads[t];
+                    rc = bench_run(&bench);
+                    if (rc != CATERVA_SUCCEED) {
+                        fprintf(stderr, "Benchmark failed: %s\n", print_error(rc));
+                        goto out;
+                    }
+                }
+            }
+        }
+    }
+
+out:
+    free(bench.samples);
+    if (bench.output != stdout) {
+        fclose(bench.output);
+    }
+    return rc == CATERVA_SUCCEED ? 0 : 1;
+}
@@ -12,7 +12,12 @@
 #include <caterva.h>
 
 #include "caterva_blosc.h"
+#include "caterva_copy.h"
+#include "caterva_instr.h"
 #include "caterva_plainbuffer.h"
+#include "caterva_pool.h"
+#include "caterva_pyramid.h"
+#include "caterva_shared.h"
 
 int caterva_ctx_new(caterva_config_t *cfg, caterva_ctx_t **ctx) {
     CATERVA_ERROR_NULL(cfg);
@@ -27,9 +32,18 @@ int caterva_ctx_new(caterva_config_t *cfg, caterva_ctx_t **ctx) {
     (*ctx)->cfg = (caterva_config_t *) cfg->alloc(sizeof(caterva_config_t));
     if (!(*ctx)->cfg) {
         DEBUG_PRINT("Allocation fails");
+        cfg->free(*ctx);
+        *ctx = NULL;
         return CATERVA_ERR_NULL_POINTER;
     }
     memcpy((*ctx)->cfg, cfg, sizeof(caterva_config_t));
+    int rc = caterva_pool_new((*ctx)->cfg, &(*ctx)->pool);
+    if (rc != CATERVA_SUCCEED) {
+        cfg->free((*ctx)->cfg);
+        cfg->free(*ctx);
+        *ctx = NULL;
+        CATERVA_ERROR(rc);
+    }
 
     return CATERVA_SUCCEED;
 }
@@ -37,6 +51,7 @@ int caterva_ctx_new(caterva_config_t *cfg, caterva_ctx_t **ctx) {
 int caterva_ctx_free(caterva_ctx_t **ctx) {
     CATERVA_ERROR_NULL(ctx);
 
+    caterva_pool_free(&(*ctx)->pool);
     void (*auxfree)(void *) = (*ctx)->cfg->free;
     auxfree((*ctx)->cfg);
     auxfree(*ctx);
@@ -44,6 +59,15 @@ int caterva_ctx_free(caterva_ctx_t **ctx) {
     return CATERVA_SUCCEED;
 }
 
+int caterva_ctx_get_pool_stats(caterva_ctx_t *ctx, caterva_pool_stats_t *stats) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(stats);
+
+    caterva_pool_get_stats(ctx->pool, stats);
+
+    return CATERVA_SUCCEED;
+}
+
 int caterva_empty(caterva_ctx_t *ctx, caterva_params_t *params,
                   caterva_storage_t *storage, caterva_array_t **array) {
     CATERVA_ERROR_NULL(ctx);
@@ -69,6 +93,34 @@ int caterva_empty(caterva_ctx_t *ctx, caterva_params_t *params,
     return CATERVA_SUCCEED;
 }
 
+int caterva_zeros(caterva_ctx_t *ctx, caterva_params_t *params,
+                  caterva_storage_t *storage, caterva_array_t **array) {
+    CATERVA_ERROR(caterva_empty(ctx, params, storage, array));
+
+    if ((*array)->nitems == 0) {
+        return CATERVA_SUCCEED;
+    }
+
+    switch ((*array)->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_zeros(ctx, *array));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            // A new file already reads as zeros, so its pages are not touched
+            if ((*array)->bufmap == NULL) {
+                memset((*array)->buf, 0, (size_t) (*array)->extnitems * (*array)->itemsize);
+            }
+            (*array)->nchunks = 1;
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+    (*array)->filled = true;
+    (*array)->empty = false;
+
+    return CATERVA_SUCCEED;
+}
+
 int
 caterva_from_schunk(caterva_ctx_t *ctx, blosc2_schunk *schunk, caterva_array_t **array) {
     CATERVA_ERROR_NULL(ctx);
@@ -100,7 +152,35 @@ int caterva_open(caterva_ctx_t *ctx, const char *urlpath, caterva_array_t **arra
     CATERVA_ERROR_NULL(urlpath);
     CATERVA_ERROR_NULL(array);
 
-    CATERVA_ERROR(caterva_blosc_open(ctx, urlpath, array));
+    CATERVA_ERROR(caterva_plainbuffer_array_open(ctx, urlpath, array));
+    if (*array == NULL) {
+        CATERVA_ERROR(caterva_blosc_open(ctx, urlpath, array));
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_open_shared(caterva_ctx_t *ctx, const char *urlpath, caterva_array_t **array) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(urlpath);
+    CATERVA_ERROR_NULL(array);
+
+    // Plain buffers are mapped as they are, so there is nothing to share
+    CATERVA_ERROR(caterva_plainbuffer_array_open(ctx, urlpath, array));
+    if (*array == NULL) {
+        CATERVA_ERROR(caterva_shared_open(ctx, urlpath, array));
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_open_mmap(caterva_ctx_t *ctx, const char *urlpath, caterva_access_t access,
+                      caterva_array_t **array) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(urlpath);
+    CATERVA_ERROR_NULL(array);
+
+    CATERVA_ERROR(caterva_blosc_open_mmap(ctx, urlpath, access, array));
 
     return CATERVA_SUCCEED;
 }
@@ -109,17 +189,26 @@ int caterva_free(caterva_ctx_t *ctx, caterva_array_t **array) {
     CATERVA_ERROR_NULL(ctx);
     CATERVA_ERROR_NULL(array);
 
+    int rc = CATERVA_SUCCEED;
     if (*array) {
+        caterva_pyramid_free(ctx, &(*array)->pyramid);
         switch ((*array)->storage) {
             case CATERVA_STORAGE_BLOSC:
-                caterva_blosc_array_free(ctx, array);
+                rc = caterva_blosc_array_free(ctx, array);
                 break;
             case CATERVA_STORAGE_PLAINBUFFER:
-                caterva_plainbuffer_array_free(ctx, array);
+                rc = caterva_plainbuffer_array_free(ctx, array);
                 break;
         }
+        caterva_instr_free(ctx, &(*array)->instr);
+        if ((*array)->fillvalue != NULL) {
+            ctx->cfg->free((*array)->fillvalue);
+        }
         ctx->cfg->free(*array);
     }
+    // A failed flush to the storage is reported once the memory is released
+    CATERVA_ERROR(rc);
+
     return CATERVA_SUCCEED;
 }
 
@@ -129,6 +218,10 @@ int caterva_append(caterva_ctx_t *ctx, caterva_array_t *array, void *chunk,
     CATERVA_ERROR_NULL(array);
     CATERVA_ERROR_NULL(chunk);
 
+    if (array->mmap != NULL || array->shared != NULL) {
+        CATERVA_ERROR(CATERVA_ERR_READ_ONLY);
+    }
+
     if (array->filled) {
         CATERVA_ERROR(CATERVA_ERR_CONTAINER_FILLED);
     }
@@ -158,6 +251,55 @@ int caterva_append(caterva_ctx_t *ctx, caterva_array_t *array, void *chunk,
     return CATERVA_SUCCEED;
 }
 
+int caterva_set_chunk(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *coords, void *chunk,
+                      int64_t chunksize) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(coords);
+    CATERVA_ERROR_NULL(chunk);
+
+    if (array->mmap != NULL || array->shared != NULL) {
+        CATERVA_ERROR(CATERVA_ERR_READ_ONLY);
+    }
+
+    if (!array->filled) {
+        DEBUG_PRINT("The array must be filled (e.g. using caterva_zeros) before setting chunks");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    int64_t start[CATERVA_MAX_DIM];
+    int64_t stop[CATERVA_MAX_DIM];
+    int64_t size = array->itemsize;
+    for (int i = 0; i < array->ndim; ++i) {
+        start[i] = coords[i] * array->chunkshape[i];
+        if (coords[i] < 0 || start[i] >= array->shape[i]) {
+            CATERVA_ERROR(CATERVA_ERR_INVALID_INDEX);
+        }
+        stop[i] = start[i] + array->chunkshape[i];
+        if (stop[i] > array->shape[i]) {
+            stop[i] = array->shape[i];
+        }
+        size *= stop[i] - start[i];
+    }
+    if (chunksize != size) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_set_chunk(ctx, array, coords, chunk, chunksize));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            CATERVA_ERROR(caterva_plainbuffer_array_set_slice_buffer(ctx, chunk, chunksize, start,
+                                                                     stop, array));
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
 int caterva_from_buffer(caterva_ctx_t *ctx, void *buffer, int64_t buffersize,
                         caterva_params_t *params, caterva_storage_t *storage,
                         caterva_array_t **array) {
@@ -264,6 +406,131 @@ int caterva_get_slice_buffer(caterva_ctx_t *ctx, caterva_array_t *src, int64_t *
     return CATERVA_SUCCEED;
 }
 
+int caterva_get_slice_buffers(caterva_ctx_t *ctx, caterva_array_t *array,
+                              caterva_slice_request_t *requests, int64_t nrequests) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    if (nrequests < 0) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    if (nrequests == 0 || array->nitems == 0) {
+        return CATERVA_SUCCEED;
+    }
+    CATERVA_ERROR_NULL(requests);
+
+    for (int64_t n = 0; n < nrequests; ++n) {
+        caterva_slice_request_t *request = &requests[n];
+        CATERVA_ERROR_NULL(request->buffer);
+        int64_t size = 1;
+        for (int i = 0; i < array->ndim; ++i) {
+            if (request->start[i] < 0 || request->stop[i] > array->shape[i] ||
+                request->stop[i] - request->start[i] > request->shape[i]) {
+                DEBUG_PRINT("The slices must be inside the array and fit in their buffers");
+                CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+            }
+            size *= request->shape[i];
+        }
+        if (request->buffersize < size * array->itemsize) {
+            CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+        }
+    }
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_get_slice_buffers(ctx, array, requests, nrequests));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            // There is nothing to decompress, so the slices are just copied one by one
+            for (int64_t n = 0; n < nrequests; ++n) {
+                caterva_slice_request_t *request = &requests[n];
+                CATERVA_ERROR(caterva_plainbuffer_array_get_slice_buffer(
+                    ctx, array, request->start, request->stop, request->shape,
+                    request->buffer));
+            }
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+// Check that the points are inside the array and that their values fit in the buffer
+static int caterva_check_points(caterva_array_t *array, const int64_t *coords, int64_t npoints,
+                                int64_t buffersize) {
+    if (npoints < 0 || buffersize < npoints * array->itemsize) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    for (int64_t n = 0; n < npoints; ++n) {
+        for (int i = 0; i < array->ndim; ++i) {
+            int64_t coord = coords[n * array->ndim + i];
+            if (coord < 0 || coord >= array->shape[i]) {
+                DEBUG_PRINT("The points must be inside the array");
+                CATERVA_ERROR(CATERVA_ERR_INVALID_INDEX);
+            }
+        }
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_get_points(caterva_ctx_t *ctx, caterva_array_t *array, const int64_t *coords,
+                       int64_t npoints, void *buffer, int64_t buffersize) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(coords);
+    CATERVA_ERROR_NULL(buffer);
+
+    CATERVA_ERROR(caterva_check_points(array, coords, npoints, buffersize));
+    if (npoints == 0) {
+        return CATERVA_SUCCEED;
+    }
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_get_points(ctx, array, coords, npoints, buffer));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            CATERVA_ERROR(
+                caterva_plainbuffer_array_get_points(ctx, array, coords, npoints, buffer));
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_set_points(caterva_ctx_t *ctx, caterva_array_t *array, const int64_t *coords,
+                       int64_t npoints, const void *buffer, int64_t buffersize) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(coords);
+    CATERVA_ERROR_NULL(buffer);
+
+    if (array->mmap != NULL || array->shared != NULL) {
+        CATERVA_ERROR(CATERVA_ERR_READ_ONLY);
+    }
+    CATERVA_ERROR(caterva_check_points(array, coords, npoints, buffersize));
+    if (npoints == 0) {
+        return CATERVA_SUCCEED;
+    }
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_set_points(ctx, array, coords, npoints, buffer));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            CATERVA_ERROR(
+                caterva_plainbuffer_array_set_points(ctx, array, coords, npoints, buffer));
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
 int caterva_set_slice_buffer(caterva_ctx_t *ctx, void *buffer, int64_t buffersize,
                              int64_t *start, int64_t *stop, caterva_array_t *array) {
     CATERVA_ERROR_NULL(ctx);
@@ -272,8 +539,16 @@ int caterva_set_slice_buffer(caterva_ctx_t *ctx, void *buffer, int64_t buffersiz
     CATERVA_ERROR_NULL(stop);
     CATERVA_ERROR_NULL(array);
 
+    if (array->mmap != NULL || array->shared != NULL) {
+        CATERVA_ERROR(CATERVA_ERR_READ_ONLY);
+    }
+
     int64_t size = 1;
     for (int i = 0; i < array->ndim; ++i) {
+        if (start[i] < 0 || start[i] > stop[i] || stop[i] > array->shape[i]) {
+            DEBUG_PRINT("The slice must be inside the array");
+            CATERVA_ERROR(CATERVA_ERR_INVALID_INDEX);
+        }
         size *= stop[i] - start[i];
     }
 
@@ -287,7 +562,8 @@ int caterva_set_slice_buffer(caterva_ctx_t *ctx, void *buffer, int64_t buffersiz
 
     switch (array->storage) {
         case CATERVA_STORAGE_BLOSC:
-            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+            CATERVA_ERROR(caterva_blosc_array_set_slice_buffer(ctx, buffer, size * array->itemsize,
+                                                               start, stop, array));
             break;
         case CATERVA_STORAGE_PLAINBUFFER:
             CATERVA_ERROR(caterva_plainbuffer_array_set_slice_buffer(
@@ -317,6 +593,9 @@ int caterva_get_slice(caterva_ctx_t *ctx, caterva_array_t *src, int64_t *start,
     }
 
     CATERVA_ERROR(caterva_empty(ctx, &params, storage, array));
+    if (src->fillvalue != NULL) {
+        CATERVA_ERROR(caterva_set_fillvalue(ctx, *array, src->fillvalue));
+    }
 
     if (src->nitems == 0 || (*array)->nitems == 0) {
         return CATERVA_SUCCEED;
@@ -342,6 +621,10 @@ int caterva_squeeze(caterva_ctx_t *ctx, caterva_array_t *array) {
     CATERVA_ERROR_NULL(ctx);
     CATERVA_ERROR_NULL(array);
 
+    if (array->mmap != NULL || array->shared != NULL) {
+        CATERVA_ERROR(CATERVA_ERR_READ_ONLY);
+    }
+
     switch (array->storage) {
         case CATERVA_STORAGE_BLOSC:
             CATERVA_ERROR(caterva_blosc_array_squeeze(ctx, array));
@@ -360,6 +643,10 @@ int caterva_squeeze_index(caterva_ctx_t *ctx, caterva_array_t *array, bool *inde
     CATERVA_ERROR_NULL(ctx);
     CATERVA_ERROR_NULL(array);
 
+    if (array->mmap != NULL || array->shared != NULL) {
+        CATERVA_ERROR(CATERVA_ERR_READ_ONLY);
+    }
+
     switch (array->storage) {
         case CATERVA_STORAGE_BLOSC:
             CATERVA_ERROR(caterva_blosc_array_squeeze_index(ctx, array, index));
@@ -374,6 +661,83 @@ int caterva_squeeze_index(caterva_ctx_t *ctx, caterva_array_t *array, bool *inde
     return CATERVA_SUCCEED;
 }
 
+int caterva_resize(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *new_shape) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(new_shape);
+
+    if (array->mmap != NULL || array->shared != NULL) {
+        CATERVA_ERROR(CATERVA_ERR_READ_ONLY);
+    }
+    bool same = true;
+    for (int i = 0; i < array->ndim; ++i) {
+        if (new_shape[i] < 0) {
+            CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+        }
+        same = same && new_shape[i] == array->shape[i];
+    }
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_resize(ctx, array, new_shape));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            CATERVA_ERROR(caterva_plainbuffer_array_resize(ctx, array, new_shape));
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    // The levels of the pyramid do not match the new shape. A failed resize keeps them.
+    if (!same) {
+        CATERVA_ERROR(caterva_pyramid_drop(ctx, array));
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_set_fillvalue(caterva_ctx_t *ctx, caterva_array_t *array, const void *fillvalue) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+
+    if (array->mmap != NULL || array->shared != NULL) {
+        CATERVA_ERROR(CATERVA_ERR_READ_ONLY);
+    }
+
+    // A fill value of zeros is the default, so it is not kept
+    uint8_t itemsize = (uint8_t) array->itemsize;
+    uint8_t *fillvalue_ = NULL;
+    if (fillvalue != NULL && !caterva_copy_is_constant(itemsize, fillvalue, 1, NULL)) {
+        fillvalue_ = ctx->cfg->alloc(itemsize);
+        CATERVA_ERROR_NULL(fillvalue_);
+        memcpy(fillvalue_, fillvalue, itemsize);
+    }
+
+    int rc = CATERVA_SUCCEED;
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            rc = caterva_blosc_array_set_fillvalue(array, fillvalue_);
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            // Plain buffers only keep it in memory
+            break;
+        default:
+            rc = CATERVA_ERR_INVALID_STORAGE;
+    }
+    if (rc != CATERVA_SUCCEED) {
+        if (fillvalue_ != NULL) {
+            ctx->cfg->free(fillvalue_);
+        }
+        CATERVA_ERROR(rc);
+    }
+    if (array->fillvalue != NULL) {
+        ctx->cfg->free(array->fillvalue);
+    }
+    array->fillvalue = fillvalue_;
+
+    return CATERVA_SUCCEED;
+}
+
 int caterva_copy(caterva_ctx_t *ctx, caterva_array_t *src, caterva_storage_t *storage,
                  caterva_array_t **array) {
     CATERVA_ERROR_NULL(ctx);
@@ -399,8 +763,287 @@ int caterva_copy(caterva_ctx_t *ctx, caterva_array_t *src, caterva_storage_t *st
         default:
             CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
     }
+    if (src->fillvalue != NULL) {
+        CATERVA_ERROR(caterva_set_fillvalue(ctx, *array, src->fillvalue));
+    }
     (*array)->filled = true;
     (*array)->empty = false;
 
     return CATERVA_SUCCEED;
 }
+
+int caterva_get_chunk_blocked(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *coords,
+                              void *buffer, int64_t buffersize, caterva_chunk_layout_t *layout) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(coords);
+    CATERVA_ERROR_NULL(layout);
+
+    for (int i = 0; i < array->ndim; ++i) {
+        if (coords[i] < 0 || coords[i] * array->chunkshape[i] >= array->shape[i]) {
+            CATERVA_ERROR(CATERVA_ERR_INVALID_INDEX);
+        }
+    }
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_get_chunk_blocked(ctx, array, coords, buffer,
+                                                                buffersize, layout));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            // Plain buffers are not split into blocks
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_set_cache_size(caterva_ctx_t *ctx, caterva_array_t *array, int64_t nbytes) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_set_cache_size(ctx, array, nbytes));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            // Plain buffers are not compressed, so there is nothing to cache
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_get_cache_stats(caterva_ctx_t *ctx, caterva_array_t *array,
+                            caterva_cache_stats_t *stats) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(stats);
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_get_cache_stats(ctx, array, stats));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            memset(stats, 0, sizeof(caterva_cache_stats_t));
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_get_chunk_stats(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *coords,
+                            caterva_stats_t *stats, caterva_stats_t *blockstats) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(coords);
+    CATERVA_ERROR_NULL(stats);
+
+    for (int i = 0; i < array->ndim; ++i) {
+        if (coords[i] < 0 || coords[i] * array->chunkshape[i] >= array->shape[i]) {
+            CATERVA_ERROR(CATERVA_ERR_INVALID_INDEX);
+        }
+    }
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_get_chunk_stats(ctx, array, coords, stats,
+                                                              blockstats));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            // Plain buffers do not keep statistics
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_get_slice_buffer_filtered(caterva_ctx_t *ctx, caterva_array_t *array,
+                                      int64_t *start, int64_t *stop, int64_t *shape,
+                                      const caterva_filter_t *filter, void *buffer,
+                                      int64_t buffersize, int64_t *nskipped) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(start);
+    CATERVA_ERROR_NULL(stop);
+    CATERVA_ERROR_NULL(shape);
+    CATERVA_ERROR_NULL(filter);
+    CATERVA_ERROR_NULL(buffer);
+
+    int64_t size = 1;
+    for (int i = 0; i < array->ndim; ++i) {
+        if (stop[i] - start[i] > shape[i]) {
+            DEBUG_PRINT("The buffer shape can not be smaller than the slice shape");
+            CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+        }
+        size *= shape[i];
+    }
+    if (buffersize < size * array->itemsize) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    int64_t nskipped_ = 0;
+    if (array->nitems != 0) {
+        switch (array->storage) {
+            case CATERVA_STORAGE_BLOSC:
+                CATERVA_ERROR(caterva_blosc_array_get_slice_buffer_filtered(
+                    ctx, array, start, stop, shape, filter, buffer, &nskipped_));
+                break;
+            case CATERVA_STORAGE_PLAINBUFFER:
+                // Plain buffers do not keep statistics
+                CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+                break;
+            default:
+                CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+        }
+    }
+    if (nskipped != NULL) {
+        *nskipped = nskipped_;
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_get_meta(caterva_ctx_t *ctx, caterva_array_t *array, uint8_t *meta, int32_t metasize,
+                     int32_t *metalen) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(metalen);
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_get_meta(ctx, array, meta, metasize, metalen));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            // Plain buffers do not have metalayers
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_check_meta(caterva_ctx_t *ctx, caterva_array_t *array, const uint8_t *meta,
+                       int32_t metalen, bool *compatible) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(meta);
+    CATERVA_ERROR_NULL(compatible);
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_check_meta(ctx, array, meta, metalen, compatible));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            // Plain buffers are not split into chunks
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_get_chunk_compressed(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *coords,
+                                 void *buffer, int64_t buffersize, int64_t *cbytes) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(coords);
+    CATERVA_ERROR_NULL(cbytes);
+
+    for (int i = 0; i < array->ndim; ++i) {
+        if (coords[i] < 0 || coords[i] * array->chunkshape[i] >= array->shape[i]) {
+            CATERVA_ERROR(CATERVA_ERR_INVALID_INDEX);
+        }
+    }
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_get_chunk_compressed(ctx, array, coords, buffer,
+                                                                   buffersize, cbytes));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            // Plain buffers are not compressed
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_set_chunk_compressed(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *coords,
+                                 const void *cchunk, int64_t cbytes) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(coords);
+    CATERVA_ERROR_NULL(cchunk);
+
+    if (array->mmap != NULL || array->shared != NULL) {
+        CATERVA_ERROR(CATERVA_ERR_READ_ONLY);
+    }
+
+    if (!array->filled) {
+        DEBUG_PRINT("The array must be filled (e.g. using caterva_zeros) before setting chunks");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    for (int i = 0; i < array->ndim; ++i) {
+        if (coords[i] < 0 || coords[i] * array->chunkshape[i] >= array->shape[i]) {
+            CATERVA_ERROR(CATERVA_ERR_INVALID_INDEX);
+        }
+    }
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_set_chunk_compressed(ctx, array, coords, cchunk,
+                                                                   cbytes));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            // Plain buffers are not compressed
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_track_versions(caterva_ctx_t *ctx, caterva_array_t *array) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+
+    if (array->mmap != NULL || array->shared != NULL) {
+        CATERVA_ERROR(CATERVA_ERR_READ_ONLY);
+    }
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_array_track_versions(ctx, array));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            // Plain buffers are not split into chunks
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    return CATERVA_SUCCEED;
+}
@@ -23,6 +23,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /* Version numbers */
 #define CATERVA_VERSION_MAJOR 0         /* for major interface/format changes  */
 #define CATERVA_VERSION_MINOR 4         /* for minor interface/format changes  */
@@ -39,6 +43,9 @@
 #define CATERVA_ERR_INVALID_STORAGE 4
 #define CATERVA_ERR_NULL_POINTER 5
 #define CATERVA_ERR_INVALID_INDEX  5
+#define CATERVA_ERR_THREADS_FAILED 6
+#define CATERVA_ERR_READ_ONLY 7
+#define CATERVA_ERR_QUEUE_FULL 8
 
 #ifdef NDEBUG
 #define DEBUG_PRINT(...) \
@@ -73,8 +80,8 @@
 #define CATERVA_ATTRIBUTE_UNUSED
 #endif
 
-static char *print_error(int rc) CATERVA_ATTRIBUTE_UNUSED;
-static char *print_error(int rc) {
+static const char *print_error(int rc) CATERVA_ATTRIBUTE_UNUSED;
+static const char *print_error(int rc) {
     switch (rc) {
         case CATERVA_ERR_INVALID_STORAGE:
             return "Invalid storage";
@@ -82,6 +89,12 @@ static char *print_error(int rc) {
             return "Pointer is null";
         case CATERVA_ERR_BLOSC_FAILED:
             return "Blosc failed";
+        case CATERVA_ERR_THREADS_FAILED:
+            return "Threads failed";
+        case CATERVA_ERR_READ_ONLY:
+            return "Array is read-only";
+        case CATERVA_ERR_QUEUE_FULL:
+            return "Queue is full";
         default:
             return "Unknown error";
     }
@@ -96,6 +109,14 @@ static char *print_error(int rc) {
 /* The maximum number of metalayers for caterva arrays */
 #define CATERVA_MAX_METALAYERS BLOSC2_MAX_METALAYERS - 1
 
+/* The maximum number of downsampled levels of the pyramid of an array */
+#define CATERVA_MAX_PYRAMID_LEVELS 16
+
+/**
+ * @brief A pool of worker threads that can be shared by several contexts (opaque).
+ */
+typedef struct caterva_threadpool_s caterva_threadpool_t;
+
 /**
  * @brief Configuration parameters used to create a caterva context.
  */
@@ -111,7 +132,8 @@ typedef struct {
     int usedict;
     //!< Indicates whether a dict is used to compress data or not.
     int nthreads;
-    //!< Determines the maximum number of threads that can be used.
+    //!< Determines the maximum number of threads that can be used. When it is greater than 1,
+    //!< caterva also gathers and compresses different chunks in parallel.
     uint8_t filters[BLOSC2_MAX_FILTERS];
     //!< Defines the filters used in compression.
     uint8_t filtersmeta[BLOSC2_MAX_FILTERS];
@@ -120,6 +142,13 @@ typedef struct {
     //!< Defines the function that is applied to the data before compressing it.
     blosc2_prefilter_params *pparams;
     //!< Indicates the parameters of the prefilter function.
+    int64_t poolsize;
+    //!< The maximum memory (in bytes) of the scratch buffers kept by the context for reuse. If it
+    //!< is 0, scratch buffers are freed as soon as they are released.
+    caterva_threadpool_t *threadpool;
+    //!< The thread pool where the parallel work is run. If it is NULL, the threads are created by
+    //!< every call. Otherwise, the calls split their work in up to @p nthreads tasks that are run
+    //!< by the workers of the pool, and Blosc uses a single thread.
 } caterva_config_t;
 
 /**
@@ -134,7 +163,76 @@ static const caterva_config_t CATERVA_CONFIG_DEFAULTS = {.alloc = malloc,
                                                          .filters = {0, 0, 0, 0, 0, BLOSC_SHUFFLE},
                                                          .filtersmeta = {0, 0, 0, 0, 0, 0},
                                                          .prefilter = NULL,
-                                                         .pparams = NULL};
+                                                         .pparams = NULL,
+                                                         .poolsize = 64 * 1024 * 1024,
+                                                         .threadpool = NULL};
+
+/**
+ * @brief A pool of scratch buffers (opaque).
+ */
+typedef struct caterva_pool_s caterva_pool_t;
+
+/**
+ * @brief The statistics of the scratch pool of a context.
+ */
+typedef struct {
+    int64_t hits;
+    //!< Number of scratch buffers reused from the pool.
+    int64_t misses;
+    //!< Number of scratch buffers that had to be allocated.
+    int64_t drops;
+    //!< Number of released buffers that were freed because the pool was full.
+    int64_t nbytes;
+    //!< The memory (in bytes) of the idle buffers kept for reuse.
+} caterva_pool_stats_t;
+
+/**
+ * @brief The placements of the workers of a thread pool on the cores.
+ */
+typedef enum {
+    CATERVA_AFFINITY_NONE,
+    //!< The workers are not pinned, so they are placed by the operating system.
+    CATERVA_AFFINITY_COMPACT,
+    //!< The workers are pinned to consecutive cores, filling a NUMA node before the next one.
+    CATERVA_AFFINITY_SCATTER,
+    //!< The workers are pinned to cores of the NUMA nodes in turn.
+    CATERVA_AFFINITY_LIST,
+    //!< The workers are pinned to the cores given in the parameters.
+} caterva_affinity_t;
+
+/**
+ * @brief The parameters used to create a thread pool.
+ */
+typedef struct {
+    int nthreads;
+    //!< The number of workers.
+    caterva_affinity_t affinity;
+    //!< The placement of the workers on the cores.
+    const int *cpus;
+    //!< The cores of @p CATERVA_AFFINITY_LIST. The worker i is pinned to `cpus[i % ncpus]`.
+    int ncpus;
+    //!< The number of cores in @p cpus.
+} caterva_threadpool_params_t;
+
+/**
+ * @brief The statistics of a thread pool.
+ */
+typedef struct {
+    int nthreads;
+    //!< The number of workers.
+    int nnodes;
+    //!< The number of NUMA nodes where the workers are placed.
+    int64_t queued;
+    //!< The number of tasks waiting to be run (the depth of the queues).
+    int64_t maxqueued;
+    //!< The maximum depth of the queues so far.
+    int64_t running;
+    //!< The number of tasks being run.
+    int64_t ntasks;
+    //!< The number of tasks completed.
+    int64_t nsteals;
+    //!< The number of tasks run by a worker other than the one they were queued to.
+} caterva_threadpool_stats_t;
 
 /**
  * @brief Context for caterva arrays that specifies the functions used to manage memory and
@@ -143,6 +241,8 @@ static const caterva_config_t CATERVA_CONFIG_DEFAULTS = {.alloc = malloc,
 typedef struct {
     caterva_config_t *cfg;
     //!< The configuration paramters.
+    caterva_pool_t *pool;
+    //!< The pool where the scratch buffers of the calls are taken from.
 } caterva_ctx_t;
 
 /**
@@ -155,6 +255,38 @@ typedef enum {
     //!< Indicates that the data is stored using a plain buffer.
 } caterva_storage_backend_t;
 
+/**
+ * @brief The access patterns that can be advised when an array is memory-mapped.
+ */
+typedef enum {
+    CATERVA_ACCESS_NORMAL,
+    //!< No particular access pattern.
+    CATERVA_ACCESS_SEQUENTIAL,
+    //!< The chunks are read in order, so they can be read ahead aggressively.
+    CATERVA_ACCESS_RANDOM,
+    //!< The chunks are read in random order, so only the chunks read are loaded.
+    CATERVA_ACCESS_AUTO,
+    //!< The access pattern is deduced from the slices read.
+} caterva_access_t;
+
+/**
+ * @brief The types of the items of an array, used to interpret their values.
+ */
+typedef enum {
+    CATERVA_DTYPE_NONE,
+    //!< The items are opaque.
+    CATERVA_DTYPE_INT8,
+    CATERVA_DTYPE_INT16,
+    CATERVA_DTYPE_INT32,
+    CATERVA_DTYPE_INT64,
+    CATERVA_DTYPE_UINT8,
+    CATERVA_DTYPE_UINT16,
+    CATERVA_DTYPE_UINT32,
+    CATERVA_DTYPE_UINT64,
+    CATERVA_DTYPE_FLOAT32,
+    CATERVA_DTYPE_FLOAT64,
+} caterva_dtype_t;
+
 /**
  * @brief The metalayer data needed to store it on an array
  */
@@ -184,6 +316,9 @@ typedef struct {
     //!< List with the metalayers desired.
     int32_t nmetalayers;
     //!< The number of metalayers.
+    caterva_dtype_t stats;
+    //!< The type of the items. If it is not @p CATERVA_DTYPE_NONE, the minimum and maximum of
+    //!< every chunk and block are kept in the @p caterva_stats metalayer.
 } caterva_storage_properties_blosc_t;
 
 /**
@@ -192,13 +327,14 @@ typedef struct {
 typedef struct {
     char *urlpath;
     //!< The plain buffer name. If @p urlpath is not @p NULL, the plain buffer will be stored on
-    //!< disk. (Not implemented yet).
+    //!< disk, in a raw file (with a small header) that is memory-mapped instead of being held in
+    //!< RAM.
 } caterva_storage_properties_plainbuffer_t;
 
 /**
  * @brief The storage properties for an array.
  */
-typedef union {
+typedef struct {
     caterva_storage_properties_blosc_t blosc;
     //!< The storage properties when the array is backed by a Blosc super-chunk.
     caterva_storage_properties_plainbuffer_t plainbuffer;
@@ -228,17 +364,333 @@ typedef struct {
 } caterva_params_t;
 
 /**
- * @brief An *optional* cache for a single block.
+ * @brief The dominant access patterns that the chunk and block shapes can be tuned for.
+ */
+typedef enum {
+    CATERVA_PATTERN_BOXES,
+    //!< N-dimensional boxes (of the advised box shape, if any).
+    CATERVA_PATTERN_ROWS,
+    //!< Scans along the last dimension.
+    CATERVA_PATTERN_COLUMNS,
+    //!< Scans along the first dimension.
+} caterva_pattern_t;
+
+/**
+ * @brief The hints used to advise the chunk and block shapes of an array. The fields that are 0
+ * take a default value, so a zero-initialized struct is a valid advice.
+ */
+typedef struct {
+    int64_t l1size;
+    //!< The size (in bytes) of the L1 data cache. If it is 0, it is detected.
+    int64_t l2size;
+    //!< The size (in bytes) of the L2 cache. If it is 0, it is detected.
+    int64_t l3size;
+    //!< The size (in bytes) of the L3 cache. If it is 0, it is detected.
+    int nreaders;
+    //!< The number of threads that will read the array at the same time. If it is 0, the number of
+    //!< threads of the context is used.
+    caterva_pattern_t pattern;
+    //!< The dominant access pattern.
+    int64_t boxshape[CATERVA_MAX_DIM];
+    //!< The shape of the boxes read when @p pattern is @p CATERVA_PATTERN_BOXES. If it is all 0,
+    //!< the boxes are assumed to be hypercubes.
+    void *sample;
+    //!< A sample of the data in a C buffer. If it is not NULL, the candidate shapes are
+    //!< benchmarked against it (compressing with the codec of the context) and the fastest one
+    //!< is advised.
+    int64_t samplesize;
+    //!< The size (in bytes) of @p sample.
+    int64_t sampleshape[CATERVA_MAX_DIM];
+    //!< The shape of @p sample.
+} caterva_advice_t;
+
+/**
+ * @brief A cache of decompressed chunks (opaque).
+ */
+typedef struct caterva_cache_s caterva_cache_t;
+
+/**
+ * @brief A lock used internally to serialize the updates of an array (opaque).
+ */
+typedef struct caterva_lock_s caterva_lock_t;
+
+/**
+ * @brief A memory mapping of a file (opaque).
+ */
+typedef struct caterva_mmap_s caterva_mmap_t;
+
+/**
+ * @brief An opened array shared by the handles of @p caterva_open_shared (opaque).
+ */
+typedef struct caterva_shared_s caterva_shared_t;
+
+/**
+ * @brief An iterator over the chunks of an array (opaque).
+ */
+typedef struct caterva_iter_s caterva_iter_t;
+
+/**
+ * @brief One of the slices of a batch read.
+ */
+typedef struct {
+    int64_t start[CATERVA_MAX_DIM];
+    //!< The coordinates where the slice begins.
+    int64_t stop[CATERVA_MAX_DIM];
+    //!< The coordinates where the slice ends.
+    int64_t shape[CATERVA_MAX_DIM];
+    //!< The shape of the buffer.
+    void *buffer;
+    //!< Pointer to the buffer where the data will be stored.
+    int64_t buffersize;
+    //!< The size (in bytes) of the buffer.
+} caterva_slice_request_t;
+
+/**
+ * @brief A handle for reading slices of an array from a single thread (opaque).
+ */
+typedef struct caterva_reader_s caterva_reader_t;
+
+/**
+ * @brief An executor running asynchronous requests in a pool of threads (opaque).
+ */
+typedef struct caterva_executor_s caterva_executor_t;
+
+/**
+ * @brief The state of an asynchronous request (opaque).
+ */
+typedef struct caterva_future_s caterva_future_t;
+
+/**
+ * @brief An appender compressing and appending data to an array in the background (opaque).
+ */
+typedef struct caterva_appender_s caterva_appender_t;
+
+/**
+ * @brief The function called when an asynchronous request finishes.
+ *
+ * It is called from a thread of the executor, so it must not block for long; e.g., it can write
+ * to an eventfd or a pipe that is polled by an event loop.
+ *
+ * @param arg The argument given with the request.
+ * @param rc The error code of the request.
+ */
+typedef void (*caterva_callback_t)(void *arg, int rc);
+
+/**
+ * @brief A region of an array returned by a chunk iterator.
+ */
+typedef struct {
+    int64_t nchunk;
+    //!< The position of the chunk in the storage order.
+    int64_t coords[CATERVA_MAX_DIM];
+    //!< The coordinates of the chunk (in chunks, not in items).
+    int64_t start[CATERVA_MAX_DIM];
+    //!< The coordinates (in items) of the first item of the region.
+    int64_t shape[CATERVA_MAX_DIM];
+    //!< The shape of the region. It is the chunkshape, clipped at the borders of the array.
+    void *buffer;
+    //!< The items of the region in C order. It is only valid until the next call to
+    //!< @p caterva_iter_next or @p caterva_iter_free, and must not be modified.
+    int64_t buffersize;
+    //!< The size (in bytes) of the region.
+} caterva_iter_region_t;
+
+/**
+ * @brief The statistics of the decompressed-chunk cache of an array.
+ */
+typedef struct {
+    int64_t hits;
+    //!< Number of chunk reads served without decompressing any block.
+    int64_t misses;
+    //!< Number of chunk reads that needed to decompress some block.
+    int64_t evictions;
+    //!< Number of chunks evicted to make room for other chunks.
+    int64_t nbytes;
+    //!< The memory (in bytes) allocated for the cached chunks.
+} caterva_cache_stats_t;
+
+/**
+ * @brief The layout of a chunk decompressed in its internal (blocked) order.
  *
- * When a chunk is needed, it is copied into this cache. In this way, if the same chunk is needed
- * again afterwards, it is not necessary to recover it because it is already in the cache.
+ * The chunk is made of @p nblocks blocks of @p blocknitems items each, stored one after the other
+ * in C order of the grid of blocks (@p extchunkshape / @p blockshape). The items of each block are
+ * stored in C order too.
+ */
+typedef struct {
+    int8_t ndim;
+    //!< Data dimensions.
+    int8_t itemsize;
+    //!< Size of each item.
+    int64_t start[CATERVA_MAX_DIM];
+    //!< The coordinates (in items) of the first item of the chunk in the array.
+    int64_t shape[CATERVA_MAX_DIM];
+    //!< The shape of the part of the chunk inside the array. The rest of the chunk is padding.
+    int64_t extchunkshape[CATERVA_MAX_DIM];
+    //!< The shape of the padded chunk, a multiple of @p blockshape.
+    int32_t blockshape[CATERVA_MAX_DIM];
+    //!< The shape of each block.
+    int32_t blocknitems;
+    //!< Number of items in each block.
+    int64_t nblocks;
+    //!< Number of blocks in the chunk.
+    int64_t nbytes;
+    //!< The size (in bytes) of the decompressed chunk.
+    bool contiguous;
+    //!< Indicate if the blocked order is the same as the C order of @p extchunkshape.
+} caterva_chunk_layout_t;
+
+/**
+ * @brief The statistics of a chunk or a block of an array.
+ */
+typedef struct {
+    double min;
+    //!< The minimum value (NaNs are ignored).
+    double max;
+    //!< The maximum value (NaNs are ignored).
+    int64_t nnan;
+    //!< Number of NaNs. It is always 0 for integer types.
+    int64_t nitems;
+    //!< Number of items summarized (padding excluded).
+} caterva_stats_t;
+
+/**
+ * @brief A range of values used to skip the chunks and blocks that do not contain any of them.
+ */
+typedef struct {
+    double low;
+    //!< The lowest value of interest (inclusive).
+    double high;
+    //!< The highest value of interest (inclusive).
+} caterva_filter_t;
+
+/**
+ * @brief The index with the statistics of the chunks and blocks of an array (opaque).
+ */
+typedef struct caterva_stats_index_s caterva_stats_index_t;
+
+/**
+ * @brief The versions of the chunks of an array (opaque).
+ */
+typedef struct caterva_versions_s caterva_versions_t;
+
+/**
+ * @brief The elementwise operations of the expressions.
+ */
+typedef enum {
+    CATERVA_OP_ADD,
+    CATERVA_OP_SUB,
+    CATERVA_OP_MUL,
+    CATERVA_OP_DIV,
+    CATERVA_OP_MIN,
+    CATERVA_OP_MAX,
+} caterva_op_t;
+
+/**
+ * @brief The reductions of the expressions.
+ */
+typedef enum {
+    CATERVA_REDUCE_SUM,
+    CATERVA_REDUCE_MIN,
+    CATERVA_REDUCE_MAX,
+} caterva_reduce_t;
+
+/**
+ * @brief A lazy expression over arrays, evaluated chunk by chunk (opaque).
+ */
+typedef struct caterva_expr_s caterva_expr_t;
+
+/**
+ * @brief The ways of computing the items of a level of a pyramid from the boxes of items of the
+ * previous level.
+ */
+typedef enum {
+    CATERVA_DOWNSAMPLE_STRIDE,
+    //!< The first item of every box, i.e. the items are just strided.
+    CATERVA_DOWNSAMPLE_MEAN,
+    //!< The mean of the items of every box (rounded to the nearest integer for integer types).
+    CATERVA_DOWNSAMPLE_MAX,
+    //!< The maximum of the items of every box.
+} caterva_downsample_t;
+
+/**
+ * @brief Parameters for building the pyramid of an array.
+ */
+typedef struct {
+    int nlevels;
+    //!< The number of downsampled levels, from 1 to @p CATERVA_MAX_PYRAMID_LEVELS.
+    int32_t factors[CATERVA_MAX_DIM];
+    //!< The downsampling factor of every dimension from a level to the next one. If it is 0, the
+    //!< factor is 2; if it is 1, the dimension is not downsampled.
+    caterva_downsample_t method;
+    //!< The way of computing the items of every level.
+    caterva_dtype_t dtype;
+    //!< The type of the items. Its size must be the itemsize of the array, unless @p method is
+    //!< @p CATERVA_DOWNSAMPLE_STRIDE (then it is not used).
+} caterva_pyramid_params_t;
+
+/**
+ * @brief The downsampled levels of an array (opaque).
+ */
+typedef struct caterva_pyramid_s caterva_pyramid_t;
+
+/**
+ * @brief The phases of the work done on an array that are timed by its counters.
+ */
+typedef enum {
+    CATERVA_PHASE_READ,
+    //!< Getting compressed chunks from the super-chunk (i.e. from disk, for arrays on disk).
+    CATERVA_PHASE_DECOMPRESS,
+    //!< Decompressing chunks (or some of their blocks).
+    CATERVA_PHASE_COPY,
+    //!< Gathering and scattering items between chunks and buffers.
+    CATERVA_PHASE_COMPRESS,
+    //!< Compressing chunks.
+    CATERVA_PHASE_APPEND,
+    //!< Storing chunks into the super-chunk. It includes their compression when they are
+    //!< compressed by Blosc itself (e.g. in @p caterva_append).
+    CATERVA_NPHASES,
+    //!< Number of phases.
+} caterva_phase_t;
+
+/**
+ * @brief The performance counters of an array.
  */
-struct chunk_cache_s {
-    uint8_t *data;
-    //!< Pointer to the chunk data.
-    int32_t nchunk;
-    //!< The chunk number in cache. If @p nchunk equals to -1, it means that the cache is empty.
-};
+typedef struct {
+    int64_t nchunks_requested;
+    //!< Number of chunks touched by the slices read.
+    int64_t nchunks_decompressed;
+    //!< Number of chunks decompressed (in whole or in part).
+    int64_t nblocks_requested;
+    //!< Number of blocks touched by the slices read.
+    int64_t nblocks_decompressed;
+    //!< Number of blocks decompressed.
+    int64_t nbytes_read;
+    //!< Compressed bytes got from the super-chunk.
+    int64_t nbytes_decompressed;
+    //!< Bytes produced by the decompression.
+    int64_t nbytes_copied;
+    //!< Bytes gathered or scattered.
+    int64_t nbytes_compressed;
+    //!< Bytes given to the compression.
+    int64_t nbytes_written;
+    //!< Bytes stored into the super-chunk (before compression, if Blosc compresses them).
+    int64_t cache_hits;
+    //!< Number of chunk reads served by the decompressed-chunk cache without decompressing.
+    int64_t cache_misses;
+    //!< Number of chunk reads that were not served (completely) by the cache.
+    int64_t nscratch;
+    //!< Number of scratch buffers taken for the array.
+    int64_t ncalls[CATERVA_NPHASES];
+    //!< Number of times that every phase has been run.
+    int64_t nsecs[CATERVA_NPHASES];
+    //!< Cumulative time (in nanoseconds) of every phase. When several threads work on the array,
+    //!< their times are added.
+} caterva_counters_t;
+
+/**
+ * @brief The performance counters of an array and its trace function (opaque).
+ */
+typedef struct caterva_instr_s caterva_instr_t;
 
 /**
  * @brief A multidimensional array of data that can be compressed data.
@@ -287,10 +739,48 @@ typedef struct {
     //!< Indicate if an array is completely filled or not.
     int64_t nchunks;
     //!< Number of chunks in the array.
-    struct chunk_cache_s chunk_cache;
-    //!< A partition cache.
+    caterva_cache_t *cache;
+    //!< The decompressed-chunk cache. It is NULL if the cache is disabled.
+    caterva_lock_t *lock;
+    //!< The lock serializing the chunk updates of the super-chunk.
+    //!< Only is used if \p storage equals to @p CATERVA_STORAGE_BLOSC.
+    caterva_mmap_t *mmap;
+    //!< The mapping of the file where the super-chunk is stored. If it is not NULL, the array is
+    //!< read-only.
+    caterva_stats_index_t *stats;
+    //!< The statistics of the chunks and blocks. It is NULL if they are not kept.
+    caterva_mmap_t *bufmap;
+    //!< The read-write mapping of the file where the plain buffer is stored (@p buf points into
+    //!< it). It is NULL if the plain buffer is held in memory.
+    //!< Only is used if \p storage equals to @p CATERVA_STORAGE_PLAINBUFFER.
+    caterva_instr_t *instr;
+    //!< The performance counters. It is NULL if they are disabled.
+    uint8_t *fillvalue;
+    //!< The value of the items that are not set by the user. It is NULL if it is 0.
+    caterva_versions_t *versions;
+    //!< The versions of the chunks. It is NULL if they are not tracked.
+    caterva_shared_t *shared;
+    //!< The opened array whose super-chunk (with its mapping, lock, statistics and versions) is
+    //!< shared with other handles. If it is not NULL, the array is read-only.
+    caterva_pyramid_t *pyramid;
+    //!< The downsampled levels. It is NULL if they have not been built (or opened yet).
 } caterva_array_t;
 
+/**
+ * @brief The function called every time that a phase of the work on an array finishes.
+ *
+ * It is called from the thread that has run the phase, so it must be thread-safe and fast.
+ *
+ * @param arg The argument given with the function.
+ * @param array Pointer to the caterva array.
+ * @param phase The phase.
+ * @param start The time when the phase started, in nanoseconds since the counters were enabled.
+ * @param nsecs The duration of the phase in nanoseconds.
+ * @param nbytes The bytes processed in the phase.
+ */
+typedef void (*caterva_trace_fn)(void *arg, caterva_array_t *array, caterva_phase_t phase,
+                                 int64_t start, int64_t nsecs, int64_t nbytes);
+
 /**
  * @brief Create a context for caterva.
  *
@@ -310,6 +800,73 @@ int caterva_ctx_new(caterva_config_t *cfg, caterva_ctx_t **ctx);
  */
 int caterva_ctx_free(caterva_ctx_t **ctx);
 
+/**
+ * @brief Get the statistics of the scratch pool of a context.
+ *
+ * The scratch buffers needed by the calls (e.g. for decompressing or repartitioning chunks) are
+ * taken from a pool owned by the context, so they are reused instead of being allocated every
+ * time. Its footprint is bounded by the `poolsize` of the configuration.
+ *
+ * @param ctx Pointer to the caterva context.
+ * @param stats Pointer to the place where the statistics will be stored.
+ *
+ * @return An error code.
+ */
+int caterva_ctx_get_pool_stats(caterva_ctx_t *ctx, caterva_pool_stats_t *stats);
+
+/**
+ * @brief Create a thread pool.
+ *
+ * The pool is used by the contexts whose configuration points to it, so the arrays of all of them
+ * share the same workers instead of creating their own threads. Every worker has its own queue of
+ * tasks, and it takes the tasks of the other queues (preferably from the same NUMA node) when
+ * its queue is empty. The tasks submitted from a thread are queued to the workers of its NUMA
+ * node, if any. The pool must be freed after the contexts using it.
+ *
+ * @param params Pointer to the parameters of the pool.
+ * @param pool Pointer to the place where the pool will be created.
+ *
+ * @return An error code.
+ */
+int caterva_threadpool_new(caterva_threadpool_params_t *params, caterva_threadpool_t **pool);
+
+/**
+ * @brief Free a thread pool, waiting for its workers to finish the queued tasks.
+ *
+ * @param pool Pointer to the pointer to the pool to be freed.
+ *
+ * @return An error code.
+ */
+int caterva_threadpool_free(caterva_threadpool_t **pool);
+
+/**
+ * @brief Get the statistics of a thread pool.
+ *
+ * @param pool Pointer to the thread pool.
+ * @param stats Pointer to the place where the statistics will be stored.
+ *
+ * @return An error code.
+ */
+int caterva_threadpool_get_stats(caterva_threadpool_t *pool, caterva_threadpool_stats_t *stats);
+
+/**
+ * @brief Advise the chunk and block shapes of an array backed by a Blosc super-chunk.
+ *
+ * The blocks are sized to fit in the L2 cache and the chunks to share the L3 cache between the
+ * readers (while keeping at least one chunk per reader), and both are shaped after the access
+ * pattern. The shapes are adjusted to reduce the padding in the edges of the array.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param params The general params of the array.
+ * @param advice The hints about the hardware and the access pattern.
+ * @param storage The storage params of the array, where the advised chunk and block shapes are
+ * set. The rest of its fields are not changed.
+ *
+ * @return An error code.
+ */
+int caterva_advise_shapes(caterva_ctx_t *ctx, caterva_params_t *params, caterva_advice_t *advice,
+                          caterva_storage_t *storage);
+
 /**
  * @brief Create an empty array.
  *
@@ -323,6 +880,23 @@ int caterva_ctx_free(caterva_ctx_t **ctx);
 int caterva_empty(caterva_ctx_t *ctx, caterva_params_t *params,
                   caterva_storage_t *storage, caterva_array_t **array);
 
+/**
+ * @brief Create an array filled with zeros.
+ *
+ * If the array is backed by a Blosc super-chunk, every chunk is stored as a special zero chunk,
+ * which only takes the space of a chunk header. The chunks can then be written in any order with
+ * @p caterva_set_chunk.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param params Pointer to the general params of the array desired.
+ * @param storage Pointer to the storage params of the array desired.
+ * @param array Pointer to the memory pointer where the array will be created.
+ *
+ * @return An error code.
+ */
+int caterva_zeros(caterva_ctx_t *ctx, caterva_params_t *params,
+                  caterva_storage_t *storage, caterva_array_t **array);
+
 /**
  * @brief Free an array.
  *
@@ -346,6 +920,25 @@ int caterva_free(caterva_ctx_t *ctx, caterva_array_t **array);
 int caterva_append(caterva_ctx_t *ctx, caterva_array_t *array, void *chunk,
                    int64_t chunksize);
 
+/**
+ * @brief Write a chunk at the given chunk coordinates of a filled array (e.g. one created with
+ * @p caterva_zeros).
+ *
+ * Chunks can be written in any order and from different threads at the same time. Each call
+ * compresses its chunk on its own; only the final insertion in the super-chunk is serialized.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param coords The coordinates of the chunk (in chunks, not in items).
+ * @param chunk Pointer to the chunk data. The chunks at the borders of the array must only contain
+ * the items inside the array, as in @p caterva_append.
+ * @param chunksize The size (in bytes) of the chunk.
+ *
+ * @return An error code.
+ */
+int caterva_set_chunk(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *coords, void *chunk,
+                      int64_t chunksize);
+
 /**
  * @brief Create a caterva array from a super-chunk. It can only be used if the array
  * is backed by a blosc super-chunk.
@@ -376,6 +969,9 @@ int caterva_from_serial_schunk(caterva_ctx_t *ctx, uint8_t *serial_schunk, int64
 /**
  * @brief Read a caterva array from disk.
  *
+ * Plain buffers stored on disk are memory-mapped for reading and writing, so their data is not
+ * loaded in memory.
+ *
  * @param ctx Pointer to the caterva context to be used.
  * @param urlpath The urlpath of the caterva array on disk.
  * @param array Pointer to the memory pointer where the array will be created.
@@ -384,6 +980,43 @@ int caterva_from_serial_schunk(caterva_ctx_t *ctx, uint8_t *serial_schunk, int64
  */
 int caterva_open(caterva_ctx_t *ctx, const char *urlpath, caterva_array_t **array);
 
+/**
+ * @brief Read a caterva array from disk by memory-mapping it.
+ *
+ * The file is mapped read-only and shared, so that every process reading the same array uses the
+ * same page cache, and the chunks are decompressed straight out of the mapped pages. The array
+ * can not be modified (@p CATERVA_ERR_READ_ONLY is returned). Only contiguous (sequential) frames
+ * can be mapped; other frames are read as in @p caterva_open.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param urlpath The urlpath of the caterva array on disk.
+ * @param access The access pattern advised to the kernel for the mapping.
+ * @param array Pointer to the memory pointer where the array will be created.
+ *
+ * @return An error code.
+ */
+int caterva_open_mmap(caterva_ctx_t *ctx, const char *urlpath, caterva_access_t access,
+                      caterva_array_t **array);
+
+/**
+ * @brief Read a caterva array from disk, sharing it with the other handles of the same file.
+ *
+ * The array is opened once per process: the first handle opens it as @p caterva_open_mmap does,
+ * and the next ones (with the same or another context) share its super-chunk, so the metadata is
+ * not parsed again and the chunk offsets are loaded once for all of them. Every handle has its
+ * own cache and performance counters, and it can be read from a different thread. The array is
+ * closed when the last handle is freed with @p caterva_free. The handles are read-only
+ * (@p CATERVA_ERR_READ_ONLY is returned), and the file must not be modified while they are
+ * open. Plain buffers stored on disk are not shared; they are opened as in @p caterva_open.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param urlpath The urlpath of the caterva array on disk.
+ * @param array Pointer to the memory pointer where the array will be created.
+ *
+ * @return An error code.
+ */
+int caterva_open_shared(caterva_ctx_t *ctx, const char *urlpath, caterva_array_t **array);
+
 /**
  * @brief Create a caterva array from the data stored in a buffer.
  *
@@ -455,6 +1088,42 @@ int caterva_squeeze_index(caterva_ctx_t *ctx, caterva_array_t *array,
  */
 int caterva_squeeze(caterva_ctx_t *ctx, caterva_array_t *array);
 
+/**
+ * @brief Resize a caterva array
+ *
+ * This function changes the shape of a caterva array, keeping its number of dimensions and its
+ * chunk and block shapes. The chunks that remain in the array are not recompressed (except the
+ * ones at the old borders that grow); the new chunks are appended or inserted in the super-chunk
+ * and the chunks that fall outside the new shape are dropped.
+ *
+ * The items that enter the array take the fill value of the array (see @p caterva_set_fillvalue).
+ * The pyramid of the array, if any, is dropped.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array. It must be filled.
+ * @param new_shape The new shape of the array.
+ *
+ * @return An error code
+ */
+int caterva_resize(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *new_shape);
+
+/**
+ * @brief Set the fill value of a caterva array.
+ *
+ * The fill value is the value of the items that are not set by the user: the padding of the
+ * chunks written from then on and the items added by @p caterva_resize. It is 0 by default. For
+ * Blosc arrays it is kept in the @p caterva_fill metalayer; plain buffers only keep it in memory.
+ * Slices and copies of an array take its fill value.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param fillvalue Pointer to the fill value (of @p itemsize bytes). If it is NULL, the fill value
+ * goes back to 0.
+ *
+ * @return An error code
+ */
+int caterva_set_fillvalue(caterva_ctx_t *ctx, caterva_array_t *array, const void *fillvalue);
+
 /**
  * @brief Get a slice from an array and store it into a C buffer.
  *
@@ -472,15 +1141,92 @@ int caterva_get_slice_buffer(caterva_ctx_t *ctx, caterva_array_t *src, int64_t *
                              int64_t *stop, int64_t *shape, void *buffer, int64_t buffersize);
 
 /**
- * @brief Set a slice into a caterva array from a C buffer. It can only be used if the array
- * is backed by a plainbuffer.
+ * @brief Get several slices from an array and store them into their C buffers.
+ *
+ * The chunks touched by the slices are grouped, so that every chunk is decompressed once (only the
+ * blocks needed by any of the slices) and copied into all the buffers of the slices touching it.
+ * This is much faster than separate @p caterva_get_slice_buffer calls when the slices are small and
+ * overlap. When @p nthreads is greater than 1, different chunks are processed in parallel.
  *
  * @param ctx Pointer to the caterva context to be used.
- * @param buffer Pointer to the buffer where the slice data is.
- * @param buffersize The size (in bytes) of the buffer.
- * @param start The coordinates where the slice will begin.
- * @param stop The coordinates where the slice will end.
- * @param array Pointer to the caterva array where the slice will be set
+ * @param array Pointer to the array from which the slices will be extracted.
+ * @param requests The slices to be read. Their buffers must not overlap.
+ * @param nrequests The number of slices.
+ *
+ * @return An error code.
+ */
+int caterva_get_slice_buffers(caterva_ctx_t *ctx, caterva_array_t *array,
+                              caterva_slice_request_t *requests, int64_t nrequests);
+
+/**
+ * @brief Get the values of scattered points of an array.
+ *
+ * The points are sorted by chunk and block, so that every block holding some point is
+ * decompressed only once.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param coords The coordinates of the points, one after the other (@p npoints x @p ndim).
+ * @param npoints The number of points.
+ * @param buffer Pointer to the buffer where the values will be stored, in the order of @p coords.
+ * @param buffersize The size (in bytes) of the buffer.
+ *
+ * @return An error code.
+ */
+int caterva_get_points(caterva_ctx_t *ctx, caterva_array_t *array, const int64_t *coords,
+                       int64_t npoints, void *buffer, int64_t buffersize);
+
+/**
+ * @brief Set the values of scattered points of an array.
+ *
+ * Every chunk holding some point is decompressed, updated and recompressed only once. If a point
+ * is repeated, the last value is kept.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array. It must be filled.
+ * @param coords The coordinates of the points, one after the other (@p npoints x @p ndim).
+ * @param npoints The number of points.
+ * @param buffer Pointer to the buffer with the values, in the order of @p coords.
+ * @param buffersize The size (in bytes) of the buffer.
+ *
+ * @return An error code.
+ */
+int caterva_set_points(caterva_ctx_t *ctx, caterva_array_t *array, const int64_t *coords,
+                       int64_t npoints, const void *buffer, int64_t buffersize);
+
+/**
+ * @brief Get a decompressed chunk in its internal (blocked) order, together with its layout. It
+ * can only be used if the array is backed by a Blosc super-chunk.
+ *
+ * Unlike @p caterva_get_slice_buffer, the blocks of the chunk are not reordered, so the chunk is
+ * decompressed directly into @p buffer.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param coords The coordinates of the chunk (in chunks, not in items).
+ * @param buffer Pointer to the buffer where the chunk will be stored. If it is NULL, only the
+ * layout is returned.
+ * @param buffersize The size (in bytes) of the buffer. It must be at least @p layout->nbytes.
+ * @param layout Pointer to the place where the layout of the chunk will be stored.
+ *
+ * @return An error code.
+ */
+int caterva_get_chunk_blocked(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *coords,
+                              void *buffer, int64_t buffersize, caterva_chunk_layout_t *layout);
+
+/**
+ * @brief Set a slice into a caterva array from a C buffer.
+ *
+ * If the array is backed by a Blosc super-chunk, it must be filled. Only the chunks touched by the
+ * slice are decompressed, updated and recompressed; the chunks fully overwritten are not even
+ * decompressed.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param buffer Pointer to the buffer where the slice data is.
+ * @param buffersize The size (in bytes) of the buffer.
+ * @param start The coordinates where the slice will begin.
+ * @param stop The coordinates where the slice will end.
+ * @param array Pointer to the caterva array where the slice will be set
  *
  * @return An error code.
  */
@@ -490,6 +1236,12 @@ int caterva_set_slice_buffer(caterva_ctx_t *ctx, void *buffer, int64_t buffersiz
 /**
  * @brief Make a copy of the array data. The copy is done into a new caterva array.
  *
+ * When both arrays are Blosc backed, the compressed chunks are copied as they are if the shapes
+ * and the compression parameters are the same. Otherwise, the destination chunks are produced
+ * (in parallel, if there are several threads) by recompressing the source ones, by moving their
+ * blocks when the blockshape is the same and both chunkshapes are made of whole blocks, or by
+ * gathering the data of their region.
+ *
  * @param ctx Pointer to the caterva context to be used.
  * @param src Pointer to the array from which data is copied.
  * @param storage Pointer to the storage params of the array desired.
@@ -500,4 +1252,712 @@ int caterva_set_slice_buffer(caterva_ctx_t *ctx, void *buffer, int64_t buffersiz
 int caterva_copy(caterva_ctx_t *ctx, caterva_array_t *src, caterva_storage_t *storage,
                  caterva_array_t **array);
 
+/**
+ * @brief Create an iterator over the chunks of a filled array, in storage order.
+ *
+ * Every chunk is decompressed into a scratch buffer owned by the iterator, so arrays can be
+ * exported chunk by chunk without a buffer for the whole array. The array must not be modified
+ * while the iterator is in use.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param prefetch Number of chunks decompressed ahead by a background thread while the caller
+ * processes the current one. If it is 0, chunks are decompressed in @p caterva_iter_next and a
+ * single scratch buffer is used.
+ * @param iter Pointer to the memory pointer where the iterator will be created.
+ *
+ * @return An error code.
+ */
+int caterva_iter_new(caterva_ctx_t *ctx, caterva_array_t *array, int prefetch,
+                     caterva_iter_t **iter);
+
+/**
+ * @brief Get the next region of an iterator.
+ *
+ * @param iter Pointer to the iterator.
+ * @param region Pointer to the place where the region will be stored.
+ * @param done Pointer to a flag set to true (and @p region left untouched) once all the regions
+ * have been returned.
+ *
+ * @return An error code.
+ */
+int caterva_iter_next(caterva_iter_t *iter, caterva_iter_region_t *region, bool *done);
+
+/**
+ * @brief Free an iterator.
+ *
+ * @param iter Pointer to the pointer to the iterator to be freed.
+ *
+ * @return An error code.
+ */
+int caterva_iter_free(caterva_iter_t **iter);
+
+/**
+ * @brief Create a reader handle for an array.
+ *
+ * A reader owns a decompression context and the scratch buffers needed for reading slices, while
+ * the super-chunk, the chunk cache and the statistics are shared with the array. Any number of
+ * threads can read from the same array at the same time, each one with its own reader, as long as
+ * the array is not modified meanwhile. Readers decompress in the calling thread.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array. It must be filled and outlive the reader.
+ * @param reader Pointer to the memory pointer where the reader will be created.
+ *
+ * @return An error code.
+ */
+int caterva_reader_new(caterva_ctx_t *ctx, caterva_array_t *array, caterva_reader_t **reader);
+
+/**
+ * @brief Get a slice into a C buffer using a reader handle. It works as
+ * @p caterva_get_slice_buffer, but reuses the decompression context and scratch buffers of the
+ * reader instead of creating them in every call.
+ *
+ * @param reader Pointer to the reader. It must not be used by several threads at the same time.
+ * @param start The coordinates where the slice will begin.
+ * @param stop The coordinates where the slice will end.
+ * @param shape The shape of the buffer.
+ * @param buffer Pointer to the buffer where data will be copied.
+ * @param buffersize The size (in bytes) of the buffer.
+ *
+ * @return An error code.
+ */
+int caterva_reader_get_slice_buffer(caterva_reader_t *reader, int64_t *start, int64_t *stop,
+                                    int64_t *shape, void *buffer, int64_t buffersize);
+
+/**
+ * @brief Free a reader handle.
+ *
+ * @param reader Pointer to the pointer to the reader to be freed.
+ *
+ * @return An error code.
+ */
+int caterva_reader_free(caterva_reader_t **reader);
+
+/**
+ * @brief Create an executor for asynchronous requests.
+ *
+ * The executor runs @p nthreads requests at a time (each one in a single thread). The requests on
+ * the same array are ordered: reads can run concurrently, but appends and updates wait for all
+ * the previous requests on the array (and the following requests wait for them). Queued reads on
+ * the same array touching common chunks are coalesced, so that every chunk is decompressed once
+ * for all of them.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param queuesize The maximum number of requests waiting to be run.
+ * @param blocking If true, the submission of a request waits while the queue is full. Otherwise,
+ * @p CATERVA_ERR_QUEUE_FULL is returned.
+ * @param executor Pointer to the memory pointer where the executor will be created.
+ *
+ * @return An error code.
+ */
+int caterva_executor_new(caterva_ctx_t *ctx, int queuesize, bool blocking,
+                         caterva_executor_t **executor);
+
+/**
+ * @brief Free an executor, after running all the requests submitted to it.
+ *
+ * The futures of its requests must be freed before.
+ *
+ * @param executor Pointer to the pointer to the executor to be freed.
+ *
+ * @return An error code.
+ */
+int caterva_executor_free(caterva_executor_t **executor);
+
+/**
+ * @brief Submit a request for getting a slice into a C buffer (see @p caterva_get_slice_buffer).
+ *
+ * The buffer must not be used until the request finishes.
+ *
+ * @param executor Pointer to the executor.
+ * @param array Pointer to the caterva array. It must outlive the request.
+ * @param start The coordinates where the slice will begin.
+ * @param stop The coordinates where the slice will end.
+ * @param shape The shape of the buffer.
+ * @param buffer Pointer to the buffer where the data will be stored.
+ * @param buffersize The size (in bytes) of the buffer.
+ * @param callback The function called when the request finishes. It can be NULL.
+ * @param arg The argument of @p callback.
+ * @param future Pointer to the memory pointer where the future of the request will be created.
+ * It must be freed with @p caterva_future_free. If it is NULL, the request is not tracked.
+ *
+ * @return An error code.
+ */
+int caterva_get_slice_buffer_async(caterva_executor_t *executor, caterva_array_t *array,
+                                   int64_t *start, int64_t *stop, int64_t *shape, void *buffer,
+                                   int64_t buffersize, caterva_callback_t callback, void *arg,
+                                   caterva_future_t **future);
+
+/**
+ * @brief Submit a request for setting a slice from a C buffer (see @p caterva_set_slice_buffer).
+ *
+ * The buffer must not be modified until the request finishes.
+ *
+ * @param executor Pointer to the executor.
+ * @param array Pointer to the caterva array. It must outlive the request.
+ * @param start The coordinates where the slice will begin.
+ * @param stop The coordinates where the slice will end.
+ * @param buffer Pointer to the buffer with the data.
+ * @param buffersize The size (in bytes) of the buffer.
+ * @param callback The function called when the request finishes. It can be NULL.
+ * @param arg The argument of @p callback.
+ * @param future Pointer to the memory pointer where the future of the request will be created.
+ * It can be NULL.
+ *
+ * @return An error code.
+ */
+int caterva_set_slice_buffer_async(caterva_executor_t *executor, caterva_array_t *array,
+                                   int64_t *start, int64_t *stop, void *buffer,
+                                   int64_t buffersize, caterva_callback_t callback, void *arg,
+                                   caterva_future_t **future);
+
+/**
+ * @brief Submit a request for appending a chunk to an array (see @p caterva_append).
+ *
+ * The chunks appended to an array are written in the order of submission. The chunk must not be
+ * modified until the request finishes.
+ *
+ * @param executor Pointer to the executor.
+ * @param array Pointer to the caterva array. It must outlive the request.
+ * @param chunk Pointer to the buffer with the chunk.
+ * @param chunksize The size (in bytes) of the chunk.
+ * @param callback The function called when the request finishes. It can be NULL.
+ * @param arg The argument of @p callback.
+ * @param future Pointer to the memory pointer where the future of the request will be created.
+ * It can be NULL.
+ *
+ * @return An error code.
+ */
+int caterva_append_async(caterva_executor_t *executor, caterva_array_t *array, void *chunk,
+                         int64_t chunksize, caterva_callback_t callback, void *arg,
+                         caterva_future_t **future);
+
+/**
+ * @brief Check whether an asynchronous request has finished, without waiting for it.
+ *
+ * @param future Pointer to the future of the request.
+ * @param done Pointer to the place where the state of the request will be stored.
+ * @param rc Pointer to the place where the error code of the request will be stored (only if it
+ * has finished). It can be NULL.
+ *
+ * @return An error code.
+ */
+int caterva_future_test(caterva_future_t *future, bool *done, int *rc);
+
+/**
+ * @brief Wait for an asynchronous request to finish.
+ *
+ * @param future Pointer to the future of the request.
+ * @param rc Pointer to the place where the error code of the request will be stored. It can be
+ * NULL.
+ *
+ * @return An error code.
+ */
+int caterva_future_wait(caterva_future_t *future, int *rc);
+
+/**
+ * @brief Free the future of a request, waiting for the request to finish.
+ *
+ * @param future Pointer to the pointer to the future to be freed.
+ *
+ * @return An error code.
+ */
+int caterva_future_free(caterva_future_t **future);
+
+/**
+ * @brief Create an appender for an array. It can only be used if the array is backed by a Blosc
+ * super-chunk.
+ *
+ * The data given to an appender is copied, so that the call returns right away; it is then
+ * assembled into chunks, compressed by @p ctx->cfg->nthreads workers and appended to the array in
+ * order, in batches of the chunks ready at the time. The memory held by the data waiting to be
+ * compressed and written is bounded by @p maxbytes (or by what a row of chunks needs, if it is
+ * larger): the appends wait while it is exceeded. The array must not be used in any other way
+ * until the appender is freed, and the appender must be used from a single thread.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param maxbytes The maximum number of bytes of data held by the appender.
+ * @param appender Pointer to the memory pointer where the appender will be created.
+ *
+ * @return An error code.
+ */
+int caterva_appender_new(caterva_ctx_t *ctx, caterva_array_t *array, int64_t maxbytes,
+                         caterva_appender_t **appender);
+
+/**
+ * @brief Append the next chunk of an array through an appender (see @p caterva_append).
+ *
+ * It can not be used while there are rows waiting to complete a row of chunks.
+ *
+ * @param appender Pointer to the appender.
+ * @param chunk Pointer to the buffer with the chunk.
+ * @param chunksize The size (in bytes) of the chunk.
+ *
+ * @return An error code. It can be the one of a previous append, since the chunks are compressed
+ * and written in the background.
+ */
+int caterva_appender_append_chunk(caterva_appender_t *appender, const void *chunk,
+                                  int64_t chunksize);
+
+/**
+ * @brief Append the next rows (items along the first dimension) of an array through an appender.
+ *
+ * The rows are buffered until they complete a row of chunks (or the array), which is then
+ * compressed and written. It can only be used when the array holds whole rows of chunks.
+ *
+ * @param appender Pointer to the appender.
+ * @param buffer Pointer to the C buffer with the rows.
+ * @param buffersize The size (in bytes) of the buffer. It must be a multiple of the size of a row.
+ *
+ * @return An error code. It can be the one of a previous append, since the chunks are compressed
+ * and written in the background.
+ */
+int caterva_appender_append_rows(caterva_appender_t *appender, const void *buffer,
+                                 int64_t buffersize);
+
+/**
+ * @brief Wait until all the chunks given to an appender are written to the array.
+ *
+ * The rows that do not complete a row of chunks yet are kept buffered.
+ *
+ * @param appender Pointer to the appender.
+ *
+ * @return An error code.
+ */
+int caterva_appender_flush(caterva_appender_t *appender);
+
+/**
+ * @brief Write all the data given to an appender and free it.
+ *
+ * If some rows do not complete a row of chunks, the row of chunks is written anyway, with the
+ * rest of its items set to the fill value, so the next rows will start a new row of chunks.
+ *
+ * @param appender Pointer to the pointer to the appender to be freed.
+ *
+ * @return An error code.
+ */
+int caterva_appender_free(caterva_appender_t **appender);
+
+/**
+ * @brief Set the memory budget of the decompressed-chunk cache of an array. It can only be used
+ * if the array is backed by a Blosc super-chunk.
+ *
+ * The chunks decompressed when reading from the array are kept in the cache (with LRU eviction),
+ * so that reading them again does not need any decompression. The cache is disabled by default
+ * and any previous content of the cache (and its statistics) is dropped. This function must not be
+ * called while the array is being read from other threads.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param nbytes The maximum size (in bytes) of the cache. If it is smaller than a decompressed
+ * chunk, the cache is disabled.
+ *
+ * @return An error code.
+ */
+int caterva_set_cache_size(caterva_ctx_t *ctx, caterva_array_t *array, int64_t nbytes);
+
+/**
+ * @brief Get the statistics of the decompressed-chunk cache of an array.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param stats Pointer to the place where the statistics will be stored. If the cache is
+ * disabled, all of them are 0.
+ *
+ * @return An error code.
+ */
+int caterva_get_cache_stats(caterva_ctx_t *ctx, caterva_array_t *array,
+                            caterva_cache_stats_t *stats);
+
+/**
+ * @brief Get the statistics of a chunk (and of its blocks) of an array created with
+ * statistics.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param coords The coordinates of the chunk in the grid of chunks.
+ * @param stats Pointer to the place where the statistics of the chunk will be stored.
+ * @param blockstats Pointer to the place where the statistics of the blocks of the chunk will be
+ * stored, in the order of @p caterva_get_chunk_blocked. It has to have room for
+ * `extchunknitems / blocknitems` elements. If it is NULL, only the chunk statistics are returned.
+ *
+ * @return An error code.
+ */
+int caterva_get_chunk_stats(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *coords,
+                            caterva_stats_t *stats, caterva_stats_t *blockstats);
+
+/**
+ * @brief Enable or disable the performance counters of an array.
+ *
+ * The counters are disabled by default, and then they only cost a pointer check in the hot paths.
+ * Enabling them resets them. This function must not be called while the array is being used from
+ * other threads.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param enabled Whether the counters are enabled.
+ *
+ * @return An error code.
+ */
+int caterva_set_counters(caterva_ctx_t *ctx, caterva_array_t *array, bool enabled);
+
+/**
+ * @brief Get the performance counters of an array.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param counters Pointer to the place where the counters will be stored. If they are disabled,
+ * all of them are 0.
+ *
+ * @return An error code.
+ */
+int caterva_get_counters(caterva_ctx_t *ctx, caterva_array_t *array,
+                         caterva_counters_t *counters);
+
+/**
+ * @brief Reset the performance counters of an array to 0.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ *
+ * @return An error code.
+ */
+int caterva_reset_counters(caterva_ctx_t *ctx, caterva_array_t *array);
+
+/**
+ * @brief Set the function called every time that a phase of the work on an array finishes, e.g.
+ * to feed a tracing system. The counters of the array are enabled if they were disabled.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param trace The function. If it is NULL, no function is called.
+ * @param arg The argument of @p trace.
+ *
+ * @return An error code.
+ */
+int caterva_set_trace(caterva_ctx_t *ctx, caterva_array_t *array, caterva_trace_fn trace,
+                      void *arg);
+
+/**
+ * @brief Get a slice into a C buffer, skipping the chunks and blocks whose statistics show that
+ * they do not have any value in the range of @p filter.
+ *
+ * The blocks skipped are not decompressed and their items are not written into the buffer, so it
+ * can be prefilled with a sentinel value. The array must have been created with statistics.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param start The coordinates where the slice will begin.
+ * @param stop The coordinates where the slice will end.
+ * @param shape The shape of the buffer.
+ * @param filter Pointer to the range of values of interest.
+ * @param buffer Pointer to the buffer where the data will be stored.
+ * @param buffersize The size (in bytes) of the buffer.
+ * @param nskipped Pointer to the place where the number of blocks skipped will be stored. It can
+ * be NULL.
+ *
+ * @return An error code.
+ */
+int caterva_get_slice_buffer_filtered(caterva_ctx_t *ctx, caterva_array_t *array,
+                                      int64_t *start, int64_t *stop, int64_t *shape,
+                                      const caterva_filter_t *filter, void *buffer,
+                                      int64_t buffersize, int64_t *nskipped);
+
+/**
+ * @brief Get the metalayer with the dimensions of an array, the one that is checked by
+ * @p caterva_check_meta. It can only be used if the array is backed by a Blosc super-chunk.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param meta Pointer to the buffer where the metalayer will be stored. If it is NULL, only its
+ * length is returned.
+ * @param metasize The size (in bytes) of the buffer.
+ * @param metalen Pointer to the place where the length (in bytes) of the metalayer will be stored.
+ *
+ * @return An error code.
+ */
+int caterva_get_meta(caterva_ctx_t *ctx, caterva_array_t *array, uint8_t *meta, int32_t metasize,
+                     int32_t *metalen);
+
+/**
+ * @brief Check if the chunks of the array described by a metalayer (got with
+ * @p caterva_get_meta, e.g. on another host) can be stored as they are in an array.
+ *
+ * The chunks are compatible if both arrays have the same number of dimensions, chunkshape and
+ * blockshape; their shapes may differ. The metalayer is validated, so it can come from an
+ * untrusted source.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param meta Pointer to the metalayer.
+ * @param metalen The length (in bytes) of the metalayer.
+ * @param compatible Pointer to the place where the result will be stored.
+ *
+ * @return An error code.
+ */
+int caterva_check_meta(caterva_ctx_t *ctx, caterva_array_t *array, const uint8_t *meta,
+                       int32_t metalen, bool *compatible);
+
+/**
+ * @brief Get a chunk of an array as it is stored, compressed. It can only be used if the array is
+ * backed by a Blosc super-chunk.
+ *
+ * The chunk is neither decompressed nor reordered, so it can be sent as it is to another array
+ * with the same chunkshape, blockshape and itemsize (see @p caterva_set_chunk_compressed).
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array. It must be filled.
+ * @param coords The coordinates of the chunk (in chunks, not in items).
+ * @param buffer Pointer to the buffer where the compressed chunk will be stored. If it is NULL,
+ * only its size is returned.
+ * @param buffersize The size (in bytes) of the buffer.
+ * @param cbytes Pointer to the place where the size (in bytes) of the compressed chunk will be
+ * stored.
+ *
+ * @return An error code.
+ */
+int caterva_get_chunk_compressed(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *coords,
+                                 void *buffer, int64_t buffersize, int64_t *cbytes);
+
+/**
+ * @brief Replace a chunk of an array with a chunk that is already compressed (e.g. got with
+ * @p caterva_get_chunk_compressed). It can only be used if the array is backed by a Blosc
+ * super-chunk.
+ *
+ * The chunk is not recompressed. Its header is checked against the chunkshape, blockshape and
+ * itemsize of the array, and then it is decompressed only if the array keeps statistics.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array. It must be filled.
+ * @param coords The coordinates of the chunk (in chunks, not in items).
+ * @param cchunk Pointer to the compressed chunk.
+ * @param cbytes The size (in bytes) of the compressed chunk.
+ *
+ * @return An error code.
+ */
+int caterva_set_chunk_compressed(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *coords,
+                                 const void *cchunk, int64_t cbytes);
+
+/**
+ * @brief Start tracking the version of every chunk of an array. It can only be used if the array
+ * is backed by a Blosc super-chunk.
+ *
+ * The array starts at version 0 and every chunk write increases it by one. The versions are
+ * stored with the array, so they are kept when it is opened again. Calling it on an array that
+ * is already tracked does nothing.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ *
+ * @return An error code.
+ */
+int caterva_track_versions(caterva_ctx_t *ctx, caterva_array_t *array);
+
+/**
+ * @brief Get the current version of an array, whose versions must be tracked.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param version Pointer to the place where the version will be stored.
+ *
+ * @return An error code.
+ */
+int caterva_get_version(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *version);
+
+/**
+ * @brief Get the coordinates of the chunks written after a version of an array, whose versions
+ * must be tracked.
+ *
+ * A resize moves the versions with the chunks, and the chunks that it adds or changes count as
+ * written, so a replica has to be resized before the chunks are copied to it.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param since The version; only the chunks written after it are returned.
+ * @param coords Pointer to the buffer where the coordinates of the chunks (in chunks, not in
+ * items) will be stored, one after the other. It must have room for @p maxchunks x @p ndim
+ * elements. If it is NULL, only the number of chunks is returned.
+ * @param maxchunks The maximum number of chunks to be stored in @p coords.
+ * @param nchunks Pointer to the place where the number of chunks written after @p since will be
+ * stored. It can be larger than @p maxchunks.
+ *
+ * @return An error code.
+ */
+int caterva_get_changed_chunks(caterva_ctx_t *ctx, caterva_array_t *array, int64_t since,
+                               int64_t *coords, int64_t maxchunks, int64_t *nchunks);
+
+/**
+ * @brief Create an expression made of an array.
+ *
+ * The array must be backed by a Blosc super-chunk and filled. All the arrays of an expression
+ * must have the same shape, chunkshape and blockshape, so that their chunks are combined as they
+ * are decompressed, without reordering them. The array must outlive the expression.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param dtype The type of the items of the array. Its size must be the itemsize of the array.
+ * @param expr Pointer to the memory pointer where the expression will be created.
+ *
+ * @return An error code.
+ */
+int caterva_expr_array(caterva_ctx_t *ctx, caterva_array_t *array, caterva_dtype_t dtype,
+                       caterva_expr_t **expr);
+
+/**
+ * @brief Create an expression made of a scalar, which is broadcast to the shape of the arrays.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param value The value of the scalar.
+ * @param expr Pointer to the memory pointer where the expression will be created.
+ *
+ * @return An error code.
+ */
+int caterva_expr_scalar(caterva_ctx_t *ctx, double value, caterva_expr_t **expr);
+
+/**
+ * @brief Create an expression that applies an elementwise operation to two expressions.
+ *
+ * If the expression is created, it owns @p lhs and @p rhs, which are freed along with it.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param op The operation.
+ * @param lhs Pointer to the left operand.
+ * @param rhs Pointer to the right operand.
+ * @param expr Pointer to the memory pointer where the expression will be created.
+ *
+ * @return An error code.
+ */
+int caterva_expr_op(caterva_ctx_t *ctx, caterva_op_t op, caterva_expr_t *lhs, caterva_expr_t *rhs,
+                    caterva_expr_t **expr);
+
+/**
+ * @brief Free an expression and its operands.
+ *
+ * @param expr Pointer to the memory pointer of the expression.
+ *
+ * @return An error code.
+ */
+int caterva_expr_free(caterva_expr_t **expr);
+
+/**
+ * @brief Evaluate an expression into a new array.
+ *
+ * The chunks of the operands are decompressed one at a time, the expression is computed block by
+ * block in double precision, and the resulting chunks are compressed straight into the new array.
+ * The chunks are evaluated in parallel when `nthreads` is greater than 1.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param expr Pointer to the expression. It must have at least an array.
+ * @param dtype The type of the items of the new array.
+ * @param storage Pointer to the storage of the new array. It must be backed by a Blosc
+ * super-chunk; its chunkshape and blockshape are taken from the operands.
+ * @param array Pointer to the memory pointer where the new array will be created.
+ *
+ * @return An error code.
+ */
+int caterva_expr_eval(caterva_ctx_t *ctx, caterva_expr_t *expr, caterva_dtype_t dtype,
+                      caterva_storage_t *storage, caterva_array_t **array);
+
+/**
+ * @brief Reduce an expression, either completely or along an axis, without materializing it.
+ *
+ * The chunks are evaluated in parallel when `nthreads` is greater than 1, each worker reducing
+ * into its own accumulators, which are merged at the end.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param expr Pointer to the expression. It must have at least an array.
+ * @param op The reduction.
+ * @param axis The axis to be reduced. If it is -1, all the items are reduced into one value.
+ * @param result Pointer to the buffer where the result will be stored, in C order. Its shape is
+ * the one of the operands without @p axis.
+ * @param resultsize The size (in bytes) of the buffer.
+ *
+ * @return An error code.
+ */
+int caterva_expr_reduce(caterva_ctx_t *ctx, caterva_expr_t *expr, caterva_reduce_t op,
+                        int8_t axis, double *result, int64_t resultsize);
+
+/**
+ * @brief Build the pyramid of an array, i.e. a series of downsampled copies of it.
+ *
+ * Every level is computed from the previous one (the first one, from the array): each item of a
+ * level is the result of @p method over a box of @p factors items of the previous level, so the
+ * shape of a level is the one of the previous level divided by the factors (rounded up). The
+ * levels are Blosc arrays with the chunkshape and blockshape of the array (clipped to their
+ * shape), and their chunks are computed in parallel when `nthreads` is greater than 1.
+ *
+ * If the array is stored on disk, the level k is stored in the file `<urlpath>.level<k>` and the
+ * pyramid is recorded in the @p caterva_pyramid metalayer, so it is found again when the array is
+ * opened. Otherwise, the levels are kept in memory along with the array. Any previous pyramid is
+ * replaced. The levels are not updated when the array is modified afterwards, so the pyramid must
+ * be built again. Resizing the array drops its pyramid (and removes the files of its levels), and
+ * a recorded pyramid whose levels do not match the array anymore is ignored.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array. It must be backed by a Blosc super-chunk and filled.
+ * @param params Pointer to the parameters of the pyramid.
+ *
+ * @return An error code.
+ */
+int caterva_pyramid_build(caterva_ctx_t *ctx, caterva_array_t *array,
+                          caterva_pyramid_params_t *params);
+
+/**
+ * @brief Get the parameters of the pyramid of an array.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param params Pointer to the parameters where the ones of the pyramid will be stored. The
+ * factors are the actual ones, and the number of levels is 0 if the array has no pyramid.
+ *
+ * @return An error code.
+ */
+int caterva_pyramid_get_params(caterva_ctx_t *ctx, caterva_array_t *array,
+                               caterva_pyramid_params_t *params);
+
+/**
+ * @brief Get a level of the pyramid of an array.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param level The level, from 1 to the number of levels of the pyramid.
+ * @param level_array Pointer to the memory pointer where the level will be returned. It belongs
+ * to @p array, so it must not be freed, and it is read-only if @p array is.
+ *
+ * @return An error code.
+ */
+int caterva_pyramid_get_level(caterva_ctx_t *ctx, caterva_array_t *array, int level,
+                              caterva_array_t **level_array);
+
+/**
+ * @brief Get a slice of an array resampled to a smaller shape into a C buffer.
+ *
+ * The slice is read from the coarsest level of the pyramid of the array that still has, along
+ * every dimension, at least as many items in the slice as the buffer (or from the array itself,
+ * if there is no such level). Every item of the buffer is then the item of that level nearest to
+ * its center, so overviews of large regions only decompress a small part of the data. Without a
+ * pyramid, the items are picked from the array itself. The level is read one chunk at a time, and
+ * the chunks that hold none of the picked items are skipped.
+ *
+ * @param ctx Pointer to the caterva context to be used.
+ * @param array Pointer to the caterva array.
+ * @param start The coordinates where the slice will begin.
+ * @param stop The coordinates where the slice will end.
+ * @param shape The shape of the buffer. It can not be larger than the slice along any dimension.
+ * @param buffer Pointer to the buffer where the data will be stored.
+ * @param buffersize The size (in bytes) of the buffer.
+ * @param level Pointer to the level that has been read (0 for the array itself). It can be NULL.
+ *
+ * @return An error code.
+ */
+int caterva_get_slice_buffer_scaled(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *start,
+                                    int64_t *stop, int64_t *shape, void *buffer,
+                                    int64_t buffersize, int *level);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif  // CATERVA_CATERVA_H_
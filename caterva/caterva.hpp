@@ -0,0 +1,550 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+/** @file caterva.hpp
+ * @brief Caterva C++ header file.
+ *
+ * This file contains an optional, header-only C++ front end for Caterva. The arrays have their
+ * number of dimensions and their item type fixed at compile time, so the loops that copy the items
+ * between the chunks and the user buffers are unrolled for them. The arrays are still created and
+ * stored through the C API, so their files can be used from C as well.
+ * @author Blosc Development team <blosc@blosc.org>
+ */
+
+#ifndef CATERVA_CATERVA_HPP_
+#define CATERVA_CATERVA_HPP_
+
+#include <caterva.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace caterva {
+
+/**
+ * @brief The exception thrown when a call to the C API fails.
+ */
+class error : public std::runtime_error {
+  public:
+    explicit error(int code) : std::runtime_error(print_error(code)), code_(code) {}
+
+    //! The error code returned by the C API.
+    int code() const noexcept { return code_; }
+
+  private:
+    int code_;
+};
+
+namespace detail {
+
+inline void check(int rc) {
+    if (rc != CATERVA_SUCCEED) {
+        throw error(rc);
+    }
+}
+
+// The strides (in items) of an array stored in C order
+template <int N, typename S>
+std::array<int64_t, N> c_strides(const S &shape) {
+    std::array<int64_t, N> strides;
+    int64_t stride = 1;
+    for (int i = N - 1; i >= 0; --i) {
+        strides[i] = stride;
+        stride *= shape[i];
+    }
+    return strides;
+}
+
+// Copy a box of `shape` items between two strided buffers. The recursion is resolved at compile
+// time, and the innermost dimension is copied with a single memcpy when it is contiguous.
+template <typename T, int D>
+struct copy_box {
+    static void run(const int64_t *shape, const T *src, const int64_t *src_strides, T *dest,
+                    const int64_t *dest_strides) {
+        for (int64_t i = 0; i < shape[0]; ++i) {
+            copy_box<T, D - 1>::run(shape + 1, src + i * src_strides[0], src_strides + 1,
+                                    dest + i * dest_strides[0], dest_strides + 1);
+        }
+    }
+};
+
+template <typename T>
+struct copy_box<T, 1> {
+    static void run(const int64_t *shape, const T *src, const int64_t *src_strides, T *dest,
+                    const int64_t *dest_strides) {
+        if (src_strides[0] == 1 && dest_strides[0] == 1) {
+            std::memcpy(dest, src, static_cast<size_t>(shape[0]) * sizeof(T));
+            return;
+        }
+        for (int64_t i = 0; i < shape[0]; ++i) {
+            dest[i * dest_strides[0]] = src[i * src_strides[0]];
+        }
+    }
+};
+
+// Move `coords` to the next position of the box [first, last), in C order. Return false once the
+// whole box has been visited.
+template <int N>
+bool next(std::array<int64_t, N> &coords, const std::array<int64_t, N> &first,
+          const std::array<int64_t, N> &last) {
+    for (int i = N - 1; i >= 0; --i) {
+        if (++coords[i] < last[i]) {
+            return true;
+        }
+        coords[i] = first[i];
+    }
+    return false;
+}
+
+}  // namespace detail
+
+/**
+ * @brief A view of a user buffer as an @p N dimensional array of @p T.
+ *
+ * A view does not own its data, so it can bind any buffer (or a region of a larger one, through
+ * its strides) without copying or allocating anything.
+ */
+template <typename T, int N>
+class view {
+  public:
+    using shape_type = std::array<int64_t, N>;
+
+    //! Bind a buffer of @p shape items stored in C order.
+    view(T *data, const shape_type &shape)
+        : data_(data), shape_(shape), strides_(detail::c_strides<N>(shape)) {}
+
+    //! Bind a buffer of @p shape items separated by @p strides items in each dimension.
+    view(T *data, const shape_type &shape, const shape_type &strides)
+        : data_(data), shape_(shape), strides_(strides) {}
+
+    //! A read-only view of the same buffer.
+    template <typename U, typename = typename std::enable_if<
+        std::is_same<const U, T>::value && !std::is_same<U, T>::value>::type>
+    view(const view<U, N> &other)  // NOLINT(runtime/explicit)
+        : data_(other.data()), shape_(other.shape()), strides_(other.strides()) {}
+
+    T *data() const noexcept { return data_; }
+    const shape_type &shape() const noexcept { return shape_; }
+    const shape_type &strides() const noexcept { return strides_; }
+
+    //! The number of items in the view.
+    int64_t size() const noexcept {
+        int64_t nitems = 1;
+        for (int i = 0; i < N; ++i) {
+            nitems *= shape_[i];
+        }
+        return nitems;
+    }
+
+    //! Whether the items are stored in C order without gaps.
+    bool contiguous() const noexcept { return strides_ == detail::c_strides<N>(shape_); }
+
+  private:
+    T *data_;
+    shape_type shape_;
+    shape_type strides_;
+};
+
+/**
+ * @brief A caterva context. It owns a @p caterva_ctx_t and frees it when it is destroyed.
+ */
+class context {
+  public:
+    explicit context(const caterva_config_t &cfg = CATERVA_CONFIG_DEFAULTS) {
+        caterva_config_t cfg_ = cfg;
+        detail::check(caterva_ctx_new(&cfg_, &ctx_));
+    }
+
+    context(const context &) = delete;
+    context &operator=(const context &) = delete;
+
+    context(context &&other) noexcept : ctx_(other.ctx_) { other.ctx_ = nullptr; }
+
+    context &operator=(context &&other) noexcept {
+        if (this != &other) {
+            reset();
+            ctx_ = other.ctx_;
+            other.ctx_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~context() { reset(); }
+
+    //! The underlying C context.
+    caterva_ctx_t *get() const noexcept { return ctx_; }
+
+  private:
+    void reset() noexcept {
+        if (ctx_ != nullptr) {
+            caterva_ctx_free(&ctx_);
+        }
+        ctx_ = nullptr;
+    }
+
+    caterva_ctx_t *ctx_ = nullptr;
+};
+
+/**
+ * @brief The storage of an array backed by a Blosc super-chunk.
+ *
+ * @param chunkshape The shape of each chunk.
+ * @param blockshape The shape of each block.
+ * @param urlpath The name of the file where the super-chunk is stored. If it is NULL, the
+ * super-chunk is held in memory.
+ * @param sequential Whether the super-chunk is stored as a single frame.
+ */
+template <int N>
+caterva_storage_t blosc_storage(const std::array<int32_t, N> &chunkshape,
+                                const std::array<int32_t, N> &blockshape,
+                                const char *urlpath = nullptr, bool sequential = false) {
+    caterva_storage_t storage = {};
+    storage.backend = CATERVA_STORAGE_BLOSC;
+    storage.properties.blosc.sequencial = sequential;
+    storage.properties.blosc.urlpath = const_cast<char *>(urlpath);
+    for (int i = 0; i < N; ++i) {
+        storage.properties.blosc.chunkshape[i] = chunkshape[i];
+        storage.properties.blosc.blockshape[i] = blockshape[i];
+    }
+    return storage;
+}
+
+/**
+ * @brief The storage of an array backed by a plain buffer.
+ *
+ * @param urlpath The name of the file where the plain buffer is mapped. If it is NULL, the plain
+ * buffer is held in memory.
+ */
+inline caterva_storage_t plainbuffer_storage(const char *urlpath = nullptr) {
+    caterva_storage_t storage = {};
+    storage.backend = CATERVA_STORAGE_PLAINBUFFER;
+    storage.properties.plainbuffer.urlpath = const_cast<char *>(urlpath);
+    return storage;
+}
+
+/**
+ * @brief An @p N dimensional caterva array of items of type @p T.
+ *
+ * It owns a @p caterva_array_t and frees it when it is destroyed. It can be moved but not copied,
+ * so the C array is never shared by accident. The context used to create it must outlive it.
+ *
+ * The slices are copied between the chunks and the views by kernels specialized for @p N and
+ * @p T: every chunk touched is decompressed (or taken from the cache) in its blocked order, and
+ * the part of each block inside the slice is copied straight into the view. The writes go
+ * through the C API, which repartitions and compresses the chunks.
+ *
+ * An array keeps a scratch chunk between calls, so it must not be used from several threads at
+ * the same time.
+ */
+template <typename T, int N>
+class array {
+    static_assert(N >= 1 && N <= CATERVA_MAX_DIM, "Wrong number of dimensions");
+    static_assert(std::is_trivially_copyable<T>::value, "The items must be trivially copyable");
+    static_assert(sizeof(T) <= INT8_MAX, "The items are too large");
+    static_assert(sizeof(std::array<int64_t, N>) == N * sizeof(int64_t),
+                  "The coordinates must be packed");
+
+  public:
+    using shape_type = std::array<int64_t, N>;
+
+    array() noexcept = default;
+
+    array(const array &) = delete;
+    array &operator=(const array &) = delete;
+
+    array(array &&other) noexcept
+        : ctx_(other.ctx_), array_(other.array_), scratch_(std::move(other.scratch_)) {
+        other.array_ = nullptr;
+    }
+
+    array &operator=(array &&other) noexcept {
+        if (this != &other) {
+            reset();
+            ctx_ = other.ctx_;
+            array_ = other.array_;
+            scratch_ = std::move(other.scratch_);
+            other.array_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~array() { reset(); }
+
+    /**
+     * @brief Create an empty array, to be filled with @p append.
+     *
+     * @param fillvalue Pointer to the value of the items that are not set. If it is NULL, it is 0.
+     */
+    static array empty(context &ctx, const shape_type &shape, const caterva_storage_t &storage,
+                       const T *fillvalue = nullptr) {
+        caterva_params_t params = make_params(shape);
+        caterva_storage_t storage_ = storage;
+        array arr(ctx.get());
+        detail::check(caterva_empty(ctx.get(), &params, &storage_, &arr.array_));
+        if (fillvalue != nullptr) {
+            arr.set_fillvalue(fillvalue);
+        }
+        return arr;
+    }
+
+    //! Create an array filled with zeros.
+    static array zeros(context &ctx, const shape_type &shape, const caterva_storage_t &storage) {
+        caterva_params_t params = make_params(shape);
+        caterva_storage_t storage_ = storage;
+        array arr(ctx.get());
+        detail::check(caterva_zeros(ctx.get(), &params, &storage_, &arr.array_));
+        return arr;
+    }
+
+    //! Create an array with the data (and the shape) of @p src.
+    static array from_buffer(context &ctx, view<const T, N> src,
+                             const caterva_storage_t &storage, const T *fillvalue = nullptr) {
+        caterva_params_t params = make_params(src.shape());
+        caterva_storage_t storage_ = storage;
+        array arr(ctx.get());
+        const T *data = arr.contiguous(src);
+        detail::check(caterva_from_buffer(ctx.get(), const_cast<T *>(data),
+                                          src.size() * static_cast<int64_t>(sizeof(T)), &params,
+                                          &storage_, &arr.array_));
+        if (fillvalue != nullptr) {
+            arr.set_fillvalue(fillvalue);
+        }
+        return arr;
+    }
+
+    //! Set the value of the items that are not set (0 if @p fillvalue is NULL).
+    void set_fillvalue(const T *fillvalue) {
+        detail::check(caterva_set_fillvalue(ctx_, array_, fillvalue));
+    }
+
+    //! Open an array stored in a file. It must have @p N dimensions and items of type @p T.
+    static array open(context &ctx, const std::string &urlpath) {
+        array arr(ctx.get());
+        detail::check(caterva_open(ctx.get(), urlpath.c_str(), &arr.array_));
+        if (arr.array_->ndim != N || arr.array_->itemsize != static_cast<int8_t>(sizeof(T))) {
+            throw error(CATERVA_ERR_INVALID_ARGUMENT);
+        }
+        return arr;
+    }
+
+    //! The underlying C array.
+    caterva_array_t *get() const noexcept { return array_; }
+
+    //! Give up the ownership of the C array, which must be freed with @p caterva_free.
+    caterva_array_t *release() noexcept {
+        caterva_array_t *arr = array_;
+        array_ = nullptr;
+        return arr;
+    }
+
+    shape_type shape() const noexcept {
+        shape_type shape;
+        for (int i = 0; i < N; ++i) {
+            shape[i] = array_->shape[i];
+        }
+        return shape;
+    }
+
+    //! The number of items in the array.
+    int64_t size() const noexcept { return array_->nitems; }
+
+    /**
+     * @brief Get the slice [@p start, @p stop) into @p dest, whose shape must be the one of the
+     * slice.
+     */
+    void get_slice(const shape_type &start, const shape_type &stop, view<T, N> dest) {
+        shape_type shape;
+        for (int i = 0; i < N; ++i) {
+            if (start[i] < 0 || start[i] > stop[i] || stop[i] > array_->shape[i] ||
+                dest.shape()[i] != stop[i] - start[i]) {
+                throw error(CATERVA_ERR_INVALID_ARGUMENT);
+            }
+            shape[i] = stop[i] - start[i];
+        }
+        if (dest.size() == 0) {
+            return;
+        }
+
+        // A plain buffer is a single chunk in C order
+        if (array_->storage == CATERVA_STORAGE_PLAINBUFFER) {
+            shape_type strides = detail::c_strides<N>(array_->shape);
+            const T *src = reinterpret_cast<const T *>(array_->buf);
+            for (int i = 0; i < N; ++i) {
+                src += start[i] * strides[i];
+            }
+            detail::copy_box<T, N>::run(shape.data(), src, strides.data(), dest.data(),
+                                        dest.strides().data());
+            return;
+        }
+
+        shape_type first;
+        shape_type last;
+        for (int i = 0; i < N; ++i) {
+            first[i] = start[i] / array_->chunkshape[i];
+            last[i] = (stop[i] - 1) / array_->chunkshape[i] + 1;
+        }
+        scratch_.resize(static_cast<size_t>(array_->extchunknitems));
+        shape_type coords = first;
+        do {
+            int64_t coords_[CATERVA_MAX_DIM];
+            std::copy(coords.begin(), coords.end(), coords_);
+            caterva_chunk_layout_t layout;
+            detail::check(caterva_get_chunk_blocked(
+                ctx_, array_, coords_, scratch_.data(),
+                static_cast<int64_t>(scratch_.size() * sizeof(T)), &layout));
+            copy_chunk(layout, start, stop, dest);
+        } while (detail::next<N>(coords, first, last));
+    }
+
+    //! Get the whole array into @p dest.
+    void to_buffer(view<T, N> dest) { get_slice(shape_type(), shape(), dest); }
+
+    //! Set the slice [@p start, @p stop) from @p src, whose shape must be the one of the slice.
+    void set_slice(const shape_type &start, const shape_type &stop, view<const T, N> src) {
+        int64_t start_[CATERVA_MAX_DIM];
+        int64_t stop_[CATERVA_MAX_DIM];
+        for (int i = 0; i < N; ++i) {
+            if (src.shape()[i] != stop[i] - start[i]) {
+                throw error(CATERVA_ERR_INVALID_ARGUMENT);
+            }
+            start_[i] = start[i];
+            stop_[i] = stop[i];
+        }
+        const T *data = contiguous(src);
+        detail::check(caterva_set_slice_buffer(ctx_, const_cast<T *>(data),
+                                               src.size() * static_cast<int64_t>(sizeof(T)),
+                                               start_, stop_, array_));
+    }
+
+    //! Append the next chunk, whose shape must be the one expected by @p caterva_append.
+    void append(view<const T, N> chunk) {
+        const T *data = contiguous(chunk);
+        detail::check(caterva_append(ctx_, array_, const_cast<T *>(data),
+                                     chunk.size() * static_cast<int64_t>(sizeof(T))));
+    }
+
+    //! Resize the array to @p shape.
+    void resize(const shape_type &shape) {
+        int64_t shape_[CATERVA_MAX_DIM];
+        std::copy(shape.begin(), shape.end(), shape_);
+        detail::check(caterva_resize(ctx_, array_, shape_));
+    }
+
+    //! Get into @p dest the values of the @p npoints points at @p coords.
+    void get_points(const shape_type *coords, int64_t npoints, T *dest) {
+        detail::check(caterva_get_points(ctx_, array_, coords->data(), npoints, dest,
+                                         npoints * static_cast<int64_t>(sizeof(T))));
+    }
+
+    //! Set the values of the @p npoints points at @p coords from @p src.
+    void set_points(const shape_type *coords, int64_t npoints, const T *src) {
+        detail::check(caterva_set_points(ctx_, array_, coords->data(), npoints, src,
+                                         npoints * static_cast<int64_t>(sizeof(T))));
+    }
+
+  private:
+    explicit array(caterva_ctx_t *ctx) noexcept : ctx_(ctx) {}
+
+    static caterva_params_t make_params(const shape_type &shape) {
+        caterva_params_t params = {};
+        params.itemsize = static_cast<uint8_t>(sizeof(T));
+        params.ndim = static_cast<uint8_t>(N);
+        for (int i = 0; i < N; ++i) {
+            params.shape[i] = shape[i];
+        }
+        return params;
+    }
+
+    void reset() noexcept {
+        if (array_ != nullptr) {
+            caterva_free(ctx_, &array_);
+        }
+        array_ = nullptr;
+    }
+
+    // Copy `src` in C order into the scratch buffer
+    void gather(view<const T, N> src) {
+        scratch_.resize(static_cast<size_t>(src.size()));
+        shape_type strides = detail::c_strides<N>(src.shape());
+        detail::copy_box<T, N>::run(src.shape().data(), src.data(), src.strides().data(),
+                                    scratch_.data(), strides.data());
+    }
+
+    // The data of `src` in C order, gathered in the scratch buffer if needed
+    const T *contiguous(view<const T, N> src) {
+        if (src.contiguous()) {
+            return src.data();
+        }
+        gather(src);
+        return scratch_.data();
+    }
+
+    // Copy the part of the (blocked) chunk in the scratch buffer that is inside the slice
+    void copy_chunk(const caterva_chunk_layout_t &layout, const shape_type &start,
+                    const shape_type &stop, view<T, N> dest) {
+        // Without reordering, the chunk is a single block
+        std::array<int64_t, N> blockshape;
+        shape_type first;
+        shape_type last;
+        for (int i = 0; i < N; ++i) {
+            blockshape[i] = layout.contiguous ? layout.extchunkshape[i] : layout.blockshape[i];
+            int64_t begin = start[i] > layout.start[i] ? start[i] - layout.start[i] : 0;
+            int64_t end = stop[i] - layout.start[i];
+            end = end < layout.shape[i] ? end : layout.shape[i];
+            first[i] = begin / blockshape[i];
+            last[i] = (end - 1) / blockshape[i] + 1;
+        }
+        shape_type bgrid;
+        for (int i = 0; i < N; ++i) {
+            bgrid[i] = layout.extchunkshape[i] / blockshape[i];
+        }
+        shape_type bstrides = detail::c_strides<N>(blockshape);
+        shape_type gstrides = detail::c_strides<N>(bgrid);
+        int64_t blocknitems = bstrides[0] * blockshape[0];
+
+        shape_type coords = first;
+        do {
+            int64_t nblock = 0;
+            int64_t src_offset = 0;
+            T *dest_ = dest.data();
+            shape_type box;
+            for (int i = 0; i < N; ++i) {
+                // The part of the block inside the slice, in array coordinates
+                int64_t bstart = layout.start[i] + coords[i] * blockshape[i];
+                int64_t bstop = bstart + blockshape[i];
+                int64_t begin = start[i] > bstart ? start[i] : bstart;
+                int64_t end = stop[i] < bstop ? stop[i] : bstop;
+                end = end < layout.start[i] + layout.shape[i] ? end :
+                      layout.start[i] + layout.shape[i];
+                box[i] = end - begin;
+                nblock += coords[i] * gstrides[i];
+                src_offset += (begin - bstart) * bstrides[i];
+                dest_ += (begin - start[i]) * dest.strides()[i];
+            }
+            detail::copy_box<T, N>::run(box.data(),
+                                        scratch_.data() + nblock * blocknitems + src_offset,
+                                        bstrides.data(), dest_, dest.strides().data());
+        } while (detail::next<N>(coords, first, last));
+    }
+
+    caterva_ctx_t *ctx_ = nullptr;
+    caterva_array_t *array_ = nullptr;
+    std::vector<T> scratch_;
+};
+
+}  // namespace caterva
+
+#endif  // CATERVA_CATERVA_HPP_
@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <caterva.h>
+
+#include "caterva_pool.h"
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+/*
+ * The chunk and block shapes are chosen in two steps: first their number of items is derived from
+ * the cache sizes (a block must be decompressed and copied while it is hot in L2, and the chunks
+ * of all the readers should fit together in L3), and then that number of items is laid out
+ * following the access pattern. When a sample of the data is given, a few candidates around that
+ * guess are benchmarked and the fastest one wins.
+ */
+
+// The cache sizes used when they cannot be detected
+#define CATERVA_ADVISE_L1SIZE (32 * 1024)
+#define CATERVA_ADVISE_L2SIZE (256 * 1024)
+#define CATERVA_ADVISE_L3SIZE (8 * 1024 * 1024)
+
+// The number of slices read to benchmark every candidate
+#define CATERVA_ADVISE_NREADS 16
+
+typedef struct {
+    int64_t chunkshape[CATERVA_MAX_DIM];
+    int64_t blockshape[CATERVA_MAX_DIM];
+} caterva_advise_candidate_t;
+
+static int64_t caterva_advise_cache_size(int level, int64_t size) {
+    if (size > 0) {
+        return size;
+    }
+    long detected = -1;
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE) && \
+    defined(_SC_LEVEL3_CACHE_SIZE)
+    switch (level) {
+        case 1:
+            detected = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+            break;
+        case 2:
+            detected = sysconf(_SC_LEVEL2_CACHE_SIZE);
+            break;
+        default:
+            detected = sysconf(_SC_LEVEL3_CACHE_SIZE);
+            break;
+    }
+#endif
+    if (detected > 0) {
+        return detected;
+    }
+    switch (level) {
+        case 1:
+            return CATERVA_ADVISE_L1SIZE;
+        case 2:
+            return CATERVA_ADVISE_L2SIZE;
+        default:
+            return CATERVA_ADVISE_L3SIZE;
+    }
+}
+
+// Lay out (up to) `nitems` items in `shape`, bounded by `bound`, growing the dimensions in `order`
+// one after the other
+static void caterva_advise_fill(int8_t ndim, const int64_t *bound, const int8_t *order,
+                                int64_t nitems, int64_t *shape) {
+    int64_t n = 1;
+    for (int i = 0; i < ndim; ++i) {
+        int8_t dim = order[i];
+        int64_t extent = nitems / n;
+        shape[dim] = extent < bound[dim] ? extent : bound[dim];
+        if (shape[dim] < 1) {
+            shape[dim] = 1;
+        }
+        n *= shape[dim];
+    }
+}
+
+// Lay out (up to) `nitems` items in `shape`, bounded by `bound`, keeping it proportional to
+// `weights`. The dimension that lags the most behind its weight is doubled until the next
+// doubling does not fit, and then it takes what is left.
+static void caterva_advise_scale(int8_t ndim, const int64_t *bound, const int64_t *weights,
+                                 int64_t nitems, int64_t *shape) {
+    bool grow[CATERVA_MAX_DIM];
+    for (int i = 0; i < ndim; ++i) {
+        shape[i] = 1;
+        grow[i] = bound[i] > 1;
+    }
+    int64_t n = 1;
+    while (true) {
+        int dim = -1;
+        for (int i = 0; i < ndim; ++i) {
+            if (grow[i] && (dim < 0 || shape[i] * weights[dim] < shape[dim] * weights[i])) {
+                dim = i;
+            }
+        }
+        if (dim < 0) {
+            break;
+        }
+        int64_t rest = n / shape[dim];
+        int64_t extent = shape[dim] * 2 < bound[dim] ? shape[dim] * 2 : bound[dim];
+        if (rest * extent > nitems) {
+            extent = nitems / rest;
+            grow[dim] = false;
+        }
+        if (extent > shape[dim]) {
+            shape[dim] = extent;
+            n = rest * extent;
+        }
+        if (shape[dim] == bound[dim]) {
+            grow[dim] = false;
+        }
+    }
+}
+
+// Lay out `nitems` items bounded by `bound` following the access pattern of `advice`
+static void caterva_advise_partition(int8_t ndim, const int64_t *bound, caterva_advice_t *advice,
+                                     int64_t nitems, int64_t *shape) {
+    int8_t order[CATERVA_MAX_DIM];
+    int64_t weights[CATERVA_MAX_DIM];
+    switch (advice->pattern) {
+        case CATERVA_PATTERN_ROWS:
+            for (int8_t i = 0; i < ndim; ++i) {
+                order[i] = (int8_t) (ndim - 1 - i);
+            }
+            caterva_advise_fill(ndim, bound, order, nitems, shape);
+            break;
+        case CATERVA_PATTERN_COLUMNS:
+            for (int8_t i = 0; i < ndim; ++i) {
+                order[i] = i;
+            }
+            caterva_advise_fill(ndim, bound, order, nitems, shape);
+            break;
+        default:
+            for (int i = 0; i < ndim; ++i) {
+                weights[i] = advice->boxshape[i] < 1 ? 1 : advice->boxshape[i];
+                if (weights[i] > bound[i]) {
+                    weights[i] = bound[i];
+                }
+            }
+            caterva_advise_scale(ndim, bound, weights, nitems, shape);
+            break;
+    }
+
+    // Keep the number of partitions per dimension, but shrink them to reduce the padding
+    for (int i = 0; i < ndim; ++i) {
+        int64_t nparts = (bound[i] + shape[i] - 1) / shape[i];
+        shape[i] = (bound[i] + nparts - 1) / nparts;
+    }
+}
+
+static void caterva_advise_candidate(int8_t ndim, const int64_t *shape, caterva_advice_t *advice,
+                                     int64_t chunknitems, int64_t blocknitems,
+                                     caterva_advise_candidate_t *candidate) {
+    if (blocknitems > chunknitems) {
+        blocknitems = chunknitems;
+    }
+    caterva_advise_partition(ndim, shape, advice, chunknitems, candidate->chunkshape);
+    caterva_advise_partition(ndim, candidate->chunkshape, advice, blocknitems,
+                             candidate->blockshape);
+}
+
+// Time the reads of the access pattern of `advice` on its sample, stored with `candidate`
+static int caterva_advise_time(caterva_ctx_t *ctx, caterva_params_t *params,
+                               caterva_advice_t *advice, caterva_advise_candidate_t *candidate,
+                               double *secs) {
+    int8_t ndim = params->ndim;
+    caterva_params_t sparams = *params;
+    caterva_storage_t storage = {0};
+    storage.backend = CATERVA_STORAGE_BLOSC;
+    for (int i = 0; i < ndim; ++i) {
+        sparams.shape[i] = advice->sampleshape[i];
+        storage.properties.blosc.chunkshape[i] = (int32_t) candidate->chunkshape[i];
+        storage.properties.blosc.blockshape[i] = (int32_t) candidate->blockshape[i];
+    }
+
+    caterva_array_t *array;
+    CATERVA_ERROR(caterva_from_buffer(ctx, advice->sample, advice->samplesize, &sparams, &storage,
+                                      &array));
+
+    int64_t sliceshape[CATERVA_MAX_DIM];
+    int64_t slicesize = params->itemsize;
+    for (int i = 0; i < ndim; ++i) {
+        switch (advice->pattern) {
+            case CATERVA_PATTERN_ROWS:
+                sliceshape[i] = i == ndim - 1 ? sparams.shape[i] : 1;
+                break;
+            case CATERVA_PATTERN_COLUMNS:
+                sliceshape[i] = i == 0 ? sparams.shape[i] : 1;
+                break;
+            default:
+                sliceshape[i] = advice->boxshape[i] > 0 ? advice->boxshape[i] :
+                                sparams.shape[i] / 2;
+                break;
+        }
+        if (sliceshape[i] > sparams.shape[i]) {
+            sliceshape[i] = sparams.shape[i];
+        }
+        if (sliceshape[i] < 1) {
+            sliceshape[i] = 1;
+        }
+        slicesize *= sliceshape[i];
+    }
+    uint8_t *slice = caterva_pool_alloc(ctx, (size_t) slicesize);
+    int rc = slice == NULL ? CATERVA_ERR_NULL_POINTER : CATERVA_SUCCEED;
+
+    // The slices are spread over the sample, visiting every dimension in a different order
+    blosc_timestamp_t start_time;
+    blosc_timestamp_t stop_time;
+    blosc_set_timestamp(&start_time);
+    for (int n = 0; rc == CATERVA_SUCCEED && n < CATERVA_ADVISE_NREADS; ++n) {
+        int64_t start[CATERVA_MAX_DIM];
+        int64_t stop[CATERVA_MAX_DIM];
+        for (int i = 0; i < ndim; ++i) {
+            int64_t range = sparams.shape[i] - sliceshape[i] + 1;
+            start[i] = ((int64_t) n * (2 * i + 1) * 7919) % range;
+            stop[i] = start[i] + sliceshape[i];
+        }
+        rc = caterva_get_slice_buffer(ctx, array, start, stop, sliceshape, slice, slicesize);
+    }
+    blosc_set_timestamp(&stop_time);
+    *secs = blosc_elapsed_secs(start_time, stop_time);
+
+    if (slice != NULL) {
+        caterva_pool_release(ctx, slice);
+    }
+    caterva_free(ctx, &array);
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_advise_shapes(caterva_ctx_t *ctx, caterva_params_t *params, caterva_advice_t *advice,
+                          caterva_storage_t *storage) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(params);
+    CATERVA_ERROR_NULL(advice);
+    CATERVA_ERROR_NULL(storage);
+
+    int8_t ndim = params->ndim;
+    int64_t itemsize = params->itemsize;
+    if (ndim == 0) {
+        return CATERVA_SUCCEED;
+    }
+
+    int64_t shape[CATERVA_MAX_DIM];
+    int64_t nitems = 1;
+    for (int i = 0; i < ndim; ++i) {
+        shape[i] = params->shape[i] > 0 ? params->shape[i] : 1;
+        nitems *= shape[i];
+    }
+
+    if (advice->sample != NULL) {
+        int64_t samplesize = itemsize;
+        for (int i = 0; i < ndim; ++i) {
+            samplesize *= advice->sampleshape[i];
+        }
+        if (samplesize == 0 || samplesize != advice->samplesize) {
+            DEBUG_PRINT("The sample size does not match its shape");
+            CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+        }
+    }
+
+    int64_t l1size = caterva_advise_cache_size(1, advice->l1size);
+    int64_t l2size = caterva_advise_cache_size(2, advice->l2size);
+    int64_t l3size = caterva_advise_cache_size(3, advice->l3size);
+    int nreaders = advice->nreaders > 0 ? advice->nreaders : ctx->cfg->nthreads;
+    if (nreaders < 1) {
+        nreaders = 1;
+    }
+
+    // A decompressed block takes half of L2, leaving room for its compressed data and for the
+    // destination of the copy. Blocks smaller than L1 only add overhead, but the blocks should
+    // not be much larger than the boxes read either.
+    int64_t blocknitems = l2size / 2 / itemsize;
+    if (advice->pattern == CATERVA_PATTERN_BOXES) {
+        int64_t boxnitems = 1;
+        for (int i = 0; i < ndim; ++i) {
+            boxnitems *= advice->boxshape[i] > 0 ? advice->boxshape[i] : shape[i];
+        }
+        if (boxnitems < blocknitems) {
+            blocknitems = boxnitems;
+        }
+    }
+    if (blocknitems < l1size / itemsize) {
+        blocknitems = l1size / itemsize;
+    }
+    if (blocknitems < 1) {
+        blocknitems = 1;
+    }
+
+    // The chunks being decompressed by all the readers share L3, but there must be enough chunks
+    // to keep all of them busy
+    int64_t chunknitems = l3size / nreaders / itemsize;
+    if (chunknitems > nitems / nreaders) {
+        chunknitems = nitems / nreaders;
+    }
+    if (chunknitems < blocknitems) {
+        chunknitems = blocknitems;
+    }
+
+    caterva_advise_candidate_t best;
+    caterva_advise_candidate(ndim, shape, advice, chunknitems, blocknitems, &best);
+
+    if (advice->sample != NULL) {
+        // Halve and double the chunks and the blocks around the first guess
+        int64_t factors[][2] = {{2, 2}, {2, 1}, {2, 4}, {1, 2}, {4, 2}};
+        double best_secs = -1;
+        for (size_t n = 0; n < sizeof(factors) / sizeof(factors[0]); ++n) {
+            int64_t cnitems = chunknitems * factors[n][0] / 2;
+            int64_t bnitems = blocknitems * factors[n][1] / 2;
+            caterva_advise_candidate_t candidate;
+            caterva_advise_candidate(ndim, shape, advice, cnitems > 0 ? cnitems : 1,
+                                     bnitems > 0 ? bnitems : 1, &candidate);
+            double secs;
+            CATERVA_ERROR(caterva_advise_time(ctx, params, advice, &candidate, &secs));
+            if (best_secs < 0 || secs < best_secs) {
+                best_secs = secs;
+                best = candidate;
+            }
+        }
+    }
+
+    for (int i = 0; i < ndim; ++i) {
+        storage->properties.blosc.chunkshape[i] = (int32_t) best.chunkshape[i];
+        storage->properties.blosc.blockshape[i] = (int32_t) best.blockshape[i];
+    }
+
+    return CATERVA_SUCCEED;
+}
@@ -0,0 +1,546 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <caterva.h>
+
+#include "caterva_blosc.h"
+#include "caterva_copy.h"
+#include "caterva_instr.h"
+#include "caterva_pool.h"
+
+/*
+ * An appender copies the data it is given into slabs: a slab is either a single chunk or the rows
+ * of a row of chunks (the chunks sharing their coordinate in the first dimension). Every chunk of
+ * a complete slab becomes a job in a ring, which is claimed by a worker that gathers, repartitions
+ * and compresses it. The worker completing the oldest chunk not written yet becomes the writer:
+ * it appends to the super-chunk all the consecutive chunks already compressed, as a batch, while
+ * the other workers keep compressing. The ring bounds the number of chunks in flight (from the
+ * moment their slab is started until they are written), and so the memory held by the appender.
+ */
+
+typedef struct {
+    uint8_t *data;
+    int64_t nrows;
+    //!< Number of rows of @p data, or -1 if it holds a single chunk.
+    int32_t chunkshape[CATERVA_MAX_DIM];
+    //!< The shape of the chunk, if it is a single chunk.
+    int64_t size;
+    //!< The size (in bytes) of @p data.
+    int64_t first;
+    //!< The first job of the slab.
+    int64_t npending;
+    //!< Number of chunks of the slab not compressed yet.
+} caterva_appender_slab_t;
+
+typedef struct {
+    caterva_appender_slab_t *slab;
+    uint8_t *cchunk;
+    int32_t cbytes;
+    //!< The size of @p cchunk, or -1 if it is not compressed yet.
+} caterva_appender_job_t;
+
+struct caterva_appender_s {
+    caterva_ctx_t *ctx;
+    caterva_array_t *array;
+    int64_t first_chunk;
+    //!< The chunk of the array produced by the first job.
+    int64_t slabchunks;
+    //!< Number of chunks in a row of chunks.
+    int64_t rowbytes;
+    //!< The size (in bytes) of a row.
+    int32_t cchunksize;
+    uint8_t zchunk[BLOSC_EXTENDED_HEADER_LENGTH];
+    //!< The special chunk that stores the chunks made only of zeros.
+    caterva_appender_slab_t *slab;
+    //!< The slab of rows being filled, if any.
+    int64_t slabrow;
+    //!< The first row of @p slab.
+    caterva_appender_job_t *jobs;
+    int64_t capacity;
+    //!< Number of jobs in the ring.
+    int64_t nreserved;
+    //!< Number of jobs reserved by the slabs started.
+    int64_t nsubmitted;
+    //!< Number of jobs that can be claimed (those of complete slabs).
+    int64_t nclaimed;
+    int64_t nwritten;
+    bool writing;
+    //!< Indicate that some worker is appending chunks to the super-chunk.
+    bool stop;
+    //!< Indicate that the workers have to finish once all the jobs are written.
+    int rc;
+    int nworkers;
+    pthread_t *threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    //!< Signaled when a slab is submitted, a job is compressed or a batch is written.
+};
+
+// Get the shape of the chunk `nchunk` of `array` (without the padding) and its number of items
+static int64_t caterva_appender_chunkshape(caterva_array_t *array, int64_t nchunk,
+                                           int32_t *chunkshape) {
+    int64_t nitems = 1;
+    for (int i = array->ndim; i < CATERVA_MAX_DIM; ++i) {
+        chunkshape[i] = 1;
+    }
+    for (int i = array->ndim - 1; i >= 0; --i) {
+        int64_t nchunks = array->extshape[i] / array->chunkshape[i];
+        int64_t start = nchunk % nchunks * array->chunkshape[i];
+        nchunk /= nchunks;
+        int64_t size = array->shape[i] - start;
+        chunkshape[i] = (int32_t) (size < array->chunkshape[i] ? size : array->chunkshape[i]);
+        nitems *= chunkshape[i];
+    }
+    return nitems;
+}
+
+// Record the error `rc` (if it is the first one). Must be called with the mutex held.
+static void caterva_appender_abort(caterva_appender_t *appender, int rc) {
+    if (appender->rc == CATERVA_SUCCEED) {
+        appender->rc = rc;
+    }
+    pthread_cond_broadcast(&appender->cond);
+}
+
+// Append the consecutive chunks already compressed, unless another worker is doing it. Must be
+// called with the mutex held.
+static void caterva_appender_write(caterva_appender_t *appender) {
+    if (appender->writing) {
+        return;
+    }
+    appender->writing = true;
+    while (appender->rc == CATERVA_SUCCEED && appender->nwritten < appender->nsubmitted &&
+           appender->jobs[appender->nwritten % appender->capacity].cbytes >= 0) {
+        int64_t first = appender->nwritten;
+        int64_t last = first;
+        while (last < appender->nsubmitted &&
+               appender->jobs[last % appender->capacity].cbytes >= 0) {
+            last++;
+        }
+        pthread_mutex_unlock(&appender->mutex);
+
+        int rc = CATERVA_SUCCEED;
+        for (int64_t n = first; n < last; ++n) {
+            caterva_appender_job_t *job = &appender->jobs[n % appender->capacity];
+            if (rc == CATERVA_SUCCEED) {
+                rc = caterva_blosc_array_append_cchunk(appender->array, job->cchunk,
+                                                       job->cbytes);
+            }
+            caterva_pool_release(appender->ctx, job->cchunk);
+        }
+
+        pthread_mutex_lock(&appender->mutex);
+        for (int64_t n = first; n < last; ++n) {
+            caterva_appender_job_t *job = &appender->jobs[n % appender->capacity];
+            job->cchunk = NULL;
+            job->cbytes = -1;
+        }
+        appender->nwritten = last;
+        if (rc != CATERVA_SUCCEED) {
+            caterva_appender_abort(appender, rc);
+        }
+        pthread_cond_broadcast(&appender->cond);
+    }
+    appender->writing = false;
+}
+
+// Fill `rchunk` with the repartitioned chunk of the job `n`, which belongs to `slab`
+static int caterva_appender_fill(caterva_appender_t *appender, caterva_appender_slab_t *slab,
+                                 int64_t n, int8_t *chunk, int8_t *rchunk, bool *zeros) {
+    caterva_array_t *array = appender->array;
+    int64_t chunkbytes = array->chunknitems * array->itemsize;
+    const int8_t *src = chunk;
+    if (slab->nrows < 0) {
+        if (slab->size == chunkbytes) {
+            src = (const int8_t *) slab->data;
+        } else {
+            caterva_blosc_array_pad_chunk(array, slab->chunkshape, slab->data, (uint8_t *) chunk);
+        }
+    } else {
+        int64_t shape[CATERVA_MAX_DIM];
+        for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+            shape[i] = array->shape[i];
+        }
+        shape[0] = slab->nrows;
+        CATERVA_ERROR(caterva_blosc_array_gather_chunk(array, (const int8_t *) slab->data, shape,
+                                                       n - slab->first, chunk));
+    }
+    if (caterva_copy_is_constant(array->itemsize, (const uint8_t *) src, array->chunknitems,
+                                 NULL)) {
+        *zeros = true;
+        return CATERVA_SUCCEED;
+    }
+    CATERVA_ERROR(caterva_blosc_array_repart_chunk(rchunk, array->extchunknitems * array->itemsize,
+                                                   (void *) src, chunkbytes, array));
+
+    return CATERVA_SUCCEED;
+}
+
+static void *caterva_appender_worker(void *arg) {
+    caterva_appender_t *appender = (caterva_appender_t *) arg;
+    caterva_ctx_t *ctx = appender->ctx;
+    caterva_array_t *array = appender->array;
+
+    int8_t *chunk = caterva_pool_alloc(ctx, (size_t) array->chunknitems * array->itemsize);
+    int8_t *rchunk = caterva_pool_alloc(ctx, (size_t) array->extchunknitems * array->itemsize);
+
+    // Each worker uses its own compression context, so blosc threads are not needed
+    blosc2_cparams *cparams;
+    blosc2_context *cctx = NULL;
+    if (blosc2_schunk_get_cparams(array->sc, &cparams) == 0) {
+        cparams->nthreads = 1;
+        cctx = blosc2_create_cctx(*cparams);
+        free(cparams);
+    }
+    caterva_instr_scratch(array, 2);
+
+    pthread_mutex_lock(&appender->mutex);
+    if (chunk == NULL || rchunk == NULL || cctx == NULL) {
+        caterva_appender_abort(appender, CATERVA_ERR_NULL_POINTER);
+    }
+    while (appender->rc == CATERVA_SUCCEED) {
+        if (appender->nclaimed == appender->nsubmitted) {
+            if (appender->stop) {
+                break;
+            }
+            pthread_cond_wait(&appender->cond, &appender->mutex);
+            continue;
+        }
+        int64_t n = appender->nclaimed++;
+        caterva_appender_job_t *job = &appender->jobs[n % appender->capacity];
+        caterva_appender_slab_t *slab = job->slab;
+        pthread_mutex_unlock(&appender->mutex);
+
+        bool zeros = false;
+        int32_t cbytes = -1;
+        uint8_t *cchunk = caterva_pool_alloc(ctx, (size_t) appender->cchunksize);
+        int rc = cchunk == NULL ? CATERVA_ERR_NULL_POINTER : CATERVA_SUCCEED;
+        if (rc == CATERVA_SUCCEED) {
+            rc = caterva_appender_fill(appender, slab, n, chunk, rchunk, &zeros);
+        }
+        if (rc == CATERVA_SUCCEED) {
+            rc = caterva_blosc_chunk_compress(array, cctx, appender->first_chunk + n, rchunk,
+                                              zeros, appender->zchunk, cchunk,
+                                              appender->cchunksize, &cbytes);
+        }
+
+        pthread_mutex_lock(&appender->mutex);
+        job->slab = NULL;
+        if (--slab->npending == 0) {
+            caterva_pool_release(ctx, slab->data);
+            ctx->cfg->free(slab);
+        }
+        if (rc != CATERVA_SUCCEED) {
+            if (cchunk != NULL) {
+                caterva_pool_release(ctx, cchunk);
+            }
+            caterva_appender_abort(appender, rc);
+            break;
+        }
+        job->cchunk = cchunk;
+        job->cbytes = cbytes;
+        caterva_appender_write(appender);
+    }
+    pthread_mutex_unlock(&appender->mutex);
+
+    if (cctx != NULL) {
+        blosc2_free_ctx(cctx);
+    }
+    if (chunk != NULL) {
+        caterva_pool_release(ctx, chunk);
+    }
+    if (rchunk != NULL) {
+        caterva_pool_release(ctx, rchunk);
+    }
+
+    return NULL;
+}
+
+int caterva_appender_new(caterva_ctx_t *ctx, caterva_array_t *array, int64_t maxbytes,
+                         caterva_appender_t **appender) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(appender);
+    if (array->storage != CATERVA_STORAGE_BLOSC) {
+        // Plain buffers are not compressed, they can be written directly
+        CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+    if (array->mmap != NULL || array->shared != NULL) {
+        CATERVA_ERROR(CATERVA_ERR_READ_ONLY);
+    }
+    if (array->filled) {
+        CATERVA_ERROR(CATERVA_ERR_CONTAINER_FILLED);
+    }
+    if (maxbytes <= 0) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    caterva_appender_t *appender_ = ctx->cfg->alloc(sizeof(caterva_appender_t));
+    CATERVA_ERROR_NULL(appender_);
+    memset(appender_, 0, sizeof(caterva_appender_t));
+    appender_->ctx = ctx;
+    appender_->array = array;
+    appender_->first_chunk = array->nchunks;
+    appender_->slabchunks = 1;
+    appender_->rowbytes = array->itemsize;
+    for (int i = 1; i < array->ndim; ++i) {
+        appender_->slabchunks *= array->extshape[i] / array->chunkshape[i];
+        appender_->rowbytes *= array->shape[i];
+    }
+    appender_->cchunksize = (int32_t) (array->extchunknitems * array->itemsize) +
+                            BLOSC_MAX_OVERHEAD;
+    int rc = caterva_blosc_zeros_chunk(array, appender_->zchunk);
+    if (rc != CATERVA_SUCCEED) {
+        ctx->cfg->free(appender_);
+        CATERVA_ERROR(rc);
+    }
+
+    // Every chunk in flight holds its share of a slab and its compressed data
+    int64_t nchunks = array->extnitems / array->chunknitems - array->nchunks;
+    appender_->capacity = maxbytes / (array->chunknitems * array->itemsize +
+                                      appender_->cchunksize);
+    if (appender_->capacity < appender_->slabchunks) {
+        appender_->capacity = appender_->slabchunks;
+    }
+    if (appender_->capacity > nchunks) {
+        appender_->capacity = nchunks;
+    }
+    caterva_appender_job_t *jobs = ctx->cfg->alloc((size_t) appender_->capacity *
+                                                   sizeof(caterva_appender_job_t));
+    if (jobs == NULL) {
+        ctx->cfg->free(appender_);
+        CATERVA_ERROR_NULL(jobs);
+    }
+    appender_->jobs = jobs;
+    for (int64_t n = 0; n < appender_->capacity; ++n) {
+        appender_->jobs[n].slab = NULL;
+        appender_->jobs[n].cchunk = NULL;
+        appender_->jobs[n].cbytes = -1;
+    }
+    pthread_mutex_init(&appender_->mutex, NULL);
+    pthread_cond_init(&appender_->cond, NULL);
+
+    appender_->nworkers = ctx->cfg->nthreads > 1 ? ctx->cfg->nthreads : 1;
+    int nstarted;
+    rc = caterva_threads_start(ctx, appender_->nworkers, caterva_appender_worker, appender_,
+                               &appender_->threads, &nstarted);
+    appender_->nworkers = nstarted;
+    if (rc != CATERVA_SUCCEED) {
+        caterva_appender_free(&appender_);
+        CATERVA_ERROR(rc);
+    }
+
+    *appender = appender_;
+    return CATERVA_SUCCEED;
+}
+
+// Start a slab of `size` bytes producing `nchunks` chunks, waiting for room in the ring
+static int caterva_appender_reserve(caterva_appender_t *appender, int64_t size, int64_t nchunks,
+                                    caterva_appender_slab_t **slab) {
+    caterva_ctx_t *ctx = appender->ctx;
+    caterva_appender_slab_t *slab_ = ctx->cfg->alloc(sizeof(caterva_appender_slab_t));
+    CATERVA_ERROR_NULL(slab_);
+    memset(slab_, 0, sizeof(caterva_appender_slab_t));
+    slab_->size = size;
+    slab_->npending = nchunks;
+
+    pthread_mutex_lock(&appender->mutex);
+    while (appender->rc == CATERVA_SUCCEED &&
+           appender->nreserved + nchunks - appender->nwritten > appender->capacity) {
+        pthread_cond_wait(&appender->cond, &appender->mutex);
+    }
+    int rc = appender->rc;
+    if (rc == CATERVA_SUCCEED) {
+        slab_->first = appender->nreserved;
+        appender->nreserved += nchunks;
+    }
+    pthread_mutex_unlock(&appender->mutex);
+    if (rc != CATERVA_SUCCEED) {
+        ctx->cfg->free(slab_);
+        CATERVA_ERROR(rc);
+    }
+
+    slab_->data = caterva_pool_alloc(ctx, (size_t) size);
+    if (slab_->data == NULL) {
+        // The reserved jobs are never submitted, so the appender can not be used anymore
+        pthread_mutex_lock(&appender->mutex);
+        caterva_appender_abort(appender, CATERVA_ERR_NULL_POINTER);
+        pthread_mutex_unlock(&appender->mutex);
+        ctx->cfg->free(slab_);
+        CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+    }
+
+    *slab = slab_;
+    return CATERVA_SUCCEED;
+}
+
+// Hand the chunks of a complete slab to the workers
+static void caterva_appender_submit(caterva_appender_t *appender, caterva_appender_slab_t *slab) {
+    pthread_mutex_lock(&appender->mutex);
+    for (int64_t n = slab->first; n < slab->first + slab->npending; ++n) {
+        appender->jobs[n % appender->capacity].slab = slab;
+    }
+    appender->nsubmitted = slab->first + slab->npending;
+    pthread_cond_broadcast(&appender->cond);
+    pthread_mutex_unlock(&appender->mutex);
+}
+
+int caterva_appender_append_chunk(caterva_appender_t *appender, const void *chunk,
+                                  int64_t chunksize) {
+    CATERVA_ERROR_NULL(appender);
+    CATERVA_ERROR_NULL(chunk);
+    caterva_array_t *array = appender->array;
+
+    if (appender->slab != NULL) {
+        DEBUG_PRINT("The rows appended do not complete a row of chunks yet");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    int64_t nchunk = appender->first_chunk + appender->nreserved;
+    if (nchunk == array->extnitems / array->chunknitems) {
+        CATERVA_ERROR(CATERVA_ERR_CONTAINER_FILLED);
+    }
+    int32_t chunkshape[CATERVA_MAX_DIM];
+    int64_t nitems = caterva_appender_chunkshape(array, nchunk, chunkshape);
+    if (chunksize != nitems * array->itemsize) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    caterva_appender_slab_t *slab;
+    CATERVA_ERROR(caterva_appender_reserve(appender, chunksize, 1, &slab));
+    slab->nrows = -1;
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        slab->chunkshape[i] = chunkshape[i];
+    }
+    memcpy(slab->data, chunk, (size_t) chunksize);
+    caterva_appender_submit(appender, slab);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_appender_append_rows(caterva_appender_t *appender, const void *buffer,
+                                 int64_t buffersize) {
+    CATERVA_ERROR_NULL(appender);
+    CATERVA_ERROR_NULL(buffer);
+    caterva_array_t *array = appender->array;
+
+    if (array->ndim == 0 || appender->rowbytes == 0 || buffersize % appender->rowbytes != 0) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    int64_t nchunk = appender->first_chunk + appender->nreserved;
+    if (appender->slab == NULL && nchunk % appender->slabchunks != 0) {
+        DEBUG_PRINT("The array does not hold whole rows of chunks");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    int64_t row = appender->slab != NULL ? appender->slabrow + appender->slab->nrows
+                                         : nchunk / appender->slabchunks * array->chunkshape[0];
+    int64_t nrows = buffersize / appender->rowbytes;
+    if (row + nrows > array->shape[0]) {
+        CATERVA_ERROR(CATERVA_ERR_CONTAINER_FILLED);
+    }
+
+    const uint8_t *rows = (const uint8_t *) buffer;
+    while (nrows > 0) {
+        if (appender->slab == NULL) {
+            int64_t slabrows = array->shape[0] - row;
+            if (slabrows > array->chunkshape[0]) {
+                slabrows = array->chunkshape[0];
+            }
+            CATERVA_ERROR(caterva_appender_reserve(appender, slabrows * appender->rowbytes,
+                                                   appender->slabchunks, &appender->slab));
+            appender->slabrow = row;
+        }
+        caterva_appender_slab_t *slab = appender->slab;
+        int64_t n = slab->size / appender->rowbytes - slab->nrows;
+        if (n > nrows) {
+            n = nrows;
+        }
+        memcpy(slab->data + slab->nrows * appender->rowbytes, rows,
+               (size_t) (n * appender->rowbytes));
+        slab->nrows += n;
+        rows += n * appender->rowbytes;
+        row += n;
+        nrows -= n;
+        if (slab->nrows * appender->rowbytes == slab->size) {
+            appender->slab = NULL;
+            caterva_appender_submit(appender, slab);
+        }
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_appender_flush(caterva_appender_t *appender) {
+    CATERVA_ERROR_NULL(appender);
+
+    pthread_mutex_lock(&appender->mutex);
+    while (appender->rc == CATERVA_SUCCEED && appender->nwritten < appender->nsubmitted) {
+        pthread_cond_wait(&appender->cond, &appender->mutex);
+    }
+    int rc = appender->rc;
+    pthread_mutex_unlock(&appender->mutex);
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_appender_free(caterva_appender_t **appender) {
+    CATERVA_ERROR_NULL(appender);
+    caterva_appender_t *appender_ = *appender;
+    if (appender_ == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    caterva_ctx_t *ctx = appender_->ctx;
+    caterva_array_t *array = appender_->array;
+
+    // The rows of an incomplete row of chunks are padded with the fill value
+    caterva_appender_slab_t *slab = appender_->slab;
+    if (slab != NULL) {
+        int64_t nrows = slab->size / appender_->rowbytes;
+        caterva_copy_fill(array->itemsize, slab->data + slab->nrows * appender_->rowbytes,
+                          (nrows - slab->nrows) * appender_->rowbytes / array->itemsize,
+                          array->fillvalue);
+        slab->nrows = nrows;
+        appender_->slab = NULL;
+        caterva_appender_submit(appender_, slab);
+    }
+
+    pthread_mutex_lock(&appender_->mutex);
+    appender_->stop = true;
+    pthread_cond_broadcast(&appender_->cond);
+    pthread_mutex_unlock(&appender_->mutex);
+    int rc = CATERVA_SUCCEED;
+    if (appender_->threads != NULL) {
+        rc = caterva_threads_join(ctx, appender_->nworkers, appender_->threads);
+    }
+    if (appender_->rc != CATERVA_SUCCEED) {
+        rc = appender_->rc;
+    }
+    pthread_mutex_destroy(&appender_->mutex);
+    pthread_cond_destroy(&appender_->cond);
+
+    // After an error, some jobs may have been left behind
+    for (int64_t n = appender_->nwritten; n < appender_->nsubmitted; ++n) {
+        caterva_appender_job_t *job = &appender_->jobs[n % appender_->capacity];
+        if (job->cchunk != NULL) {
+            caterva_pool_release(ctx, job->cchunk);
+        }
+        if (job->slab != NULL && --job->slab->npending == 0) {
+            caterva_pool_release(ctx, job->slab->data);
+            ctx->cfg->free(job->slab);
+        }
+    }
+    ctx->cfg->free(appender_->jobs);
+    ctx->cfg->free(appender_);
+    *appender = NULL;
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
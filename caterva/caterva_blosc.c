@@ -12,6 +12,18 @@
 #include <assert.h>
 #include <caterva.h>
 
+#include "caterva_blosc.h"
+#include "caterva_cache.h"
+#include "caterva_copy.h"
+#include "caterva_instr.h"
+#include "caterva_mmap.h"
+#include "caterva_plainbuffer.h"
+#include "caterva_pool.h"
+#include "caterva_shared.h"
+#include "caterva_stats.h"
+#include "caterva_versions.h"
+#include "caterva_threads.h"
+
 static void index_unidim_to_multidim(int8_t ndim, int64_t *shape, int64_t i, int64_t *index) {
     int64_t strides[CATERVA_MAX_DIM];
     strides[ndim - 1] = 1;
@@ -267,12 +279,79 @@ caterva_blosc_from_schunk(caterva_ctx_t *ctx, blosc2_schunk *schunk, caterva_arr
         (*array)->extchunkshape[i] = 1;
     }
 
-    // The partition cache (empty initially)
-    (*array)->chunk_cache.data = NULL;
-    (*array)->chunk_cache.nchunk = -1;  // means no valid cache yet
+    // The decompressed-chunk cache (disabled initially)
+    (*array)->cache = NULL;
+    (*array)->mmap = NULL;
+    (*array)->bufmap = NULL;
+    (*array)->instr = NULL;
+    (*array)->shared = NULL;
+    (*array)->pyramid = NULL;
+    CATERVA_ERROR(caterva_lock_new(ctx, &(*array)->lock));
 
     (*array)->buf = NULL;
 
+    // Load the fill value, if any
+    (*array)->fillvalue = NULL;
+    if (blosc2_vlmeta_exists(schunk, CATERVA_FILL_METALAYER) >= 0) {
+        uint8_t *content;
+        uint32_t content_len;
+        if (blosc2_vlmeta_get(schunk, CATERVA_FILL_METALAYER, &content, &content_len) < 0) {
+            CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+        }
+        // A fill value of zeros is recorded when the fill value goes back to the default
+        if (content_len != (uint32_t) (*array)->itemsize) {
+            DEBUG_PRINT("The fill value does not match the itemsize, so it is ignored");
+        } else if (!caterva_copy_is_constant((uint8_t) content_len, content, 1, NULL)) {
+            (*array)->fillvalue = ctx->cfg->alloc(content_len);
+        }
+        if ((*array)->fillvalue != NULL) {
+            memcpy((*array)->fillvalue, content, content_len);
+        }
+        free(content);
+    }
+
+    // Load the statistics index, if any
+    (*array)->stats = NULL;
+    if (blosc2_vlmeta_exists(schunk, CATERVA_STATS_METALAYER) >= 0) {
+        uint8_t *content;
+        uint32_t content_len;
+        if (blosc2_vlmeta_get(schunk, CATERVA_STATS_METALAYER, &content, &content_len) < 0) {
+            CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+        }
+        int rc = caterva_stats_deserialize(ctx, content, (int32_t) content_len,
+                                           &(*array)->stats);
+        free(content);
+        CATERVA_ERROR(rc);
+        int64_t nchunks = (*array)->chunknitems > 0 ?
+                          (*array)->extnitems / (*array)->chunknitems : 0;
+        int64_t nblocks = (*array)->blocknitems > 0 ?
+                          (*array)->extchunknitems / (*array)->blocknitems : 0;
+        if ((*array)->stats->nchunks != nchunks || (*array)->stats->nblocks != nblocks) {
+            DEBUG_PRINT("The statistics do not match the array shape, so they are ignored");
+            caterva_stats_free(ctx, &(*array)->stats);
+        }
+    }
+
+    // Load the versions of the chunks, if they are tracked
+    (*array)->versions = NULL;
+    if (blosc2_vlmeta_exists(schunk, CATERVA_VERSIONS_METALAYER) >= 0) {
+        uint8_t *content;
+        uint32_t content_len;
+        if (blosc2_vlmeta_get(schunk, CATERVA_VERSIONS_METALAYER, &content, &content_len) < 0) {
+            CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+        }
+        int rc = caterva_versions_deserialize(ctx, content, (int32_t) content_len,
+                                              &(*array)->versions);
+        free(content);
+        CATERVA_ERROR(rc);
+        int64_t nchunks = (*array)->chunknitems > 0 ?
+                          (*array)->extnitems / (*array)->chunknitems : 0;
+        if ((*array)->versions->nchunks != nchunks) {
+            DEBUG_PRINT("The versions do not match the array shape, so they are ignored");
+            caterva_versions_free(ctx, &(*array)->versions);
+        }
+    }
+
     if ((*array)->nitems == 0) {
         (*array)->filled = true;
         (*array)->empty = false;
@@ -309,12 +388,154 @@ int caterva_blosc_open(caterva_ctx_t *ctx, const char *urlpath, caterva_array_t
     return CATERVA_SUCCEED;
 }
 
-int caterva_blosc_array_free(caterva_ctx_t *ctx, caterva_array_t **array) {
-    CATERVA_UNUSED_PARAM(ctx);
+int caterva_blosc_open_mmap(caterva_ctx_t *ctx, const char *urlpath, caterva_access_t access,
+                            caterva_array_t **array) {
+    caterva_mmap_t *map;
+    CATERVA_ERROR(caterva_mmap_new(ctx, urlpath, access, &map));
+    if (map == NULL) {
+        // The frame is not contiguous, so it is read as usual
+        CATERVA_ERROR(caterva_blosc_open(ctx, urlpath, array));
+        return CATERVA_SUCCEED;
+    }
+
+    // The chunks are not copied, so they are decompressed straight out of the mapping
+    blosc2_schunk *sc = blosc2_schunk_from_buffer(map->addr, map->len, false);
+    if (sc == NULL) {
+        caterva_mmap_free(ctx, &map);
+        DEBUG_PRINT("Blosc error");
+        return CATERVA_ERR_BLOSC_FAILED;
+    }
+    int rc = caterva_from_schunk(ctx, sc, array);
+    if (rc != CATERVA_SUCCEED) {
+        blosc2_schunk_free(sc);
+        caterva_mmap_free(ctx, &map);
+        CATERVA_ERROR(rc);
+    }
+    (*array)->mmap = map;
+
+    return CATERVA_SUCCEED;
+}
+
+// Store the statistics index in its metalayer, if it has changed since the last time
+static int caterva_blosc_stats_flush(caterva_array_t *array) {
+    caterva_stats_index_t *index = array->stats;
+    if (index == NULL || !index->dirty || array->mmap != NULL) {
+        return CATERVA_SUCCEED;
+    }
+    uint8_t *content;
+    int32_t content_len;
+    CATERVA_ERROR(caterva_stats_serialize(index, &content, &content_len));
+    int rc;
+    if (blosc2_vlmeta_exists(array->sc, CATERVA_STATS_METALAYER) < 0) {
+        rc = blosc2_vlmeta_add(array->sc, CATERVA_STATS_METALAYER, content,
+                               (uint32_t) content_len, NULL);
+    } else {
+        rc = blosc2_vlmeta_update(array->sc, CATERVA_STATS_METALAYER, content,
+                                  (uint32_t) content_len, NULL);
+    }
+    free(content);
+    if (rc < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+    index->dirty = false;
+
+    return CATERVA_SUCCEED;
+}
+
+// Store the versions of the chunks in their metalayer, if they have changed since the last time
+static int caterva_blosc_versions_flush(caterva_array_t *array) {
+    caterva_versions_t *versions = array->versions;
+    if (versions == NULL || !versions->dirty || array->mmap != NULL) {
+        return CATERVA_SUCCEED;
+    }
+    uint8_t *content;
+    int32_t content_len;
+    CATERVA_ERROR(caterva_versions_serialize(versions, &content, &content_len));
+    int rc;
+    if (blosc2_vlmeta_exists(array->sc, CATERVA_VERSIONS_METALAYER) < 0) {
+        rc = blosc2_vlmeta_add(array->sc, CATERVA_VERSIONS_METALAYER, content,
+                               (uint32_t) content_len, NULL);
+    } else {
+        rc = blosc2_vlmeta_update(array->sc, CATERVA_VERSIONS_METALAYER, content,
+                                  (uint32_t) content_len, NULL);
+    }
+    free(content);
+    if (rc < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+    versions->dirty = false;
+
+    return CATERVA_SUCCEED;
+}
 
+int caterva_blosc_array_free(caterva_ctx_t *ctx, caterva_array_t **array) {
+    int rc = CATERVA_SUCCEED;
+    if ((*array)->shared != NULL) {
+        // Everything but the cache belongs to the shared array
+        caterva_cache_free(&(*array)->cache);
+        CATERVA_ERROR(caterva_shared_release(&(*array)->shared));
+        return CATERVA_SUCCEED;
+    }
     if ((*array)->sc != NULL) {
+        rc = caterva_blosc_stats_flush(*array);
+        int rc_ = caterva_blosc_versions_flush(*array);
+        rc = rc != CATERVA_SUCCEED ? rc : rc_;
         blosc2_schunk_free((*array)->sc);
     }
+    // The super-chunk may point into the mapping, so it is unmapped afterwards
+    caterva_mmap_free(ctx, &(*array)->mmap);
+    caterva_cache_free(&(*array)->cache);
+    caterva_lock_free(ctx, &(*array)->lock);
+    caterva_stats_free(ctx, &(*array)->stats);
+    caterva_versions_free(ctx, &(*array)->versions);
+    CATERVA_ERROR(rc);
+    return CATERVA_SUCCEED;
+}
+
+// Build in `chunk` (of BLOSC_EXTENDED_HEADER_LENGTH bytes) a chunk of `array` made only of zeros.
+// It is a Blosc special chunk, which is just a header, so it is never compressed or decompressed.
+int caterva_blosc_zeros_chunk(caterva_array_t *array, uint8_t *chunk) {
+    blosc2_cparams *cparams;
+    if (blosc2_schunk_get_cparams(array->sc, &cparams) < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+    int32_t chunkbytes = (int32_t) (array->extchunknitems * array->itemsize);
+    int csize = blosc2_chunk_zeros(*cparams, chunkbytes, chunk, BLOSC_EXTENDED_HEADER_LENGTH);
+    free(cparams);
+    if (csize < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+// Whether the compressed chunk `cchunk` is a special chunk made only of zeros. The other special
+// chunks (NaNs, uninitialized...) are left to the decompressor.
+static bool caterva_blosc_is_zeros_chunk(const uint8_t *cchunk, int32_t cbytes) {
+    int32_t nbytes;
+    int32_t csize;
+    if (cbytes != BLOSC_EXTENDED_HEADER_LENGTH ||
+        blosc2_cbuffer_sizes(cchunk, &nbytes, &csize, NULL) < 0) {
+        return false;
+    }
+    int special = (cchunk[BLOSC2_CHUNK_BLOSC2_FLAGS] >> 4) & BLOSC2_SPECIAL_MASK;
+    return nbytes > 0 && csize == BLOSC_EXTENDED_HEADER_LENGTH && special == BLOSC2_SPECIAL_ZERO;
+}
+
+// Append to the super-chunk of `array` a special chunk made only of zeros
+static int caterva_blosc_append_zeros(caterva_array_t *array, const uint8_t *zchunk) {
+    blosc_timestamp_t start;
+    caterva_instr_start(array, &start);
+    if (blosc2_schunk_append_chunk(array->sc, (uint8_t *) zchunk, true) < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+    caterva_instr_phase(array, CATERVA_PHASE_APPEND, &start, BLOSC_EXTENDED_HEADER_LENGTH);
+    if (array->stats != NULL) {
+        caterva_stats_update_constant(array->stats, array, array->sc->nchunks - 1, 0);
+        array->stats->dirty = true;
+    }
+    caterva_versions_touch(array->versions, array->sc->nchunks - 1);
+
     return CATERVA_SUCCEED;
 }
 
@@ -327,8 +548,11 @@ int caterva_blosc_array_repart_chunk(int8_t *rchunk, int64_t rchunksize, void *c
         CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
     }
 
+    blosc_timestamp_t start;
+    caterva_instr_start(array, &start);
     const int8_t *src_b = (int8_t *) chunk;
-    memset(rchunk, 0, (size_t) rchunksize);
+    caterva_copy_fill(array->itemsize, (uint8_t *) rchunk, array->extchunknitems,
+                      array->fillvalue);
     int32_t d_pshape[CATERVA_MAX_DIM];
     int64_t d_epshape[CATERVA_MAX_DIM];
     int32_t d_spshape[CATERVA_MAX_DIM];
@@ -346,6 +570,17 @@ int caterva_blosc_array_repart_chunk(int8_t *rchunk, int64_t rchunksize, void *c
         aux[i] = d_epshape[i] / d_spshape[i] * aux[i + 1];
     }
 
+    int64_t s_shape[CATERVA_MAX_DIM];
+    int64_t b_shape[CATERVA_MAX_DIM];
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        s_shape[i] = d_pshape[i];
+        b_shape[i] = d_spshape[i];
+    }
+    int64_t s_strides[CATERVA_MAX_DIM];
+    int64_t b_strides[CATERVA_MAX_DIM];
+    caterva_copy_strides(CATERVA_MAX_DIM, s_shape, s_strides);
+    caterva_copy_strides(CATERVA_MAX_DIM, b_shape, b_strides);
+
     /* Fill each block buffer */
     int32_t orig[CATERVA_MAX_DIM];
     int64_t actual_spsize[CATERVA_MAX_DIM];
@@ -356,106 +591,58 @@ int caterva_blosc_array_repart_chunk(int8_t *rchunk, int64_t rchunksize, void *c
             orig[i] = (int32_t)(sci % (aux[i]) / (aux[i + 1]) * d_spshape[i]);
         }
         /* Calculate if padding with 0s is needed for this block */
+        bool outside = false;
+        int64_t s_coord_f = 0;
         for (int i = CATERVA_MAX_DIM - 1; i >= 0; i--) {
+            if (orig[i] >= d_pshape[i]) {
+                outside = true;
+                break;
+            }
             if (orig[i] + d_spshape[i] > d_pshape[i]) {
                 actual_spsize[i] = (d_pshape[i] - orig[i]);
             } else {
                 actual_spsize[i] = d_spshape[i];
             }
+            s_coord_f += orig[i] * s_strides[i];
         }
-        int32_t seq_copylen = actual_spsize[7] * array->itemsize;
-        /* Reorder each line of data from src_b to chunk */
-        int64_t ii[CATERVA_MAX_DIM];
-        int64_t ncopies = 1;
-        for (int i = 0; i < CATERVA_MAX_DIM - 1; ++i) {
-            ncopies *= actual_spsize[i];
-        }
-        for (int ncopy = 0; ncopy < ncopies; ++ncopy) {
-            index_unidim_to_multidim(CATERVA_MAX_DIM - 1, actual_spsize, ncopy, ii);
-
-            int64_t d_a = d_spshape[7];
-            int64_t d_coord_f = sci * array->blocknitems;
-            for (int i = CATERVA_MAX_DIM - 2; i >= 0; i--) {
-                d_coord_f += ii[i] * d_a;
-                d_a *= d_spshape[i];
-            }
-
-            int64_t s_coord_f = orig[7];
-            int64_t s_a = d_pshape[7];
-            for (int i = CATERVA_MAX_DIM - 2; i >= 0; i--) {
-                s_coord_f += (orig[i] + ii[i]) * s_a;
-                s_a *= d_pshape[i];
-            }
-
-            memcpy(rchunk + d_coord_f * array->itemsize, src_b + s_coord_f * array->itemsize,
-                   seq_copylen);
+        if (outside) {
+            // The block only contains padding
+            continue;
         }
+        /* Reorder the data of the block from src_b to rchunk */
+        int64_t d_coord_f = (int64_t) sci * array->blocknitems;
+        caterva_copy_box(CATERVA_MAX_DIM, array->itemsize, actual_spsize,
+                         (uint8_t *) src_b + s_coord_f * array->itemsize, s_strides,
+                         (uint8_t *) rchunk + d_coord_f * array->itemsize, b_strides);
     }
+    caterva_instr_phase(array, CATERVA_PHASE_COPY, &start, chunksize);
     return CATERVA_SUCCEED;
 }
 
-int caterva_blosc_array_append(caterva_ctx_t *ctx, caterva_array_t *array, void *chunk,
-                               int32_t chunksize) {
-    CATERVA_UNUSED_PARAM(ctx);
-
-    uint8_t *bchunk = (uint8_t *) chunk;
-    int64_t typesize = array->itemsize;
-    int32_t size_rep = (int32_t)(array->extchunknitems * typesize);
-    int8_t *rchunk = ctx->cfg->alloc((size_t) size_rep);
-    int64_t c_pshape[CATERVA_MAX_DIM];
+// Copy `chunk`, with shape `chunkshape` (of a border chunk), into the full chunk `paddedchunk`,
+// padding the rest with the fill value
+void caterva_blosc_array_pad_chunk(caterva_array_t *array, const int32_t *chunkshape,
+                                   const uint8_t *chunk, uint8_t *paddedchunk) {
     int8_t c_ndim = array->ndim;
-
-    bool padding = false;
-    int32_t size_chunk = array->chunknitems * array->itemsize;
-    if (chunksize != size_chunk) {
-        padding = true;
+    caterva_copy_fill(array->itemsize, paddedchunk, array->chunknitems, array->fillvalue);
+    int64_t c_pshape[CATERVA_MAX_DIM];
+    int64_t next_pshape[CATERVA_MAX_DIM];
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        next_pshape[(CATERVA_MAX_DIM - c_ndim + i) % CATERVA_MAX_DIM] = chunkshape[i];
+        c_pshape[(CATERVA_MAX_DIM - c_ndim + i) % CATERVA_MAX_DIM] = array->chunkshape[i];
     }
+    int64_t src_strides[CATERVA_MAX_DIM];
+    int64_t dest_strides[CATERVA_MAX_DIM];
+    caterva_copy_strides(CATERVA_MAX_DIM, next_pshape, src_strides);
+    caterva_copy_strides(CATERVA_MAX_DIM, c_pshape, dest_strides);
+    caterva_copy_box(CATERVA_MAX_DIM, array->itemsize, next_pshape, chunk, src_strides,
+                     paddedchunk, dest_strides);
+}
 
-    if (padding) {
-        uint8_t *paddedchunk = ctx->cfg->alloc(size_chunk);
-        memset(paddedchunk, 0, size_chunk);
-        int32_t next_pshape[CATERVA_MAX_DIM];
-        for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-            next_pshape[(CATERVA_MAX_DIM - c_ndim + i) % CATERVA_MAX_DIM] =
-                array->next_chunkshape[i];
-            c_pshape[(CATERVA_MAX_DIM - c_ndim + i) % CATERVA_MAX_DIM] = array->chunkshape[i];
-        }
-        int32_t seq_copylen = next_pshape[7] * array->itemsize;
-        bool blank;
-        int64_t ii[CATERVA_MAX_DIM];
-        int ind_src = 0;
-        int ind_dest = 0;
-        int64_t ncopies = 1;
-        for (int i = 0; i < CATERVA_MAX_DIM - 1; ++i) {
-            ncopies *= c_pshape[i];
-        }
-        for (int ncopy = 0; ncopy < ncopies; ++ncopy) {
-            index_unidim_to_multidim(CATERVA_MAX_DIM - 1, c_pshape, ncopy, ii);
-
-            // Calculate if line is full of 0s
-            blank = false;
-            for (int i = 0; i < CATERVA_MAX_DIM - 1; i++) {
-                if (ii[i] >= next_pshape[i]) {
-                    blank = true;
-                    break;
-                }
-            }
-            if (!blank) {
-                memcpy(paddedchunk + ind_dest * array->itemsize, bchunk + ind_src * array->itemsize,
-                       seq_copylen);
-                ind_src += next_pshape[7];
-            }
-            ind_dest += c_pshape[7];
-        }
-        caterva_blosc_array_repart_chunk(rchunk, size_rep, paddedchunk, size_chunk, array);
-        ctx->cfg->free(paddedchunk);
-    } else {
-        caterva_blosc_array_repart_chunk(rchunk, size_rep, bchunk, chunksize, array);
-    }
-    if (blosc2_schunk_append_buffer(array->sc, rchunk, (size_t) size_rep) < 0) {
-        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
-    }
-    ctx->cfg->free(rchunk);
+// Update the shape of the next chunk to be appended, which is the chunk `nchunk`
+static void caterva_blosc_next_chunkshape(caterva_array_t *array, int64_t nchunk) {
+    int8_t c_ndim = array->ndim;
+    int64_t c_pshape[CATERVA_MAX_DIM];
     // Calculate chunk position in each dimension
     int64_t c_shape[CATERVA_MAX_DIM];
     int64_t c_eshape[CATERVA_MAX_DIM];
@@ -471,9 +658,9 @@ int caterva_blosc_array_append(caterva_ctx_t *ctx, caterva_array_t *array, void
     for (int i = CATERVA_MAX_DIM - 2; i >= 0; i--) {
         aux[i] = c_eshape[i] / c_pshape[i] * aux[i + 1];
     }
-    poschunk[7] = (array->nchunks + 1) % aux[7];
+    poschunk[7] = nchunk % aux[7];
     for (int i = CATERVA_MAX_DIM - 2; i >= 0; i--) {
-        poschunk[i] = ((array->nchunks + 1) % aux[i]) / aux[i + 1];
+        poschunk[i] = (nchunk % aux[i]) / aux[i + 1];
     }
 
     // Update next_chunkshape, next_chunknitems
@@ -490,31 +677,205 @@ int caterva_blosc_array_append(caterva_ctx_t *ctx, caterva_array_t *array, void
         array->next_chunkshape[i] =
             (int32_t) n_pshape[(CATERVA_MAX_DIM - c_ndim + i) % CATERVA_MAX_DIM];
     }
+}
+
+int caterva_blosc_array_append(caterva_ctx_t *ctx, caterva_array_t *array, void *chunk,
+                               int64_t chunksize) {
+    CATERVA_UNUSED_PARAM(ctx);
+
+    uint8_t *bchunk = (uint8_t *) chunk;
+    int64_t typesize = array->itemsize;
+    int32_t size_rep = (int32_t)(array->extchunknitems * typesize);
+
+    // A chunk of zeros is stored as a special chunk, without repartitioning or compressing it
+    if (caterva_copy_is_constant(array->itemsize, bchunk, chunksize / typesize, NULL)) {
+        uint8_t zchunk[BLOSC_EXTENDED_HEADER_LENGTH];
+        CATERVA_ERROR(caterva_blosc_zeros_chunk(array, zchunk));
+        CATERVA_ERROR(caterva_blosc_append_zeros(array, zchunk));
+    } else {
+        int8_t *rchunk = caterva_pool_alloc(ctx, (size_t) size_rep);
+        bool padding = false;
+        int32_t size_chunk = array->chunknitems * array->itemsize;
+        if (chunksize != size_chunk) {
+            padding = true;
+        }
+
+        caterva_instr_scratch(array, padding ? 2 : 1);
+        if (padding) {
+            uint8_t *paddedchunk = caterva_pool_alloc(ctx, size_chunk);
+            caterva_blosc_array_pad_chunk(array, array->next_chunkshape, bchunk, paddedchunk);
+            caterva_blosc_array_repart_chunk(rchunk, size_rep, paddedchunk, size_chunk, array);
+            caterva_pool_release(ctx, paddedchunk);
+        } else {
+            caterva_blosc_array_repart_chunk(rchunk, size_rep, bchunk, chunksize, array);
+        }
+        blosc_timestamp_t start;
+        caterva_instr_start(array, &start);
+        int64_t cbytes = array->sc->cbytes;
+        if (blosc2_schunk_append_buffer(array->sc, rchunk, (size_t) size_rep) < 0) {
+            CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+        }
+        caterva_instr_phase(array, CATERVA_PHASE_APPEND, &start, array->sc->cbytes - cbytes);
+        if (array->stats != NULL) {
+            caterva_stats_update(array->stats, array, array->sc->nchunks - 1,
+                                 (uint8_t *) rchunk);
+        }
+        caterva_versions_touch(array->versions, array->sc->nchunks - 1);
+        caterva_pool_release(ctx, rchunk);
+    }
+    if (array->stats != NULL) {
+        array->stats->dirty = true;
+    }
+    if (array->cache != NULL) {
+        caterva_cache_invalidate(array->cache, array->sc->nchunks - 1);
+    }
+    if (array->sc->nchunks == array->extnitems / array->chunknitems) {
+        CATERVA_ERROR(caterva_blosc_stats_flush(array));
+    }
+    caterva_blosc_next_chunkshape(array, array->nchunks + 1);
 
     return CATERVA_SUCCEED;
 }
 
-int caterva_blosc_array_from_buffer(caterva_ctx_t *ctx, caterva_array_t *array, void *buffer,
-                                    int64_t buffersize) {
-    CATERVA_UNUSED_PARAM(buffersize);
+int caterva_blosc_array_zeros(caterva_ctx_t *ctx, caterva_array_t *array) {
+    CATERVA_UNUSED_PARAM(ctx);
+    uint8_t chunk[BLOSC_EXTENDED_HEADER_LENGTH];
+    CATERVA_ERROR(caterva_blosc_zeros_chunk(array, chunk));
+
+    int64_t nchunks = array->extnitems / array->chunknitems;
+    for (int64_t nchunk = 0; nchunk < nchunks; ++nchunk) {
+        if (blosc2_schunk_append_chunk(array->sc, chunk, true) < 0) {
+            CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+        }
+    }
+
+    array->nchunks = nchunks;
+    for (int64_t nchunk = 0; nchunk < nchunks; ++nchunk) {
+        caterva_versions_touch(array->versions, nchunk);
+    }
+    if (array->stats != NULL) {
+        for (int64_t nchunk = 0; nchunk < nchunks; ++nchunk) {
+            caterva_stats_update_constant(array->stats, array, nchunk, 0);
+        }
+        array->stats->dirty = true;
+        CATERVA_ERROR(caterva_blosc_stats_flush(array));
+    }
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_set_chunk(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *coords,
+                                  void *chunk, int64_t chunksize) {
+    int8_t ndim = array->ndim;
+    int32_t chunkshape[CATERVA_MAX_DIM];
+    for (int i = ndim; i < CATERVA_MAX_DIM; ++i) {
+        chunkshape[i] = 1;
+    }
+    int64_t nchunk = 0;
+    int64_t inc = 1;
+    for (int i = ndim - 1; i >= 0; --i) {
+        nchunk += coords[i] * inc;
+        inc *= array->extshape[i] / array->chunkshape[i];
+        chunkshape[i] = array->chunkshape[i];
+        if ((coords[i] + 1) * array->chunkshape[i] > array->shape[i]) {
+            chunkshape[i] = (int32_t) (array->shape[i] - coords[i] * array->chunkshape[i]);
+        }
+    }
+
+    int32_t size_chunk = array->chunknitems * array->itemsize;
+    int32_t size_rep = (int32_t) (array->extchunknitems * array->itemsize);
+    int32_t cchunksize = size_rep + BLOSC_MAX_OVERHEAD;
+    int8_t *rchunk = caterva_pool_alloc(ctx, (size_t) size_rep);
+    uint8_t *cchunk = caterva_pool_alloc(ctx, (size_t) cchunksize);
+    uint8_t *paddedchunk = NULL;
+    if (chunksize != size_chunk) {
+        paddedchunk = caterva_pool_alloc(ctx, (size_t) size_chunk);
+    }
+    if (rchunk == NULL || cchunk == NULL || (chunksize != size_chunk && paddedchunk == NULL)) {
+        if (rchunk != NULL) {
+            caterva_pool_release(ctx, rchunk);
+        }
+        if (cchunk != NULL) {
+            caterva_pool_release(ctx, cchunk);
+        }
+        if (paddedchunk != NULL) {
+            caterva_pool_release(ctx, paddedchunk);
+        }
+        CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+    }
+
+    caterva_instr_scratch(array, paddedchunk != NULL ? 3 : 2);
+    if (paddedchunk != NULL) {
+        caterva_blosc_array_pad_chunk(array, chunkshape, chunk, paddedchunk);
+        caterva_blosc_array_repart_chunk(rchunk, size_rep, paddedchunk, size_chunk, array);
+        caterva_pool_release(ctx, paddedchunk);
+    } else {
+        caterva_blosc_array_repart_chunk(rchunk, size_rep, chunk, chunksize, array);
+    }
+    // Compress the chunk with a private context, so that different threads can do it at once.
+    // Only the insertion in the super-chunk is serialized.
+    int rc = CATERVA_SUCCEED;
+    blosc2_cparams *cparams;
+    blosc2_context *cctx = NULL;
+    if (blosc2_schunk_get_cparams(array->sc, &cparams) == 0) {
+        cctx = blosc2_create_cctx(*cparams);
+        free(cparams);
+    }
+    int cbytes = -1;
+    blosc_timestamp_t start;
+    if (cctx != NULL) {
+        caterva_instr_start(array, &start);
+        cbytes = blosc2_compress_ctx(cctx, rchunk, size_rep, cchunk, cchunksize);
+        caterva_instr_phase(array, CATERVA_PHASE_COMPRESS, &start, size_rep);
+        blosc2_free_ctx(cctx);
+    }
+    if (cbytes <= 0) {
+        rc = CATERVA_ERR_BLOSC_FAILED;
+    } else {
+        // The statistics and the version only change once the chunk has been stored
+        pthread_mutex_lock(&array->lock->mutex);
+        caterva_instr_start(array, &start);
+        if (blosc2_schunk_update_chunk(array->sc, (int) nchunk, cchunk, true) < 0) {
+            rc = CATERVA_ERR_BLOSC_FAILED;
+        } else {
+            caterva_instr_phase(array, CATERVA_PHASE_APPEND, &start, cbytes);
+            if (array->stats != NULL) {
+                caterva_stats_update(array->stats, array, nchunk, (uint8_t *) rchunk);
+                array->stats->dirty = true;
+            }
+            caterva_versions_touch(array->versions, nchunk);
+        }
+        pthread_mutex_unlock(&array->lock->mutex);
+    }
+    caterva_pool_release(ctx, rchunk);
+    caterva_pool_release(ctx, cchunk);
+    CATERVA_ERROR(rc);
+
+    if (array->cache != NULL) {
+        caterva_cache_invalidate(array->cache, nchunk);
+    }
 
-    const int8_t *bbuffer = (int8_t *) buffer;
+    return CATERVA_SUCCEED;
+}
 
+// Gather the data of the chunk `nchunk` from a C buffer with shape `shape`, which is the shape of
+// the array (or of its first rows, when `nchunk` counts the chunks from the first one in them)
+int caterva_blosc_array_gather_chunk(caterva_array_t *array, const int8_t *bbuffer,
+                                     const int64_t *shape, int64_t nchunk, int8_t *chunk) {
     int64_t d_shape[CATERVA_MAX_DIM];
     int64_t d_eshape[CATERVA_MAX_DIM];
     int32_t d_pshape[CATERVA_MAX_DIM];
     int8_t d_ndim = array->ndim;
 
     for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-        d_shape[(CATERVA_MAX_DIM - d_ndim + i) % CATERVA_MAX_DIM] = array->shape[i];
+        d_shape[(CATERVA_MAX_DIM - d_ndim + i) % CATERVA_MAX_DIM] = shape[i];
         d_eshape[(CATERVA_MAX_DIM - d_ndim + i) % CATERVA_MAX_DIM] = array->extshape[i];
         d_pshape[(CATERVA_MAX_DIM - d_ndim + i) % CATERVA_MAX_DIM] = array->chunkshape[i];
     }
 
+    blosc_timestamp_t start;
+    caterva_instr_start(array, &start);
     int8_t typesize = array->itemsize;
-    int8_t *chunk = ctx->cfg->alloc((size_t) array->chunknitems * typesize);
-    int8_t *rchunk = ctx->cfg->alloc((size_t) array->extchunknitems * typesize);
-    CATERVA_ERROR_NULL(chunk);
+    caterva_copy_fill(typesize, (uint8_t *) chunk, array->chunknitems, array->fillvalue);
 
     /* Calculate the constants out of the for  */
     int64_t aux[CATERVA_MAX_DIM];
@@ -523,290 +884,1808 @@ int caterva_blosc_array_from_buffer(caterva_ctx_t *ctx, caterva_array_t *array,
         aux[i] = d_eshape[i] / d_pshape[i] * aux[i + 1];
     }
 
-    /* Fill each chunk buffer */
+    /* Calculate the coord. of the chunk first element */
     int64_t desp[CATERVA_MAX_DIM];
     int64_t actual_psize[CATERVA_MAX_DIM];
-    for (int64_t ci = 0; ci < array->extnitems / array->chunknitems; ci++) {
-        if (!array->filled) {
-            memset(chunk, 0, array->chunknitems * typesize);
-            memset(rchunk, 0, (size_t) array->extchunknitems * typesize);
-            /* Calculate the coord. of the chunk first element */
-            desp[7] = ci % (d_eshape[7] / d_pshape[7]) * d_pshape[7];
-            for (int i = CATERVA_MAX_DIM - 2; i >= 0; i--) {
-                desp[i] = ci % (aux[i]) / (aux[i + 1]) * d_pshape[i];
-            }
-            /* Calculate if padding with 0s is needed for this chunk */
-            for (int i = CATERVA_MAX_DIM - 1; i >= 0; i--) {
-                if (desp[i] + d_pshape[i] > d_shape[i]) {
-                    actual_psize[i] = (int32_t)(d_shape[i] - desp[i]);
-                } else {
-                    actual_psize[i] = d_pshape[i];
-                }
-            }
-            int32_t seq_copylen = actual_psize[7] * typesize;
-            /* Copy each line of data from chunk to arr */
-            int64_t ii[CATERVA_MAX_DIM];
-            int64_t ncopies = 1;
-            for (int i = 0; i < CATERVA_MAX_DIM - 1; ++i) {
-                ncopies *= actual_psize[i];
-            }
-            for (int ncopy = 0; ncopy < ncopies; ++ncopy) {
-                index_unidim_to_multidim(CATERVA_MAX_DIM - 1, actual_psize, ncopy, ii);
-
-                int64_t d_a = d_pshape[7];
-                int64_t d_coord_f = 0;
-                for (int i = CATERVA_MAX_DIM - 2; i >= 0; i--) {
-                    d_coord_f += ii[i] * d_a;
-                    d_a *= d_pshape[i];
-                }
-                int64_t s_coord_f = desp[7];
-                int64_t s_a = d_shape[7];
-                for (int i = CATERVA_MAX_DIM - 2; i >= 0; i--) {
-                    s_coord_f += (desp[i] + ii[i]) * s_a;
-                    s_a *= d_shape[i];
-                }
-                memcpy(chunk + d_coord_f * typesize, bbuffer + s_coord_f * typesize, seq_copylen);
-            }
-            // Copy each chunk from rchunk to dest
-            caterva_blosc_array_repart_chunk(rchunk, (int32_t) array->extchunknitems * typesize,
-                                             chunk, array->chunknitems * typesize, array);
-
-            blosc2_schunk_append_buffer(array->sc, rchunk,
-                                        (size_t) array->extchunknitems * typesize);
-            array->empty = false;
-            array->nchunks++;
-            if (array->nchunks == array->extnitems / array->chunknitems) {
-                array->filled = true;
-            }
+    desp[7] = nchunk % (d_eshape[7] / d_pshape[7]) * d_pshape[7];
+    for (int i = CATERVA_MAX_DIM - 2; i >= 0; i--) {
+        desp[i] = nchunk % (aux[i]) / (aux[i + 1]) * d_pshape[i];
+    }
+    /* Calculate if padding with 0s is needed for this chunk */
+    for (int i = CATERVA_MAX_DIM - 1; i >= 0; i--) {
+        if (desp[i] + d_pshape[i] > d_shape[i]) {
+            actual_psize[i] = (int32_t)(d_shape[i] - desp[i]);
+        } else {
+            actual_psize[i] = d_pshape[i];
         }
     }
-    ctx->cfg->free(chunk);
-    ctx->cfg->free(rchunk);
-
-    return CATERVA_SUCCEED;
-}
-
-int caterva_blosc_array_get_slice_buffer(caterva_ctx_t *ctx, caterva_array_t *array,
-                                         int64_t *start, int64_t *stop, const int64_t *shape,
-                                         void *buffer) {
-    uint8_t *bbuffer = buffer;  // for allowing pointer arithmetic
-    int64_t start__[CATERVA_MAX_DIM];
-    int64_t stop__[CATERVA_MAX_DIM];
-    int64_t shape__[CATERVA_MAX_DIM];
-    int64_t extshape__[CATERVA_MAX_DIM];
-    int64_t chunkshape__[CATERVA_MAX_DIM];
-    int64_t extchunkshape__[CATERVA_MAX_DIM];
-    int64_t blockshape__[CATERVA_MAX_DIM];
-
+    int64_t b_shape[CATERVA_MAX_DIM];
+    int64_t s_coord_f = 0;
+    int64_t s_strides[CATERVA_MAX_DIM];
+    int64_t d_strides[CATERVA_MAX_DIM];
     for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-        start__[i] = (i < array->ndim) ? start[i] : 0;
-        stop__[i] = (i < array->ndim) ? stop[i] : 1;
-        shape__[i] = (i < array->ndim) ? shape[i] : 1;
-        extshape__[i] = (i < array->ndim) ? array->extshape[i] : 1;
-        chunkshape__[i] = (i < array->ndim) ? array->chunkshape[i] : 1;
-        extchunkshape__[i] = (i < array->ndim) ? array->extchunkshape[i] : 1;
-        blockshape__[i] = (i < array->ndim) ? array->blockshape[i] : 1;
+        b_shape[i] = d_pshape[i];
     }
+    caterva_copy_strides(CATERVA_MAX_DIM, d_shape, s_strides);
+    caterva_copy_strides(CATERVA_MAX_DIM, b_shape, d_strides);
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        s_coord_f += desp[i] * s_strides[i];
+    }
+    /* Copy the data of the chunk from arr */
+    caterva_copy_box(CATERVA_MAX_DIM, typesize, actual_psize,
+                     (const uint8_t *) bbuffer + s_coord_f * typesize, s_strides,
+                     (uint8_t *) chunk, d_strides);
+    caterva_instr_phase(array, CATERVA_PHASE_COPY, &start,
+                        (int64_t) array->chunknitems * typesize);
 
-    int64_t start_[CATERVA_MAX_DIM];
-    int64_t stop_[CATERVA_MAX_DIM];
-    int64_t d_pshape_[CATERVA_MAX_DIM];
-    int64_t s_pshape[CATERVA_MAX_DIM];
-    int64_t s_eshape[CATERVA_MAX_DIM];
-    int64_t s_epshape[CATERVA_MAX_DIM];
-    int64_t s_spshape[CATERVA_MAX_DIM];
-    int8_t s_ndim = array->ndim;
+    return CATERVA_SUCCEED;
+}
 
-    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-        start_[(CATERVA_MAX_DIM - s_ndim + i) % CATERVA_MAX_DIM] = start__[i];
-        stop_[(CATERVA_MAX_DIM - s_ndim + i) % CATERVA_MAX_DIM] = stop__[i];
-        d_pshape_[(CATERVA_MAX_DIM - s_ndim + i) % CATERVA_MAX_DIM] = shape__[i];
-        s_eshape[(CATERVA_MAX_DIM - s_ndim + i) % CATERVA_MAX_DIM] = extshape__[i];
-        s_pshape[(CATERVA_MAX_DIM - s_ndim + i) % CATERVA_MAX_DIM] = chunkshape__[i];
-        s_epshape[(CATERVA_MAX_DIM - s_ndim + i) % CATERVA_MAX_DIM] = extchunkshape__[i];
-        s_spshape[(CATERVA_MAX_DIM - s_ndim + i) % CATERVA_MAX_DIM] = blockshape__[i];
-    }
-
-    // Acceleration path for the case where we are doing (1-dim) aligned chunk reads
-    if ((s_ndim == 1) && (array->chunkshape[0] == shape[0]) &&
-        (array->chunkshape[0] == array->blockshape[0]) && (start[0] % array->chunkshape[0] == 0) &&
-        (stop[0] % array->chunkshape[0] == 0)) {
-        int nchunk = (int) (start[0] / array->chunkshape[0]);
-        // In case of an aligned read, decompress directly in destination
-        if (blosc2_schunk_decompress_chunk(array->sc, nchunk, bbuffer,
-                                           (size_t) array->chunknitems * array->sc->typesize) < 0) {
-            CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+/*
+ * Compress the repartitioned chunk `rchunk`, which will be the chunk `nchunk` of `array`, into
+ * `cchunk` and update its statistics. If `zeros` is true (or `rchunk` turns out to hold only
+ * zeros), the special chunk `zchunk` is copied instead. It can be called from several threads at
+ * once, as long as they compress different chunks.
+ */
+int caterva_blosc_chunk_compress(caterva_array_t *array, blosc2_context *cctx, int64_t nchunk,
+                                 int8_t *rchunk, bool zeros, const uint8_t *zchunk,
+                                 uint8_t *cchunk, int32_t cchunksize, int32_t *cbytes) {
+    int32_t chunkbytes = (int32_t) (array->extchunknitems * array->itemsize);
+    if (!zeros) {
+        zeros = caterva_copy_is_constant(array->itemsize, (uint8_t *) rchunk,
+                                         array->extchunknitems, NULL);
+    }
+    if (array->stats != NULL) {
+        if (zeros) {
+            caterva_stats_update_constant(array->stats, array, nchunk, 0);
+        } else {
+            caterva_stats_update(array->stats, array, nchunk, (uint8_t *) rchunk);
         }
+    }
+    if (zeros) {
+        // The chunks of zeros are not compressed, they are stored as special chunks
+        memcpy(cchunk, zchunk, BLOSC_EXTENDED_HEADER_LENGTH);
+        *cbytes = BLOSC_EXTENDED_HEADER_LENGTH;
         return CATERVA_SUCCEED;
     }
 
-    for (int j = 0; j < CATERVA_MAX_DIM - s_ndim; ++j) {
-        start_[j] = 0;
+    blosc_timestamp_t start;
+    caterva_instr_start(array, &start);
+    *cbytes = blosc2_compress_ctx(cctx, rchunk, chunkbytes, cchunk, cchunksize);
+    if (*cbytes <= 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
     }
-    /* Create chunk buffers */
-    int typesize = array->itemsize;
-    int nblocks = ((int) array->extchunknitems) / array->blocknitems;
-    bool *block_maskout = ctx->cfg->alloc(nblocks);
+    caterva_instr_phase(array, CATERVA_PHASE_COMPRESS, &start, chunkbytes);
 
-    uint8_t *chunk;
-    bool local_cache;
-    if (array->chunk_cache.data == NULL) {
-        chunk = (uint8_t *) ctx->cfg->alloc((size_t) array->extchunknitems * typesize);
-        CATERVA_ERROR_NULL(chunk);
-        local_cache = true;
-    } else {
-        chunk = array->chunk_cache.data;
-        local_cache = false;
+    return CATERVA_SUCCEED;
+}
+
+/*
+ * Append the compressed chunk `cchunk` (of `cbytes` bytes) to `array`, doing the bookkeeping of
+ * caterva_append. The statistics of the chunk must be updated already.
+ */
+int caterva_blosc_array_append_cchunk(caterva_array_t *array, uint8_t *cchunk, int32_t cbytes) {
+    blosc_timestamp_t start;
+    caterva_instr_start(array, &start);
+    if (blosc2_schunk_append_chunk(array->sc, cchunk, true) < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
     }
-    int64_t i_start[CATERVA_MAX_DIM], i_stop[CATERVA_MAX_DIM], i_shape[CATERVA_MAX_DIM];
-    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-        i_start[i] = start_[i] / s_pshape[i];
-        i_stop[i] = (stop_[i] - 1) / s_pshape[i];
-        i_shape[i] = i_stop[i] - i_start[i] + 1;
+    caterva_instr_phase(array, CATERVA_PHASE_APPEND, &start, cbytes);
+    int64_t nchunk = array->sc->nchunks - 1;
+    caterva_versions_touch(array->versions, nchunk);
+    if (array->stats != NULL) {
+        array->stats->dirty = true;
+    }
+    if (array->cache != NULL) {
+        caterva_cache_invalidate(array->cache, nchunk);
+    }
+    caterva_blosc_next_chunkshape(array, array->nchunks + 1);
+    array->empty = false;
+    array->nchunks++;
+    if (array->nchunks == array->extnitems / array->chunknitems) {
+        array->filled = true;
+        CATERVA_ERROR(caterva_blosc_stats_flush(array));
     }
 
-    /* Calculate the used chunks */
-    int64_t ii[CATERVA_MAX_DIM];
-    int64_t j_start[CATERVA_MAX_DIM], j_stop[CATERVA_MAX_DIM], j_shape[CATERVA_MAX_DIM];
-    int64_t sp_start[CATERVA_MAX_DIM], sp_stop[CATERVA_MAX_DIM], sp_shape[CATERVA_MAX_DIM];
+    return CATERVA_SUCCEED;
+}
 
-    int64_t nchunks = 1;
-    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-        nchunks *= i_shape[i];
-    }
-    for (int chunk_ind = 0; chunk_ind < nchunks; ++chunk_ind) {
-        index_unidim_to_multidim(CATERVA_MAX_DIM, i_shape, chunk_ind, ii);
-        for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-            ii[i] += i_start[i];
+typedef struct {
+    caterva_ctx_t *ctx;
+    caterva_array_t *array;
+    caterva_array_t *src;
+    //!< If it is not NULL, every worker opens a reader of this (Blosc) array for @p fill.
+    caterva_blosc_fill_fn fill;
+    void *fill_arg;
+    int64_t nchunks;
+    //!< Number of chunks to produce.
+    int64_t next_chunk;
+    //!< The next chunk to be claimed by a worker.
+    int64_t nwritten;
+    //!< Number of chunks already appended to the super-chunk.
+    int nslots;
+    //!< Number of compressed chunks that can be waiting for the writer.
+    uint8_t **slots;
+    int32_t *slots_cbytes;
+    //!< Compressed size of each slot. If it is -1, the slot is not ready yet.
+    int32_t cchunksize;
+    uint8_t zchunk[BLOSC_EXTENDED_HEADER_LENGTH];
+    //!< The special chunk that stores the chunks made only of zeros.
+    int rc;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} caterva_blosc_pipeline_t;
+
+static void caterva_blosc_pipeline_abort(caterva_blosc_pipeline_t *pipe, int rc) {
+    pthread_mutex_lock(&pipe->mutex);
+    if (pipe->rc == CATERVA_SUCCEED) {
+        pipe->rc = rc;
+    }
+    pthread_cond_broadcast(&pipe->cond);
+    pthread_mutex_unlock(&pipe->mutex);
+}
+
+static void *caterva_blosc_pipeline_worker(void *arg) {
+    caterva_blosc_pipeline_t *pipe = (caterva_blosc_pipeline_t *) arg;
+    caterva_ctx_t *ctx = pipe->ctx;
+    caterva_array_t *array = pipe->array;
+
+    int8_t *chunk = caterva_pool_alloc(ctx, (size_t) array->chunknitems * array->itemsize);
+    int8_t *rchunk = caterva_pool_alloc(ctx, (size_t) array->extchunknitems * array->itemsize);
+
+    // Each worker uses its own compression context, so blosc threads are not needed
+    blosc2_cparams *cparams;
+    blosc2_context *cctx = NULL;
+    if (blosc2_schunk_get_cparams(array->sc, &cparams) == 0) {
+        cparams->nthreads = 1;
+        cctx = blosc2_create_cctx(*cparams);
+        free(cparams);
+    }
+    if (chunk == NULL || rchunk == NULL || cctx == NULL) {
+        caterva_blosc_pipeline_abort(pipe, CATERVA_ERR_NULL_POINTER);
+    }
+    caterva_instr_scratch(array, 2);
+    caterva_blosc_reader_t reader = {0};
+    if (pipe->src != NULL) {
+        int rc = caterva_blosc_reader_init(ctx, pipe->src, 1, true, &reader);
+        if (rc != CATERVA_SUCCEED) {
+            caterva_blosc_pipeline_abort(pipe, rc);
         }
+    }
 
-        /* Get the chunk ii */
-        memset(block_maskout, true, nblocks);
-        int nchunk = 0;
-        int inc = 1;
-        for (int i = CATERVA_MAX_DIM - 1; i >= 0; --i) {
-            nchunk += (int) (ii[i] * inc);
-            inc *= (int) (s_eshape[i] / s_pshape[i]);
+    pthread_mutex_lock(&pipe->mutex);
+    while (pipe->rc == CATERVA_SUCCEED) {
+        // Do not get ahead of the writer more than the available slots
+        while (pipe->rc == CATERVA_SUCCEED && pipe->next_chunk < pipe->nchunks &&
+               pipe->next_chunk >= pipe->nwritten + pipe->nslots) {
+            pthread_cond_wait(&pipe->cond, &pipe->mutex);
+        }
+        if (pipe->rc != CATERVA_SUCCEED || pipe->next_chunk >= pipe->nchunks) {
+            break;
         }
-        if (array->chunk_cache.data != NULL) {
-            array->chunk_cache.nchunk = nchunk;
+        int64_t nchunk = pipe->next_chunk++;
+        pthread_mutex_unlock(&pipe->mutex);
+
+        int slot = (int) (nchunk % pipe->nslots);
+        bool zeros = false;
+        int rc = pipe->fill(pipe->fill_arg, pipe->src != NULL ? &reader : NULL, array, nchunk,
+                            chunk, rchunk, &zeros);
+        int32_t cbytes = -1;
+        if (rc == CATERVA_SUCCEED) {
+            rc = caterva_blosc_chunk_compress(array, cctx, nchunk, rchunk, zeros, pipe->zchunk,
+                                              pipe->slots[slot], pipe->cchunksize, &cbytes);
         }
-        /* Calculate the used blocks */
-        for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-            if (ii[i] == i_start[i]) {
-                j_start[i] = (start_[i] % s_pshape[i]) / s_spshape[i];
-            } else {
-                j_start[i] = 0;
+
+        pthread_mutex_lock(&pipe->mutex);
+        if (rc != CATERVA_SUCCEED) {
+            if (pipe->rc == CATERVA_SUCCEED) {
+                pipe->rc = rc;
             }
-            if (ii[i] == i_stop[i]) {
-                j_stop[i] = ((stop_[i] - 1) % s_pshape[i]) / s_spshape[i];
-            } else {
-                j_stop[i] = (s_epshape[i] / s_spshape[i]) - 1;
+        } else {
+            pipe->slots_cbytes[slot] = cbytes;
+        }
+        pthread_cond_broadcast(&pipe->cond);
+    }
+    pthread_mutex_unlock(&pipe->mutex);
+
+    caterva_blosc_reader_destroy(ctx, &reader);
+    if (cctx != NULL) {
+        blosc2_free_ctx(cctx);
+    }
+    if (chunk != NULL) {
+        caterva_pool_release(ctx, chunk);
+    }
+    if (rchunk != NULL) {
+        caterva_pool_release(ctx, rchunk);
+    }
+
+    return NULL;
+}
+
+/*
+ * Append `nchunks` chunks produced by `fill` to the super-chunk of `array`. Chunks are filled
+ * and compressed by `ctx->cfg->nthreads` workers, each one with its own buffers and compression
+ * context, while the calling thread appends them to the super-chunk in order.
+ */
+static int caterva_blosc_append_parallel(caterva_ctx_t *ctx, caterva_array_t *array,
+                                         caterva_array_t *src, int64_t nchunks,
+                                         caterva_blosc_fill_fn fill, void *fill_arg) {
+    caterva_blosc_pipeline_t pipe;
+    pipe.ctx = ctx;
+    pipe.array = array;
+    pipe.src = src;
+    pipe.fill = fill;
+    pipe.fill_arg = fill_arg;
+    pipe.nchunks = nchunks;
+    pipe.next_chunk = 0;
+    pipe.nwritten = 0;
+    pipe.rc = CATERVA_SUCCEED;
+    pipe.cchunksize = (int32_t) (array->extchunknitems * array->itemsize) + BLOSC_MAX_OVERHEAD;
+    CATERVA_ERROR(caterva_blosc_zeros_chunk(array, pipe.zchunk));
+
+    int nworkers = ctx->cfg->nthreads;
+    if (nworkers > nchunks) {
+        nworkers = (int) nchunks;
+    }
+    // Two slots per worker is enough to keep all of them busy while the writer appends
+    pipe.nslots = 2 * nworkers;
+    pipe.slots = ctx->cfg->alloc(pipe.nslots * sizeof(uint8_t *));
+    CATERVA_ERROR_NULL(pipe.slots);
+    pipe.slots_cbytes = ctx->cfg->alloc(pipe.nslots * sizeof(int32_t));
+    if (pipe.slots_cbytes == NULL) {
+        ctx->cfg->free(pipe.slots);
+        CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+    }
+    for (int i = 0; i < pipe.nslots; ++i) {
+        pipe.slots[i] = caterva_pool_alloc(ctx, (size_t) pipe.cchunksize);
+        if (pipe.slots[i] == NULL) {
+            // Give back the slots allocated so far
+            for (int j = 0; j < i; ++j) {
+                caterva_pool_release(ctx, pipe.slots[j]);
             }
-            j_shape[i] = j_stop[i] - j_start[i] + 1;
+            ctx->cfg->free(pipe.slots);
+            ctx->cfg->free(pipe.slots_cbytes);
+            CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
         }
+        pipe.slots_cbytes[i] = -1;
+    }
+    pthread_mutex_init(&pipe.mutex, NULL);
+    pthread_cond_init(&pipe.cond, NULL);
 
-        int64_t jj[CATERVA_MAX_DIM];
-        int64_t num_blocks = 1;
+    caterva_threads_t *threads;
+    int rc = caterva_threads_fork(ctx, nworkers, caterva_blosc_pipeline_worker, &pipe, &threads);
+    if (rc != CATERVA_SUCCEED) {
+        caterva_blosc_pipeline_abort(&pipe, rc);
+    }
+
+    // The calling thread acts as the ordered writer
+    for (int64_t nchunk = 0; rc == CATERVA_SUCCEED && nchunk < nchunks; ++nchunk) {
+        int slot = (int) (nchunk % pipe.nslots);
+        pthread_mutex_lock(&pipe.mutex);
+        while (pipe.rc == CATERVA_SUCCEED && pipe.slots_cbytes[slot] < 0) {
+            pthread_cond_wait(&pipe.cond, &pipe.mutex);
+        }
+        rc = pipe.rc;
+        pthread_mutex_unlock(&pipe.mutex);
+        if (rc != CATERVA_SUCCEED) {
+            break;
+        }
+
+        blosc_timestamp_t start;
+        caterva_instr_start(array, &start);
+        if (blosc2_schunk_append_chunk(array->sc, pipe.slots[slot], true) < 0) {
+            rc = CATERVA_ERR_BLOSC_FAILED;
+            caterva_blosc_pipeline_abort(&pipe, rc);
+            break;
+        }
+        caterva_instr_phase(array, CATERVA_PHASE_APPEND, &start, pipe.slots_cbytes[slot]);
+        caterva_versions_touch(array->versions, array->sc->nchunks - 1);
+        array->empty = false;
+        array->nchunks++;
+        if (array->nchunks == array->extnitems / array->chunknitems) {
+            array->filled = true;
+        }
+
+        pthread_mutex_lock(&pipe.mutex);
+        pipe.slots_cbytes[slot] = -1;
+        pipe.nwritten++;
+        pthread_cond_broadcast(&pipe.cond);
+        pthread_mutex_unlock(&pipe.mutex);
+    }
+
+    if (threads != NULL) {
+        int rc_join = caterva_threads_wait(ctx, &threads);
+        if (rc == CATERVA_SUCCEED) {
+            rc = rc_join;
+        }
+    }
+    pthread_mutex_destroy(&pipe.mutex);
+    pthread_cond_destroy(&pipe.cond);
+    for (int i = 0; i < pipe.nslots; ++i) {
+        caterva_pool_release(ctx, pipe.slots[i]);
+    }
+    ctx->cfg->free(pipe.slots);
+    ctx->cfg->free(pipe.slots_cbytes);
+
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+// The same as caterva_blosc_append_parallel, but filling and compressing the chunks one by one
+static int caterva_blosc_append_serial(caterva_ctx_t *ctx, caterva_array_t *array,
+                                       caterva_array_t *src, int64_t nchunks,
+                                       caterva_blosc_fill_fn fill, void *fill_arg) {
+    int8_t typesize = array->itemsize;
+    int8_t *chunk = caterva_pool_alloc(ctx, (size_t) array->chunknitems * typesize);
+    int8_t *rchunk = caterva_pool_alloc(ctx, (size_t) array->extchunknitems * typesize);
+    caterva_blosc_reader_t reader = {0};
+    int rc = chunk == NULL || rchunk == NULL ? CATERVA_ERR_NULL_POINTER : CATERVA_SUCCEED;
+    if (rc == CATERVA_SUCCEED && src != NULL) {
+        rc = caterva_blosc_reader_init(ctx, src, caterva_threads_blosc(ctx), true, &reader);
+    }
+
+    uint8_t zchunk[BLOSC_EXTENDED_HEADER_LENGTH];
+    if (rc == CATERVA_SUCCEED) {
+        rc = caterva_blosc_zeros_chunk(array, zchunk);
+    }
+
+    for (int64_t ci = 0; rc == CATERVA_SUCCEED && ci < nchunks; ci++) {
+        bool zeros = false;
+        rc = fill(fill_arg, src != NULL ? &reader : NULL, array, ci, chunk, rchunk, &zeros);
+        if (rc != CATERVA_SUCCEED) {
+            break;
+        }
+        if (!zeros) {
+            zeros = caterva_copy_is_constant(array->itemsize, (uint8_t *) rchunk,
+                                             array->extchunknitems, NULL);
+        }
+        if (zeros) {
+            // The chunks of zeros are not compressed, they are stored as special chunks
+            rc = caterva_blosc_append_zeros(array, zchunk);
+            if (rc != CATERVA_SUCCEED) {
+                break;
+            }
+        } else {
+            if (array->stats != NULL) {
+                caterva_stats_update(array->stats, array, ci, (uint8_t *) rchunk);
+                array->stats->dirty = true;
+            }
+            blosc_timestamp_t start;
+            caterva_instr_start(array, &start);
+            int64_t cbytes = array->sc->cbytes;
+            if (blosc2_schunk_append_buffer(array->sc, rchunk,
+                                            (size_t) array->extchunknitems * typesize) < 0) {
+                rc = CATERVA_ERR_BLOSC_FAILED;
+                break;
+            }
+            caterva_instr_phase(array, CATERVA_PHASE_APPEND, &start,
+                                array->sc->cbytes - cbytes);
+            caterva_versions_touch(array->versions, ci);
+        }
+        array->empty = false;
+        array->nchunks++;
+        if (array->nchunks == array->extnitems / array->chunknitems) {
+            array->filled = true;
+        }
+    }
+    caterva_blosc_reader_destroy(ctx, &reader);
+    if (chunk != NULL) {
+        caterva_pool_release(ctx, chunk);
+    }
+    if (rchunk != NULL) {
+        caterva_pool_release(ctx, rchunk);
+    }
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+static int caterva_blosc_fill_from_buffer(void *fill_arg, caterva_blosc_reader_t *reader,
+                                          caterva_array_t *array, int64_t nchunk, int8_t *chunk,
+                                          int8_t *rchunk, bool *zeros) {
+    CATERVA_UNUSED_PARAM(reader);
+    const int8_t *bbuffer = (const int8_t *) fill_arg;
+    int8_t typesize = array->itemsize;
+
+    CATERVA_ERROR(caterva_blosc_array_gather_chunk(array, bbuffer, array->shape, nchunk, chunk));
+    if (caterva_copy_is_constant(typesize, (uint8_t *) chunk, array->chunknitems, NULL)) {
+        *zeros = true;
+        return CATERVA_SUCCEED;
+    }
+    CATERVA_ERROR(caterva_blosc_array_repart_chunk(rchunk, array->extchunknitems * typesize,
+                                                   chunk, array->chunknitems * typesize, array));
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_from_buffer(caterva_ctx_t *ctx, caterva_array_t *array, void *buffer,
+                                    int64_t buffersize) {
+    CATERVA_UNUSED_PARAM(buffersize);
+
+    if (array->filled) {
+        return CATERVA_SUCCEED;
+    }
+
+    int64_t nchunks = array->extnitems / array->chunknitems;
+
+    // The user prefilter may not be prepared to be called from different chunks at once
+    if (ctx->cfg->nthreads > 1 && nchunks > 1 && ctx->cfg->prefilter == NULL) {
+        CATERVA_ERROR(caterva_blosc_append_parallel(ctx, array, NULL, nchunks,
+                                                    caterva_blosc_fill_from_buffer, buffer));
+        if (array->stats != NULL) {
+            array->stats->dirty = true;
+            CATERVA_ERROR(caterva_blosc_stats_flush(array));
+        }
+        return CATERVA_SUCCEED;
+    }
+
+    CATERVA_ERROR(caterva_blosc_append_serial(ctx, array, NULL, nchunks,
+                                              caterva_blosc_fill_from_buffer, buffer));
+    CATERVA_ERROR(caterva_blosc_stats_flush(array));
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_fill(caterva_ctx_t *ctx, caterva_array_t *array, caterva_array_t *src,
+                             caterva_blosc_fill_fn fill, void *fill_arg) {
+    if (array->filled) {
+        return CATERVA_SUCCEED;
+    }
+
+    int64_t nchunks = array->extnitems / array->chunknitems;
+    if (ctx->cfg->nthreads > 1 && nchunks > 1 && ctx->cfg->prefilter == NULL) {
+        CATERVA_ERROR(caterva_blosc_append_parallel(ctx, array, src, nchunks, fill, fill_arg));
+    } else {
+        CATERVA_ERROR(caterva_blosc_append_serial(ctx, array, src, nchunks, fill, fill_arg));
+    }
+    if (array->stats != NULL) {
+        array->stats->dirty = true;
+        CATERVA_ERROR(caterva_blosc_stats_flush(array));
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+// Make sure that the frame has loaded its chunk offsets, so that it can be read concurrently.
+// Frames stored in files load them lazily the first time a chunk is read.
+static int caterva_blosc_load_offsets(caterva_array_t *array) {
+    int rc = CATERVA_SUCCEED;
+    pthread_mutex_lock(&array->lock->mutex);
+    if (!array->lock->loaded && array->sc->nchunks > 0) {
+        uint8_t *cchunk;
+        bool needs_free;
+        if (blosc2_schunk_get_chunk(array->sc, 0, &cchunk, &needs_free) < 0) {
+            rc = CATERVA_ERR_BLOSC_FAILED;
+        } else {
+            if (needs_free) {
+                free(cchunk);
+            }
+            array->lock->loaded = true;
+        }
+    }
+    pthread_mutex_unlock(&array->lock->mutex);
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+// The scratch buffer is only allocated if `scratch` is true
+int caterva_blosc_reader_init(caterva_ctx_t *ctx, caterva_array_t *array, int nthreads,
+                              bool scratch, caterva_blosc_reader_t *reader) {
+    reader->dctx = NULL;
+    reader->block_maskout = NULL;
+    reader->chunk = NULL;
+    reader->nblocks = (int) (array->extchunknitems / array->blocknitems);
+
+    CATERVA_ERROR(caterva_blosc_load_offsets(array));
+
+    blosc2_dparams *dparams;
+    if (blosc2_schunk_get_dparams(array->sc, &dparams) < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+    dparams->nthreads = (int16_t) nthreads;
+    reader->dctx = blosc2_create_dctx(*dparams);
+    free(dparams);
+    CATERVA_ERROR_NULL(reader->dctx);
+
+    reader->block_maskout = caterva_pool_alloc(ctx, reader->nblocks);
+    CATERVA_ERROR_NULL(reader->block_maskout);
+    if (scratch) {
+        reader->chunk = caterva_pool_alloc(ctx, (size_t) array->extchunknitems * array->itemsize);
+        CATERVA_ERROR_NULL(reader->chunk);
+    }
+    caterva_instr_scratch(array, scratch ? 2 : 1);
+
+    return CATERVA_SUCCEED;
+}
+
+void caterva_blosc_reader_destroy(caterva_ctx_t *ctx, caterva_blosc_reader_t *reader) {
+    if (reader->dctx != NULL) {
+        blosc2_free_ctx(reader->dctx);
+    }
+    if (reader->block_maskout != NULL) {
+        caterva_pool_release(ctx, reader->block_maskout);
+    }
+    if (reader->chunk != NULL) {
+        caterva_pool_release(ctx, reader->chunk);
+    }
+}
+
+// Decompress the chunk `nchunk` into `dest`. If `maskout` is not NULL, only the blocks that are
+// not masked out are decompressed.
+int caterva_blosc_reader_decompress(caterva_blosc_reader_t *reader, caterva_array_t *array,
+                                    int64_t nchunk, bool *maskout, uint8_t *dest,
+                                    int32_t destsize) {
+    blosc_timestamp_t start;
+    caterva_instr_start(array, &start);
+    uint8_t *cchunk;
+    bool needs_free;
+    int cbytes = blosc2_schunk_get_chunk(array->sc, (int) nchunk, &cchunk, &needs_free);
+    if (cbytes < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+    if (array->mmap != NULL && !needs_free) {
+        caterva_mmap_willneed(array->mmap, cchunk, cbytes);
+    }
+    caterva_instr_phase(array, CATERVA_PHASE_READ, &start, cbytes);
+
+    // The chunks of zeros are served without going through the decompressor
+    if (caterva_blosc_is_zeros_chunk(cchunk, cbytes)) {
+        if (needs_free) {
+            free(cchunk);
+        }
+        if (maskout == NULL) {
+            memset(dest, 0, (size_t) destsize);
+            return CATERVA_SUCCEED;
+        }
+        int64_t blockbytes = array->blocknitems * array->itemsize;
+        for (int nblock = 0; nblock < reader->nblocks; ++nblock) {
+            int64_t offset = nblock * blockbytes;
+            if (!maskout[nblock] && offset < destsize) {
+                int64_t nbytes = offset + blockbytes > destsize ? destsize - offset : blockbytes;
+                memset(dest + offset, 0, (size_t) nbytes);
+            }
+        }
+        return CATERVA_SUCCEED;
+    }
+
+    caterva_instr_start(array, &start);
+    int nblocks = reader->nblocks;
+    if (maskout != NULL) {
+        blosc2_set_maskout(reader->dctx, maskout, reader->nblocks);
+        if (array->instr != NULL) {
+            for (int nblock = 0; nblock < reader->nblocks; ++nblock) {
+                nblocks -= maskout[nblock];
+            }
+        }
+    }
+    int rc = blosc2_decompress_ctx(reader->dctx, cchunk, cbytes, dest, destsize);
+    if (needs_free) {
+        free(cchunk);
+    }
+    if (rc < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+    if (array->instr != NULL) {
+        caterva_instr_phase(array, CATERVA_PHASE_DECOMPRESS, &start,
+                            (int64_t) nblocks * array->blocknitems * array->itemsize);
+        caterva_instr_decompressed(array, 1, nblocks);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+/**
+ * The geometry of a slice read, padded to CATERVA_MAX_DIM dimensions.
+ */
+typedef struct {
+    uint8_t *bbuffer;
+    int64_t start_[CATERVA_MAX_DIM];
+    int64_t stop_[CATERVA_MAX_DIM];
+    int64_t d_pshape_[CATERVA_MAX_DIM];
+    int64_t s_pshape[CATERVA_MAX_DIM];
+    int64_t s_eshape[CATERVA_MAX_DIM];
+    int64_t s_epshape[CATERVA_MAX_DIM];
+    int64_t s_spshape[CATERVA_MAX_DIM];
+    int64_t i_start[CATERVA_MAX_DIM];
+    int64_t i_stop[CATERVA_MAX_DIM];
+    int64_t i_shape[CATERVA_MAX_DIM];
+    //!< The coordinates (and the shape) of the chunks touched by the slice.
+    int64_t nchunks;
+    //!< Number of chunks touched by the slice.
+    const caterva_filter_t *filter;
+    //!< If it is not NULL, the blocks whose statistics do not match it are not read.
+} caterva_blosc_slice_t;
+
+static void caterva_blosc_slice_init(caterva_array_t *array, const int64_t *start,
+                                     const int64_t *stop, const int64_t *shape, void *buffer,
+                                     caterva_blosc_slice_t *slice) {
+    int64_t start__[CATERVA_MAX_DIM];
+    int64_t stop__[CATERVA_MAX_DIM];
+    int64_t shape__[CATERVA_MAX_DIM];
+    int64_t extshape__[CATERVA_MAX_DIM];
+    int64_t chunkshape__[CATERVA_MAX_DIM];
+    int64_t extchunkshape__[CATERVA_MAX_DIM];
+    int64_t blockshape__[CATERVA_MAX_DIM];
+
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        start__[i] = (i < array->ndim) ? start[i] : 0;
+        stop__[i] = (i < array->ndim) ? stop[i] : 1;
+        shape__[i] = (i < array->ndim) ? shape[i] : 1;
+        extshape__[i] = (i < array->ndim) ? array->extshape[i] : 1;
+        chunkshape__[i] = (i < array->ndim) ? array->chunkshape[i] : 1;
+        extchunkshape__[i] = (i < array->ndim) ? array->extchunkshape[i] : 1;
+        blockshape__[i] = (i < array->ndim) ? array->blockshape[i] : 1;
+    }
+
+    int8_t s_ndim = array->ndim;
+    slice->bbuffer = buffer;
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        slice->start_[(CATERVA_MAX_DIM - s_ndim + i) % CATERVA_MAX_DIM] = start__[i];
+        slice->stop_[(CATERVA_MAX_DIM - s_ndim + i) % CATERVA_MAX_DIM] = stop__[i];
+        slice->d_pshape_[(CATERVA_MAX_DIM - s_ndim + i) % CATERVA_MAX_DIM] = shape__[i];
+        slice->s_eshape[(CATERVA_MAX_DIM - s_ndim + i) % CATERVA_MAX_DIM] = extshape__[i];
+        slice->s_pshape[(CATERVA_MAX_DIM - s_ndim + i) % CATERVA_MAX_DIM] = chunkshape__[i];
+        slice->s_epshape[(CATERVA_MAX_DIM - s_ndim + i) % CATERVA_MAX_DIM] = extchunkshape__[i];
+        slice->s_spshape[(CATERVA_MAX_DIM - s_ndim + i) % CATERVA_MAX_DIM] = blockshape__[i];
+    }
+    for (int j = 0; j < CATERVA_MAX_DIM - s_ndim; ++j) {
+        slice->start_[j] = 0;
+    }
+
+    slice->filter = NULL;
+    slice->nchunks = 1;
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        slice->i_start[i] = slice->start_[i] / slice->s_pshape[i];
+        slice->i_stop[i] = (slice->stop_[i] - 1) / slice->s_pshape[i];
+        slice->i_shape[i] = slice->i_stop[i] - slice->i_start[i] + 1;
+        slice->nchunks *= slice->i_shape[i];
+    }
+}
+
+/**
+ * The position of a chunk touched by a slice, and the blocks of the chunk touched by it.
+ */
+typedef struct {
+    int64_t ii[CATERVA_MAX_DIM];
+    //!< The chunk coordinates.
+    int64_t nchunk;
+    //!< The chunk number in the super-chunk.
+    int64_t j_start[CATERVA_MAX_DIM];
+    int64_t j_stop[CATERVA_MAX_DIM];
+    int64_t j_shape[CATERVA_MAX_DIM];
+    //!< The coordinates (and the shape) of the blocks touched by the slice.
+    int64_t nblocks;
+    //!< Number of blocks touched by the slice.
+} caterva_blosc_slice_chunk_t;
+
+// Locate the `chunk_ind`-th chunk touched by `slice`
+static void caterva_blosc_slice_locate(caterva_blosc_slice_t *slice, int64_t chunk_ind,
+                                       caterva_blosc_slice_chunk_t *pos) {
+    int64_t *start_ = slice->start_;
+    int64_t *stop_ = slice->stop_;
+    int64_t *s_pshape = slice->s_pshape;
+    int64_t *s_epshape = slice->s_epshape;
+    int64_t *s_spshape = slice->s_spshape;
+    int64_t *ii = pos->ii;
+
+    index_unidim_to_multidim(CATERVA_MAX_DIM, slice->i_shape, chunk_ind, ii);
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        ii[i] += slice->i_start[i];
+    }
+
+    /* Get the chunk ii */
+    pos->nchunk = 0;
+    int64_t inc = 1;
+    for (int i = CATERVA_MAX_DIM - 1; i >= 0; --i) {
+        pos->nchunk += ii[i] * inc;
+        inc *= slice->s_eshape[i] / s_pshape[i];
+    }
+
+    /* Calculate the used blocks */
+    pos->nblocks = 1;
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        if (ii[i] == slice->i_start[i]) {
+            pos->j_start[i] = (start_[i] % s_pshape[i]) / s_spshape[i];
+        } else {
+            pos->j_start[i] = 0;
+        }
+        if (ii[i] == slice->i_stop[i]) {
+            pos->j_stop[i] = ((stop_[i] - 1) % s_pshape[i]) / s_spshape[i];
+        } else {
+            pos->j_stop[i] = (s_epshape[i] / s_spshape[i]) - 1;
+        }
+        pos->j_shape[i] = pos->j_stop[i] - pos->j_start[i] + 1;
+        pos->nblocks *= pos->j_shape[i];
+    }
+}
+
+// Get the coordinates (and the number inside the chunk) of the `block_ind`-th block touched
+static int caterva_blosc_slice_block(caterva_blosc_slice_t *slice,
+                                     caterva_blosc_slice_chunk_t *pos, int64_t block_ind,
+                                     int64_t *jj) {
+    index_unidim_to_multidim(CATERVA_MAX_DIM, pos->j_shape, block_ind, jj);
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        jj[i] += pos->j_start[i];
+    }
+    int sinc = 1;
+    int nblock = 0;
+    for (int i = CATERVA_MAX_DIM - 1; i >= 0; --i) {
+        nblock += (int) (jj[i] * sinc);
+        sinc *= (int) (slice->s_epshape[i] / slice->s_spshape[i]);
+    }
+
+    return nblock;
+}
+
+// Whether the block `nblock` of the chunk `nchunk` has to be read by a slice with `filter`
+static bool caterva_blosc_slice_match(caterva_array_t *array, const caterva_filter_t *filter,
+                                      int64_t nchunk, int nblock) {
+    if (filter == NULL) {
+        return true;
+    }
+    caterva_stats_t *stats = caterva_stats_chunk(array->stats, nchunk);
+    return caterva_stats_match(&stats[0], filter) &&
+           caterva_stats_match(&stats[1 + nblock], filter);
+}
+
+// Copy the data between the blocks of a (decompressed) chunk and the buffer of `slice`. If `set`
+// is true, the data is copied from the buffer into the chunk. The blocks skipped by the filter of
+// `slice` are not copied.
+static void caterva_blosc_slice_copy(caterva_array_t *array, caterva_blosc_slice_t *slice,
+                                     caterva_blosc_slice_chunk_t *pos, uint8_t *chunk, bool set) {
+    uint8_t *bbuffer = slice->bbuffer;
+    int64_t *start_ = slice->start_;
+    int64_t *stop_ = slice->stop_;
+    int64_t *d_pshape_ = slice->d_pshape_;
+    int64_t *s_pshape = slice->s_pshape;
+    int64_t *s_spshape = slice->s_spshape;
+    int64_t *i_start = slice->i_start;
+    int64_t *i_stop = slice->i_stop;
+    int64_t *ii = pos->ii;
+    int64_t *j_start = pos->j_start;
+    int64_t *j_stop = pos->j_stop;
+    int typesize = array->itemsize;
+
+    int64_t sp_strides[CATERVA_MAX_DIM];
+    int64_t buf_strides[CATERVA_MAX_DIM];
+    caterva_copy_strides(CATERVA_MAX_DIM, s_spshape, sp_strides);
+    caterva_copy_strides(CATERVA_MAX_DIM, d_pshape_, buf_strides);
+
+    blosc_timestamp_t start;
+    caterva_instr_start(array, &start);
+    int64_t nbytes = 0;
+    int64_t jj[CATERVA_MAX_DIM];
+    int64_t sp_start[CATERVA_MAX_DIM], sp_stop[CATERVA_MAX_DIM], sp_shape[CATERVA_MAX_DIM];
+    for (int block_ind = 0; block_ind < pos->nblocks; ++block_ind) {
+        int nblock = caterva_blosc_slice_block(slice, pos, block_ind, jj);
+        if (!caterva_blosc_slice_match(array, slice->filter, pos->nchunk, nblock)) {
+            continue;
+        }
+        int64_t s_start = nblock * array->blocknitems;
+        /* memcpy */
+        for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+            if (jj[i] == j_start[i] && ii[i] == i_start[i]) {
+                sp_start[i] = (start_[i] % s_pshape[i]) % s_spshape[i];
+            } else {
+                sp_start[i] = 0;
+            }
+            if (jj[i] == j_stop[i] && ii[i] == i_stop[i]) {
+                sp_stop[i] = (((stop_[i] - 1) % s_pshape[i]) % s_spshape[i]) + 1;
+            } else {
+                sp_stop[i] = s_spshape[i];
+            }
+            if ((jj[i] + 1) * s_spshape[i] > s_pshape[i]) {  // case padding
+                int64_t lastn = s_pshape[i] % s_spshape[i];
+                if (lastn < sp_stop[i]) {
+                    sp_stop[i] = lastn;
+                }
+            }
+            sp_shape[i] = sp_stop[i] - sp_start[i];
+        }
+        int64_t sp_pointer = s_start;
+        int64_t buf_pointer = 0;
         for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-            num_blocks *= j_shape[i];
+            sp_pointer += sp_start[i] * sp_strides[i];
+            buf_pointer +=
+                (sp_start[i] + s_spshape[i] * jj[i] + s_pshape[i] * ii[i] - start_[i]) *
+                buf_strides[i];
         }
-        for (int block_ind = 0; block_ind < num_blocks; ++block_ind) {
-            index_unidim_to_multidim(CATERVA_MAX_DIM, j_shape, block_ind, jj);
+
+        // Copy the data from the block to bdest (or from bdest to the block)
+        if (set) {
+            caterva_copy_box(CATERVA_MAX_DIM, array->itemsize, sp_shape,
+                             &bbuffer[buf_pointer * typesize], buf_strides,
+                             &chunk[sp_pointer * typesize], sp_strides);
+        } else {
+            caterva_copy_box(CATERVA_MAX_DIM, array->itemsize, sp_shape,
+                             &chunk[sp_pointer * typesize], sp_strides,
+                             &bbuffer[buf_pointer * typesize], buf_strides);
+        }
+        if (array->instr != NULL) {
+            int64_t boxbytes = typesize;
             for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-                jj[i] += j_start[i];
+                boxbytes *= sp_shape[i];
             }
-            /* Fill chunk mask */
-            int sinc = 1;
-            int nblock = 0;
-            for (int i = CATERVA_MAX_DIM - 1; i >= 0; --i) {
-                nblock += (int) (jj[i] * sinc);
-                sinc *= (int) (s_epshape[i] / s_spshape[i]);
+            nbytes += boxbytes;
+        }
+    }
+    if (!set) {
+        caterva_instr_requested(array, 1, pos->nblocks);
+    }
+    caterva_instr_phase(array, CATERVA_PHASE_COPY, &start, nbytes);
+}
+
+// Decompress the blocks of the chunk `nchunk` that are not masked out in the block mask of
+// `reader`, returning where they are. If there is a cache, the blocks that are already there are
+// reused and the missing ones are decompressed into it; the cache `entry` must then be released
+// (with the block mask of `reader`) once the blocks have been used.
+static int caterva_blosc_reader_blocks(caterva_blosc_reader_t *reader, caterva_array_t *array,
+                                       int64_t nchunk, uint8_t **chunk,
+                                       caterva_cache_entry_t **entry) {
+    *chunk = reader->chunk;
+    *entry = NULL;
+    bool decompress = true;
+    if (array->cache != NULL) {
+        uint8_t *data;
+        CATERVA_ERROR(caterva_cache_acquire(array->cache, nchunk, reader->block_maskout, &data,
+                                            &decompress, entry));
+        if (data != NULL) {
+            *chunk = data;
+        }
+        caterva_instr_cache(array, !decompress);
+    }
+    if (decompress) {
+        int rc = caterva_blosc_reader_decompress(
+            reader, array, nchunk, reader->block_maskout, *chunk,
+            (int32_t) (array->extchunknitems * array->itemsize));
+        if (rc != CATERVA_SUCCEED) {
+            if (*entry != NULL) {
+                caterva_cache_release(array->cache, *entry, reader->block_maskout, false);
+                *entry = NULL;
+            }
+            CATERVA_ERROR(rc);
+        }
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+// Decompress the blocks of the `chunk_ind`-th chunk touched by `slice` and copy them into it. The
+// number of blocks skipped by the filter of `slice` is added to `nskipped`.
+static int caterva_blosc_slice_chunk(caterva_array_t *array, caterva_blosc_slice_t *slice,
+                                     caterva_blosc_reader_t *reader, int64_t chunk_ind,
+                                     int64_t *nskipped) {
+    bool *block_maskout = reader->block_maskout;
+
+    caterva_blosc_slice_chunk_t pos;
+    caterva_blosc_slice_locate(slice, chunk_ind, &pos);
+
+    /* Fill chunk mask */
+    memset(block_maskout, true, reader->nblocks);
+    int64_t jj[CATERVA_MAX_DIM];
+    int64_t nskipped_ = 0;
+    for (int block_ind = 0; block_ind < pos.nblocks; ++block_ind) {
+        int nblock = caterva_blosc_slice_block(slice, &pos, block_ind, jj);
+        if (caterva_blosc_slice_match(array, slice->filter, pos.nchunk, nblock)) {
+            block_maskout[nblock] = false;
+        } else {
+            nskipped_++;
+        }
+    }
+    *nskipped += nskipped_;
+    if (nskipped_ == pos.nblocks) {
+        return CATERVA_SUCCEED;
+    }
+
+    uint8_t *chunk;
+    caterva_cache_entry_t *entry;
+    CATERVA_ERROR(caterva_blosc_reader_blocks(reader, array, pos.nchunk, &chunk, &entry));
+    caterva_blosc_slice_copy(array, slice, &pos, chunk, false);
+    if (entry != NULL) {
+        caterva_cache_release(array->cache, entry, reader->block_maskout, true);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+typedef struct {
+    caterva_ctx_t *ctx;
+    caterva_array_t *array;
+    caterva_blosc_slice_t *slice;
+    int64_t next_chunk;
+    //!< The next chunk (of the ones touched by the slice) to be claimed by a worker.
+    int64_t nskipped;
+    //!< Number of blocks skipped by the filter of the slice.
+    int rc;
+    pthread_mutex_t mutex;
+} caterva_blosc_slice_job_t;
+
+static void *caterva_blosc_slice_worker(void *arg) {
+    caterva_blosc_slice_job_t *job = (caterva_blosc_slice_job_t *) arg;
+
+    caterva_blosc_reader_t reader;
+    int rc = caterva_blosc_reader_init(job->ctx, job->array, 1, true, &reader);
+    int64_t nskipped = 0;
+
+    while (rc == CATERVA_SUCCEED) {
+        pthread_mutex_lock(&job->mutex);
+        if (job->rc != CATERVA_SUCCEED || job->next_chunk >= job->slice->nchunks) {
+            pthread_mutex_unlock(&job->mutex);
+            break;
+        }
+        int64_t chunk_ind = job->next_chunk++;
+        pthread_mutex_unlock(&job->mutex);
+
+        // Each chunk is copied into a different region of the buffer, so no locking is needed
+        rc = caterva_blosc_slice_chunk(job->array, job->slice, &reader, chunk_ind, &nskipped);
+    }
+    caterva_blosc_reader_destroy(job->ctx, &reader);
+
+    pthread_mutex_lock(&job->mutex);
+    if (rc != CATERVA_SUCCEED) {
+        job->rc = rc;
+    }
+    job->nskipped += nskipped;
+    pthread_mutex_unlock(&job->mutex);
+
+    return NULL;
+}
+
+// Read the chunks touched by `slice` using `ctx->cfg->nthreads` workers, each one with its own
+// reader. Every worker decompresses different chunks.
+static int caterva_blosc_slice_parallel(caterva_ctx_t *ctx, caterva_array_t *array,
+                                        caterva_blosc_slice_t *slice, int64_t *nskipped) {
+    int nworkers = ctx->cfg->nthreads;
+    if (nworkers > slice->nchunks) {
+        nworkers = (int) slice->nchunks;
+    }
+
+    caterva_blosc_slice_job_t job;
+    job.ctx = ctx;
+    job.array = array;
+    job.slice = slice;
+    job.next_chunk = 0;
+    job.nskipped = 0;
+    job.rc = CATERVA_SUCCEED;
+    pthread_mutex_init(&job.mutex, NULL);
+
+    caterva_threads_t *threads;
+    int rc = caterva_threads_fork(ctx, nworkers, caterva_blosc_slice_worker, &job, &threads);
+    if (rc != CATERVA_SUCCEED) {
+        pthread_mutex_lock(&job.mutex);
+        job.rc = rc;
+        pthread_mutex_unlock(&job.mutex);
+    }
+    if (threads != NULL) {
+        int rc_join = caterva_threads_wait(ctx, &threads);
+        if (rc == CATERVA_SUCCEED) {
+            rc = rc_join;
+        }
+    }
+    pthread_mutex_destroy(&job.mutex);
+    if (rc == CATERVA_SUCCEED) {
+        rc = job.rc;
+    }
+    *nskipped += job.nskipped;
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+// Whether a decompressed chunk is already in C order, i.e. its blocks are laid out one after the
+// other in the same order as their items. This happens when the blocks span the chunk in all but
+// the leading dimensions, where they have size 1 except in (at most) one that the block divides.
+static bool caterva_blosc_chunk_is_contiguous(caterva_array_t *array) {
+    if (array->blocknitems == 0) {
+        return false;
+    }
+    int i = 0;
+    while (i < array->ndim && array->blockshape[i] == 1) {
+        i++;
+    }
+    if (i < array->ndim) {
+        if (array->chunkshape[i] % array->blockshape[i] != 0) {
+            return false;
+        }
+        i++;
+    }
+    for (; i < array->ndim; ++i) {
+        if (array->blockshape[i] != array->chunkshape[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Decompress the whole chunk `nchunk` into `dest` in its internal (blocked) order. If there is a
+// cache, the chunk is taken from it (and kept there) instead.
+static int caterva_blosc_reader_chunk(caterva_blosc_reader_t *reader, caterva_array_t *array,
+                                      int64_t nchunk, uint8_t *dest) {
+    int32_t chunkbytes = (int32_t) (array->extchunknitems * array->itemsize);
+
+    caterva_cache_entry_t *entry = NULL;
+    uint8_t *data = NULL;
+    bool decompress = true;
+    if (array->cache != NULL) {
+        memset(reader->block_maskout, false, reader->nblocks);
+        CATERVA_ERROR(caterva_cache_acquire(array->cache, nchunk, reader->block_maskout, &data,
+                                            &decompress, &entry));
+        caterva_instr_cache(array, !decompress);
+    }
+    caterva_instr_requested(array, 1, reader->nblocks);
+    if (data == NULL) {
+        CATERVA_ERROR(caterva_blosc_reader_decompress(reader, array, nchunk, NULL, dest,
+                                                      chunkbytes));
+        return CATERVA_SUCCEED;
+    }
+
+    int rc = CATERVA_SUCCEED;
+    if (decompress) {
+        rc = caterva_blosc_reader_decompress(reader, array, nchunk, reader->block_maskout, data,
+                                             chunkbytes);
+    }
+    if (rc == CATERVA_SUCCEED) {
+        memcpy(dest, data, (size_t) chunkbytes);
+    }
+    caterva_cache_release(array->cache, entry, reader->block_maskout, rc == CATERVA_SUCCEED);
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+// Read the chunks touched by `slice` one by one (or in parallel, if there are several threads)
+static int caterva_blosc_slice_read(caterva_ctx_t *ctx, caterva_array_t *array,
+                                    caterva_blosc_slice_t *slice, int64_t *nskipped) {
+    if (ctx->cfg->nthreads > 1 && slice->nchunks > 1) {
+        CATERVA_ERROR(caterva_blosc_slice_parallel(ctx, array, slice, nskipped));
+        return CATERVA_SUCCEED;
+    }
+
+    caterva_blosc_reader_t reader;
+    int rc = caterva_blosc_reader_init(ctx, array, caterva_threads_blosc(ctx), true, &reader);
+    for (int64_t chunk_ind = 0; rc == CATERVA_SUCCEED && chunk_ind < slice->nchunks;
+         ++chunk_ind) {
+        rc = caterva_blosc_slice_chunk(array, slice, &reader, chunk_ind, nskipped);
+    }
+    caterva_blosc_reader_destroy(ctx, &reader);
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+// Let the mapping of the array (if any) know the range of chunks read by a slice
+static void caterva_blosc_slice_track(caterva_array_t *array, const int64_t *start,
+                                      const int64_t *stop) {
+    if (array->mmap == NULL) {
+        return;
+    }
+    int64_t first_nchunk = 0;
+    int64_t last_nchunk = 0;
+    bool empty = false;
+    for (int i = 0; i < array->ndim; ++i) {
+        int64_t nchunks = array->extshape[i] / array->chunkshape[i];
+        empty = empty || stop[i] <= start[i];
+        first_nchunk = first_nchunk * nchunks + start[i] / array->chunkshape[i];
+        last_nchunk = last_nchunk * nchunks + (stop[i] - 1) / array->chunkshape[i];
+    }
+    if (!empty) {
+        caterva_mmap_track(array->mmap, first_nchunk, last_nchunk);
+    }
+}
+
+// Prepare a slice read, returning whether it is exactly one chunk whose blocks are in C order (and
+// which chunk it is)
+static bool caterva_blosc_slice_aligned(caterva_array_t *array, const int64_t *start,
+                                        const int64_t *stop, const int64_t *shape,
+                                        int64_t *nchunk) {
+    caterva_blosc_slice_track(array, start, stop);
+
+    bool aligned = caterva_blosc_chunk_is_contiguous(array);
+    *nchunk = 0;
+    for (int i = 0; aligned && i < array->ndim; ++i) {
+        aligned = (start[i] % array->chunkshape[i] == 0) &&
+                  (stop[i] - start[i] == array->chunkshape[i]) &&
+                  (shape[i] == array->chunkshape[i]);
+        *nchunk = *nchunk * (array->extshape[i] / array->chunkshape[i]) +
+                  start[i] / array->chunkshape[i];
+    }
+
+    return aligned && array->ndim > 0;
+}
+
+int caterva_blosc_array_get_slice_buffer(caterva_ctx_t *ctx, caterva_array_t *array,
+                                         int64_t *start, int64_t *stop, const int64_t *shape,
+                                         void *buffer) {
+    // Acceleration path for the case where we are reading exactly one chunk whose blocks are in
+    // C order: decompress it directly in destination
+    int64_t nchunk;
+    if (caterva_blosc_slice_aligned(array, start, stop, shape, &nchunk)) {
+        caterva_blosc_reader_t reader;
+        int rc = caterva_blosc_reader_init(ctx, array, caterva_threads_blosc(ctx), false, &reader);
+        if (rc == CATERVA_SUCCEED) {
+            rc = caterva_blosc_reader_chunk(&reader, array, nchunk, buffer);
+        }
+        caterva_blosc_reader_destroy(ctx, &reader);
+        CATERVA_ERROR(rc);
+        return CATERVA_SUCCEED;
+    }
+
+    caterva_blosc_slice_t slice;
+    caterva_blosc_slice_init(array, start, stop, shape, buffer, &slice);
+    int64_t nskipped = 0;
+    CATERVA_ERROR(caterva_blosc_slice_read(ctx, array, &slice, &nskipped));
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_reader_get_slice_buffer(caterva_blosc_reader_t *reader, caterva_array_t *array,
+                                          int64_t *start, int64_t *stop, const int64_t *shape,
+                                          void *buffer) {
+    int64_t nchunk;
+    if (caterva_blosc_slice_aligned(array, start, stop, shape, &nchunk)) {
+        CATERVA_ERROR(caterva_blosc_reader_chunk(reader, array, nchunk, buffer));
+        return CATERVA_SUCCEED;
+    }
+
+    caterva_blosc_slice_t slice;
+    caterva_blosc_slice_init(array, start, stop, shape, buffer, &slice);
+    int64_t nskipped = 0;
+    for (int64_t chunk_ind = 0; chunk_ind < slice.nchunks; ++chunk_ind) {
+        CATERVA_ERROR(caterva_blosc_slice_chunk(array, &slice, reader, chunk_ind, &nskipped));
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_get_slice_buffer_filtered(caterva_ctx_t *ctx, caterva_array_t *array,
+                                                  int64_t *start, int64_t *stop,
+                                                  const int64_t *shape,
+                                                  const caterva_filter_t *filter, void *buffer,
+                                                  int64_t *nskipped) {
+    if (array->stats == NULL) {
+        DEBUG_PRINT("The array does not have statistics");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    caterva_blosc_slice_t slice;
+    caterva_blosc_slice_init(array, start, stop, shape, buffer, &slice);
+    slice.filter = filter;
+    *nskipped = 0;
+    CATERVA_ERROR(caterva_blosc_slice_read(ctx, array, &slice, nskipped));
+
+    return CATERVA_SUCCEED;
+}
+
+/**
+ * A chunk touched by one of the slices of a batch read.
+ */
+typedef struct {
+    int64_t nchunk;
+    //!< The chunk number in the super-chunk.
+    int64_t nslice;
+    //!< The slice touching the chunk.
+    int64_t chunk_ind;
+    //!< The position of the chunk among the ones touched by the slice.
+} caterva_blosc_batch_item_t;
+
+/**
+ * A batch read, where the chunks touched by the slices are grouped so that every chunk is
+ * decompressed once for all of them.
+ */
+typedef struct {
+    caterva_ctx_t *ctx;
+    caterva_array_t *array;
+    caterva_blosc_slice_t *slices;
+    caterva_blosc_batch_item_t *items;
+    //!< The chunks touched by the slices, sorted by chunk.
+    int64_t *groups;
+    //!< The first item of every chunk (and the number of items, at the end).
+    int64_t ngroups;
+    //!< Number of different chunks touched by the slices.
+    int64_t next_group;
+    //!< The next group to be claimed by a worker.
+    int rc;
+    pthread_mutex_t mutex;
+} caterva_blosc_batch_t;
+
+static int caterva_blosc_batch_compare(const void *a, const void *b) {
+    const caterva_blosc_batch_item_t *item_a = a;
+    const caterva_blosc_batch_item_t *item_b = b;
+    if (item_a->nchunk != item_b->nchunk) {
+        return item_a->nchunk < item_b->nchunk ? -1 : 1;
+    }
+    if (item_a->nslice != item_b->nslice) {
+        return item_a->nslice < item_b->nslice ? -1 : 1;
+    }
+    return 0;
+}
+
+// Decompress the union of the blocks needed by the slices touching the chunk of `group`, and copy
+// them into all of them
+static int caterva_blosc_batch_chunk(caterva_blosc_batch_t *batch, caterva_blosc_reader_t *reader,
+                                     int64_t group) {
+    caterva_array_t *array = batch->array;
+    caterva_blosc_batch_item_t *items = &batch->items[batch->groups[group]];
+    int64_t nitems = batch->groups[group + 1] - batch->groups[group];
+
+    caterva_blosc_slice_chunk_t pos;
+    int64_t jj[CATERVA_MAX_DIM];
+    memset(reader->block_maskout, true, reader->nblocks);
+    for (int64_t n = 0; n < nitems; ++n) {
+        caterva_blosc_slice_t *slice = &batch->slices[items[n].nslice];
+        caterva_blosc_slice_locate(slice, items[n].chunk_ind, &pos);
+        for (int block_ind = 0; block_ind < pos.nblocks; ++block_ind) {
+            reader->block_maskout[caterva_blosc_slice_block(slice, &pos, block_ind, jj)] = false;
+        }
+    }
+
+    uint8_t *chunk;
+    caterva_cache_entry_t *entry;
+    CATERVA_ERROR(caterva_blosc_reader_blocks(reader, array, items[0].nchunk, &chunk, &entry));
+    for (int64_t n = 0; n < nitems; ++n) {
+        caterva_blosc_slice_t *slice = &batch->slices[items[n].nslice];
+        caterva_blosc_slice_locate(slice, items[n].chunk_ind, &pos);
+        caterva_blosc_slice_copy(array, slice, &pos, chunk, false);
+    }
+    if (entry != NULL) {
+        caterva_cache_release(array->cache, entry, reader->block_maskout, true);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+static void *caterva_blosc_batch_worker(void *arg) {
+    caterva_blosc_batch_t *batch = (caterva_blosc_batch_t *) arg;
+
+    caterva_blosc_reader_t reader;
+    int rc = caterva_blosc_reader_init(batch->ctx, batch->array, 1, true, &reader);
+    while (rc == CATERVA_SUCCEED) {
+        pthread_mutex_lock(&batch->mutex);
+        if (batch->rc != CATERVA_SUCCEED || batch->next_group >= batch->ngroups) {
+            pthread_mutex_unlock(&batch->mutex);
+            break;
+        }
+        int64_t group = batch->next_group++;
+        pthread_mutex_unlock(&batch->mutex);
+
+        // Each chunk is copied into different regions of the buffers, so no locking is needed
+        rc = caterva_blosc_batch_chunk(batch, &reader, group);
+    }
+    caterva_blosc_reader_destroy(batch->ctx, &reader);
+
+    pthread_mutex_lock(&batch->mutex);
+    if (rc != CATERVA_SUCCEED) {
+        batch->rc = rc;
+    }
+    pthread_mutex_unlock(&batch->mutex);
+
+    return NULL;
+}
+
+// Read the groups of chunks of `batch` one by one (or in parallel, if there are several threads)
+static int caterva_blosc_batch_read(caterva_blosc_batch_t *batch) {
+    caterva_ctx_t *ctx = batch->ctx;
+    int nworkers = ctx->cfg->nthreads;
+    if (nworkers > batch->ngroups) {
+        nworkers = (int) batch->ngroups;
+    }
+
+    if (nworkers <= 1) {
+        caterva_blosc_reader_t reader;
+        int rc = caterva_blosc_reader_init(ctx, batch->array, caterva_threads_blosc(ctx), true, &reader);
+        for (int64_t group = 0; rc == CATERVA_SUCCEED && group < batch->ngroups; ++group) {
+            rc = caterva_blosc_batch_chunk(batch, &reader, group);
+        }
+        caterva_blosc_reader_destroy(ctx, &reader);
+        CATERVA_ERROR(rc);
+        return CATERVA_SUCCEED;
+    }
+
+    pthread_mutex_init(&batch->mutex, NULL);
+    caterva_threads_t *threads;
+    int rc = caterva_threads_fork(ctx, nworkers, caterva_blosc_batch_worker, batch, &threads);
+    if (rc != CATERVA_SUCCEED) {
+        pthread_mutex_lock(&batch->mutex);
+        batch->rc = rc;
+        pthread_mutex_unlock(&batch->mutex);
+    }
+    if (threads != NULL) {
+        int rc_join = caterva_threads_wait(ctx, &threads);
+        if (rc == CATERVA_SUCCEED) {
+            rc = rc_join;
+        }
+    }
+    pthread_mutex_destroy(&batch->mutex);
+    if (rc == CATERVA_SUCCEED) {
+        rc = batch->rc;
+    }
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_get_slice_buffers(caterva_ctx_t *ctx, caterva_array_t *array,
+                                          caterva_slice_request_t *requests,
+                                          int64_t nrequests) {
+    caterva_blosc_batch_t batch;
+    batch.ctx = ctx;
+    batch.array = array;
+    batch.items = NULL;
+    batch.groups = NULL;
+    batch.ngroups = 0;
+    batch.next_group = 0;
+    batch.rc = CATERVA_SUCCEED;
+    batch.slices = ctx->cfg->alloc(nrequests * sizeof(caterva_blosc_slice_t));
+    CATERVA_ERROR_NULL(batch.slices);
+
+    int64_t nitems = 0;
+    for (int64_t n = 0; n < nrequests; ++n) {
+        caterva_slice_request_t *request = &requests[n];
+        caterva_blosc_slice_init(array, request->start, request->stop, request->shape,
+                                 request->buffer, &batch.slices[n]);
+        bool empty = false;
+        for (int i = 0; i < array->ndim; ++i) {
+            empty = empty || request->stop[i] <= request->start[i];
+        }
+        if (empty) {
+            batch.slices[n].nchunks = 0;
+        } else {
+            caterva_blosc_slice_track(array, request->start, request->stop);
+        }
+        nitems += batch.slices[n].nchunks;
+    }
+
+    int rc = CATERVA_SUCCEED;
+    if (nitems > 0) {
+        batch.items = ctx->cfg->alloc(nitems * sizeof(caterva_blosc_batch_item_t));
+        batch.groups = ctx->cfg->alloc((nitems + 1) * sizeof(int64_t));
+        rc = batch.items == NULL || batch.groups == NULL ? CATERVA_ERR_NULL_POINTER : rc;
+    }
+    if (rc == CATERVA_SUCCEED && nitems > 0) {
+        // Group the chunks touched by the slices
+        int64_t nitem = 0;
+        for (int64_t n = 0; n < nrequests; ++n) {
+            for (int64_t chunk_ind = 0; chunk_ind < batch.slices[n].nchunks; ++chunk_ind) {
+                caterva_blosc_slice_chunk_t pos;
+                caterva_blosc_slice_locate(&batch.slices[n], chunk_ind, &pos);
+                batch.items[nitem].nchunk = pos.nchunk;
+                batch.items[nitem].nslice = n;
+                batch.items[nitem].chunk_ind = chunk_ind;
+                nitem++;
+            }
+        }
+        qsort(batch.items, (size_t) nitems, sizeof(caterva_blosc_batch_item_t),
+              caterva_blosc_batch_compare);
+        for (nitem = 0; nitem < nitems; ++nitem) {
+            if (nitem == 0 || batch.items[nitem].nchunk != batch.items[nitem - 1].nchunk) {
+                batch.groups[batch.ngroups++] = nitem;
+            }
+        }
+        batch.groups[batch.ngroups] = nitems;
+
+        rc = caterva_blosc_batch_read(&batch);
+    }
+
+    ctx->cfg->free(batch.slices);
+    if (batch.items != NULL) {
+        ctx->cfg->free(batch.items);
+    }
+    if (batch.groups != NULL) {
+        ctx->cfg->free(batch.groups);
+    }
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+/**
+ * The position of one of the points of a gather (or scatter) inside the array.
+ */
+typedef struct {
+    int64_t nchunk;
+    //!< The chunk number in the super-chunk.
+    int64_t offset;
+    //!< The position (in items) of the point in the decompressed chunk, in blocked order.
+    int64_t npoint;
+    //!< The position of the point in the request.
+} caterva_blosc_point_t;
+
+static int caterva_blosc_point_compare(const void *a, const void *b) {
+    const caterva_blosc_point_t *point_a = a;
+    const caterva_blosc_point_t *point_b = b;
+    if (point_a->nchunk != point_b->nchunk) {
+        return point_a->nchunk < point_b->nchunk ? -1 : 1;
+    }
+    if (point_a->offset != point_b->offset) {
+        return point_a->offset < point_b->offset ? -1 : 1;
+    }
+    if (point_a->npoint != point_b->npoint) {
+        return point_a->npoint < point_b->npoint ? -1 : 1;
+    }
+    return 0;
+}
+
+// Locate the points in the chunks and sort them by chunk and block (and by their position in the
+// request, for the points repeated)
+static int caterva_blosc_points_locate(caterva_ctx_t *ctx, caterva_array_t *array,
+                                       const int64_t *coords, int64_t npoints,
+                                       caterva_blosc_point_t **points) {
+    *points = ctx->cfg->alloc(npoints * sizeof(caterva_blosc_point_t));
+    CATERVA_ERROR_NULL(*points);
+
+    int8_t ndim = array->ndim;
+    for (int64_t n = 0; n < npoints; ++n) {
+        const int64_t *point = &coords[n * ndim];
+        int64_t nchunk = 0;
+        int64_t nblock = 0;
+        int64_t offset = 0;
+        for (int i = 0; i < ndim; ++i) {
+            int64_t chunk_coord = point[i] % array->chunkshape[i];
+            nchunk = nchunk * (array->extshape[i] / array->chunkshape[i]) +
+                     point[i] / array->chunkshape[i];
+            nblock = nblock * (array->extchunkshape[i] / array->blockshape[i]) +
+                     chunk_coord / array->blockshape[i];
+            offset = offset * array->blockshape[i] + chunk_coord % array->blockshape[i];
+        }
+        (*points)[n].nchunk = nchunk;
+        (*points)[n].offset = nblock * array->blocknitems + offset;
+        (*points)[n].npoint = n;
+    }
+    qsort(*points, (size_t) npoints, sizeof(caterva_blosc_point_t), caterva_blosc_point_compare);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_get_points(caterva_ctx_t *ctx, caterva_array_t *array,
+                                   const int64_t *coords, int64_t npoints, void *buffer) {
+    caterva_blosc_point_t *points;
+    CATERVA_ERROR(caterva_blosc_points_locate(ctx, array, coords, npoints, &points));
+
+    uint8_t *bbuffer = buffer;
+    uint8_t itemsize = array->itemsize;
+    caterva_blosc_reader_t reader;
+    int rc = caterva_blosc_reader_init(ctx, array, caterva_threads_blosc(ctx), true, &reader);
+    int64_t first = 0;
+    while (rc == CATERVA_SUCCEED && first < npoints) {
+        int64_t nchunk = points[first].nchunk;
+        int64_t last = first;
+        while (last < npoints && points[last].nchunk == nchunk) {
+            last++;
+        }
+
+        // Only the blocks holding some point are decompressed
+        memset(reader.block_maskout, true, reader.nblocks);
+        for (int64_t n = first; n < last; ++n) {
+            reader.block_maskout[points[n].offset / array->blocknitems] = false;
+        }
+        uint8_t *chunk;
+        caterva_cache_entry_t *entry;
+        rc = caterva_blosc_reader_blocks(&reader, array, nchunk, &chunk, &entry);
+        if (rc != CATERVA_SUCCEED) {
+            break;
+        }
+        for (int64_t n = first; n < last; ++n) {
+            memcpy(&bbuffer[points[n].npoint * itemsize], &chunk[points[n].offset * itemsize],
+                   itemsize);
+        }
+        if (entry != NULL) {
+            caterva_cache_release(array->cache, entry, reader.block_maskout, true);
+        }
+        first = last;
+    }
+    caterva_blosc_reader_destroy(ctx, &reader);
+    ctx->cfg->free(points);
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_get_chunk_buffer(caterva_blosc_reader_t *reader, caterva_array_t *array,
+                                         int64_t *coords, void *buffer) {
+    int64_t start[CATERVA_MAX_DIM];
+    int64_t stop[CATERVA_MAX_DIM];
+    int64_t shape[CATERVA_MAX_DIM];
+    int64_t nchunk = 0;
+    bool aligned = caterva_blosc_chunk_is_contiguous(array);
+    for (int i = 0; i < array->ndim; ++i) {
+        nchunk = nchunk * (array->extshape[i] / array->chunkshape[i]) + coords[i];
+        start[i] = coords[i] * array->chunkshape[i];
+        stop[i] = start[i] + array->chunkshape[i];
+        if (stop[i] > array->shape[i]) {
+            stop[i] = array->shape[i];
+            aligned = false;
+        }
+        shape[i] = stop[i] - start[i];
+    }
+
+    if (aligned) {
+        CATERVA_ERROR(caterva_blosc_reader_chunk(reader, array, nchunk, buffer));
+        return CATERVA_SUCCEED;
+    }
+
+    caterva_blosc_slice_t slice;
+    caterva_blosc_slice_init(array, start, stop, shape, buffer, &slice);
+    int64_t nskipped = 0;
+    CATERVA_ERROR(caterva_blosc_slice_chunk(array, &slice, reader, 0, &nskipped));
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_get_chunk_blocked(caterva_ctx_t *ctx, caterva_array_t *array,
+                                          int64_t *coords, void *buffer, int64_t buffersize,
+                                          caterva_chunk_layout_t *layout) {
+    int64_t nchunk = 0;
+    layout->ndim = array->ndim;
+    layout->itemsize = array->itemsize;
+    for (int i = 0; i < array->ndim; ++i) {
+        nchunk = nchunk * (array->extshape[i] / array->chunkshape[i]) + coords[i];
+        layout->start[i] = coords[i] * array->chunkshape[i];
+        layout->shape[i] = array->chunkshape[i];
+        if (layout->start[i] + layout->shape[i] > array->shape[i]) {
+            layout->shape[i] = array->shape[i] - layout->start[i];
+        }
+        layout->extchunkshape[i] = array->extchunkshape[i];
+        layout->blockshape[i] = array->blockshape[i];
+    }
+    layout->blocknitems = array->blocknitems;
+    layout->nblocks = array->extchunknitems / array->blocknitems;
+    layout->nbytes = array->extchunknitems * array->itemsize;
+    layout->contiguous = caterva_blosc_chunk_is_contiguous(array);
+
+    if (buffer == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    if (buffersize < layout->nbytes) {
+        DEBUG_PRINT("The buffer is smaller than the decompressed chunk");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    if (nchunk >= array->sc->nchunks) {
+        DEBUG_PRINT("The chunk has not been written yet");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_INDEX);
+    }
+
+    caterva_blosc_reader_t reader;
+    int rc = caterva_blosc_reader_init(ctx, array, caterva_threads_blosc(ctx), false, &reader);
+    if (rc == CATERVA_SUCCEED) {
+        rc = caterva_blosc_reader_chunk(&reader, array, nchunk, buffer);
+    }
+    caterva_blosc_reader_destroy(ctx, &reader);
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+// Create a compression context with the parameters of the super-chunk of `array`
+static int caterva_blosc_create_cctx(caterva_ctx_t *ctx, caterva_array_t *array,
+                                     blosc2_context **cctx) {
+    blosc2_cparams *cparams;
+    if (blosc2_schunk_get_cparams(array->sc, &cparams) < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+    cparams->nthreads = (int16_t) caterva_threads_blosc(ctx);
+    *cctx = blosc2_create_cctx(*cparams);
+    free(cparams);
+    if (*cctx == NULL) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+// Replace the chunk `nchunk` with the (decompressed) `chunk`, compressing it into `cchunk`. The
+// statistics and the cache are updated accordingly.
+static int caterva_blosc_chunk_replace(caterva_array_t *array, blosc2_context *cctx,
+                                       int64_t nchunk, uint8_t *chunk, uint8_t *cchunk,
+                                       int32_t cchunksize) {
+    int32_t chunkbytes = (int32_t) (array->extchunknitems * array->itemsize);
+    if (array->stats != NULL) {
+        caterva_stats_update(array->stats, array, nchunk, chunk);
+        array->stats->dirty = true;
+    }
+    blosc_timestamp_t start;
+    caterva_instr_start(array, &start);
+    int cbytes = blosc2_compress_ctx(cctx, chunk, chunkbytes, cchunk, cchunksize);
+    if (cbytes <= 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+    caterva_instr_phase(array, CATERVA_PHASE_COMPRESS, &start, chunkbytes);
+    int rc = CATERVA_SUCCEED;
+    pthread_mutex_lock(&array->lock->mutex);
+    caterva_instr_start(array, &start);
+    if (blosc2_schunk_update_chunk(array->sc, (int) nchunk, cchunk, true) < 0) {
+        rc = CATERVA_ERR_BLOSC_FAILED;
+    }
+    caterva_instr_phase(array, CATERVA_PHASE_APPEND, &start, cbytes);
+    caterva_versions_touch(array->versions, nchunk);
+    pthread_mutex_unlock(&array->lock->mutex);
+    CATERVA_ERROR(rc);
+    if (array->cache != NULL) {
+        caterva_cache_invalidate(array->cache, nchunk);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_set_slice_buffer(caterva_ctx_t *ctx, void *buffer, int64_t buffersize,
+                                         int64_t *start, int64_t *stop, caterva_array_t *array) {
+    CATERVA_UNUSED_PARAM(buffersize);
+
+    if (!array->filled) {
+        DEBUG_PRINT("The array must be filled before updating its elements");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    int64_t shape[CATERVA_MAX_DIM];
+    for (int i = 0; i < array->ndim; ++i) {
+        shape[i] = stop[i] - start[i];
+    }
+    caterva_blosc_slice_t slice;
+    caterva_blosc_slice_init(array, start, stop, shape, buffer, &slice);
+
+    int64_t s_shape[CATERVA_MAX_DIM];
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        s_shape[(CATERVA_MAX_DIM - array->ndim + i) % CATERVA_MAX_DIM] = array->shape[i];
+    }
+
+    int32_t chunkbytes = (int32_t) (array->extchunknitems * array->itemsize);
+    int32_t cchunksize = chunkbytes + BLOSC_MAX_OVERHEAD;
+    uint8_t *cchunk = caterva_pool_alloc(ctx, (size_t) cchunksize);
+    CATERVA_ERROR_NULL(cchunk);
+    caterva_blosc_reader_t reader;
+    int rc = caterva_blosc_reader_init(ctx, array, caterva_threads_blosc(ctx), true, &reader);
+    blosc2_context *cctx = NULL;
+    if (rc == CATERVA_SUCCEED) {
+        rc = caterva_blosc_create_cctx(ctx, array, &cctx);
+    }
+
+    for (int64_t chunk_ind = 0; rc == CATERVA_SUCCEED && chunk_ind < slice.nchunks; ++chunk_ind) {
+        caterva_blosc_slice_chunk_t pos;
+        caterva_blosc_slice_locate(&slice, chunk_ind, &pos);
+
+        // A chunk that is fully overwritten does not have to be decompressed
+        bool overwritten = true;
+        for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+            int64_t chunk_start = pos.ii[i] * slice.s_pshape[i];
+            int64_t chunk_stop = chunk_start + slice.s_pshape[i];
+            if (chunk_stop > s_shape[i]) {
+                chunk_stop = s_shape[i];
+            }
+            if (slice.start_[i] > chunk_start || slice.stop_[i] < chunk_stop) {
+                overwritten = false;
+                break;
+            }
+        }
+        if (overwritten) {
+            caterva_copy_fill(array->itemsize, reader.chunk, chunkbytes / array->itemsize,
+                              array->fillvalue);
+        } else {
+            rc = caterva_blosc_reader_decompress(&reader, array, pos.nchunk, NULL, reader.chunk,
+                                                 chunkbytes);
+            if (rc != CATERVA_SUCCEED) {
+                break;
             }
-            block_maskout[nblock] = false;
         }
 
-        blosc2_set_maskout(array->sc->dctx, block_maskout, nblocks);
-        blosc2_schunk_decompress_chunk(array->sc, nchunk, chunk,
-                                       (size_t) array->extchunknitems * typesize);
+        /* Merge the new data in the chunk and replace it */
+        caterva_blosc_slice_copy(array, &slice, &pos, reader.chunk, true);
+        rc = caterva_blosc_chunk_replace(array, cctx, pos.nchunk, reader.chunk, cchunk,
+                                         cchunksize);
+    }
 
-        num_blocks = 1;
-        for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-            num_blocks *= j_shape[i];
-        }
-        for (int block_ind = 0; block_ind < num_blocks; ++block_ind) {
-            index_unidim_to_multidim(CATERVA_MAX_DIM, j_shape, block_ind, jj);
-            for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-                jj[i] += j_start[i];
-            }
-            /* Decompress block jj */
-            int s_start = 0;
-            int sinc = 1;
-            int nblock = 0;
-            for (int i = CATERVA_MAX_DIM - 1; i >= 0; --i) {
-                nblock += (int) (jj[i] * sinc);
-                sinc *= (int) (s_epshape[i] / s_spshape[i]);
-            }
+    if (cctx != NULL) {
+        blosc2_free_ctx(cctx);
+    }
+    caterva_blosc_reader_destroy(ctx, &reader);
+    caterva_pool_release(ctx, cchunk);
+    CATERVA_ERROR(rc);
 
-            s_start = nblock * array->blocknitems;
-            /* memcpy */
-            for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-                if (jj[i] == j_start[i] && ii[i] == i_start[i]) {
-                    sp_start[i] = (start_[i] % s_pshape[i]) % s_spshape[i];
-                } else {
-                    sp_start[i] = 0;
-                }
-                if (jj[i] == j_stop[i] && ii[i] == i_stop[i]) {
-                    sp_stop[i] = (((stop_[i] - 1) % s_pshape[i]) % s_spshape[i]) + 1;
-                } else {
-                    sp_stop[i] = s_spshape[i];
-                }
-                if ((jj[i] + 1) * s_spshape[i] > s_pshape[i]) {  // case padding
-                    int64_t lastn = s_pshape[i] % s_spshape[i];
-                    if (lastn < sp_stop[i]) {
-                        sp_stop[i] = lastn;
-                    }
-                }
-                sp_shape[i] = sp_stop[i] - sp_start[i];
-            }
-            int64_t kk[CATERVA_MAX_DIM];
-            kk[CATERVA_MAX_DIM - 1] = sp_start[CATERVA_MAX_DIM - 1];
-            int64_t ncopies = 1;
-            for (int i = 0; i < CATERVA_MAX_DIM - 1; ++i) {
-                ncopies *= sp_shape[i];
-            }
-            for (int ncopy = 0; ncopy < ncopies; ++ncopy) {
-                index_unidim_to_multidim(CATERVA_MAX_DIM - 1, sp_shape, ncopy, kk);
-                for (int i = 0; i < CATERVA_MAX_DIM - 1; ++i) {
-                    kk[i] += sp_start[i];
-                }
+    return CATERVA_SUCCEED;
+}
 
-                // Copy each line of data from block to bdest
-                int64_t sp_pointer = 0;
-                int64_t sp_pointer_inc = 1;
-                for (int i = CATERVA_MAX_DIM - 1; i >= 0; --i) {
-                    sp_pointer += kk[i] * sp_pointer_inc;
-                    sp_pointer_inc *= s_spshape[i];
-                }
-                int64_t buf_pointer = 0;
-                int64_t buf_pointer_inc = 1;
-                for (int i = CATERVA_MAX_DIM - 1; i >= 0; --i) {
-                    buf_pointer +=
-                        (kk[i] + s_spshape[i] * jj[i] + s_pshape[i] * ii[i] - start_[i]) *
-                        buf_pointer_inc;
-                    buf_pointer_inc *= d_pshape_[i];
-                }
+int caterva_blosc_array_set_points(caterva_ctx_t *ctx, caterva_array_t *array,
+                                   const int64_t *coords, int64_t npoints, const void *buffer) {
+    if (!array->filled) {
+        DEBUG_PRINT("The array must be filled before updating its elements");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
 
-                memcpy(&bbuffer[buf_pointer * typesize], &chunk[(s_start + sp_pointer) * typesize],
-                       (size_t)(sp_stop[7] - sp_start[7]) * typesize);
-            }
+    caterva_blosc_point_t *points;
+    CATERVA_ERROR(caterva_blosc_points_locate(ctx, array, coords, npoints, &points));
+
+    const uint8_t *bbuffer = buffer;
+    uint8_t itemsize = array->itemsize;
+    int32_t chunkbytes = (int32_t) (array->extchunknitems * itemsize);
+    int32_t cchunksize = chunkbytes + BLOSC_MAX_OVERHEAD;
+    uint8_t *cchunk = caterva_pool_alloc(ctx, (size_t) cchunksize);
+    if (cchunk == NULL) {
+        ctx->cfg->free(points);
+        CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+    }
+    caterva_blosc_reader_t reader;
+    blosc2_context *cctx = NULL;
+    int rc = caterva_blosc_reader_init(ctx, array, caterva_threads_blosc(ctx), true, &reader);
+    if (rc == CATERVA_SUCCEED) {
+        rc = caterva_blosc_create_cctx(ctx, array, &cctx);
+    }
+
+    // Every chunk holding some point is decompressed, updated and recompressed once. Repeated
+    // points are sorted by their position in the request, so the last value is kept.
+    int64_t first = 0;
+    while (rc == CATERVA_SUCCEED && first < npoints) {
+        int64_t nchunk = points[first].nchunk;
+        int64_t last = first;
+        while (last < npoints && points[last].nchunk == nchunk) {
+            last++;
+        }
+        rc = caterva_blosc_reader_decompress(&reader, array, nchunk, NULL, reader.chunk,
+                                             chunkbytes);
+        if (rc != CATERVA_SUCCEED) {
+            break;
         }
+        for (int64_t n = first; n < last; ++n) {
+            memcpy(&reader.chunk[points[n].offset * itemsize],
+                   &bbuffer[points[n].npoint * itemsize], itemsize);
+        }
+        rc = caterva_blosc_chunk_replace(array, cctx, nchunk, reader.chunk, cchunk, cchunksize);
+        first = last;
+    }
+
+    if (cctx != NULL) {
+        blosc2_free_ctx(cctx);
+    }
+    caterva_blosc_reader_destroy(ctx, &reader);
+    caterva_pool_release(ctx, cchunk);
+    ctx->cfg->free(points);
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_set_cache_size(caterva_ctx_t *ctx, caterva_array_t *array,
+                                       int64_t nbytes) {
+    CATERVA_ERROR(caterva_cache_free(&array->cache));
+    int nblocks = array->blocknitems > 0 ? (int) (array->extchunknitems / array->blocknitems) : 0;
+    int64_t nchunks = array->chunknitems > 0 ? array->extnitems / array->chunknitems : 0;
+    CATERVA_ERROR(caterva_cache_new(ctx, nbytes, array->extchunknitems * array->itemsize, nblocks,
+                                    nchunks, &array->cache));
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_get_cache_stats(caterva_ctx_t *ctx, caterva_array_t *array,
+                                        caterva_cache_stats_t *stats) {
+    CATERVA_UNUSED_PARAM(ctx);
+
+    if (array->cache == NULL) {
+        memset(stats, 0, sizeof(caterva_cache_stats_t));
+    } else {
+        caterva_cache_get_stats(array->cache, stats);
     }
 
-    ctx->cfg->free(block_maskout);
-    if (local_cache) {
-        ctx->cfg->free(chunk);
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_get_chunk_stats(caterva_ctx_t *ctx, caterva_array_t *array,
+                                        int64_t *coords, caterva_stats_t *stats,
+                                        caterva_stats_t *blockstats) {
+    CATERVA_UNUSED_PARAM(ctx);
+
+    if (array->stats == NULL) {
+        DEBUG_PRINT("The array does not have statistics");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    int64_t nchunk = 0;
+    for (int i = 0; i < array->ndim; ++i) {
+        nchunk = nchunk * (array->extshape[i] / array->chunkshape[i]) + coords[i];
+    }
+    caterva_stats_t *records = caterva_stats_chunk(array->stats, nchunk);
+    *stats = records[0];
+    if (blockstats != NULL) {
+        memcpy(blockstats, &records[1], array->stats->nblocks * sizeof(caterva_stats_t));
     }
+
     return CATERVA_SUCCEED;
 }
 
@@ -828,7 +2707,7 @@ int caterva_blosc_array_get_slice(caterva_ctx_t *ctx, caterva_array_t *src, int6
                                   int64_t *stop, caterva_array_t *array) {
     int typesize = src->itemsize;
 
-    uint8_t *chunk = ctx->cfg->alloc((size_t) array->chunknitems * typesize);
+    uint8_t *chunk = caterva_pool_alloc(ctx, (size_t) array->chunknitems * typesize);
     CATERVA_ERROR_NULL(chunk);
     int64_t next_chunkshape__[CATERVA_MAX_DIM];
     int64_t chunkshape__[CATERVA_MAX_DIM];
@@ -881,7 +2760,7 @@ int caterva_blosc_array_get_slice(caterva_ctx_t *ctx, caterva_array_t *src, int6
             ii[j] += d_start[j];
         }
 
-        memset(chunk, 0, array->chunknitems * typesize);
+        caterva_copy_fill(typesize, (uint8_t *) chunk, array->chunknitems, array->fillvalue);
         int64_t jj[CATERVA_MAX_DIM];
         for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
             if (ii[i] + d_next_pshape[i] > d_stop[i]) {
@@ -899,136 +2778,709 @@ int caterva_blosc_array_get_slice(caterva_ctx_t *ctx, caterva_array_t *src, int6
             stop_[i] = jj[(CATERVA_MAX_DIM - d_ndim + i) % CATERVA_MAX_DIM];
             d_pshape_[i] = d_next_pshape[(CATERVA_MAX_DIM - d_ndim + i) % CATERVA_MAX_DIM];
         }
-
-        CATERVA_ERROR(caterva_get_slice_buffer(ctx, src, start_, stop_, d_pshape_, chunk,
-                                               array->next_chunknitems * typesize));
-
-        CATERVA_ERROR(caterva_append(ctx, array, chunk, array->next_chunknitems * typesize));
-        for (int i = 0; i < src->ndim; ++i) {
-            d_next_pshape[(CATERVA_MAX_DIM - d_ndim + i) % CATERVA_MAX_DIM] =
-                array->next_chunkshape[i];
+
+        CATERVA_ERROR(caterva_get_slice_buffer(ctx, src, start_, stop_, d_pshape_, chunk,
+                                               array->next_chunknitems * typesize));
+
+        CATERVA_ERROR(caterva_append(ctx, array, chunk, array->next_chunknitems * typesize));
+        for (int i = 0; i < src->ndim; ++i) {
+            d_next_pshape[(CATERVA_MAX_DIM - d_ndim + i) % CATERVA_MAX_DIM] =
+                array->next_chunkshape[i];
+        }
+    }
+    caterva_pool_release(ctx, chunk);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_update_shape(caterva_array_t *array, int8_t ndim, int64_t *shape,
+                               int32_t *chunkshape, int32_t *blockshape) {
+    array->ndim = ndim;
+    array->nitems = 1;
+    array->extnitems = 1;
+    array->extchunknitems = 1;
+    array->chunknitems = 1;
+    array->blocknitems = 1;
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        if (i < ndim) {
+            array->shape[i] = shape[i];
+            array->chunkshape[i] = chunkshape[i];
+            array->blockshape[i] = blockshape[i];
+            if (shape[i] != 0) {
+                if (shape[i] % array->chunkshape[i] == 0) {
+                    array->extshape[i] = shape[i];
+                } else {
+                    array->extshape[i] = shape[i] + chunkshape[i] - shape[i] % chunkshape[i];
+                }
+                if (chunkshape[i] % blockshape[i] == 0) {
+                    array->extchunkshape[i] = chunkshape[i];
+                } else {
+                    array->extchunkshape[i] =
+                            chunkshape[i] + blockshape[i] - chunkshape[i] % blockshape[i];
+                }
+            } else {
+                array->extchunkshape[i] = 0;
+                array->extshape[i] = 0;
+            }
+        } else {
+            array->blockshape[i] = 1;
+            array->chunkshape[i] = 1;
+            array->extshape[i] = 1;
+            array->extchunkshape[i] = 1;
+            array->shape[i] = 1;
+        }
+        array->nitems *= array->shape[i];
+        array->extnitems *= array->extshape[i];
+        array->extchunknitems *= array->extchunkshape[i];
+        array->chunknitems *= array->chunkshape[i];
+        array->blocknitems *= array->blockshape[i];
+    }
+
+    uint8_t *smeta = NULL;
+    // Serialize the dimension info ...
+    int32_t smeta_len =
+        serialize_meta(array->ndim, array->shape, array->chunkshape, array->blockshape, &smeta);
+    if (smeta_len < 0) {
+        fprintf(stderr, "error during serializing dims info for Caterva");
+        return -1;
+    }
+    // ... and update it in its metalayer
+    if (blosc2_meta_exists(array->sc, "caterva") < 0) {
+        if (blosc2_meta_add(array->sc, "caterva", smeta, (uint32_t) smeta_len) < 0) {
+            CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+        }
+    } else {
+        if (blosc2_meta_update(array->sc, "caterva", smeta, (uint32_t) smeta_len) < 0) {
+            CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+        }
+    }
+    free(smeta);
+
+    return CATERVA_SUCCEED;
+}
+
+
+int caterva_blosc_array_squeeze_index(caterva_ctx_t *ctx, caterva_array_t *array, bool *index) {
+    CATERVA_UNUSED_PARAM(ctx);
+    uint8_t nones = 0;
+    int64_t newshape[CATERVA_MAX_DIM];
+    int32_t newchunkshape[CATERVA_MAX_DIM];
+    int32_t newblockshape[CATERVA_MAX_DIM];
+
+    for (int i = 0; i < array->ndim; ++i) {
+        if (index[i] == true) {
+            if (array->shape[i] != 1) {
+                CATERVA_ERROR(CATERVA_ERR_INVALID_INDEX);
+            }
+        } else {
+            newshape[nones] = array->shape[i];
+            newchunkshape[nones] = array->chunkshape[i];
+            newblockshape[nones] = array->blockshape[i];
+            nones += 1;
+        }
+    }
+
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        if (i < nones) {
+            array->chunkshape[i] = newchunkshape[i];
+            array->blockshape[i] = newblockshape[i];
+        } else {
+            array->chunkshape[i] = 1;
+            array->blockshape[i] = 1;
+        }
+    }
+
+    CATERVA_ERROR(caterva_blosc_update_shape(array, nones, newshape, newchunkshape, newblockshape));
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_squeeze(caterva_ctx_t *ctx, caterva_array_t *array) {
+    CATERVA_UNUSED_PARAM(ctx);
+    int32_t newblockshape[CATERVA_MAX_DIM];
+    bool index[CATERVA_MAX_DIM];
+
+    for (int i = 0; i < array->ndim; ++i) {
+        if (array->shape[i] != 1) {
+           index[i] = false;
+        } else {
+            index[i] = true;
+        }
+    }
+    CATERVA_ERROR(caterva_blosc_array_squeeze_index(ctx, array, index));
+
+    return CATERVA_SUCCEED;
+}
+
+// Set to the fill value the items of a (blocked) chunk that are outside the box [0, valid)
+static void caterva_blosc_fill_outside(caterva_array_t *array, uint8_t *chunk,
+                                       const int64_t *valid) {
+    int8_t ndim = array->ndim;
+    int64_t bgrid[CATERVA_MAX_DIM];
+    for (int i = 0; i < ndim; ++i) {
+        bgrid[i] = array->extchunkshape[i] / array->blockshape[i];
+    }
+    int64_t nblocks = array->extchunknitems / array->blocknitems;
+    int64_t rowlen = ndim > 0 ? array->blockshape[ndim - 1] : 1;
+    int64_t nrows = array->blocknitems / rowlen;
+    for (int64_t nblock = 0; nblock < nblocks; ++nblock) {
+        int64_t origin[CATERVA_MAX_DIM] = {0};
+        int64_t rem = nblock;
+        for (int i = ndim - 1; i >= 0; --i) {
+            origin[i] = (rem % bgrid[i]) * array->blockshape[i];
+            rem /= bgrid[i];
+        }
+        uint8_t *block = chunk + nblock * array->blocknitems * array->itemsize;
+        for (int64_t row = 0; row < nrows; ++row) {
+            // The part of the row outside the box starts at `first`
+            int64_t first = 0;
+            if (ndim > 0) {
+                first = valid[ndim - 1] - origin[ndim - 1];
+                first = first < 0 ? 0 : (first > rowlen ? rowlen : first);
+            }
+            int64_t r = row;
+            for (int i = ndim - 2; i >= 0; --i) {
+                if (origin[i] + r % array->blockshape[i] >= valid[i]) {
+                    first = 0;
+                }
+                r /= array->blockshape[i];
+            }
+            if (first < rowlen) {
+                caterva_copy_fill(array->itemsize, block + (row * rowlen + first) * array->itemsize,
+                                  rowlen - first, array->fillvalue);
+            }
+        }
+    }
+}
+
+// Compress into `*cchunk` (allocated from the pool) a chunk of `array` made only of its fill value
+static int caterva_blosc_fill_chunk(caterva_ctx_t *ctx, caterva_array_t *array,
+                                    uint8_t **cchunk) {
+    int32_t chunkbytes = (int32_t) (array->extchunknitems * array->itemsize);
+    int32_t cchunksize = chunkbytes + BLOSC_MAX_OVERHEAD;
+    blosc2_cparams *cparams;
+    if (blosc2_schunk_get_cparams(array->sc, &cparams) < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+    cparams->nthreads = (int16_t) caterva_threads_blosc(ctx);
+    blosc2_context *cctx = blosc2_create_cctx(*cparams);
+    free(cparams);
+    uint8_t *rchunk = caterva_pool_alloc(ctx, (size_t) chunkbytes);
+    *cchunk = caterva_pool_alloc(ctx, (size_t) cchunksize);
+
+    int rc = CATERVA_SUCCEED;
+    if (cctx == NULL) {
+        rc = CATERVA_ERR_BLOSC_FAILED;
+    } else if (rchunk == NULL || *cchunk == NULL) {
+        rc = CATERVA_ERR_NULL_POINTER;
+    } else {
+        caterva_copy_fill(array->itemsize, rchunk, array->extchunknitems, array->fillvalue);
+        if (blosc2_compress_ctx(cctx, rchunk, chunkbytes, *cchunk, cchunksize) <= 0) {
+            rc = CATERVA_ERR_BLOSC_FAILED;
+        }
+    }
+    if (cctx != NULL) {
+        blosc2_free_ctx(cctx);
+    }
+    if (rchunk != NULL) {
+        caterva_pool_release(ctx, rchunk);
+    }
+    if (rc != CATERVA_SUCCEED && *cchunk != NULL) {
+        caterva_pool_release(ctx, *cchunk);
+        *cchunk = NULL;
+    }
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+// Rewrite the chunks that stay in the array but whose part inside it changes. The items that
+// enter the array are set to the fill value, because they may hold stale data from a previous
+// shrink.
+static int caterva_blosc_resize_borders(caterva_ctx_t *ctx, caterva_array_t *array,
+                                        const int64_t *old_shape, const int64_t *old_grid) {
+    int8_t ndim = array->ndim;
+    int64_t grid[CATERVA_MAX_DIM];
+    int64_t nchunks = 1;
+    for (int i = 0; i < ndim; ++i) {
+        grid[i] = array->extshape[i] / array->chunkshape[i];
+        nchunks *= grid[i];
+    }
+
+    int32_t chunkbytes = (int32_t) (array->extchunknitems * array->itemsize);
+    int32_t cchunksize = chunkbytes + BLOSC_MAX_OVERHEAD;
+    uint8_t *cchunk = NULL;
+    blosc2_context *cctx = NULL;
+    caterva_blosc_reader_t reader;
+    int rc = caterva_blosc_reader_init(ctx, array, caterva_threads_blosc(ctx), true, &reader);
+
+    for (int64_t nchunk = 0; rc == CATERVA_SUCCEED && nchunk < nchunks; ++nchunk) {
+        int64_t coords[CATERVA_MAX_DIM];
+        index_unidim_to_multidim(ndim, grid, nchunk, coords);
+        bool grown = false;
+        bool changed = false;
+        int64_t valid[CATERVA_MAX_DIM];
+        for (int i = 0; i < ndim; ++i) {
+            if (coords[i] >= old_grid[i]) {
+                // A new chunk, which is made of the fill value
+                changed = false;
+                break;
+            }
+            int64_t chunk_start = coords[i] * array->chunkshape[i];
+            int64_t old_valid = old_shape[i] - chunk_start;
+            int64_t new_valid = array->shape[i] - chunk_start;
+            old_valid = old_valid > array->chunkshape[i] ? array->chunkshape[i] : old_valid;
+            new_valid = new_valid > array->chunkshape[i] ? array->chunkshape[i] : new_valid;
+            valid[i] = old_valid;
+            grown = grown || new_valid > old_valid;
+            changed = changed || new_valid != old_valid;
+        }
+        // Only the statistics depend on the items that leave the array
+        if (!changed || (!grown && array->stats == NULL)) {
+            continue;
+        }
+
+        rc = caterva_blosc_reader_decompress(&reader, array, nchunk, NULL, reader.chunk,
+                                             chunkbytes);
+        if (rc != CATERVA_SUCCEED) {
+            break;
+        }
+        if (!grown) {
+            // The chunk is kept as it is, only the statistics forget the items that left
+            caterva_stats_update(array->stats, array, nchunk, reader.chunk);
+            continue;
+        }
+        caterva_blosc_fill_outside(array, reader.chunk, valid);
+        if (cctx == NULL) {
+            blosc2_cparams *cparams;
+            if (blosc2_schunk_get_cparams(array->sc, &cparams) < 0) {
+                rc = CATERVA_ERR_BLOSC_FAILED;
+                break;
+            }
+            cparams->nthreads = (int16_t) caterva_threads_blosc(ctx);
+            cctx = blosc2_create_cctx(*cparams);
+            free(cparams);
+            cchunk = caterva_pool_alloc(ctx, (size_t) cchunksize);
+            if (cctx == NULL || cchunk == NULL) {
+                rc = cctx == NULL ? CATERVA_ERR_BLOSC_FAILED : CATERVA_ERR_NULL_POINTER;
+                break;
+            }
+        }
+        int cbytes = blosc2_compress_ctx(cctx, reader.chunk, chunkbytes, cchunk, cchunksize);
+        if (cbytes <= 0 || blosc2_schunk_update_chunk(array->sc, (int) nchunk, cchunk, true) < 0) {
+            rc = CATERVA_ERR_BLOSC_FAILED;
+            break;
+        }
+        // The statistics and the version only change once the filled chunk has been stored
+        if (array->stats != NULL) {
+            caterva_stats_update(array->stats, array, nchunk, reader.chunk);
+        }
+        caterva_versions_touch(array->versions, nchunk);
+    }
+
+    if (cctx != NULL) {
+        blosc2_free_ctx(cctx);
+    }
+    if (cchunk != NULL) {
+        caterva_pool_release(ctx, cchunk);
+    }
+    caterva_blosc_reader_destroy(ctx, &reader);
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_resize(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *new_shape) {
+    if (!array->filled) {
+        DEBUG_PRINT("The array must be filled before resizing it");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    int8_t ndim = array->ndim;
+    int64_t old_shape[CATERVA_MAX_DIM];
+    int64_t old_grid[CATERVA_MAX_DIM];
+    int64_t new_grid[CATERVA_MAX_DIM];
+    int64_t old_nchunks = 1;
+    int64_t new_nchunks = 1;
+    for (int i = 0; i < ndim; ++i) {
+        old_shape[i] = array->shape[i];
+        old_grid[i] = array->extshape[i] / array->chunkshape[i];
+        new_grid[i] = (new_shape[i] + array->chunkshape[i] - 1) / array->chunkshape[i];
+        old_nchunks *= old_grid[i];
+        new_nchunks *= new_grid[i];
+    }
+    if (new_nchunks > INT32_MAX) {
+        DEBUG_PRINT("The number of chunks exceeds the super-chunk limit");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    CATERVA_ERROR(caterva_blosc_update_shape(array, ndim, new_shape, array->chunkshape,
+                                             array->blockshape));
+    array->nchunks = new_nchunks;
+    if (array->cache != NULL) {
+        caterva_cache_invalidate(array->cache, -1);
+    }
+
+    // The chunks keep their relative (C) order, so the ones that leave the grid are deleted
+    // (from the end, to keep the positions of the pending ones) and the new ones are inserted
+    // afterwards. The data in the remaining chunks is not touched.
+    int64_t coords[CATERVA_MAX_DIM];
+    for (int64_t nchunk = old_nchunks - 1; nchunk >= 0; --nchunk) {
+        index_unidim_to_multidim(ndim, old_grid, nchunk, coords);
+        bool outside = false;
+        for (int i = 0; i < ndim; ++i) {
+            outside = outside || coords[i] >= new_grid[i];
+        }
+        if (outside && blosc2_schunk_delete_chunk(array->sc, (int) nchunk) < 0) {
+            CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+        }
+    }
+
+    if (new_nchunks > array->sc->nchunks) {
+        // All the new chunks are made of the fill value, so they share a single compressed chunk
+        uint8_t zchunk[BLOSC_EXTENDED_HEADER_LENGTH];
+        uint8_t *chunk = zchunk;
+        int rc;
+        if (array->fillvalue == NULL) {
+            rc = caterva_blosc_zeros_chunk(array, zchunk);
+        } else {
+            rc = caterva_blosc_fill_chunk(ctx, array, &chunk);
+        }
+        for (int64_t nchunk = 0; rc == CATERVA_SUCCEED && nchunk < new_nchunks; ++nchunk) {
+            index_unidim_to_multidim(ndim, new_grid, nchunk, coords);
+            bool inside = true;
+            for (int i = 0; i < ndim; ++i) {
+                inside = inside && coords[i] < old_grid[i];
+            }
+            if (inside) {
+                continue;
+            }
+            // Growing the outermost dimension only appends chunks
+            int err;
+            if (nchunk == array->sc->nchunks) {
+                err = blosc2_schunk_append_chunk(array->sc, chunk, true);
+            } else {
+                err = blosc2_schunk_insert_chunk(array->sc, (int) nchunk, chunk, true);
+            }
+            if (err < 0) {
+                rc = CATERVA_ERR_BLOSC_FAILED;
+            }
+        }
+        if (chunk != zchunk && chunk != NULL) {
+            caterva_pool_release(ctx, chunk);
+        }
+        CATERVA_ERROR(rc);
+    }
+
+    // Move the records of the remaining chunks to their new positions
+    if (array->stats != NULL) {
+        caterva_stats_index_t *index;
+        CATERVA_ERROR(caterva_stats_new(ctx, array->stats->dtype, new_nchunks,
+                                        array->stats->nblocks, &index));
+        for (int64_t nchunk = 0; nchunk < new_nchunks; ++nchunk) {
+            index_unidim_to_multidim(ndim, new_grid, nchunk, coords);
+            int64_t old_nchunk = 0;
+            for (int i = 0; i < ndim && old_nchunk >= 0; ++i) {
+                old_nchunk = coords[i] < old_grid[i] ? old_nchunk * old_grid[i] + coords[i] : -1;
+            }
+            if (old_nchunk < 0) {
+                caterva_stats_update_constant(index, array, nchunk,
+                                              caterva_stats_item_value(index->dtype,
+                                                                       array->fillvalue));
+            } else {
+                memcpy(caterva_stats_chunk(index, nchunk),
+                       caterva_stats_chunk(array->stats, old_nchunk),
+                       (size_t) (1 + index->nblocks) * sizeof(caterva_stats_t));
+            }
+        }
+        caterva_stats_free(ctx, &array->stats);
+        array->stats = index;
+        array->stats->dirty = true;
+    }
+
+    // Move the versions too; the new chunks count as written
+    if (array->versions != NULL) {
+        caterva_versions_t *versions;
+        CATERVA_ERROR(caterva_versions_new(ctx, new_nchunks, &versions));
+        versions->version = array->versions->version;
+        for (int64_t nchunk = 0; nchunk < new_nchunks; ++nchunk) {
+            index_unidim_to_multidim(ndim, new_grid, nchunk, coords);
+            int64_t old_nchunk = 0;
+            for (int i = 0; i < ndim && old_nchunk >= 0; ++i) {
+                old_nchunk = coords[i] < old_grid[i] ? old_nchunk * old_grid[i] + coords[i] : -1;
+            }
+            if (old_nchunk < 0) {
+                caterva_versions_touch(versions, nchunk);
+            } else {
+                versions->chunks[nchunk] = array->versions->chunks[old_nchunk];
+            }
         }
+        caterva_versions_free(ctx, &array->versions);
+        array->versions = versions;
     }
-    ctx->cfg->free(chunk);
+
+    CATERVA_ERROR(caterva_blosc_resize_borders(ctx, array, old_shape, old_grid));
+    CATERVA_ERROR(caterva_blosc_stats_flush(array));
+    CATERVA_ERROR(caterva_blosc_versions_flush(array));
 
     return CATERVA_SUCCEED;
 }
 
-int caterva_blosc_update_shape(caterva_array_t *array, int8_t ndim, int64_t *shape,
-                               int32_t *chunkshape, int32_t *blockshape) {
-    array->ndim = ndim;
-    array->nitems = 1;
-    array->extnitems = 1;
-    array->extchunknitems = 1;
-    array->chunknitems = 1;
-    array->blocknitems = 1;
-    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-        if (i < ndim) {
-            array->shape[i] = shape[i];
-            array->chunkshape[i] = chunkshape[i];
-            array->blockshape[i] = blockshape[i];
-            if (shape[i] != 0) {
-                if (shape[i] % array->chunkshape[i] == 0) {
-                    array->extshape[i] = shape[i];
-                } else {
-                    array->extshape[i] = shape[i] + chunkshape[i] - shape[i] % chunkshape[i];
-                }
-                if (chunkshape[i] % blockshape[i] == 0) {
-                    array->extchunkshape[i] = chunkshape[i];
-                } else {
-                    array->extchunkshape[i] =
-                            chunkshape[i] + blockshape[i] - chunkshape[i] % blockshape[i];
-                }
-            } else {
-                array->extchunkshape[i] = 0;
-                array->extshape[i] = 0;
-            }
-        } else {
-            array->blockshape[i] = 1;
-            array->chunkshape[i] = 1;
-            array->extshape[i] = 1;
-            array->extchunkshape[i] = 1;
-            array->shape[i] = 1;
+// Whether the chunks of `src` and `array` are compressed with the same parameters
+static bool caterva_blosc_same_cparams(caterva_array_t *src, caterva_array_t *array) {
+    blosc2_cparams *src_cparams;
+    blosc2_cparams *cparams;
+    if (blosc2_schunk_get_cparams(src->sc, &src_cparams) < 0) {
+        return false;
+    }
+    if (blosc2_schunk_get_cparams(array->sc, &cparams) < 0) {
+        free(src_cparams);
+        return false;
+    }
+    bool equals = src_cparams->compcode == cparams->compcode &&
+                  src_cparams->compcode_meta == cparams->compcode_meta &&
+                  src_cparams->clevel == cparams->clevel &&
+                  src_cparams->use_dict == cparams->use_dict &&
+                  src_cparams->typesize == cparams->typesize &&
+                  src_cparams->blocksize == cparams->blocksize &&
+                  src_cparams->splitmode == cparams->splitmode &&
+                  memcmp(src_cparams->filters, cparams->filters, BLOSC2_MAX_FILTERS) == 0 &&
+                  memcmp(src_cparams->filters_meta, cparams->filters_meta,
+                         BLOSC2_MAX_FILTERS) == 0;
+    free(src_cparams);
+    free(cparams);
+
+    return equals;
+}
+
+// Whether the blocks of `src` can be moved as they are into the chunks of `array`, i.e. both
+// arrays have the same blockshape and their chunks are made of whole blocks
+static bool caterva_blosc_same_blocks(caterva_array_t *src, caterva_array_t *array) {
+    if (src->storage != CATERVA_STORAGE_BLOSC || array->ndim == 0) {
+        return false;
+    }
+    for (int i = 0; i < array->ndim; ++i) {
+        if (src->blockshape[i] != array->blockshape[i] ||
+            src->chunkshape[i] % src->blockshape[i] != 0 ||
+            array->chunkshape[i] % array->blockshape[i] != 0) {
+            return false;
         }
-        array->nitems *= array->shape[i];
-        array->extnitems *= array->extshape[i];
-        array->extchunknitems *= array->extchunkshape[i];
-        array->chunknitems *= array->chunkshape[i];
-        array->blocknitems *= array->blockshape[i];
     }
+    return true;
+}
 
-    uint8_t *smeta = NULL;
-    // Serialize the dimension info ...
-    int32_t smeta_len =
-        serialize_meta(array->ndim, array->shape, array->chunkshape, array->blockshape, &smeta);
-    if (smeta_len < 0) {
-        fprintf(stderr, "error during serializing dims info for Caterva");
-        return -1;
+/**
+ * The source of the chunks produced by the fill functions of caterva_blosc_array_copy.
+ */
+typedef struct {
+    caterva_ctx_t *ctx;
+    caterva_array_t *src;
+} caterva_blosc_copy_t;
+
+// Add the metalayers of `src` missing in `array`, as blosc2_schunk_copy does. The statistics are
+// not copied, because they are computed again for the new chunks.
+static int caterva_blosc_copy_metalayers(caterva_array_t *src, caterva_array_t *array) {
+    for (int i = 0; i < src->sc->nmetalayers; ++i) {
+        char *name = src->sc->metalayers[i]->name;
+        if (blosc2_meta_exists(array->sc, name) >= 0) {
+            continue;
+        }
+        uint8_t *content;
+        uint32_t content_len;
+        if (blosc2_meta_get(src->sc, name, &content, &content_len) < 0) {
+            CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+        }
+        int rc = blosc2_meta_add(array->sc, name, content, content_len);
+        free(content);
+        if (rc < 0) {
+            CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+        }
     }
-    // ... and update it in its metalayer
-    if (blosc2_meta_exists(array->sc, "caterva") < 0) {
-        if (blosc2_meta_add(array->sc, "caterva", smeta, (uint32_t) smeta_len) < 0) {
+    for (int i = 0; i < src->sc->nvlmetalayers; ++i) {
+        char *name = src->sc->vlmetalayers[i]->name;
+        if (strcmp(name, CATERVA_STATS_METALAYER) == 0 ||
+            blosc2_vlmeta_exists(array->sc, name) >= 0) {
+            continue;
+        }
+        uint8_t *content;
+        uint32_t content_len;
+        if (blosc2_vlmeta_get(src->sc, name, &content, &content_len) < 0) {
             CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
         }
-    } else {
-        if (blosc2_meta_update(array->sc, "caterva", smeta, (uint32_t) smeta_len) < 0) {
+        int rc = blosc2_vlmeta_add(array->sc, name, content, content_len, NULL);
+        free(content);
+        if (rc < 0) {
             CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
         }
     }
-    free(smeta);
 
     return CATERVA_SUCCEED;
 }
 
+// Copy a chunk with the same shapes as the ones of the array, recompressing it
+static int caterva_blosc_fill_recompress(void *fill_arg, caterva_blosc_reader_t *reader,
+                                         caterva_array_t *array, int64_t nchunk, int8_t *chunk,
+                                         int8_t *rchunk, bool *zeros) {
+    CATERVA_UNUSED_PARAM(chunk);
+    CATERVA_UNUSED_PARAM(zeros);
+    caterva_array_t *src = ((caterva_blosc_copy_t *) fill_arg)->src;
 
-int caterva_blosc_array_squeeze_index(caterva_ctx_t *ctx, caterva_array_t *array, bool *index) {
-    CATERVA_UNUSED_PARAM(ctx);
-    uint8_t nones = 0;
-    int64_t newshape[CATERVA_MAX_DIM];
-    int32_t newchunkshape[CATERVA_MAX_DIM];
-    int32_t newblockshape[CATERVA_MAX_DIM];
+    CATERVA_ERROR(caterva_blosc_reader_decompress(
+        reader, src, nchunk, NULL, (uint8_t *) rchunk,
+        (int32_t) (array->extchunknitems * array->itemsize)));
 
-    for (int i = 0; i < array->ndim; ++i) {
-        if (index[i] == true) {
-            if (array->shape[i] != 1) {
-                CATERVA_ERROR(CATERVA_ERR_INVALID_INDEX);
-            }
-        } else {
-            newshape[nones] = array->shape[i];
-            newchunkshape[nones] = array->chunkshape[i];
-            newblockshape[nones] = array->blockshape[i];
-            nones += 1;
+    return CATERVA_SUCCEED;
+}
+
+// Build a chunk out of the blocks of the source chunks that overlap it. Only the needed blocks of
+// every source chunk are decompressed, and they are not regathered.
+static int caterva_blosc_fill_blocks(void *fill_arg, caterva_blosc_reader_t *reader,
+                                     caterva_array_t *array, int64_t nchunk, int8_t *chunk,
+                                     int8_t *rchunk, bool *zeros) {
+    CATERVA_UNUSED_PARAM(chunk);
+    CATERVA_UNUSED_PARAM(zeros);
+    caterva_array_t *src = ((caterva_blosc_copy_t *) fill_arg)->src;
+    int8_t ndim = array->ndim;
+    int64_t blockbytes = array->blocknitems * array->itemsize;
+
+    // The chunk, and the source chunks overlapping it, in block units
+    int64_t grid[CATERVA_MAX_DIM];
+    int64_t coords[CATERVA_MAX_DIM];
+    int64_t d_blocks[CATERVA_MAX_DIM];
+    int64_t s_blocks[CATERVA_MAX_DIM];
+    int64_t s_grid[CATERVA_MAX_DIM];
+    int64_t first[CATERVA_MAX_DIM];
+    int64_t s_first[CATERVA_MAX_DIM];
+    int64_t s_shape[CATERVA_MAX_DIM];
+    int64_t s_nchunks = 1;
+    bool partial = false;
+    for (int i = 0; i < ndim; ++i) {
+        grid[i] = array->extshape[i] / array->chunkshape[i];
+        d_blocks[i] = array->chunkshape[i] / array->blockshape[i];
+        s_blocks[i] = src->chunkshape[i] / src->blockshape[i];
+        s_grid[i] = src->extshape[i] / src->chunkshape[i];
+    }
+    index_unidim_to_multidim(ndim, grid, nchunk, coords);
+    for (int i = 0; i < ndim; ++i) {
+        first[i] = coords[i] * d_blocks[i];
+        int64_t last = first[i] + d_blocks[i] - 1;
+        // The blocks beyond the source chunks only hold padding
+        if (last >= s_grid[i] * s_blocks[i]) {
+            last = s_grid[i] * s_blocks[i] - 1;
+            partial = true;
+        }
+        s_first[i] = first[i] / s_blocks[i];
+        s_shape[i] = last / s_blocks[i] - s_first[i] + 1;
+        s_nchunks *= s_shape[i];
+    }
+    if (partial) {
+        caterva_copy_fill(array->itemsize, (uint8_t *) rchunk, array->extchunknitems,
+                          array->fillvalue);
+    }
+
+    for (int64_t s_ind = 0; s_ind < s_nchunks; ++s_ind) {
+        int64_t s_coords[CATERVA_MAX_DIM];
+        index_unidim_to_multidim(ndim, s_shape, s_ind, s_coords);
+        int64_t s_nchunk = 0;
+        // The blocks of the source chunk that are inside the chunk
+        int64_t b_first[CATERVA_MAX_DIM];
+        int64_t b_shape[CATERVA_MAX_DIM];
+        int64_t nblocks = 1;
+        for (int i = 0; i < ndim; ++i) {
+            s_coords[i] += s_first[i];
+            s_nchunk = s_nchunk * s_grid[i] + s_coords[i];
+            int64_t start = s_coords[i] * s_blocks[i];
+            int64_t stop = start + s_blocks[i];
+            start = start < first[i] ? first[i] : start;
+            stop = stop > first[i] + d_blocks[i] ? first[i] + d_blocks[i] : stop;
+            b_first[i] = start;
+            b_shape[i] = stop - start;
+            nblocks *= b_shape[i];
         }
-    }
 
-    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
-        if (i < nones) {
-            array->chunkshape[i] = newchunkshape[i];
-            array->blockshape[i] = newblockshape[i];
-        } else {
-            array->chunkshape[i] = 1;
-            array->blockshape[i] = 1;
+        memset(reader->block_maskout, true, reader->nblocks);
+        for (int64_t b_ind = 0; b_ind < nblocks; ++b_ind) {
+            int64_t b_coords[CATERVA_MAX_DIM];
+            index_unidim_to_multidim(ndim, b_shape, b_ind, b_coords);
+            int64_t s_nblock = 0;
+            for (int i = 0; i < ndim; ++i) {
+                s_nblock = s_nblock * s_blocks[i] + (b_first[i] + b_coords[i]) % s_blocks[i];
+            }
+            reader->block_maskout[s_nblock] = false;
+        }
+        CATERVA_ERROR(caterva_blosc_reader_decompress(
+            reader, src, s_nchunk, reader->block_maskout, reader->chunk,
+            (int32_t) (src->extchunknitems * src->itemsize)));
+
+        for (int64_t b_ind = 0; b_ind < nblocks; ++b_ind) {
+            int64_t b_coords[CATERVA_MAX_DIM];
+            index_unidim_to_multidim(ndim, b_shape, b_ind, b_coords);
+            int64_t s_nblock = 0;
+            int64_t d_nblock = 0;
+            for (int i = 0; i < ndim; ++i) {
+                int64_t block = b_first[i] + b_coords[i];
+                s_nblock = s_nblock * s_blocks[i] + block % s_blocks[i];
+                d_nblock = d_nblock * d_blocks[i] + (block - first[i]);
+            }
+            memcpy(rchunk + d_nblock * blockbytes, reader->chunk + s_nblock * blockbytes,
+                   (size_t) blockbytes);
         }
     }
 
-    CATERVA_ERROR(caterva_blosc_update_shape(array, nones, newshape, newchunkshape, newblockshape));
-
     return CATERVA_SUCCEED;
 }
 
-int caterva_blosc_array_squeeze(caterva_ctx_t *ctx, caterva_array_t *array) {
-    CATERVA_UNUSED_PARAM(ctx);
-    int32_t newblockshape[CATERVA_MAX_DIM];
-    bool index[CATERVA_MAX_DIM];
+// Gather a chunk from any region of the source array (Blosc or plain buffer)
+static int caterva_blosc_fill_slice(void *fill_arg, caterva_blosc_reader_t *reader,
+                                    caterva_array_t *array, int64_t nchunk, int8_t *chunk,
+                                    int8_t *rchunk, bool *zeros) {
+    caterva_blosc_copy_t *copy = (caterva_blosc_copy_t *) fill_arg;
+    caterva_array_t *src = copy->src;
+    int8_t ndim = array->ndim;
+    int8_t typesize = array->itemsize;
 
-    for (int i = 0; i < array->ndim; ++i) {
-        if (array->shape[i] != 1) {
-           index[i] = false;
-        } else {
-            index[i] = true;
+    int64_t grid[CATERVA_MAX_DIM];
+    int64_t coords[CATERVA_MAX_DIM];
+    int64_t start[CATERVA_MAX_DIM];
+    int64_t stop[CATERVA_MAX_DIM];
+    int64_t shape[CATERVA_MAX_DIM];
+    bool partial = false;
+    for (int i = 0; i < ndim; ++i) {
+        grid[i] = array->extshape[i] / array->chunkshape[i];
+    }
+    if (ndim > 0) {
+        index_unidim_to_multidim(ndim, grid, nchunk, coords);
+    }
+    for (int i = 0; i < ndim; ++i) {
+        shape[i] = array->chunkshape[i];
+        start[i] = coords[i] * shape[i];
+        stop[i] = start[i] + shape[i];
+        if (stop[i] > array->shape[i]) {
+            stop[i] = array->shape[i];
+            partial = true;
         }
     }
-    CATERVA_ERROR(caterva_blosc_array_squeeze_index(ctx, array, index));
+    if (partial) {
+        caterva_copy_fill(typesize, (uint8_t *) chunk, array->chunknitems, array->fillvalue);
+    }
+
+    if (src->storage == CATERVA_STORAGE_PLAINBUFFER) {
+        CATERVA_ERROR(caterva_plainbuffer_array_get_slice_buffer(copy->ctx, src, start, stop,
+                                                                 shape, chunk));
+    } else {
+        caterva_blosc_slice_t slice;
+        caterva_blosc_slice_init(src, start, stop, shape, chunk, &slice);
+        int64_t nskipped = 0;
+        for (int64_t chunk_ind = 0; chunk_ind < slice.nchunks; ++chunk_ind) {
+            CATERVA_ERROR(caterva_blosc_slice_chunk(src, &slice, reader, chunk_ind, &nskipped));
+        }
+    }
+    if (caterva_copy_is_constant(typesize, (uint8_t *) chunk, array->chunknitems, NULL)) {
+        *zeros = true;
+        return CATERVA_SUCCEED;
+    }
+    CATERVA_ERROR(caterva_blosc_array_repart_chunk(rchunk, array->extchunknitems * typesize,
+                                                   chunk, array->chunknitems * typesize, array));
 
     return CATERVA_SUCCEED;
 }
@@ -1036,38 +3488,83 @@ int caterva_blosc_array_squeeze(caterva_ctx_t *ctx, caterva_array_t *array) {
 int caterva_blosc_array_copy(caterva_ctx_t *ctx, caterva_params_t *params,
                              caterva_storage_t *storage, caterva_array_t *src,
                              caterva_array_t **dest) {
-    CATERVA_UNUSED_PARAM(params);
+    // The user prefilter may not be prepared to be called from different chunks at once
+    if (ctx->cfg->prefilter != NULL) {
+        int64_t start[CATERVA_MAX_DIM] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+        int64_t stop[CATERVA_MAX_DIM];
+        for (int i = 0; i < src->ndim; ++i) {
+            stop[i] = src->shape[i];
+        }
+        CATERVA_ERROR(caterva_get_slice(ctx, src, start, stop, storage, dest));
+        return CATERVA_SUCCEED;
+    }
 
     bool equals = true;
     if (src->storage == CATERVA_STORAGE_PLAINBUFFER) {
         equals = false;
     }
-    for (int i = 0; i < src->ndim; ++i) {
+    for (int i = 0; equals && i < src->ndim; ++i) {
         if (src->chunkshape[i] != storage->properties.blosc.chunkshape[i]) {
             equals = false;
-            break;
         }
         if (src->blockshape[i] != storage->properties.blosc.blockshape[i]) {
             equals = false;
-            break;
         }
     }
 
+    CATERVA_ERROR(caterva_empty(ctx, params, storage, dest));
+    caterva_array_t *array = *dest;
+
+    // The compressed chunks can be copied as they are if they would be compressed in the same way
+    // (the statistics are copied along with them, so they have to be of the same type)
+    caterva_dtype_t src_dtype = src->stats != NULL ? src->stats->dtype : CATERVA_DTYPE_NONE;
+    caterva_dtype_t dtype = array->stats != NULL ? array->stats->dtype : CATERVA_DTYPE_NONE;
+    if (equals && src_dtype == dtype && caterva_blosc_same_cparams(src, array)) {
+        blosc2_schunk *new_sc = blosc2_schunk_copy(src->sc, array->sc->storage);
+        blosc2_schunk_free(array->sc);
+        array->sc = new_sc;
+        array->nchunks = src->nchunks;
+        if (src->stats != NULL) {
+            caterva_stats_index_t *index = array->stats;
+            memcpy(index->records, src->stats->records,
+                   (size_t) (index->nchunks * (1 + index->nblocks)) * sizeof(caterva_stats_t));
+            index->dirty = true;
+            CATERVA_ERROR(caterva_blosc_stats_flush(array));
+        }
+        return CATERVA_SUCCEED;
+    }
+
+    // Otherwise, every chunk is produced with the cheapest fill function for the shapes
+    int rc = CATERVA_SUCCEED;
+    caterva_blosc_fill_fn fill;
     if (equals) {
-        CATERVA_ERROR(caterva_empty(ctx, params, storage, dest));
-        blosc2_schunk *new_sc = blosc2_schunk_copy(src->sc, (*dest)->sc->storage);
-        blosc2_schunk_free((*dest)->sc);
-        (*dest)->sc = new_sc;
-        src->empty = false;
-        src->filled = true;
+        fill = caterva_blosc_fill_recompress;
+        rc = caterva_blosc_copy_metalayers(src, array);
+    } else if (caterva_blosc_same_blocks(src, array)) {
+        fill = caterva_blosc_fill_blocks;
     } else {
-        int64_t start[CATERVA_MAX_DIM] = {0, 0, 0, 0, 0, 0, 0, 0};
-
-        int64_t stop[CATERVA_MAX_DIM];
-        for (int i = 0; i < src->ndim; ++i) {
-            stop[i] = src->shape[i];
+        fill = caterva_blosc_fill_slice;
+    }
+    caterva_blosc_copy_t copy;
+    copy.ctx = ctx;
+    copy.src = src;
+    caterva_array_t *reader_src = src->storage == CATERVA_STORAGE_BLOSC ? src : NULL;
+    int64_t nchunks = array->chunknitems > 0 ? array->extnitems / array->chunknitems : 0;
+    if (rc == CATERVA_SUCCEED && nchunks > 0) {
+        if (ctx->cfg->nthreads > 1 && nchunks > 1) {
+            rc = caterva_blosc_append_parallel(ctx, array, reader_src, nchunks, fill, &copy);
+        } else {
+            rc = caterva_blosc_append_serial(ctx, array, reader_src, nchunks, fill, &copy);
         }
-        CATERVA_ERROR(caterva_get_slice(ctx, src, start, stop, storage, dest));
+    }
+    if (rc == CATERVA_SUCCEED && array->stats != NULL) {
+        array->stats->dirty = true;
+        rc = caterva_blosc_stats_flush(array);
+    }
+    if (rc != CATERVA_SUCCEED) {
+        caterva_free(ctx, dest);
+        CATERVA_ERROR(rc);
     }
 
     return CATERVA_SUCCEED;
@@ -1134,9 +3631,17 @@ int caterva_blosc_array_empty(caterva_ctx_t *ctx, caterva_params_t *params,
         (*array)->next_chunkshape[i] = 1;
     }
 
-    // The partition cache (empty initially)
-    (*array)->chunk_cache.data = NULL;
-    (*array)->chunk_cache.nchunk = -1;  // means no valid cache yet
+    // The decompressed-chunk cache (disabled initially)
+    (*array)->cache = NULL;
+    (*array)->mmap = NULL;
+    (*array)->bufmap = NULL;
+    (*array)->instr = NULL;
+    (*array)->stats = NULL;
+    (*array)->fillvalue = NULL;
+    (*array)->versions = NULL;
+    (*array)->shared = NULL;
+    (*array)->pyramid = NULL;
+    CATERVA_ERROR(caterva_lock_new(ctx, &(*array)->lock));
 
     (*array)->buf = NULL;
 
@@ -1147,7 +3652,7 @@ int caterva_blosc_array_empty(caterva_ctx_t *ctx, caterva_params_t *params,
     cparams.prefilter = ctx->cfg->prefilter;
     cparams.pparams = ctx->cfg->pparams;
     cparams.use_dict = ctx->cfg->usedict;
-    cparams.nthreads = (int16_t) ctx->cfg->nthreads;
+    cparams.nthreads = (int16_t) caterva_threads_blosc(ctx);
     cparams.clevel = (uint8_t) ctx->cfg->complevel;
     cparams.compcode = (uint8_t) ctx->cfg->compcodec;
     for (int i = 0; i < BLOSC2_MAX_FILTERS; ++i) {
@@ -1157,7 +3662,7 @@ int caterva_blosc_array_empty(caterva_ctx_t *ctx, caterva_params_t *params,
 
     blosc2_dparams dparams = BLOSC2_DPARAMS_DEFAULTS;
     dparams.schunk = NULL;
-    dparams.nthreads = ctx->cfg->nthreads;
+    dparams.nthreads = (int16_t) caterva_threads_blosc(ctx);
 
     blosc2_storage b_storage = BLOSC2_STORAGE_DEFAULTS;
     b_storage.cparams = &cparams;
@@ -1204,5 +3709,251 @@ int caterva_blosc_array_empty(caterva_ctx_t *ctx, caterva_params_t *params,
     }
     (*array)->sc = sc;
 
+    caterva_dtype_t dtype = storage->properties.blosc.stats;
+    if (dtype != CATERVA_DTYPE_NONE) {
+        if (caterva_stats_dtype_size(dtype) != params->itemsize) {
+            DEBUG_PRINT("The type of the statistics does not match the itemsize");
+            CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+        }
+        int64_t nchunks = (*array)->chunknitems > 0 ?
+                          (*array)->extnitems / (*array)->chunknitems : 0;
+        int nblocks = (*array)->blocknitems > 0 ?
+                      (int) ((*array)->extchunknitems / (*array)->blocknitems) : 0;
+        CATERVA_ERROR(caterva_stats_new(ctx, dtype, nchunks, nblocks, &(*array)->stats));
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_get_meta(caterva_ctx_t *ctx, caterva_array_t *array, uint8_t *meta,
+                                 int32_t metasize, int32_t *metalen) {
+    CATERVA_UNUSED_PARAM(ctx);
+
+    uint8_t *smeta;
+    uint32_t smeta_len;
+    if (blosc2_meta_get(array->sc, "caterva", &smeta, &smeta_len) < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+    *metalen = (int32_t) smeta_len;
+    int rc = CATERVA_SUCCEED;
+    if (meta != NULL) {
+        if (metasize < (int32_t) smeta_len) {
+            DEBUG_PRINT("The buffer is smaller than the metalayer");
+            rc = CATERVA_ERR_INVALID_ARGUMENT;
+        } else {
+            memcpy(meta, smeta, smeta_len);
+        }
+    }
+    free(smeta);
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+// Whether `meta` is a well-formed caterva metalayer, so that it can be deserialized safely
+static bool caterva_blosc_meta_valid(const uint8_t *meta, int32_t metalen) {
+    if (metalen < 3 || meta[0] != 0x90 + 5 || meta[1] > CATERVA_METALAYER_VERSION ||
+        meta[2] > CATERVA_MAX_DIM) {
+        return false;
+    }
+    int ndim = meta[2];
+    if (metalen != 3 + (1 + ndim * 9) + 2 * (1 + ndim * 5)) {
+        return false;
+    }
+    // The shape, the chunkshape and the blockshape entries
+    const uint8_t types[3] = {0xd3, 0xd2, 0xd2};
+    const int sizes[3] = {8, 4, 4};
+    const uint8_t *p = meta + 3;
+    for (int j = 0; j < 3; ++j) {
+        if (*p++ != 0x90 + ndim) {
+            return false;
+        }
+        for (int i = 0; i < ndim; ++i) {
+            if (*p != types[j]) {
+                return false;
+            }
+            p += 1 + sizes[j];
+        }
+    }
+    return true;
+}
+
+int caterva_blosc_array_check_meta(caterva_ctx_t *ctx, caterva_array_t *array,
+                                   const uint8_t *meta, int32_t metalen, bool *compatible) {
+    CATERVA_UNUSED_PARAM(ctx);
+
+    if (!caterva_blosc_meta_valid(meta, metalen)) {
+        DEBUG_PRINT("The metalayer is corrupted");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    int8_t ndim;
+    int64_t shape[CATERVA_MAX_DIM];
+    int32_t chunkshape[CATERVA_MAX_DIM];
+    int32_t blockshape[CATERVA_MAX_DIM];
+    deserialize_meta((uint8_t *) meta, (uint32_t) metalen, &ndim, shape, chunkshape, blockshape);
+
+    *compatible = ndim == array->ndim;
+    for (int i = 0; i < ndim && *compatible; ++i) {
+        *compatible = chunkshape[i] == array->chunkshape[i] &&
+                      blockshape[i] == array->blockshape[i];
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_get_chunk_compressed(caterva_ctx_t *ctx, caterva_array_t *array,
+                                             int64_t *coords, void *buffer, int64_t buffersize,
+                                             int64_t *cbytes) {
+    CATERVA_UNUSED_PARAM(ctx);
+
+    int64_t nchunk = 0;
+    for (int i = 0; i < array->ndim; ++i) {
+        nchunk = nchunk * (array->extshape[i] / array->chunkshape[i]) + coords[i];
+    }
+    if (nchunk >= array->sc->nchunks) {
+        DEBUG_PRINT("The chunk has not been written yet");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_INDEX);
+    }
+
+    blosc_timestamp_t start;
+    caterva_instr_start(array, &start);
+    uint8_t *cchunk;
+    bool needs_free;
+    int cbytes_ = blosc2_schunk_get_chunk(array->sc, (int) nchunk, &cchunk, &needs_free);
+    if (cbytes_ < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+    caterva_instr_phase(array, CATERVA_PHASE_READ, &start, cbytes_);
+    *cbytes = cbytes_;
+    int rc = CATERVA_SUCCEED;
+    if (buffer != NULL) {
+        if (buffersize < cbytes_) {
+            DEBUG_PRINT("The buffer is smaller than the compressed chunk");
+            rc = CATERVA_ERR_INVALID_ARGUMENT;
+        } else {
+            memcpy(buffer, cchunk, (size_t) cbytes_);
+        }
+    }
+    if (needs_free) {
+        free(cchunk);
+    }
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_set_chunk_compressed(caterva_ctx_t *ctx, caterva_array_t *array,
+                                             int64_t *coords, const void *cchunk,
+                                             int64_t cbytes) {
+    int64_t nchunk = 0;
+    for (int i = 0; i < array->ndim; ++i) {
+        nchunk = nchunk * (array->extshape[i] / array->chunkshape[i]) + coords[i];
+    }
+
+    // The chunk must have been compressed from a chunk with the same layout. The typesize is
+    // the fourth byte of the Blosc header.
+    const uint8_t *cchunk_ = (const uint8_t *) cchunk;
+    int32_t chunkbytes = (int32_t) (array->extchunknitems * array->itemsize);
+    int32_t nbytes;
+    int32_t csize;
+    int32_t blocksize;
+    if (cbytes < BLOSC_EXTENDED_HEADER_LENGTH || cbytes > INT32_MAX ||
+        blosc2_cbuffer_sizes(cchunk_, &nbytes, &csize, &blocksize) < 0) {
+        DEBUG_PRINT("The chunk is not a Blosc chunk");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    bool zeros = caterva_blosc_is_zeros_chunk(cchunk_, (int32_t) cbytes);
+    // The special chunks are made only of a header and do not carry the blocksize
+    bool special = cbytes == BLOSC_EXTENDED_HEADER_LENGTH;
+    if (csize != cbytes || nbytes != chunkbytes || cchunk_[3] != (uint8_t) array->itemsize ||
+        (!special && blocksize != array->blocknitems * array->itemsize)) {
+        DEBUG_PRINT("The chunk does not match the chunkshape, blockshape or itemsize");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    // Only the statistics need the decompressed chunk
+    bool decompress = array->stats != NULL && !zeros;
+    caterva_blosc_reader_t reader;
+    if (decompress) {
+        int rc = caterva_blosc_reader_init(ctx, array, caterva_threads_blosc(ctx), true, &reader);
+        if (rc == CATERVA_SUCCEED) {
+            blosc_timestamp_t start;
+            caterva_instr_start(array, &start);
+            if (blosc2_decompress_ctx(reader.dctx, cchunk_, (int32_t) cbytes, reader.chunk,
+                                      chunkbytes) < 0) {
+                rc = CATERVA_ERR_BLOSC_FAILED;
+            } else {
+                caterva_instr_phase(array, CATERVA_PHASE_DECOMPRESS, &start, chunkbytes);
+            }
+        }
+        if (rc != CATERVA_SUCCEED) {
+            caterva_blosc_reader_destroy(ctx, &reader);
+            CATERVA_ERROR(rc);
+        }
+    }
+
+    // The statistics and the version only change once the chunk has been stored
+    int rc = CATERVA_SUCCEED;
+    pthread_mutex_lock(&array->lock->mutex);
+    blosc_timestamp_t start;
+    caterva_instr_start(array, &start);
+    if (blosc2_schunk_update_chunk(array->sc, (int) nchunk, (uint8_t *) cchunk_, true) < 0) {
+        rc = CATERVA_ERR_BLOSC_FAILED;
+    } else {
+        caterva_instr_phase(array, CATERVA_PHASE_APPEND, &start, cbytes);
+        if (decompress) {
+            caterva_stats_update(array->stats, array, nchunk, reader.chunk);
+        } else if (array->stats != NULL) {
+            caterva_stats_update_constant(array->stats, array, nchunk, 0);
+        }
+        if (array->stats != NULL) {
+            array->stats->dirty = true;
+        }
+        caterva_versions_touch(array->versions, nchunk);
+    }
+    pthread_mutex_unlock(&array->lock->mutex);
+    if (decompress) {
+        caterva_blosc_reader_destroy(ctx, &reader);
+    }
+    CATERVA_ERROR(rc);
+
+    if (array->cache != NULL) {
+        caterva_cache_invalidate(array->cache, nchunk);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_set_fillvalue(caterva_array_t *array, const uint8_t *fillvalue) {
+    bool exists = blosc2_vlmeta_exists(array->sc, CATERVA_FILL_METALAYER) >= 0;
+    if (fillvalue == NULL && !exists) {
+        return CATERVA_SUCCEED;
+    }
+
+    // Blosc can not delete a variable-length metalayer, so the default is recorded as zeros
+    uint8_t zeros[UINT8_MAX] = {0};
+    uint8_t *content = fillvalue != NULL ? (uint8_t *) fillvalue : zeros;
+    uint32_t content_len = (uint32_t) (uint8_t) array->itemsize;
+    int rc;
+    if (exists) {
+        rc = blosc2_vlmeta_update(array->sc, CATERVA_FILL_METALAYER, content, content_len, NULL);
+    } else {
+        rc = blosc2_vlmeta_add(array->sc, CATERVA_FILL_METALAYER, content, content_len, NULL);
+    }
+    if (rc < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_blosc_array_track_versions(caterva_ctx_t *ctx, caterva_array_t *array) {
+    if (array->versions != NULL) {
+        return CATERVA_SUCCEED;
+    }
+    int64_t nchunks = array->chunknitems > 0 ? array->extnitems / array->chunknitems : 0;
+    CATERVA_ERROR(caterva_versions_new(ctx, nchunks, &array->versions));
+    CATERVA_ERROR(caterva_blosc_versions_flush(array));
+
     return CATERVA_SUCCEED;
 }
@@ -12,6 +12,49 @@
 #ifndef CATERVA_CATERVA_BLOSC_H_
 #define CATERVA_CATERVA_BLOSC_H_
 
+#include <caterva.h>
+
+/* The name of the variable-length metalayer where the fill value is stored */
+#define CATERVA_FILL_METALAYER "caterva_fill"
+
+/**
+ * The state needed to decompress chunks of an array. Each thread reading from an array must use
+ * its own reader, so that the decompression context of the super-chunk is never shared.
+ */
+typedef struct {
+    blosc2_context *dctx;
+    //!< The decompression context.
+    bool *block_maskout;
+    //!< The blocks that do not have to be decompressed.
+    int nblocks;
+    //!< Number of blocks in a chunk.
+    uint8_t *chunk;
+    //!< Scratch buffer where chunks are decompressed.
+} caterva_blosc_reader_t;
+
+/**
+ * Function used by the append pipeline to produce the chunk @p nchunk, already repartitioned
+ * into blocks, in @p rchunk. @p chunk is a scratch buffer of `chunknitems * itemsize` bytes.
+ * If the chunks are read from a Blosc array, @p reader is a reader of it private to the caller.
+ * If the function finds out that the chunk is made only of zeros, it can set @p zeros instead of
+ * producing @p rchunk.
+ */
+typedef int (*caterva_blosc_fill_fn)(void *fill_arg, caterva_blosc_reader_t *reader,
+                                     caterva_array_t *array, int64_t nchunk, int8_t *chunk,
+                                     int8_t *rchunk, bool *zeros);
+
+int caterva_blosc_reader_init(caterva_ctx_t *ctx, caterva_array_t *array, int nthreads,
+                              bool scratch, caterva_blosc_reader_t *reader);
+
+void caterva_blosc_reader_destroy(caterva_ctx_t *ctx, caterva_blosc_reader_t *reader);
+
+int caterva_blosc_reader_decompress(caterva_blosc_reader_t *reader, caterva_array_t *array,
+                                    int64_t nchunk, bool *maskout, uint8_t *dest,
+                                    int32_t destsize);
+
+int caterva_blosc_array_fill(caterva_ctx_t *ctx, caterva_array_t *array, caterva_array_t *src,
+                             caterva_blosc_fill_fn fill, void *fill_arg);
+
 int caterva_blosc_array_empty(caterva_ctx_t *ctx, caterva_params_t *params,
                               caterva_storage_t *storage, caterva_array_t **array);
 
@@ -25,19 +68,81 @@ int caterva_blosc_from_serial_schunk(caterva_ctx_t *ctx, uint8_t *serial_schunk,
 
 int caterva_blosc_open(caterva_ctx_t *ctx, const char *urlpath, caterva_array_t **array);
 
+int caterva_blosc_open_mmap(caterva_ctx_t *ctx, const char *urlpath, caterva_access_t access,
+                            caterva_array_t **array);
+
 int caterva_blosc_array_repart_chunk(int8_t *rchunk, int64_t rchunksize, void *chunk,
                                      int64_t chunksize, caterva_array_t *array);
 
+int caterva_blosc_zeros_chunk(caterva_array_t *array, uint8_t *chunk);
+
+void caterva_blosc_array_pad_chunk(caterva_array_t *array, const int32_t *chunkshape,
+                                   const uint8_t *chunk, uint8_t *paddedchunk);
+
+int caterva_blosc_array_gather_chunk(caterva_array_t *array, const int8_t *bbuffer,
+                                     const int64_t *shape, int64_t nchunk, int8_t *chunk);
+
+int caterva_blosc_chunk_compress(caterva_array_t *array, blosc2_context *cctx, int64_t nchunk,
+                                 int8_t *rchunk, bool zeros, const uint8_t *zchunk,
+                                 uint8_t *cchunk, int32_t cchunksize, int32_t *cbytes);
+
+int caterva_blosc_array_append_cchunk(caterva_array_t *array, uint8_t *cchunk, int32_t cbytes);
+
 int caterva_blosc_array_append(caterva_ctx_t *ctx, caterva_array_t *array, void *chunk,
                                int64_t chunksize);
 
+int caterva_blosc_array_zeros(caterva_ctx_t *ctx, caterva_array_t *array);
+
+int caterva_blosc_array_set_chunk(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *coords,
+                                  void *chunk, int64_t chunksize);
+
 int caterva_blosc_array_from_buffer(caterva_ctx_t *ctx, caterva_array_t *array, void *buffer,
                                     int64_t buffersize);
 
 int caterva_blosc_array_get_slice_buffer(caterva_ctx_t *ctx, caterva_array_t *array,
-                                         int64_t *start, int64_t *stop, int64_t *shape,
+                                         int64_t *start, int64_t *stop, const int64_t *shape,
                                          void *buffer);
 
+int caterva_blosc_array_get_slice_buffer_filtered(caterva_ctx_t *ctx, caterva_array_t *array,
+                                                  int64_t *start, int64_t *stop,
+                                                  const int64_t *shape,
+                                                  const caterva_filter_t *filter, void *buffer,
+                                                  int64_t *nskipped);
+
+int caterva_blosc_array_get_chunk_stats(caterva_ctx_t *ctx, caterva_array_t *array,
+                                        int64_t *coords, caterva_stats_t *stats,
+                                        caterva_stats_t *blockstats);
+
+int caterva_blosc_array_get_slice_buffers(caterva_ctx_t *ctx, caterva_array_t *array,
+                                          caterva_slice_request_t *requests,
+                                          int64_t nrequests);
+
+int caterva_blosc_array_get_points(caterva_ctx_t *ctx, caterva_array_t *array,
+                                   const int64_t *coords, int64_t npoints, void *buffer);
+
+int caterva_blosc_array_set_points(caterva_ctx_t *ctx, caterva_array_t *array,
+                                   const int64_t *coords, int64_t npoints, const void *buffer);
+
+int caterva_blosc_reader_get_slice_buffer(caterva_blosc_reader_t *reader, caterva_array_t *array,
+                                          int64_t *start, int64_t *stop, const int64_t *shape,
+                                          void *buffer);
+
+int caterva_blosc_array_get_chunk_buffer(caterva_blosc_reader_t *reader, caterva_array_t *array,
+                                         int64_t *coords, void *buffer);
+
+int caterva_blosc_array_get_chunk_blocked(caterva_ctx_t *ctx, caterva_array_t *array,
+                                          int64_t *coords, void *buffer, int64_t buffersize,
+                                          caterva_chunk_layout_t *layout);
+
+int caterva_blosc_array_set_slice_buffer(caterva_ctx_t *ctx, void *buffer, int64_t buffersize,
+                                         int64_t *start, int64_t *stop, caterva_array_t *array);
+
+int caterva_blosc_array_set_cache_size(caterva_ctx_t *ctx, caterva_array_t *array,
+                                       int64_t nbytes);
+
+int caterva_blosc_array_get_cache_stats(caterva_ctx_t *ctx, caterva_array_t *array,
+                                        caterva_cache_stats_t *stats);
+
 int caterva_blosc_array_to_buffer(caterva_ctx_t *ctx, caterva_array_t *array, void *buffer);
 
 int caterva_blosc_array_get_slice(caterva_ctx_t *ctx, caterva_array_t *src, int64_t *start,
@@ -47,8 +152,27 @@ int caterva_blosc_array_squeeze_index(caterva_ctx_t *ctx, caterva_array_t *src,
 
 int caterva_blosc_array_squeeze(caterva_ctx_t *ctx, caterva_array_t *src);
 
+int caterva_blosc_array_resize(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *new_shape);
+
 int caterva_blosc_array_copy(caterva_ctx_t *ctx, caterva_params_t *params,
                              caterva_storage_t *storage, caterva_array_t *src,
                              caterva_array_t **dest);
 
+int caterva_blosc_array_get_meta(caterva_ctx_t *ctx, caterva_array_t *array, uint8_t *meta,
+                                 int32_t metasize, int32_t *metalen);
+
+int caterva_blosc_array_check_meta(caterva_ctx_t *ctx, caterva_array_t *array,
+                                   const uint8_t *meta, int32_t metalen, bool *compatible);
+
+int caterva_blosc_array_get_chunk_compressed(caterva_ctx_t *ctx, caterva_array_t *array,
+                                             int64_t *coords, void *buffer, int64_t buffersize,
+                                             int64_t *cbytes);
+
+int caterva_blosc_array_set_chunk_compressed(caterva_ctx_t *ctx, caterva_array_t *array,
+                                             int64_t *coords, const void *cchunk, int64_t cbytes);
+
+int caterva_blosc_array_set_fillvalue(caterva_array_t *array, const uint8_t *fillvalue);
+
+int caterva_blosc_array_track_versions(caterva_ctx_t *ctx, caterva_array_t *array);
+
 #endif  // CATERVA_CATERVA_BLOSC_H_
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "caterva_cache.h"
+
+#include "caterva_threads.h"
+
+/*
+ * A cache of decompressed chunks with LRU eviction. The blocks of an entry are tracked
+ * individually, so a chunk that was partially decompressed (using a maskout) can be reused for
+ * reading the blocks that were already decompressed, and be completed afterwards.
+ *
+ * Entries are pinned while a reader copies data out of them and cannot be evicted meanwhile. Only
+ * one thread at a time can decompress blocks into an entry; other threads asking for the same
+ * chunk in the meantime bypass the cache.
+ */
+
+struct caterva_cache_entry_s {
+    int64_t nchunk;
+    //!< The chunk held by the entry. If @p nchunk equals to -1, the entry is empty.
+    uint8_t *data;
+    //!< The decompressed chunk (allocated the first time the entry is used).
+    bool *valid;
+    //!< The blocks of the chunk that have been decompressed in @p data.
+    int pins;
+    //!< Number of readers using the entry.
+    bool filling;
+    //!< Indicate if there is a thread decompressing blocks into the entry.
+    uint64_t last_use;
+    //!< The value of the cache clock when the entry was used for the last time.
+};
+
+struct caterva_cache_s {
+    void *(*alloc)(size_t);
+    void (*free)(void *);
+    int64_t chunkbytes;
+    //!< The size (in bytes) of a decompressed chunk.
+    int nblocks;
+    //!< Number of blocks in a chunk.
+    int nentries;
+    caterva_cache_entry_t *entries;
+    uint64_t clock;
+    caterva_cache_stats_t stats;
+    pthread_mutex_t mutex;
+};
+
+int caterva_cache_new(caterva_ctx_t *ctx, int64_t nbytes, int64_t chunkbytes, int nblocks,
+                      int64_t nchunks, caterva_cache_t **cache) {
+    *cache = NULL;
+    if (nbytes <= 0 || chunkbytes <= 0 || nbytes / chunkbytes == 0) {
+        // The budget is not enough for a single chunk, so the cache is disabled
+        return CATERVA_SUCCEED;
+    }
+    // There is no need for more entries than chunks
+    int64_t nentries = nbytes / chunkbytes;
+    if (nentries > nchunks) {
+        nentries = nchunks;
+    }
+    if (nentries <= 0) {
+        return CATERVA_SUCCEED;
+    }
+    if (nentries > INT32_MAX) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    caterva_cache_t *cache_ = ctx->cfg->alloc(sizeof(caterva_cache_t));
+    CATERVA_ERROR_NULL(cache_);
+    cache_->alloc = ctx->cfg->alloc;
+    cache_->free = ctx->cfg->free;
+    cache_->chunkbytes = chunkbytes;
+    cache_->nblocks = nblocks;
+    cache_->nentries = (int) nentries;
+    cache_->clock = 0;
+    memset(&cache_->stats, 0, sizeof(caterva_cache_stats_t));
+    cache_->entries = ctx->cfg->alloc((size_t) nentries * sizeof(caterva_cache_entry_t));
+    if (cache_->entries == NULL) {
+        ctx->cfg->free(cache_);
+        CATERVA_ERROR_NULL(NULL);
+    }
+    for (int i = 0; i < cache_->nentries; ++i) {
+        caterva_cache_entry_t *entry = &cache_->entries[i];
+        entry->nchunk = -1;
+        entry->data = NULL;
+        entry->valid = NULL;
+        entry->pins = 0;
+        entry->filling = false;
+        entry->last_use = 0;
+    }
+    pthread_mutex_init(&cache_->mutex, NULL);
+
+    *cache = cache_;
+    return CATERVA_SUCCEED;
+}
+
+int caterva_cache_free(caterva_cache_t **cache) {
+    caterva_cache_t *cache_ = *cache;
+    if (cache_ == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    for (int i = 0; i < cache_->nentries; ++i) {
+        if (cache_->entries[i].data != NULL) {
+            cache_->free(cache_->entries[i].data);
+            cache_->free(cache_->entries[i].valid);
+        }
+    }
+    cache_->free(cache_->entries);
+    pthread_mutex_destroy(&cache_->mutex);
+    cache_->free(cache_);
+    *cache = NULL;
+
+    return CATERVA_SUCCEED;
+}
+
+// Find an entry that can hold a new chunk. Must be called with the mutex held.
+static caterva_cache_entry_t *caterva_cache_victim(caterva_cache_t *cache) {
+    caterva_cache_entry_t *victim = NULL;
+    for (int i = 0; i < cache->nentries; ++i) {
+        caterva_cache_entry_t *entry = &cache->entries[i];
+        if (entry->pins > 0 || entry->filling) {
+            continue;
+        }
+        // Empty entries are preferred (the ones already allocated first), then the LRU one
+        if (entry->nchunk < 0) {
+            if (entry->data != NULL) {
+                victim = entry;
+                break;
+            }
+            if (victim == NULL || victim->nchunk >= 0) {
+                victim = entry;
+            }
+        } else if (victim == NULL ||
+                   (victim->nchunk >= 0 && entry->last_use < victim->last_use)) {
+            victim = entry;
+        }
+    }
+    if (victim == NULL) {
+        return NULL;
+    }
+
+    if (victim->data == NULL) {
+        victim->data = cache->alloc((size_t) cache->chunkbytes);
+        victim->valid = cache->alloc((size_t) cache->nblocks * sizeof(bool));
+        if (victim->data == NULL || victim->valid == NULL) {
+            if (victim->data != NULL) {
+                cache->free(victim->data);
+            }
+            if (victim->valid != NULL) {
+                cache->free(victim->valid);
+            }
+            victim->data = NULL;
+            victim->valid = NULL;
+            return NULL;
+        }
+        cache->stats.nbytes += cache->chunkbytes;
+    }
+    if (victim->nchunk >= 0) {
+        cache->stats.evictions++;
+    }
+    victim->nchunk = -1;
+    memset(victim->valid, 0, (size_t) cache->nblocks * sizeof(bool));
+
+    return victim;
+}
+
+/*
+ * Get the decompressed chunk `nchunk`. The blocks needed are the ones that are not masked out in
+ * `maskout`.
+ *
+ * If all the blocks needed are already in the cache, `decompress` is set to false. Otherwise, it is
+ * set to true and `maskout` is updated so that only the missing blocks are decompressed into
+ * `data`. If the cache can not be used, `data` is set to NULL and `maskout` is not modified.
+ *
+ * Every entry acquired must be released with `caterva_cache_release`.
+ */
+int caterva_cache_acquire(caterva_cache_t *cache, int64_t nchunk, bool *maskout, uint8_t **data,
+                          bool *decompress, caterva_cache_entry_t **entry) {
+    *data = NULL;
+    *entry = NULL;
+    *decompress = true;
+
+    pthread_mutex_lock(&cache->mutex);
+    caterva_cache_entry_t *entry_ = NULL;
+    for (int i = 0; i < cache->nentries; ++i) {
+        if (cache->entries[i].nchunk == nchunk) {
+            entry_ = &cache->entries[i];
+            break;
+        }
+    }
+
+    if (entry_ != NULL) {
+        if (entry_->filling) {
+            cache->stats.misses++;
+            pthread_mutex_unlock(&cache->mutex);
+            return CATERVA_SUCCEED;
+        }
+        bool missing = false;
+        for (int i = 0; i < cache->nblocks; ++i) {
+            if (!maskout[i] && !entry_->valid[i]) {
+                missing = true;
+                break;
+            }
+        }
+        if (missing) {
+            for (int i = 0; i < cache->nblocks; ++i) {
+                maskout[i] = maskout[i] || entry_->valid[i];
+            }
+            entry_->filling = true;
+            cache->stats.misses++;
+        } else {
+            *decompress = false;
+            cache->stats.hits++;
+        }
+    } else {
+        cache->stats.misses++;
+        entry_ = caterva_cache_victim(cache);
+        if (entry_ == NULL) {
+            pthread_mutex_unlock(&cache->mutex);
+            return CATERVA_SUCCEED;
+        }
+        entry_->nchunk = nchunk;
+        entry_->filling = true;
+    }
+
+    entry_->pins++;
+    entry_->last_use = ++cache->clock;
+    pthread_mutex_unlock(&cache->mutex);
+
+    *data = entry_->data;
+    *entry = entry_;
+    return CATERVA_SUCCEED;
+}
+
+/*
+ * Release an entry acquired with `caterva_cache_acquire`. If `filled` is true, the blocks that
+ * were not masked out in `maskout` are marked as valid.
+ */
+void caterva_cache_release(caterva_cache_t *cache, caterva_cache_entry_t *entry,
+                           const bool *maskout, bool filled) {
+    pthread_mutex_lock(&cache->mutex);
+    if (entry->filling) {
+        // An entry invalidated while it was being filled stays empty
+        if (filled && entry->nchunk >= 0) {
+            for (int i = 0; i < cache->nblocks; ++i) {
+                entry->valid[i] = entry->valid[i] || !maskout[i];
+            }
+        }
+        entry->filling = false;
+    }
+    entry->pins--;
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+/*
+ * Drop the chunk `nchunk` from the cache. If `nchunk` is -1, all the chunks are dropped.
+ */
+void caterva_cache_invalidate(caterva_cache_t *cache, int64_t nchunk) {
+    pthread_mutex_lock(&cache->mutex);
+    for (int i = 0; i < cache->nentries; ++i) {
+        caterva_cache_entry_t *entry = &cache->entries[i];
+        if (entry->nchunk >= 0 && (nchunk < 0 || entry->nchunk == nchunk)) {
+            entry->nchunk = -1;
+            memset(entry->valid, 0, (size_t) cache->nblocks * sizeof(bool));
+        }
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+void caterva_cache_get_stats(caterva_cache_t *cache, caterva_cache_stats_t *stats) {
+    pthread_mutex_lock(&cache->mutex);
+    *stats = cache->stats;
+    pthread_mutex_unlock(&cache->mutex);
+}
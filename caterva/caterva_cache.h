@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef CATERVA_CATERVA_CACHE_H_
+#define CATERVA_CATERVA_CACHE_H_
+
+#include <caterva.h>
+
+typedef struct caterva_cache_entry_s caterva_cache_entry_t;
+
+int caterva_cache_new(caterva_ctx_t *ctx, int64_t nbytes, int64_t chunkbytes, int nblocks,
+                      int64_t nchunks, caterva_cache_t **cache);
+
+int caterva_cache_free(caterva_cache_t **cache);
+
+int caterva_cache_acquire(caterva_cache_t *cache, int64_t nchunk, bool *maskout, uint8_t **data,
+                          bool *decompress, caterva_cache_entry_t **entry);
+
+void caterva_cache_release(caterva_cache_t *cache, caterva_cache_entry_t *entry,
+                           const bool *maskout, bool filled);
+
+void caterva_cache_invalidate(caterva_cache_t *cache, int64_t nchunk);
+
+void caterva_cache_get_stats(caterva_cache_t *cache, caterva_cache_stats_t *stats);
+
+#endif  // CATERVA_CATERVA_CACHE_H_
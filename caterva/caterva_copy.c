@@ -0,0 +1,469 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "caterva_copy.h"
+
+/*
+ * Kernels for copying boxes of items between strided (C-ordered) arrays.
+ *
+ * The shape of the box is normalized first: dimensions of size 1 are dropped and dimensions that
+ * are contiguous in both arrays are merged. The resulting box is then copied by a kernel
+ * specialized for its number of dimensions (1 to 4) and its itemsize (1, 2, 4 or 8), which walks
+ * both arrays with incremental pointers. Long lines use memcpy. Boxes of short lines (like the
+ * lines of small blocks) are copied as tiles of lines instead, by a kernel that moves every line
+ * with a couple of (possibly overlapping) vector loads and stores; it is chosen at runtime
+ * between AVX2, SSE2, NEON and a scalar fallback.
+ */
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#include <emmintrin.h>
+#define CATERVA_COPY_HAVE_SSE2
+#if defined(__GNUC__) || defined(__clang__)
+#include <immintrin.h>
+#define CATERVA_COPY_HAVE_AVX2
+#endif
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define CATERVA_COPY_HAVE_NEON
+#endif
+
+// Lines longer than this (in bytes) are copied using memcpy
+#define CATERVA_COPY_SHORT_LINE 64
+
+typedef void (*caterva_copy_kernel_t)(const int64_t *shape, const uint8_t *src,
+                                      const int64_t *src_strides, uint8_t *dest,
+                                      const int64_t *dest_strides);
+
+#define CATERVA_COPY_KERNELS(type)                                                               \
+    static inline void caterva_copy_line_##type(uint8_t *dest, const uint8_t *src, int64_t n) { \
+        if (n * (int64_t) sizeof(type) > CATERVA_COPY_SHORT_LINE) {                             \
+            memcpy(dest, src, (size_t) n * sizeof(type));                                       \
+            return;                                                                              \
+        }                                                                                        \
+        for (int64_t i = 0; i < n; ++i) {                                                        \
+            memcpy(dest + i * sizeof(type), src + i * sizeof(type), sizeof(type));               \
+        }                                                                                        \
+    }                                                                                            \
+                                                                                                 \
+    static void caterva_copy_1d_##type(const int64_t *shape, const uint8_t *src,                \
+                                       const int64_t *src_strides, uint8_t *dest,               \
+                                       const int64_t *dest_strides) {                           \
+        (void) src_strides;                                                                      \
+        (void) dest_strides;                                                                     \
+        caterva_copy_line_##type(dest, src, shape[0]);                                           \
+    }                                                                                            \
+                                                                                                 \
+    static void caterva_copy_2d_##type(const int64_t *shape, const uint8_t *src,                \
+                                       const int64_t *src_strides, uint8_t *dest,               \
+                                       const int64_t *dest_strides) {                           \
+        for (int64_t i0 = 0; i0 < shape[0]; ++i0) {                                              \
+            caterva_copy_line_##type(dest, src, shape[1]);                                       \
+            src += src_strides[0];                                                               \
+            dest += dest_strides[0];                                                             \
+        }                                                                                        \
+    }                                                                                            \
+                                                                                                 \
+    static void caterva_copy_3d_##type(const int64_t *shape, const uint8_t *src,                \
+                                       const int64_t *src_strides, uint8_t *dest,               \
+                                       const int64_t *dest_strides) {                           \
+        for (int64_t i0 = 0; i0 < shape[0]; ++i0) {                                              \
+            caterva_copy_2d_##type(shape + 1, src, src_strides + 1, dest, dest_strides + 1);     \
+            src += src_strides[0];                                                               \
+            dest += dest_strides[0];                                                             \
+        }                                                                                        \
+    }                                                                                            \
+                                                                                                 \
+    static void caterva_copy_4d_##type(const int64_t *shape, const uint8_t *src,                \
+                                       const int64_t *src_strides, uint8_t *dest,               \
+                                       const int64_t *dest_strides) {                           \
+        for (int64_t i0 = 0; i0 < shape[0]; ++i0) {                                              \
+            caterva_copy_3d_##type(shape + 1, src, src_strides + 1, dest, dest_strides + 1);     \
+            src += src_strides[0];                                                               \
+            dest += dest_strides[0];                                                             \
+        }                                                                                        \
+    }
+
+CATERVA_COPY_KERNELS(uint8_t)
+CATERVA_COPY_KERNELS(uint16_t)
+CATERVA_COPY_KERNELS(uint32_t)
+CATERVA_COPY_KERNELS(uint64_t)
+
+static const caterva_copy_kernel_t caterva_copy_kernels[4][4] = {
+    {caterva_copy_1d_uint8_t, caterva_copy_2d_uint8_t, caterva_copy_3d_uint8_t,
+     caterva_copy_4d_uint8_t},
+    {caterva_copy_1d_uint16_t, caterva_copy_2d_uint16_t, caterva_copy_3d_uint16_t,
+     caterva_copy_4d_uint16_t},
+    {caterva_copy_1d_uint32_t, caterva_copy_2d_uint32_t, caterva_copy_3d_uint32_t,
+     caterva_copy_4d_uint32_t},
+    {caterva_copy_1d_uint64_t, caterva_copy_2d_uint64_t, caterva_copy_3d_uint64_t,
+     caterva_copy_4d_uint64_t},
+};
+
+/*
+ * Tile kernels. They copy shape[0] lines of shape[1] bytes, with 0 < shape[1] <= 64; the strides
+ * are expressed in bytes. Every line is moved with loads and stores of the widest size that fits
+ * in it, the last one overlapping the previous ones instead of looping over a tail.
+ */
+
+static inline void caterva_copy_line_small(uint8_t *dest, const uint8_t *src, int64_t nbytes) {
+    if (nbytes >= 8) {
+        uint64_t head, tail;
+        memcpy(&head, src, 8);
+        memcpy(&tail, src + nbytes - 8, 8);
+        memcpy(dest, &head, 8);
+        memcpy(dest + nbytes - 8, &tail, 8);
+    } else if (nbytes >= 4) {
+        uint32_t head, tail;
+        memcpy(&head, src, 4);
+        memcpy(&tail, src + nbytes - 4, 4);
+        memcpy(dest, &head, 4);
+        memcpy(dest + nbytes - 4, &tail, 4);
+    } else if (nbytes >= 2) {
+        uint16_t head, tail;
+        memcpy(&head, src, 2);
+        memcpy(&tail, src + nbytes - 2, 2);
+        memcpy(dest, &head, 2);
+        memcpy(dest + nbytes - 2, &tail, 2);
+    } else {
+        *dest = *src;
+    }
+}
+
+static void caterva_copy_tile_scalar(const int64_t *shape, const uint8_t *src,
+                                     const int64_t *src_strides, uint8_t *dest,
+                                     const int64_t *dest_strides) {
+    int64_t nbytes = shape[1];
+    for (int64_t i0 = 0; i0 < shape[0]; ++i0) {
+        if (nbytes <= 16) {
+            caterva_copy_line_small(dest, src, nbytes);
+        } else {
+            int64_t offset = 0;
+            for (; offset < nbytes - 8; offset += 8) {
+                memcpy(dest + offset, src + offset, 8);
+            }
+            memcpy(dest + nbytes - 8, src + nbytes - 8, 8);
+        }
+        src += src_strides[0];
+        dest += dest_strides[0];
+    }
+}
+
+#if defined(CATERVA_COPY_HAVE_SSE2)
+static void caterva_copy_tile_sse2(const int64_t *shape, const uint8_t *src,
+                                   const int64_t *src_strides, uint8_t *dest,
+                                   const int64_t *dest_strides) {
+    int64_t nbytes = shape[1];
+    if (nbytes < 16) {
+        caterva_copy_tile_scalar(shape, src, src_strides, dest, dest_strides);
+        return;
+    }
+    for (int64_t i0 = 0; i0 < shape[0]; ++i0) {
+        __m128i a = _mm_loadu_si128((const __m128i *) src);
+        __m128i b = _mm_loadu_si128((const __m128i *) (src + nbytes - 16));
+        if (nbytes > 32) {
+            __m128i c = _mm_loadu_si128((const __m128i *) (src + 16));
+            __m128i d = _mm_loadu_si128((const __m128i *) (src + nbytes - 32));
+            _mm_storeu_si128((__m128i *) (dest + 16), c);
+            _mm_storeu_si128((__m128i *) (dest + nbytes - 32), d);
+        }
+        _mm_storeu_si128((__m128i *) dest, a);
+        _mm_storeu_si128((__m128i *) (dest + nbytes - 16), b);
+        src += src_strides[0];
+        dest += dest_strides[0];
+    }
+}
+#endif
+
+#if defined(CATERVA_COPY_HAVE_AVX2)
+__attribute__((target("avx2")))
+static void caterva_copy_tile_avx2(const int64_t *shape, const uint8_t *src,
+                                   const int64_t *src_strides, uint8_t *dest,
+                                   const int64_t *dest_strides) {
+    int64_t nbytes = shape[1];
+    if (nbytes < 32) {
+        caterva_copy_tile_sse2(shape, src, src_strides, dest, dest_strides);
+        return;
+    }
+    for (int64_t i0 = 0; i0 < shape[0]; ++i0) {
+        __m256i a = _mm256_loadu_si256((const __m256i *) src);
+        __m256i b = _mm256_loadu_si256((const __m256i *) (src + nbytes - 32));
+        _mm256_storeu_si256((__m256i *) dest, a);
+        _mm256_storeu_si256((__m256i *) (dest + nbytes - 32), b);
+        src += src_strides[0];
+        dest += dest_strides[0];
+    }
+}
+#endif
+
+#if defined(CATERVA_COPY_HAVE_NEON)
+static void caterva_copy_tile_neon(const int64_t *shape, const uint8_t *src,
+                                   const int64_t *src_strides, uint8_t *dest,
+                                   const int64_t *dest_strides) {
+    int64_t nbytes = shape[1];
+    if (nbytes < 16) {
+        caterva_copy_tile_scalar(shape, src, src_strides, dest, dest_strides);
+        return;
+    }
+    for (int64_t i0 = 0; i0 < shape[0]; ++i0) {
+        uint8x16_t a = vld1q_u8(src);
+        uint8x16_t b = vld1q_u8(src + nbytes - 16);
+        if (nbytes > 32) {
+            uint8x16_t c = vld1q_u8(src + 16);
+            uint8x16_t d = vld1q_u8(src + nbytes - 32);
+            vst1q_u8(dest + 16, c);
+            vst1q_u8(dest + nbytes - 32, d);
+        }
+        vst1q_u8(dest, a);
+        vst1q_u8(dest + nbytes - 16, b);
+        src += src_strides[0];
+        dest += dest_strides[0];
+    }
+}
+#endif
+
+// The instruction set forced by caterva_copy_set_isa, or -1 to detect it
+static int caterva_copy_forced_isa = -1;
+
+// Whether the tile kernel can use the instruction set `isa` in this machine
+bool caterva_copy_isa_supported(caterva_copy_isa_t isa) {
+    switch (isa) {
+        case CATERVA_COPY_ISA_SCALAR:
+            return true;
+#if defined(CATERVA_COPY_HAVE_SSE2)
+        case CATERVA_COPY_ISA_SSE2:
+            return true;
+#endif
+#if defined(CATERVA_COPY_HAVE_AVX2)
+        case CATERVA_COPY_ISA_AVX2:
+            return __builtin_cpu_supports("avx2") != 0;
+#endif
+#if defined(CATERVA_COPY_HAVE_NEON)
+        case CATERVA_COPY_ISA_NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+// Get the instruction set used by the tile kernel
+caterva_copy_isa_t caterva_copy_get_isa(void) {
+    if (caterva_copy_forced_isa >= 0) {
+        return (caterva_copy_isa_t) caterva_copy_forced_isa;
+    }
+    if (caterva_copy_isa_supported(CATERVA_COPY_ISA_AVX2)) {
+        return CATERVA_COPY_ISA_AVX2;
+    }
+    if (caterva_copy_isa_supported(CATERVA_COPY_ISA_SSE2)) {
+        return CATERVA_COPY_ISA_SSE2;
+    }
+    if (caterva_copy_isa_supported(CATERVA_COPY_ISA_NEON)) {
+        return CATERVA_COPY_ISA_NEON;
+    }
+    return CATERVA_COPY_ISA_SCALAR;
+}
+
+/*
+ * Force the instruction set used by the tile kernel (or go back to detecting it if `isa` is
+ * CATERVA_COPY_ISA_AUTO). This is meant for tests, and must not be called while other threads
+ * are copying.
+ */
+int caterva_copy_set_isa(caterva_copy_isa_t isa) {
+    if (isa == CATERVA_COPY_ISA_AUTO) {
+        caterva_copy_forced_isa = -1;
+        return CATERVA_SUCCEED;
+    }
+    if (!caterva_copy_isa_supported(isa)) {
+        DEBUG_PRINT("The instruction set is not supported by this machine");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    caterva_copy_forced_isa = (int) isa;
+    return CATERVA_SUCCEED;
+}
+
+static caterva_copy_kernel_t caterva_copy_tile_kernel(void) {
+    switch (caterva_copy_get_isa()) {
+#if defined(CATERVA_COPY_HAVE_AVX2)
+        case CATERVA_COPY_ISA_AVX2:
+            return caterva_copy_tile_avx2;
+#endif
+#if defined(CATERVA_COPY_HAVE_SSE2)
+        case CATERVA_COPY_ISA_SSE2:
+            return caterva_copy_tile_sse2;
+#endif
+#if defined(CATERVA_COPY_HAVE_NEON)
+        case CATERVA_COPY_ISA_NEON:
+            return caterva_copy_tile_neon;
+#endif
+        default:
+            return caterva_copy_tile_scalar;
+    }
+}
+
+// Compute the (C-ordered) strides, in items, of an array with shape `shape`
+void caterva_copy_strides(int8_t ndim, const int64_t *shape, int64_t *strides) {
+    if (ndim == 0) {
+        return;
+    }
+    strides[ndim - 1] = 1;
+    for (int i = ndim - 2; i >= 0; --i) {
+        strides[i] = strides[i + 1] * shape[i + 1];
+    }
+}
+
+/*
+ * Copy a box with shape `shape` from `src` to `dest`. The strides are expressed in items and the
+ * last dimension must be contiguous (stride 1) in both arrays.
+ */
+void caterva_copy_box(int8_t ndim, uint8_t itemsize, const int64_t *shape, const uint8_t *src,
+                      const int64_t *src_strides, uint8_t *dest, const int64_t *dest_strides) {
+    int64_t n_shape[CATERVA_MAX_DIM];
+    int64_t n_src_strides[CATERVA_MAX_DIM];
+    int64_t n_dest_strides[CATERVA_MAX_DIM];
+
+    // Normalize the box, from the innermost dimension outwards
+    int8_t n_ndim = 0;
+    for (int i = ndim - 1; i >= 0; --i) {
+        if (shape[i] <= 0) {
+            return;
+        }
+        if (shape[i] == 1 && i != ndim - 1) {
+            continue;
+        }
+        if (n_ndim > 0) {
+            int j = CATERVA_MAX_DIM - n_ndim;
+            if (src_strides[i] == n_shape[j] * n_src_strides[j] &&
+                dest_strides[i] == n_shape[j] * n_dest_strides[j]) {
+                n_shape[j] *= shape[i];
+                continue;
+            }
+        }
+        n_ndim++;
+        n_shape[CATERVA_MAX_DIM - n_ndim] = shape[i];
+        n_src_strides[CATERVA_MAX_DIM - n_ndim] = src_strides[i];
+        n_dest_strides[CATERVA_MAX_DIM - n_ndim] = dest_strides[i];
+    }
+    if (n_ndim == 0) {
+        // 0-dim arrays hold a single item
+        memcpy(dest, src, itemsize);
+        return;
+    }
+    // From now on, the strides are expressed in bytes
+    for (int i = CATERVA_MAX_DIM - n_ndim; i < CATERVA_MAX_DIM; ++i) {
+        n_src_strides[i] *= itemsize;
+        n_dest_strides[i] *= itemsize;
+    }
+    int64_t *b_shape = &n_shape[CATERVA_MAX_DIM - n_ndim];
+    int64_t *b_src_strides = &n_src_strides[CATERVA_MAX_DIM - n_ndim];
+    int64_t *b_dest_strides = &n_dest_strides[CATERVA_MAX_DIM - n_ndim];
+
+    caterva_copy_kernel_t kernel;
+    int8_t kernel_ndim;
+    if (n_ndim >= 2 && b_shape[n_ndim - 1] * itemsize <= CATERVA_COPY_SHORT_LINE) {
+        // Copy the short lines as bytes, a 2-dim tile at a time
+        b_shape[n_ndim - 1] *= itemsize;
+        kernel = caterva_copy_tile_kernel();
+        kernel_ndim = 2;
+    } else {
+        int kind;
+        switch (itemsize) {
+            case 1:
+                kind = 0;
+                break;
+            case 2:
+                kind = 1;
+                break;
+            case 4:
+                kind = 2;
+                break;
+            case 8:
+                kind = 3;
+                break;
+            default:
+                // Copy the items as bytes
+                kind = 0;
+                b_shape[n_ndim - 1] *= itemsize;
+        }
+        kernel_ndim = (int8_t) (n_ndim < 4 ? n_ndim : 4);
+        kernel = caterva_copy_kernels[kind][kernel_ndim - 1];
+    }
+
+    if (n_ndim == kernel_ndim) {
+        kernel(b_shape, src, b_src_strides, dest, b_dest_strides);
+        return;
+    }
+
+    // Iterate over the outer dimensions and copy the inner boxes
+    int8_t outer_ndim = (int8_t) (n_ndim - kernel_ndim);
+    int64_t index[CATERVA_MAX_DIM] = {0};
+    int64_t nboxes = 1;
+    for (int i = 0; i < outer_ndim; ++i) {
+        nboxes *= b_shape[i];
+    }
+    for (int64_t nbox = 0; nbox < nboxes; ++nbox) {
+        kernel(b_shape + outer_ndim, src, b_src_strides + outer_ndim, dest,
+               b_dest_strides + outer_ndim);
+        // Advance the outer index (and the pointers)
+        for (int i = outer_ndim - 1; i >= 0; --i) {
+            index[i]++;
+            src += b_src_strides[i];
+            dest += b_dest_strides[i];
+            if (index[i] < b_shape[i]) {
+                break;
+            }
+            src -= b_src_strides[i] * b_shape[i];
+            dest -= b_dest_strides[i] * b_shape[i];
+            index[i] = 0;
+        }
+    }
+}
+
+// Set the `nitems` items of `dest` to `value` (or to 0 if it is NULL)
+void caterva_copy_fill(uint8_t itemsize, uint8_t *dest, int64_t nitems, const uint8_t *value) {
+    int64_t nbytes = nitems * itemsize;
+    if (value == NULL) {
+        memset(dest, 0, (size_t) nbytes);
+        return;
+    }
+    if (nbytes <= 0) {
+        return;
+    }
+    // The filled prefix is doubled until it covers the whole buffer
+    memcpy(dest, value, itemsize);
+    int64_t filled = itemsize;
+    while (filled < nbytes) {
+        int64_t n = filled < nbytes - filled ? filled : nbytes - filled;
+        memcpy(dest + filled, dest, (size_t) n);
+        filled += n;
+    }
+}
+
+// Whether the `nitems` items of `src` are all equal to `value` (or to 0 if it is NULL)
+bool caterva_copy_is_constant(uint8_t itemsize, const uint8_t *src, int64_t nitems,
+                              const uint8_t *value) {
+    if (nitems <= 0) {
+        return true;
+    }
+    if (value != NULL) {
+        if (memcmp(src, value, itemsize) != 0) {
+            return false;
+        }
+    } else {
+        for (int i = 0; i < itemsize; ++i) {
+            if (src[i] != 0) {
+                return false;
+            }
+        }
+    }
+    // Every item equals the first one if the buffer equals itself shifted by one item
+    return memcmp(src, src + itemsize, (size_t) ((nitems - 1) * itemsize)) == 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef CATERVA_CATERVA_COPY_H_
+#define CATERVA_CATERVA_COPY_H_
+
+#include <caterva.h>
+
+/**
+ * @brief The instruction sets of the kernel copying boxes of short lines.
+ */
+typedef enum {
+    CATERVA_COPY_ISA_AUTO = -1,  //!< Use the best one supported by the machine.
+    CATERVA_COPY_ISA_SCALAR,
+    CATERVA_COPY_ISA_SSE2,
+    CATERVA_COPY_ISA_AVX2,
+    CATERVA_COPY_ISA_NEON,
+} caterva_copy_isa_t;
+
+bool caterva_copy_isa_supported(caterva_copy_isa_t isa);
+
+caterva_copy_isa_t caterva_copy_get_isa(void);
+
+int caterva_copy_set_isa(caterva_copy_isa_t isa);
+
+void caterva_copy_strides(int8_t ndim, const int64_t *shape, int64_t *strides);
+
+void caterva_copy_box(int8_t ndim, uint8_t itemsize, const int64_t *shape, const uint8_t *src,
+                      const int64_t *src_strides, uint8_t *dest, const int64_t *dest_strides);
+
+void caterva_copy_fill(uint8_t itemsize, uint8_t *dest, int64_t nitems, const uint8_t *value);
+
+bool caterva_copy_is_constant(uint8_t itemsize, const uint8_t *src, int64_t nitems,
+                              const uint8_t *value);
+
+#endif  // CATERVA_CATERVA_COPY_H_
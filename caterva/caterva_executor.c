@@ -0,0 +1,441 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <caterva.h>
+
+#include "caterva_threads.h"
+
+/*
+ * An executor keeps a bounded FIFO queue of requests and a pool of workers. A worker takes the
+ * first request that does not conflict with the ones running or queued before it on the same
+ * array (only reads can overlap), together with the queued reads of the same array touching some
+ * common chunk, which are run as a single batch. The workers use a context of their own with a
+ * single thread, since the parallelism comes from running several requests at a time.
+ */
+
+/* The maximum number of reads coalesced into a batch */
+#define CATERVA_EXECUTOR_MAX_BATCH 64
+
+typedef enum {
+    CATERVA_EXECUTOR_GET_SLICE,
+    CATERVA_EXECUTOR_SET_SLICE,
+    CATERVA_EXECUTOR_APPEND,
+} caterva_executor_op_t;
+
+struct caterva_future_s {
+    caterva_executor_t *executor;
+    caterva_executor_op_t op;
+    caterva_array_t *array;
+    caterva_slice_request_t slice;
+    //!< The slice (or the chunk, for appends) of the request.
+    caterva_callback_t callback;
+    void *arg;
+    int rc;
+    bool done;
+    bool owned;
+    //!< Indicate that the future is kept (and freed) by the caller.
+    caterva_future_t *next;
+    //!< The next request in the queue (or in the list of running requests).
+};
+
+struct caterva_executor_s {
+    caterva_ctx_t *ctx;
+    //!< The context used by the workers.
+    caterva_future_t *queue;
+    //!< The requests waiting to be run, in order of submission.
+    int nqueued;
+    int queuesize;
+    bool blocking;
+    caterva_future_t *running;
+    //!< The requests being run.
+    bool stop;
+    //!< Indicate that the workers have to finish once the queue is empty.
+    int nworkers;
+    pthread_t *threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    //!< Signaled when a request is queued, taken or finished.
+};
+
+static bool caterva_executor_conflict(caterva_future_t *a, caterva_future_t *b) {
+    return a->array == b->array &&
+           (a->op != CATERVA_EXECUTOR_GET_SLICE || b->op != CATERVA_EXECUTOR_GET_SLICE);
+}
+
+// Whether the chunks touched by two slices of the same array overlap
+static bool caterva_executor_overlap(caterva_future_t *a, caterva_future_t *b) {
+    caterva_array_t *array = a->array;
+    for (int i = 0; i < array->ndim; ++i) {
+        int64_t chunkshape = array->chunkshape[i];
+        if (a->slice.stop[i] <= a->slice.start[i] || b->slice.stop[i] <= b->slice.start[i]) {
+            return false;
+        }
+        if ((a->slice.stop[i] - 1) / chunkshape < b->slice.start[i] / chunkshape ||
+            (b->slice.stop[i] - 1) / chunkshape < a->slice.start[i] / chunkshape) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether `request` can be run now. Must be called with the mutex held.
+static bool caterva_executor_ready(caterva_executor_t *executor, caterva_future_t *request) {
+    for (caterva_future_t *other = executor->running; other != NULL; other = other->next) {
+        if (caterva_executor_conflict(request, other)) {
+            return false;
+        }
+    }
+    for (caterva_future_t *other = executor->queue; other != request; other = other->next) {
+        if (caterva_executor_conflict(request, other)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Take the first request that can be run (and the reads coalesced with it) from the queue, moving
+// them to the running list. Must be called with the mutex held.
+static int caterva_executor_take(caterva_executor_t *executor, caterva_future_t **batch) {
+    caterva_future_t **link = &executor->queue;
+    while (*link != NULL && !caterva_executor_ready(executor, *link)) {
+        link = &(*link)->next;
+    }
+    if (*link == NULL) {
+        return 0;
+    }
+
+    int nbatch = 0;
+    caterva_future_t *first = *link;
+    while (*link != NULL && nbatch < CATERVA_EXECUTOR_MAX_BATCH) {
+        caterva_future_t *request = *link;
+        bool take = request == first;
+        if (!take && first->op == CATERVA_EXECUTOR_GET_SLICE &&
+            request->op == CATERVA_EXECUTOR_GET_SLICE && request->array == first->array) {
+            take = caterva_executor_overlap(request, first) &&
+                   caterva_executor_ready(executor, request);
+        }
+        if (!take) {
+            link = &request->next;
+            continue;
+        }
+        *link = request->next;
+        executor->nqueued--;
+        batch[nbatch++] = request;
+        if (first->op != CATERVA_EXECUTOR_GET_SLICE) {
+            break;
+        }
+    }
+    for (int n = 0; n < nbatch; ++n) {
+        batch[n]->next = executor->running;
+        executor->running = batch[n];
+    }
+
+    return nbatch;
+}
+
+static int caterva_executor_run(caterva_ctx_t *ctx, caterva_future_t *request) {
+    caterva_slice_request_t *slice = &request->slice;
+    switch (request->op) {
+        case CATERVA_EXECUTOR_GET_SLICE:
+            return caterva_get_slice_buffer(ctx, request->array, slice->start, slice->stop,
+                                            slice->shape, slice->buffer, slice->buffersize);
+        case CATERVA_EXECUTOR_SET_SLICE:
+            return caterva_set_slice_buffer(ctx, slice->buffer, slice->buffersize, slice->start,
+                                            slice->stop, request->array);
+        case CATERVA_EXECUTOR_APPEND:
+            return caterva_append(ctx, request->array, slice->buffer, slice->buffersize);
+        default:
+            return CATERVA_ERR_INVALID_ARGUMENT;
+    }
+}
+
+static void *caterva_executor_worker(void *arg) {
+    caterva_executor_t *executor = (caterva_executor_t *) arg;
+    caterva_future_t *batch[CATERVA_EXECUTOR_MAX_BATCH];
+    caterva_slice_request_t slices[CATERVA_EXECUTOR_MAX_BATCH];
+
+    pthread_mutex_lock(&executor->mutex);
+    while (true) {
+        int nbatch = caterva_executor_take(executor, batch);
+        if (nbatch == 0) {
+            if (executor->stop && executor->queue == NULL) {
+                break;
+            }
+            pthread_cond_wait(&executor->cond, &executor->mutex);
+            continue;
+        }
+        // There is room in the queue now
+        pthread_cond_broadcast(&executor->cond);
+        pthread_mutex_unlock(&executor->mutex);
+
+        // The coalesced reads are run together, and one by one if any of them fails
+        bool done = false;
+        if (nbatch > 1) {
+            for (int n = 0; n < nbatch; ++n) {
+                slices[n] = batch[n]->slice;
+            }
+            if (caterva_get_slice_buffers(executor->ctx, batch[0]->array, slices, nbatch) ==
+                CATERVA_SUCCEED) {
+                for (int n = 0; n < nbatch; ++n) {
+                    batch[n]->rc = CATERVA_SUCCEED;
+                }
+                done = true;
+            }
+        }
+        for (int n = 0; !done && n < nbatch; ++n) {
+            batch[n]->rc = caterva_executor_run(executor->ctx, batch[n]);
+        }
+        for (int n = 0; n < nbatch; ++n) {
+            if (batch[n]->callback != NULL) {
+                batch[n]->callback(batch[n]->arg, batch[n]->rc);
+            }
+        }
+
+        pthread_mutex_lock(&executor->mutex);
+        for (int n = 0; n < nbatch; ++n) {
+            caterva_future_t **link = &executor->running;
+            while (*link != batch[n]) {
+                link = &(*link)->next;
+            }
+            *link = batch[n]->next;
+            batch[n]->done = true;
+            if (!batch[n]->owned) {
+                executor->ctx->cfg->free(batch[n]);
+            }
+        }
+        pthread_cond_broadcast(&executor->cond);
+    }
+    pthread_mutex_unlock(&executor->mutex);
+
+    return NULL;
+}
+
+int caterva_executor_new(caterva_ctx_t *ctx, int queuesize, bool blocking,
+                         caterva_executor_t **executor) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(executor);
+    if (queuesize <= 0) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    caterva_executor_t *executor_ = ctx->cfg->alloc(sizeof(caterva_executor_t));
+    CATERVA_ERROR_NULL(executor_);
+    memset(executor_, 0, sizeof(caterva_executor_t));
+    executor_->queuesize = queuesize;
+    executor_->blocking = blocking;
+    executor_->nworkers = ctx->cfg->nthreads > 1 ? ctx->cfg->nthreads : 1;
+
+    caterva_config_t cfg = *ctx->cfg;
+    cfg.nthreads = 1;
+    int rc = caterva_ctx_new(&cfg, &executor_->ctx);
+    if (rc != CATERVA_SUCCEED) {
+        ctx->cfg->free(executor_);
+        CATERVA_ERROR(rc);
+    }
+    pthread_mutex_init(&executor_->mutex, NULL);
+    pthread_cond_init(&executor_->cond, NULL);
+
+    int nstarted;
+    rc = caterva_threads_start(executor_->ctx, executor_->nworkers, caterva_executor_worker, executor_,
+                               &executor_->threads, &nstarted);
+    executor_->nworkers = nstarted;
+    if (rc != CATERVA_SUCCEED) {
+        caterva_executor_free(&executor_);
+        CATERVA_ERROR(rc);
+    }
+
+    *executor = executor_;
+    return CATERVA_SUCCEED;
+}
+
+int caterva_executor_free(caterva_executor_t **executor) {
+    CATERVA_ERROR_NULL(executor);
+    caterva_executor_t *executor_ = *executor;
+    if (executor_ == NULL) {
+        return CATERVA_SUCCEED;
+    }
+
+    pthread_mutex_lock(&executor_->mutex);
+    executor_->stop = true;
+    pthread_cond_broadcast(&executor_->cond);
+    pthread_mutex_unlock(&executor_->mutex);
+    int rc = CATERVA_SUCCEED;
+    if (executor_->threads != NULL) {
+        rc = caterva_threads_join(executor_->ctx, executor_->nworkers, executor_->threads);
+    }
+    pthread_mutex_destroy(&executor_->mutex);
+    pthread_cond_destroy(&executor_->cond);
+
+    caterva_ctx_t *ctx = executor_->ctx;
+    void (*auxfree)(void *) = ctx->cfg->free;
+    caterva_ctx_free(&ctx);
+    auxfree(executor_);
+    *executor = NULL;
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+// Queue a request, waiting for room in the queue if the executor is blocking
+static int caterva_executor_submit(caterva_executor_t *executor, caterva_future_t *request,
+                                   caterva_future_t **future) {
+    request->executor = executor;
+    request->rc = CATERVA_SUCCEED;
+    request->done = false;
+    request->owned = future != NULL;
+    request->next = NULL;
+
+    pthread_mutex_lock(&executor->mutex);
+    while (executor->nqueued >= executor->queuesize) {
+        if (!executor->blocking) {
+            pthread_mutex_unlock(&executor->mutex);
+            executor->ctx->cfg->free(request);
+            CATERVA_ERROR(CATERVA_ERR_QUEUE_FULL);
+        }
+        pthread_cond_wait(&executor->cond, &executor->mutex);
+    }
+    caterva_future_t **link = &executor->queue;
+    while (*link != NULL) {
+        link = &(*link)->next;
+    }
+    *link = request;
+    executor->nqueued++;
+    pthread_cond_broadcast(&executor->cond);
+    pthread_mutex_unlock(&executor->mutex);
+
+    if (future != NULL) {
+        *future = request;
+    }
+    return CATERVA_SUCCEED;
+}
+
+// Create a request for a slice of `array`
+static int caterva_executor_request(caterva_executor_t *executor, caterva_executor_op_t op,
+                                    caterva_array_t *array, const int64_t *start,
+                                    const int64_t *stop, const int64_t *shape, void *buffer,
+                                    int64_t buffersize, caterva_callback_t callback, void *arg,
+                                    caterva_future_t **request) {
+    caterva_future_t *request_ = executor->ctx->cfg->alloc(sizeof(caterva_future_t));
+    CATERVA_ERROR_NULL(request_);
+    memset(request_, 0, sizeof(caterva_future_t));
+    request_->op = op;
+    request_->array = array;
+    for (int i = 0; start != NULL && i < array->ndim; ++i) {
+        request_->slice.start[i] = start[i];
+        request_->slice.stop[i] = stop[i];
+        request_->slice.shape[i] = shape != NULL ? shape[i] : stop[i] - start[i];
+    }
+    request_->slice.buffer = buffer;
+    request_->slice.buffersize = buffersize;
+    request_->callback = callback;
+    request_->arg = arg;
+
+    *request = request_;
+    return CATERVA_SUCCEED;
+}
+
+int caterva_get_slice_buffer_async(caterva_executor_t *executor, caterva_array_t *array,
+                                   int64_t *start, int64_t *stop, int64_t *shape, void *buffer,
+                                   int64_t buffersize, caterva_callback_t callback, void *arg,
+                                   caterva_future_t **future) {
+    CATERVA_ERROR_NULL(executor);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(start);
+    CATERVA_ERROR_NULL(stop);
+    CATERVA_ERROR_NULL(shape);
+    CATERVA_ERROR_NULL(buffer);
+
+    caterva_future_t *request;
+    CATERVA_ERROR(caterva_executor_request(executor, CATERVA_EXECUTOR_GET_SLICE, array, start,
+                                           stop, shape, buffer, buffersize, callback, arg,
+                                           &request));
+    CATERVA_ERROR(caterva_executor_submit(executor, request, future));
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_set_slice_buffer_async(caterva_executor_t *executor, caterva_array_t *array,
+                                   int64_t *start, int64_t *stop, void *buffer,
+                                   int64_t buffersize, caterva_callback_t callback, void *arg,
+                                   caterva_future_t **future) {
+    CATERVA_ERROR_NULL(executor);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(start);
+    CATERVA_ERROR_NULL(stop);
+    CATERVA_ERROR_NULL(buffer);
+
+    caterva_future_t *request;
+    CATERVA_ERROR(caterva_executor_request(executor, CATERVA_EXECUTOR_SET_SLICE, array, start,
+                                           stop, NULL, buffer, buffersize, callback, arg,
+                                           &request));
+    CATERVA_ERROR(caterva_executor_submit(executor, request, future));
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_append_async(caterva_executor_t *executor, caterva_array_t *array, void *chunk,
+                         int64_t chunksize, caterva_callback_t callback, void *arg,
+                         caterva_future_t **future) {
+    CATERVA_ERROR_NULL(executor);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(chunk);
+
+    caterva_future_t *request;
+    CATERVA_ERROR(caterva_executor_request(executor, CATERVA_EXECUTOR_APPEND, array, NULL, NULL,
+                                           NULL, chunk, chunksize, callback, arg, &request));
+    CATERVA_ERROR(caterva_executor_submit(executor, request, future));
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_future_test(caterva_future_t *future, bool *done, int *rc) {
+    CATERVA_ERROR_NULL(future);
+    CATERVA_ERROR_NULL(done);
+
+    caterva_executor_t *executor = future->executor;
+    pthread_mutex_lock(&executor->mutex);
+    *done = future->done;
+    if (future->done && rc != NULL) {
+        *rc = future->rc;
+    }
+    pthread_mutex_unlock(&executor->mutex);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_future_wait(caterva_future_t *future, int *rc) {
+    CATERVA_ERROR_NULL(future);
+
+    caterva_executor_t *executor = future->executor;
+    pthread_mutex_lock(&executor->mutex);
+    while (!future->done) {
+        pthread_cond_wait(&executor->cond, &executor->mutex);
+    }
+    if (rc != NULL) {
+        *rc = future->rc;
+    }
+    pthread_mutex_unlock(&executor->mutex);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_future_free(caterva_future_t **future) {
+    CATERVA_ERROR_NULL(future);
+    if (*future == NULL) {
+        return CATERVA_SUCCEED;
+    }
+
+    CATERVA_ERROR(caterva_future_wait(*future, NULL));
+    (*future)->executor->ctx->cfg->free(*future);
+    *future = NULL;
+
+    return CATERVA_SUCCEED;
+}
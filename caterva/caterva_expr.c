@@ -0,0 +1,822 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <caterva.h>
+
+#include <math.h>
+
+#include "caterva_blosc.h"
+#include "caterva_instr.h"
+#include "caterva_pool.h"
+#include "caterva_stats.h"
+
+/*
+ * The expressions are trees that are only evaluated when their result is requested. As all their
+ * arrays have the same chunkshape and blockshape, the decompressed chunks of all of them have the
+ * same (blocked) layout, so they are combined item by item without reordering them. The tree is
+ * compiled into a list of steps in postorder, and every step computes a whole block into a
+ * scratch buffer of doubles, which is small enough to stay in the cache while the next steps
+ * read it.
+ */
+
+typedef enum {
+    CATERVA_EXPR_ARRAY,
+    CATERVA_EXPR_SCALAR,
+    CATERVA_EXPR_OP,
+} caterva_expr_kind_t;
+
+struct caterva_expr_s {
+    caterva_ctx_t *ctx;
+    caterva_expr_kind_t kind;
+    caterva_array_t *array;
+    caterva_dtype_t dtype;
+    //!< The array and the type of its items (only for arrays).
+    double value;
+    //!< The value (only for scalars).
+    caterva_op_t op;
+    caterva_expr_t *lhs;
+    caterva_expr_t *rhs;
+    //!< The operation and its operands (only for operations).
+    caterva_array_t *ref;
+    //!< An array of the expression, which gives its geometry. It is NULL if there is none.
+    int nnodes;
+    //!< Number of nodes of the tree.
+};
+
+typedef struct {
+    caterva_expr_t *node;
+    int lhs;
+    int rhs;
+    //!< The steps that compute the operands (only for operations).
+    int operand;
+    //!< The operand whose chunk is read (only for arrays).
+} caterva_expr_step_t;
+
+typedef struct {
+    caterva_ctx_t *ctx;
+    caterva_array_t *ref;
+    caterva_expr_step_t *steps;
+    int nsteps;
+    caterva_array_t **operands;
+    //!< The different arrays of the expression. Each one is decompressed once per chunk.
+    int noperands;
+} caterva_expr_program_t;
+
+typedef struct {
+    uint8_t **chunks;
+    //!< The decompressed chunk of every operand.
+    double **scratch;
+    //!< The block computed by every step.
+    const double **values;
+    //!< The block of every step, which is read from the chunk of the operand for doubles.
+} caterva_expr_scratch_t;
+
+int caterva_expr_array(caterva_ctx_t *ctx, caterva_array_t *array, caterva_dtype_t dtype,
+                       caterva_expr_t **expr) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(expr);
+
+    if (array->storage != CATERVA_STORAGE_BLOSC) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+    if (!array->filled) {
+        DEBUG_PRINT("The array must be filled before using it in an expression");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    if (caterva_stats_dtype_size(dtype) != array->itemsize) {
+        DEBUG_PRINT("The type does not match the itemsize");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    caterva_expr_t *expr_ = ctx->cfg->alloc(sizeof(caterva_expr_t));
+    CATERVA_ERROR_NULL(expr_);
+    memset(expr_, 0, sizeof(caterva_expr_t));
+    expr_->ctx = ctx;
+    expr_->kind = CATERVA_EXPR_ARRAY;
+    expr_->array = array;
+    expr_->dtype = dtype;
+    expr_->ref = array;
+    expr_->nnodes = 1;
+
+    *expr = expr_;
+    return CATERVA_SUCCEED;
+}
+
+int caterva_expr_scalar(caterva_ctx_t *ctx, double value, caterva_expr_t **expr) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(expr);
+
+    caterva_expr_t *expr_ = ctx->cfg->alloc(sizeof(caterva_expr_t));
+    CATERVA_ERROR_NULL(expr_);
+    memset(expr_, 0, sizeof(caterva_expr_t));
+    expr_->ctx = ctx;
+    expr_->kind = CATERVA_EXPR_SCALAR;
+    expr_->value = value;
+    expr_->nnodes = 1;
+
+    *expr = expr_;
+    return CATERVA_SUCCEED;
+}
+
+int caterva_expr_op(caterva_ctx_t *ctx, caterva_op_t op, caterva_expr_t *lhs, caterva_expr_t *rhs,
+                    caterva_expr_t **expr) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(lhs);
+    CATERVA_ERROR_NULL(rhs);
+    CATERVA_ERROR_NULL(expr);
+
+    if (op < CATERVA_OP_ADD || op > CATERVA_OP_MAX || lhs == rhs) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    caterva_array_t *a = lhs->ref;
+    caterva_array_t *b = rhs->ref;
+    if (a != NULL && b != NULL) {
+        bool same = a->ndim == b->ndim;
+        for (int i = 0; i < a->ndim && same; ++i) {
+            same = a->shape[i] == b->shape[i] && a->chunkshape[i] == b->chunkshape[i] &&
+                   a->blockshape[i] == b->blockshape[i];
+        }
+        if (!same) {
+            DEBUG_PRINT("The arrays must have the same shape, chunkshape and blockshape");
+            CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+        }
+    }
+
+    caterva_expr_t *expr_ = ctx->cfg->alloc(sizeof(caterva_expr_t));
+    CATERVA_ERROR_NULL(expr_);
+    memset(expr_, 0, sizeof(caterva_expr_t));
+    expr_->ctx = ctx;
+    expr_->kind = CATERVA_EXPR_OP;
+    expr_->op = op;
+    expr_->lhs = lhs;
+    expr_->rhs = rhs;
+    expr_->ref = a != NULL ? a : b;
+    expr_->nnodes = 1 + lhs->nnodes + rhs->nnodes;
+
+    *expr = expr_;
+    return CATERVA_SUCCEED;
+}
+
+int caterva_expr_free(caterva_expr_t **expr) {
+    CATERVA_ERROR_NULL(expr);
+
+    caterva_expr_t *expr_ = *expr;
+    if (expr_ == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    if (expr_->kind == CATERVA_EXPR_OP) {
+        caterva_expr_free(&expr_->lhs);
+        caterva_expr_free(&expr_->rhs);
+    }
+    expr_->ctx->cfg->free(expr_);
+    *expr = NULL;
+
+    return CATERVA_SUCCEED;
+}
+
+// Append the steps of `node` to `program` in postorder, and return the index of its step
+static int caterva_expr_compile_node(caterva_expr_program_t *program, caterva_expr_t *node) {
+    caterva_expr_step_t step;
+    step.node = node;
+    step.lhs = -1;
+    step.rhs = -1;
+    step.operand = -1;
+    if (node->kind == CATERVA_EXPR_OP) {
+        step.lhs = caterva_expr_compile_node(program, node->lhs);
+        step.rhs = caterva_expr_compile_node(program, node->rhs);
+    } else if (node->kind == CATERVA_EXPR_ARRAY) {
+        for (int i = 0; i < program->noperands && step.operand < 0; ++i) {
+            if (program->operands[i] == node->array) {
+                step.operand = i;
+            }
+        }
+        if (step.operand < 0) {
+            step.operand = program->noperands;
+            program->operands[program->noperands++] = node->array;
+        }
+    }
+    program->steps[program->nsteps] = step;
+    return program->nsteps++;
+}
+
+static int caterva_expr_compile(caterva_ctx_t *ctx, caterva_expr_t *expr,
+                                caterva_expr_program_t *program) {
+    if (expr->ref == NULL) {
+        DEBUG_PRINT("The expression must have at least an array");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    program->ctx = ctx;
+    program->ref = expr->ref;
+    program->nsteps = 0;
+    program->noperands = 0;
+    program->steps = ctx->cfg->alloc((size_t) expr->nnodes * sizeof(caterva_expr_step_t));
+    program->operands = ctx->cfg->alloc((size_t) expr->nnodes * sizeof(caterva_array_t *));
+    if (program->steps == NULL || program->operands == NULL) {
+        if (program->steps != NULL) {
+            ctx->cfg->free(program->steps);
+        }
+        if (program->operands != NULL) {
+            ctx->cfg->free(program->operands);
+        }
+        CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+    }
+    caterva_expr_compile_node(program, expr);
+
+    return CATERVA_SUCCEED;
+}
+
+static void caterva_expr_program_free(caterva_expr_program_t *program) {
+    program->ctx->cfg->free(program->steps);
+    program->ctx->cfg->free(program->operands);
+}
+
+static void caterva_expr_scratch_free(caterva_expr_program_t *program,
+                                      caterva_expr_scratch_t *scratch) {
+    caterva_ctx_t *ctx = program->ctx;
+    if (scratch->chunks != NULL) {
+        for (int i = 0; i < program->noperands; ++i) {
+            if (scratch->chunks[i] != NULL) {
+                caterva_pool_release(ctx, scratch->chunks[i]);
+            }
+        }
+        ctx->cfg->free(scratch->chunks);
+        scratch->chunks = NULL;
+    }
+    if (scratch->scratch != NULL) {
+        for (int i = 0; i < program->nsteps; ++i) {
+            if (scratch->scratch[i] != NULL) {
+                caterva_pool_release(ctx, scratch->scratch[i]);
+            }
+        }
+        ctx->cfg->free(scratch->scratch);
+        scratch->scratch = NULL;
+    }
+    if (scratch->values != NULL) {
+        ctx->cfg->free((void *) scratch->values);
+        scratch->values = NULL;
+    }
+}
+
+// Allocate the buffers needed by a thread to evaluate `program`
+static int caterva_expr_scratch_init(caterva_expr_program_t *program,
+                                     caterva_expr_scratch_t *scratch) {
+    caterva_ctx_t *ctx = program->ctx;
+    int64_t blocknitems = program->ref->blocknitems;
+    scratch->chunks = ctx->cfg->alloc((size_t) program->noperands * sizeof(uint8_t *));
+    scratch->scratch = ctx->cfg->alloc((size_t) program->nsteps * sizeof(double *));
+    scratch->values = ctx->cfg->alloc((size_t) program->nsteps * sizeof(double *));
+    bool failed = scratch->chunks == NULL || scratch->scratch == NULL || scratch->values == NULL;
+    for (int i = 0; i < program->noperands && scratch->chunks != NULL; ++i) {
+        caterva_array_t *operand = program->operands[i];
+        scratch->chunks[i] = caterva_pool_alloc(ctx, (size_t) operand->extchunknitems *
+                                                     operand->itemsize);
+        failed = failed || scratch->chunks[i] == NULL;
+    }
+    for (int i = 0; i < program->nsteps && scratch->scratch != NULL; ++i) {
+        caterva_expr_t *node = program->steps[i].node;
+        scratch->scratch[i] = NULL;
+        // The blocks of doubles are read straight from the chunk
+        if (node->kind == CATERVA_EXPR_ARRAY && node->dtype == CATERVA_DTYPE_FLOAT64) {
+            continue;
+        }
+        scratch->scratch[i] = caterva_pool_alloc(ctx, (size_t) blocknitems * sizeof(double));
+        if (scratch->scratch[i] == NULL) {
+            failed = true;
+        } else if (node->kind == CATERVA_EXPR_SCALAR) {
+            for (int64_t j = 0; j < blocknitems; ++j) {
+                scratch->scratch[i][j] = node->value;
+            }
+        }
+    }
+    if (failed) {
+        caterva_expr_scratch_free(program, scratch);
+        CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+    }
+    caterva_instr_scratch(program->ref, program->noperands + program->nsteps);
+
+    return CATERVA_SUCCEED;
+}
+
+#define CATERVA_EXPR_CONVERT(dest_type, dest, src_type, src, n)       \
+    do {                                                              \
+        dest_type *dest_ = (dest_type *) (dest);                      \
+        const src_type *src_ = (const src_type *) (src);              \
+        for (int64_t i_ = 0; i_ < (n); ++i_) {                        \
+            dest_[i_] = (dest_type) src_[i_];                         \
+        }                                                             \
+    } while (0)
+
+// Convert `n` items of type `dtype` into doubles
+static void caterva_expr_load(caterva_dtype_t dtype, const uint8_t *items, int64_t n,
+                              double *dest) {
+    switch (dtype) {
+        case CATERVA_DTYPE_INT8:
+            CATERVA_EXPR_CONVERT(double, dest, int8_t, items, n);
+            break;
+        case CATERVA_DTYPE_INT16:
+            CATERVA_EXPR_CONVERT(double, dest, int16_t, items, n);
+            break;
+        case CATERVA_DTYPE_INT32:
+            CATERVA_EXPR_CONVERT(double, dest, int32_t, items, n);
+            break;
+        case CATERVA_DTYPE_INT64:
+            CATERVA_EXPR_CONVERT(double, dest, int64_t, items, n);
+            break;
+        case CATERVA_DTYPE_UINT8:
+            CATERVA_EXPR_CONVERT(double, dest, uint8_t, items, n);
+            break;
+        case CATERVA_DTYPE_UINT16:
+            CATERVA_EXPR_CONVERT(double, dest, uint16_t, items, n);
+            break;
+        case CATERVA_DTYPE_UINT32:
+            CATERVA_EXPR_CONVERT(double, dest, uint32_t, items, n);
+            break;
+        case CATERVA_DTYPE_UINT64:
+            CATERVA_EXPR_CONVERT(double, dest, uint64_t, items, n);
+            break;
+        case CATERVA_DTYPE_FLOAT32:
+            CATERVA_EXPR_CONVERT(double, dest, float, items, n);
+            break;
+        case CATERVA_DTYPE_FLOAT64:
+            memcpy(dest, items, (size_t) n * sizeof(double));
+            break;
+        default:
+            break;
+    }
+}
+
+// Convert `n` doubles into items of type `dtype`
+static void caterva_expr_store(caterva_dtype_t dtype, const double *values, int64_t n,
+                               uint8_t *items) {
+    switch (dtype) {
+        case CATERVA_DTYPE_INT8:
+            CATERVA_EXPR_CONVERT(int8_t, items, double, values, n);
+            break;
+        case CATERVA_DTYPE_INT16:
+            CATERVA_EXPR_CONVERT(int16_t, items, double, values, n);
+            break;
+        case CATERVA_DTYPE_INT32:
+            CATERVA_EXPR_CONVERT(int32_t, items, double, values, n);
+            break;
+        case CATERVA_DTYPE_INT64:
+            CATERVA_EXPR_CONVERT(int64_t, items, double, values, n);
+            break;
+        case CATERVA_DTYPE_UINT8:
+            CATERVA_EXPR_CONVERT(uint8_t, items, double, values, n);
+            break;
+        case CATERVA_DTYPE_UINT16:
+            CATERVA_EXPR_CONVERT(uint16_t, items, double, values, n);
+            break;
+        case CATERVA_DTYPE_UINT32:
+            CATERVA_EXPR_CONVERT(uint32_t, items, double, values, n);
+            break;
+        case CATERVA_DTYPE_UINT64:
+            CATERVA_EXPR_CONVERT(uint64_t, items, double, values, n);
+            break;
+        case CATERVA_DTYPE_FLOAT32:
+            CATERVA_EXPR_CONVERT(float, items, double, values, n);
+            break;
+        case CATERVA_DTYPE_FLOAT64:
+            memcpy(items, values, (size_t) n * sizeof(double));
+            break;
+        default:
+            break;
+    }
+}
+
+// The loops are kept free of branches, so that the compiler can vectorize them
+static void caterva_expr_kernel(caterva_op_t op, const double *a, const double *b, int64_t n,
+                                double *dest) {
+    switch (op) {
+        case CATERVA_OP_ADD:
+            for (int64_t i = 0; i < n; ++i) {
+                dest[i] = a[i] + b[i];
+            }
+            break;
+        case CATERVA_OP_SUB:
+            for (int64_t i = 0; i < n; ++i) {
+                dest[i] = a[i] - b[i];
+            }
+            break;
+        case CATERVA_OP_MUL:
+            for (int64_t i = 0; i < n; ++i) {
+                dest[i] = a[i] * b[i];
+            }
+            break;
+        case CATERVA_OP_DIV:
+            for (int64_t i = 0; i < n; ++i) {
+                dest[i] = a[i] / b[i];
+            }
+            break;
+        case CATERVA_OP_MIN:
+            for (int64_t i = 0; i < n; ++i) {
+                dest[i] = b[i] < a[i] ? b[i] : a[i];
+            }
+            break;
+        case CATERVA_OP_MAX:
+            for (int64_t i = 0; i < n; ++i) {
+                dest[i] = b[i] > a[i] ? b[i] : a[i];
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Compute the block `nblock` of the chunks in `scratch` and return it
+static const double *caterva_expr_block(caterva_expr_program_t *program,
+                                        caterva_expr_scratch_t *scratch, int64_t nblock) {
+    int64_t blocknitems = program->ref->blocknitems;
+    for (int i = 0; i < program->nsteps; ++i) {
+        caterva_expr_step_t *step = &program->steps[i];
+        caterva_expr_t *node = step->node;
+        switch (node->kind) {
+            case CATERVA_EXPR_ARRAY: {
+                const uint8_t *items = scratch->chunks[step->operand] +
+                                       nblock * blocknitems * node->array->itemsize;
+                if (node->dtype == CATERVA_DTYPE_FLOAT64) {
+                    scratch->values[i] = (const double *) items;
+                } else {
+                    caterva_expr_load(node->dtype, items, blocknitems, scratch->scratch[i]);
+                    scratch->values[i] = scratch->scratch[i];
+                }
+                break;
+            }
+            case CATERVA_EXPR_SCALAR:
+                scratch->values[i] = scratch->scratch[i];
+                break;
+            case CATERVA_EXPR_OP:
+                caterva_expr_kernel(node->op, scratch->values[step->lhs],
+                                    scratch->values[step->rhs], blocknitems, scratch->scratch[i]);
+                scratch->values[i] = scratch->scratch[i];
+                break;
+        }
+    }
+    return scratch->values[program->nsteps - 1];
+}
+
+// Decompress the chunk `nchunk` of every operand into `scratch`
+static int caterva_expr_decompress(caterva_expr_program_t *program, caterva_expr_scratch_t *scratch,
+                                   caterva_blosc_reader_t *reader, int64_t nchunk) {
+    for (int i = 0; i < program->noperands; ++i) {
+        caterva_array_t *operand = program->operands[i];
+        CATERVA_ERROR(caterva_blosc_reader_decompress(
+            reader, operand, nchunk, NULL, scratch->chunks[i],
+            (int32_t) (operand->extchunknitems * operand->itemsize)));
+    }
+    return CATERVA_SUCCEED;
+}
+
+typedef struct {
+    caterva_expr_program_t *program;
+    caterva_dtype_t dtype;
+} caterva_expr_eval_t;
+
+// The fill function of the append pipeline, which produces the chunks of the result already in
+// their blocked order
+static int caterva_expr_fill(void *fill_arg, caterva_blosc_reader_t *reader,
+                             caterva_array_t *array, int64_t nchunk, int8_t *chunk,
+                             int8_t *rchunk, bool *zeros) {
+    CATERVA_UNUSED_PARAM(chunk);
+    CATERVA_UNUSED_PARAM(zeros);
+    caterva_expr_eval_t *eval = (caterva_expr_eval_t *) fill_arg;
+    caterva_expr_program_t *program = eval->program;
+
+    caterva_expr_scratch_t scratch;
+    CATERVA_ERROR(caterva_expr_scratch_init(program, &scratch));
+    int rc = caterva_expr_decompress(program, &scratch, reader, nchunk);
+    if (rc == CATERVA_SUCCEED) {
+        int64_t nblocks = array->extchunknitems / array->blocknitems;
+        int64_t blockbytes = array->blocknitems * array->itemsize;
+        for (int64_t nblock = 0; nblock < nblocks; ++nblock) {
+            const double *values = caterva_expr_block(program, &scratch, nblock);
+            caterva_expr_store(eval->dtype, values, array->blocknitems,
+                               (uint8_t *) rchunk + nblock * blockbytes);
+        }
+    }
+    caterva_expr_scratch_free(program, &scratch);
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_expr_eval(caterva_ctx_t *ctx, caterva_expr_t *expr, caterva_dtype_t dtype,
+                      caterva_storage_t *storage, caterva_array_t **array) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(expr);
+    CATERVA_ERROR_NULL(storage);
+    CATERVA_ERROR_NULL(array);
+
+    if (storage->backend != CATERVA_STORAGE_BLOSC) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+    int itemsize = caterva_stats_dtype_size(dtype);
+    if (itemsize == 0) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    caterva_expr_program_t program;
+    CATERVA_ERROR(caterva_expr_compile(ctx, expr, &program));
+
+    // The result has the geometry of the operands, so its chunks are computed in place
+    caterva_array_t *ref = program.ref;
+    caterva_params_t params = {0};
+    params.itemsize = (uint8_t) itemsize;
+    params.ndim = ref->ndim;
+    caterva_storage_t storage_ = *storage;
+    for (int i = 0; i < ref->ndim; ++i) {
+        params.shape[i] = ref->shape[i];
+        storage_.properties.blosc.chunkshape[i] = ref->chunkshape[i];
+        storage_.properties.blosc.blockshape[i] = ref->blockshape[i];
+    }
+    int rc = caterva_empty(ctx, &params, &storage_, array);
+    if (rc == CATERVA_SUCCEED) {
+        caterva_expr_eval_t eval;
+        eval.program = &program;
+        eval.dtype = dtype;
+        rc = caterva_blosc_array_fill(ctx, *array, program.operands[0], caterva_expr_fill, &eval);
+        if (rc != CATERVA_SUCCEED) {
+            caterva_free(ctx, array);
+        }
+    }
+    caterva_expr_program_free(&program);
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+typedef struct {
+    caterva_ctx_t *ctx;
+    caterva_expr_program_t *program;
+    caterva_reduce_t op;
+    int64_t ostrides[CATERVA_MAX_DIM];
+    //!< The strides of the result for every dimension of the operands (0 for the reduced ones).
+    double *result;
+    int64_t nresult;
+    int64_t nchunks;
+    int64_t next_chunk;
+    //!< The next chunk to be claimed by a worker.
+    int nthreads;
+    //!< Number of threads used by every worker to decompress the chunks.
+    int rc;
+    pthread_mutex_t mutex;
+} caterva_expr_reduce_job_t;
+
+static void caterva_expr_reduce_init(caterva_reduce_t op, double *acc, int64_t n) {
+    double value = op == CATERVA_REDUCE_MIN ? INFINITY : op == CATERVA_REDUCE_MAX ? -INFINITY : 0;
+    for (int64_t i = 0; i < n; ++i) {
+        acc[i] = value;
+    }
+}
+
+// Reduce every one of the `n` values into its own accumulator
+static void caterva_expr_reduce_items(caterva_reduce_t op, const double *values, int64_t n,
+                                      double *acc) {
+    switch (op) {
+        case CATERVA_REDUCE_SUM:
+            for (int64_t i = 0; i < n; ++i) {
+                acc[i] += values[i];
+            }
+            break;
+        case CATERVA_REDUCE_MIN:
+            for (int64_t i = 0; i < n; ++i) {
+                acc[i] = values[i] < acc[i] ? values[i] : acc[i];
+            }
+            break;
+        case CATERVA_REDUCE_MAX:
+            for (int64_t i = 0; i < n; ++i) {
+                acc[i] = values[i] > acc[i] ? values[i] : acc[i];
+            }
+            break;
+    }
+}
+
+// Reduce the `n` values into a single accumulator
+static void caterva_expr_reduce_row(caterva_reduce_t op, const double *values, int64_t n,
+                                    double *acc) {
+    double acc_ = *acc;
+    switch (op) {
+        case CATERVA_REDUCE_SUM:
+            for (int64_t i = 0; i < n; ++i) {
+                acc_ += values[i];
+            }
+            break;
+        case CATERVA_REDUCE_MIN:
+            for (int64_t i = 0; i < n; ++i) {
+                acc_ = values[i] < acc_ ? values[i] : acc_;
+            }
+            break;
+        case CATERVA_REDUCE_MAX:
+            for (int64_t i = 0; i < n; ++i) {
+                acc_ = values[i] > acc_ ? values[i] : acc_;
+            }
+            break;
+    }
+    *acc = acc_;
+}
+
+// Reduce the block `nblock` of the chunk `nchunk` into `acc`, skipping the padding. The block is
+// in C order, so it is reduced row by row.
+static void caterva_expr_reduce_block(caterva_expr_reduce_job_t *job, const double *values,
+                                      int64_t nchunk, int64_t nblock, double *acc) {
+    caterva_array_t *ref = job->program->ref;
+    int8_t ndim = ref->ndim;
+    int64_t start[CATERVA_MAX_DIM];
+    int64_t shape[CATERVA_MAX_DIM];
+    int64_t bstrides[CATERVA_MAX_DIM];
+    int64_t bstride = 1;
+    for (int i = ndim - 1; i >= 0; --i) {
+        int64_t nchunks = ref->extshape[i] / ref->chunkshape[i];
+        int64_t nblocks = ref->extchunkshape[i] / ref->blockshape[i];
+        int64_t chunk_start = (nchunk % nchunks) * ref->chunkshape[i];
+        int64_t block_start = (nblock % nblocks) * ref->blockshape[i];
+        nchunk /= nchunks;
+        nblock /= nblocks;
+        // The items past the chunkshape are the padding of the chunk, not of the next one
+        shape[i] = ref->blockshape[i];
+        if (block_start + shape[i] > ref->chunkshape[i]) {
+            shape[i] = ref->chunkshape[i] - block_start;
+        }
+        start[i] = chunk_start + block_start;
+        if (start[i] + shape[i] > ref->shape[i]) {
+            shape[i] = ref->shape[i] - start[i];
+        }
+        if (shape[i] <= 0) {
+            return;
+        }
+        bstrides[i] = bstride;
+        bstride *= ref->blockshape[i];
+    }
+
+    int last = ndim - 1;
+    int64_t row[CATERVA_MAX_DIM] = {0};
+    while (true) {
+        int64_t offset = 0;
+        int64_t index = 0;
+        for (int i = 0; i < last; ++i) {
+            offset += row[i] * bstrides[i];
+            index += (start[i] + row[i]) * job->ostrides[i];
+        }
+        index += start[last] * job->ostrides[last];
+        if (job->ostrides[last] == 0) {
+            caterva_expr_reduce_row(job->op, values + offset, shape[last], &acc[index]);
+        } else {
+            caterva_expr_reduce_items(job->op, values + offset, shape[last], &acc[index]);
+        }
+        int i = last - 1;
+        for (; i >= 0; --i) {
+            if (++row[i] < shape[i]) {
+                break;
+            }
+            row[i] = 0;
+        }
+        if (i < 0) {
+            break;
+        }
+    }
+}
+
+static void *caterva_expr_reduce_worker(void *arg) {
+    caterva_expr_reduce_job_t *job = (caterva_expr_reduce_job_t *) arg;
+    caterva_ctx_t *ctx = job->ctx;
+    caterva_expr_program_t *program = job->program;
+    caterva_array_t *ref = program->ref;
+
+    caterva_blosc_reader_t reader;
+    caterva_expr_scratch_t scratch = {0};
+    int rc = caterva_blosc_reader_init(ctx, program->operands[0], job->nthreads, false, &reader);
+    if (rc == CATERVA_SUCCEED) {
+        rc = caterva_expr_scratch_init(program, &scratch);
+    }
+    double *acc = ctx->cfg->alloc((size_t) job->nresult * sizeof(double));
+    if (rc == CATERVA_SUCCEED && acc == NULL) {
+        rc = CATERVA_ERR_NULL_POINTER;
+    }
+    if (acc != NULL) {
+        caterva_expr_reduce_init(job->op, acc, job->nresult);
+    }
+
+    int64_t nblocks = ref->extchunknitems / ref->blocknitems;
+    while (rc == CATERVA_SUCCEED) {
+        pthread_mutex_lock(&job->mutex);
+        if (job->rc != CATERVA_SUCCEED || job->next_chunk >= job->nchunks) {
+            pthread_mutex_unlock(&job->mutex);
+            break;
+        }
+        int64_t nchunk = job->next_chunk++;
+        pthread_mutex_unlock(&job->mutex);
+
+        rc = caterva_expr_decompress(program, &scratch, &reader, nchunk);
+        for (int64_t nblock = 0; rc == CATERVA_SUCCEED && nblock < nblocks; ++nblock) {
+            const double *values = caterva_expr_block(program, &scratch, nblock);
+            caterva_expr_reduce_block(job, values, nchunk, nblock, acc);
+        }
+    }
+    caterva_expr_scratch_free(program, &scratch);
+    caterva_blosc_reader_destroy(ctx, &reader);
+
+    // The accumulators of the workers are merged at the end
+    pthread_mutex_lock(&job->mutex);
+    if (rc != CATERVA_SUCCEED) {
+        job->rc = rc;
+    } else {
+        caterva_expr_reduce_items(job->op, acc, job->nresult, job->result);
+    }
+    pthread_mutex_unlock(&job->mutex);
+    if (acc != NULL) {
+        ctx->cfg->free(acc);
+    }
+
+    return NULL;
+}
+
+int caterva_expr_reduce(caterva_ctx_t *ctx, caterva_expr_t *expr, caterva_reduce_t op,
+                        int8_t axis, double *result, int64_t resultsize) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(expr);
+    CATERVA_ERROR_NULL(result);
+
+    if (op < CATERVA_REDUCE_SUM || op > CATERVA_REDUCE_MAX) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    caterva_array_t *ref = expr->ref;
+    if (ref == NULL) {
+        DEBUG_PRINT("The expression must have at least an array");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    if (axis < -1 || axis >= ref->ndim) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_INDEX);
+    }
+
+    caterva_expr_reduce_job_t job;
+    job.ctx = ctx;
+    job.op = op;
+    job.result = result;
+    job.nresult = 1;
+    for (int i = ref->ndim - 1; i >= 0; --i) {
+        if (axis == -1 || i == axis) {
+            job.ostrides[i] = 0;
+        } else {
+            job.ostrides[i] = job.nresult;
+            job.nresult *= ref->shape[i];
+        }
+    }
+    if (resultsize < job.nresult * (int64_t) sizeof(double)) {
+        DEBUG_PRINT("The result buffer is too small");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    caterva_expr_reduce_init(op, result, job.nresult);
+    if (ref->nitems == 0) {
+        return CATERVA_SUCCEED;
+    }
+
+    caterva_expr_program_t program;
+    CATERVA_ERROR(caterva_expr_compile(ctx, expr, &program));
+    job.program = &program;
+    job.nchunks = ref->extnitems / ref->chunknitems;
+    job.next_chunk = 0;
+    job.rc = CATERVA_SUCCEED;
+    pthread_mutex_init(&job.mutex, NULL);
+
+    // Every worker decompresses different chunks
+    int nworkers = ctx->cfg->nthreads;
+    if (nworkers > job.nchunks) {
+        nworkers = (int) job.nchunks;
+    }
+    int rc = CATERVA_SUCCEED;
+    if (nworkers <= 1) {
+        job.nthreads = caterva_threads_blosc(ctx);
+        caterva_expr_reduce_worker(&job);
+    } else {
+        job.nthreads = 1;
+        caterva_threads_t *threads;
+        rc = caterva_threads_fork(ctx, nworkers, caterva_expr_reduce_worker, &job, &threads);
+        if (rc != CATERVA_SUCCEED) {
+            pthread_mutex_lock(&job.mutex);
+            job.rc = rc;
+            pthread_mutex_unlock(&job.mutex);
+        }
+        if (threads != NULL) {
+            int rc_join = caterva_threads_wait(ctx, &threads);
+            if (rc == CATERVA_SUCCEED) {
+                rc = rc_join;
+            }
+        }
+    }
+    pthread_mutex_destroy(&job.mutex);
+    caterva_expr_program_free(&program);
+    if (rc == CATERVA_SUCCEED) {
+        rc = job.rc;
+    }
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "caterva_instr.h"
+
+/*
+ * The performance counters of an array. Every hot path checks `array->instr` before taking any
+ * timestamp, so disabled counters only cost a pointer check. The counters are updated once per
+ * chunk (never per item or per block), under a mutex, since several workers may share the array.
+ */
+
+static int caterva_instr_new(caterva_ctx_t *ctx, caterva_instr_t **instr) {
+    caterva_instr_t *instr_ = ctx->cfg->alloc(sizeof(caterva_instr_t));
+    CATERVA_ERROR_NULL(instr_);
+    memset(instr_, 0, sizeof(caterva_instr_t));
+    if (pthread_mutex_init(&instr_->mutex, NULL) != 0) {
+        ctx->cfg->free(instr_);
+        CATERVA_ERROR(CATERVA_ERR_THREADS_FAILED);
+    }
+    blosc_set_timestamp(&instr_->origin);
+
+    *instr = instr_;
+    return CATERVA_SUCCEED;
+}
+
+int caterva_instr_free(caterva_ctx_t *ctx, caterva_instr_t **instr) {
+    if (*instr == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    pthread_mutex_destroy(&(*instr)->mutex);
+    ctx->cfg->free(*instr);
+    *instr = NULL;
+
+    return CATERVA_SUCCEED;
+}
+
+// Take the time when a phase starts, if the counters are enabled
+void caterva_instr_start(caterva_array_t *array, blosc_timestamp_t *start) {
+    if (array->instr != NULL) {
+        blosc_set_timestamp(start);
+    }
+}
+
+// Account a phase started at `start` (with `caterva_instr_start`) that has processed `nbytes`
+void caterva_instr_phase(caterva_array_t *array, caterva_phase_t phase, blosc_timestamp_t *start,
+                         int64_t nbytes) {
+    caterva_instr_t *instr = array->instr;
+    if (instr == NULL) {
+        return;
+    }
+    blosc_timestamp_t stop;
+    blosc_set_timestamp(&stop);
+    int64_t nsecs = (int64_t) blosc_elapsed_nsecs(*start, stop);
+
+    pthread_mutex_lock(&instr->mutex);
+    caterva_counters_t *counters = &instr->counters;
+    counters->ncalls[phase]++;
+    counters->nsecs[phase] += nsecs;
+    switch (phase) {
+        case CATERVA_PHASE_READ:
+            counters->nbytes_read += nbytes;
+            break;
+        case CATERVA_PHASE_DECOMPRESS:
+            counters->nbytes_decompressed += nbytes;
+            break;
+        case CATERVA_PHASE_COPY:
+            counters->nbytes_copied += nbytes;
+            break;
+        case CATERVA_PHASE_COMPRESS:
+            counters->nbytes_compressed += nbytes;
+            break;
+        case CATERVA_PHASE_APPEND:
+            counters->nbytes_written += nbytes;
+            break;
+        default:
+            break;
+    }
+    caterva_trace_fn trace = instr->trace;
+    void *trace_arg = instr->trace_arg;
+    pthread_mutex_unlock(&instr->mutex);
+
+    if (trace != NULL) {
+        trace(trace_arg, array, phase, (int64_t) blosc_elapsed_nsecs(instr->origin, *start),
+              nsecs, nbytes);
+    }
+}
+
+void caterva_instr_requested(caterva_array_t *array, int64_t nchunks, int64_t nblocks) {
+    caterva_instr_t *instr = array->instr;
+    if (instr == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&instr->mutex);
+    instr->counters.nchunks_requested += nchunks;
+    instr->counters.nblocks_requested += nblocks;
+    pthread_mutex_unlock(&instr->mutex);
+}
+
+void caterva_instr_decompressed(caterva_array_t *array, int64_t nchunks, int64_t nblocks) {
+    caterva_instr_t *instr = array->instr;
+    if (instr == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&instr->mutex);
+    instr->counters.nchunks_decompressed += nchunks;
+    instr->counters.nblocks_decompressed += nblocks;
+    pthread_mutex_unlock(&instr->mutex);
+}
+
+void caterva_instr_cache(caterva_array_t *array, bool hit) {
+    caterva_instr_t *instr = array->instr;
+    if (instr == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&instr->mutex);
+    if (hit) {
+        instr->counters.cache_hits++;
+    } else {
+        instr->counters.cache_misses++;
+    }
+    pthread_mutex_unlock(&instr->mutex);
+}
+
+void caterva_instr_scratch(caterva_array_t *array, int64_t nbuffers) {
+    caterva_instr_t *instr = array->instr;
+    if (instr == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&instr->mutex);
+    instr->counters.nscratch += nbuffers;
+    pthread_mutex_unlock(&instr->mutex);
+}
+
+int caterva_set_counters(caterva_ctx_t *ctx, caterva_array_t *array, bool enabled) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+
+    CATERVA_ERROR(caterva_instr_free(ctx, &array->instr));
+    if (enabled) {
+        CATERVA_ERROR(caterva_instr_new(ctx, &array->instr));
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_get_counters(caterva_ctx_t *ctx, caterva_array_t *array,
+                         caterva_counters_t *counters) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(counters);
+
+    caterva_instr_t *instr = array->instr;
+    if (instr == NULL) {
+        memset(counters, 0, sizeof(caterva_counters_t));
+        return CATERVA_SUCCEED;
+    }
+    pthread_mutex_lock(&instr->mutex);
+    *counters = instr->counters;
+    pthread_mutex_unlock(&instr->mutex);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_reset_counters(caterva_ctx_t *ctx, caterva_array_t *array) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+
+    caterva_instr_t *instr = array->instr;
+    if (instr == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    pthread_mutex_lock(&instr->mutex);
+    memset(&instr->counters, 0, sizeof(caterva_counters_t));
+    pthread_mutex_unlock(&instr->mutex);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_set_trace(caterva_ctx_t *ctx, caterva_array_t *array, caterva_trace_fn trace,
+                      void *arg) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+
+    if (array->instr == NULL) {
+        CATERVA_ERROR(caterva_instr_new(ctx, &array->instr));
+    }
+    caterva_instr_t *instr = array->instr;
+    pthread_mutex_lock(&instr->mutex);
+    instr->trace = trace;
+    instr->trace_arg = arg;
+    pthread_mutex_unlock(&instr->mutex);
+
+    return CATERVA_SUCCEED;
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef CATERVA_CATERVA_INSTR_H_
+#define CATERVA_CATERVA_INSTR_H_
+
+#include <caterva.h>
+
+#include "caterva_threads.h"
+
+struct caterva_instr_s {
+    caterva_counters_t counters;
+    caterva_trace_fn trace;
+    void *trace_arg;
+    blosc_timestamp_t origin;
+    //!< The time when the counters were enabled (the origin of the trace times).
+    pthread_mutex_t mutex;
+};
+
+int caterva_instr_free(caterva_ctx_t *ctx, caterva_instr_t **instr);
+
+void caterva_instr_start(caterva_array_t *array, blosc_timestamp_t *start);
+
+void caterva_instr_phase(caterva_array_t *array, caterva_phase_t phase, blosc_timestamp_t *start,
+                         int64_t nbytes);
+
+void caterva_instr_requested(caterva_array_t *array, int64_t nchunks, int64_t nblocks);
+
+void caterva_instr_decompressed(caterva_array_t *array, int64_t nchunks, int64_t nblocks);
+
+void caterva_instr_cache(caterva_array_t *array, bool hit);
+
+void caterva_instr_scratch(caterva_array_t *array, int64_t nbuffers);
+
+#endif  // CATERVA_CATERVA_INSTR_H_
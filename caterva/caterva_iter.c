@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <caterva.h>
+
+#include "caterva_blosc.h"
+#include "caterva_pool.h"
+#include "caterva_threads.h"
+
+/*
+ * An iterator over the chunks of an array in storage order. The chunks are decompressed into a
+ * ring of `prefetch + 1` slots: while the consumer holds one slot, a background thread decompresses
+ * the following chunks into the other ones. Without prefetching, there is a single slot and the
+ * chunks are decompressed by the consumer itself.
+ */
+
+typedef struct {
+    uint8_t *buffer;
+    //!< The chunk (in C order).
+    int64_t nchunk;
+    //!< The chunk held by the slot. If @p nchunk is -1, the slot is free.
+} caterva_iter_slot_t;
+
+struct caterva_iter_s {
+    caterva_ctx_t *ctx;
+    caterva_array_t *array;
+    int64_t nchunks;
+    //!< Number of chunks in the array.
+    int64_t next_chunk;
+    //!< The next chunk to be returned to the consumer.
+    int nslots;
+    caterva_iter_slot_t *slots;
+    caterva_blosc_reader_t reader;
+    //!< The reader used to decompress the chunks (only used by the producer).
+    bool prefetch;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    //!< Signaled when a slot is filled or freed.
+    bool stop;
+    //!< Indicate that the producer has to stop.
+    int rc;
+    //!< The first error found by the producer.
+};
+
+static void caterva_iter_coords(caterva_array_t *array, int64_t nchunk, int64_t *coords) {
+    for (int i = array->ndim - 1; i >= 0; --i) {
+        int64_t nchunks = array->extshape[i] / array->chunkshape[i];
+        coords[i] = nchunk % nchunks;
+        nchunk /= nchunks;
+    }
+}
+
+static int caterva_iter_read(caterva_iter_t *iter, int64_t nchunk, uint8_t *buffer) {
+    int64_t coords[CATERVA_MAX_DIM];
+    caterva_iter_coords(iter->array, nchunk, coords);
+    CATERVA_ERROR(caterva_blosc_array_get_chunk_buffer(&iter->reader, iter->array, coords, buffer));
+    return CATERVA_SUCCEED;
+}
+
+static void *caterva_iter_producer(void *arg) {
+    caterva_iter_t *iter = (caterva_iter_t *) arg;
+
+    for (int64_t nchunk = 0; nchunk < iter->nchunks; ++nchunk) {
+        caterva_iter_slot_t *slot = &iter->slots[nchunk % iter->nslots];
+
+        // Wait for the consumer to release the slot
+        pthread_mutex_lock(&iter->mutex);
+        while (!iter->stop && slot->nchunk != -1) {
+            pthread_cond_wait(&iter->cond, &iter->mutex);
+        }
+        bool stop = iter->stop;
+        pthread_mutex_unlock(&iter->mutex);
+        if (stop) {
+            break;
+        }
+
+        int rc = caterva_iter_read(iter, nchunk, slot->buffer);
+
+        pthread_mutex_lock(&iter->mutex);
+        if (rc != CATERVA_SUCCEED) {
+            iter->rc = rc;
+        } else {
+            slot->nchunk = nchunk;
+        }
+        pthread_cond_broadcast(&iter->cond);
+        pthread_mutex_unlock(&iter->mutex);
+        if (rc != CATERVA_SUCCEED) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+int caterva_iter_new(caterva_ctx_t *ctx, caterva_array_t *array, int prefetch,
+                     caterva_iter_t **iter) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(iter);
+
+    if (!array->filled) {
+        DEBUG_PRINT("The array must be filled before iterating over it");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    if (prefetch < 0) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    caterva_iter_t *iter_ = ctx->cfg->alloc(sizeof(caterva_iter_t));
+    CATERVA_ERROR_NULL(iter_);
+    memset(iter_, 0, sizeof(caterva_iter_t));
+    iter_->ctx = ctx;
+    iter_->array = array;
+    iter_->next_chunk = 0;
+    iter_->rc = CATERVA_SUCCEED;
+
+    // Plain buffers are made of a single chunk, which is returned without any copy
+    if (array->storage == CATERVA_STORAGE_PLAINBUFFER) {
+        iter_->nchunks = array->nitems == 0 ? 0 : 1;
+        *iter = iter_;
+        return CATERVA_SUCCEED;
+    }
+
+    iter_->nchunks = array->nitems == 0 ? 0 : array->extnitems / array->chunknitems;
+    if (iter_->nchunks == 0) {
+        *iter = iter_;
+        return CATERVA_SUCCEED;
+    }
+    iter_->prefetch = prefetch > 0 && iter_->nchunks > 1;
+    iter_->nslots = iter_->prefetch ? prefetch + 1 : 1;
+    if (iter_->nslots > iter_->nchunks) {
+        iter_->nslots = (int) iter_->nchunks;
+    }
+
+    int rc = caterva_blosc_reader_init(ctx, array, caterva_threads_blosc(ctx), true, &iter_->reader);
+    if (rc == CATERVA_SUCCEED) {
+        iter_->slots = ctx->cfg->alloc(iter_->nslots * sizeof(caterva_iter_slot_t));
+        rc = iter_->slots == NULL ? CATERVA_ERR_NULL_POINTER : CATERVA_SUCCEED;
+    }
+    for (int i = 0; rc == CATERVA_SUCCEED && i < iter_->nslots; ++i) {
+        iter_->slots[i].nchunk = -1;
+        iter_->slots[i].buffer = caterva_pool_alloc(ctx,
+                                                    (size_t) array->chunknitems * array->itemsize);
+        if (iter_->slots[i].buffer == NULL) {
+            // Make sure that the remaining slots are not freed
+            iter_->nslots = i;
+            rc = CATERVA_ERR_NULL_POINTER;
+        }
+    }
+    if (rc != CATERVA_SUCCEED) {
+        caterva_iter_free(&iter_);
+        CATERVA_ERROR(rc);
+    }
+
+    if (iter_->prefetch) {
+        pthread_mutex_init(&iter_->mutex, NULL);
+        pthread_cond_init(&iter_->cond, NULL);
+        if (pthread_create(&iter_->thread, NULL, caterva_iter_producer, iter_) != 0) {
+            pthread_mutex_destroy(&iter_->mutex);
+            pthread_cond_destroy(&iter_->cond);
+            iter_->prefetch = false;
+            caterva_iter_free(&iter_);
+            CATERVA_ERROR(CATERVA_ERR_THREADS_FAILED);
+        }
+    }
+
+    *iter = iter_;
+    return CATERVA_SUCCEED;
+}
+
+int caterva_iter_next(caterva_iter_t *iter, caterva_iter_region_t *region, bool *done) {
+    CATERVA_ERROR_NULL(iter);
+    CATERVA_ERROR_NULL(region);
+    CATERVA_ERROR_NULL(done);
+
+    caterva_array_t *array = iter->array;
+    if (iter->next_chunk >= iter->nchunks) {
+        *done = true;
+        return CATERVA_SUCCEED;
+    }
+    *done = false;
+    int64_t nchunk = iter->next_chunk;
+
+    uint8_t *buffer;
+    if (array->storage == CATERVA_STORAGE_PLAINBUFFER) {
+        buffer = array->buf;
+    } else if (iter->prefetch) {
+        // Release the slot of the previous chunk and wait for the current one
+        pthread_mutex_lock(&iter->mutex);
+        if (nchunk > 0) {
+            iter->slots[(nchunk - 1) % iter->nslots].nchunk = -1;
+            pthread_cond_broadcast(&iter->cond);
+        }
+        caterva_iter_slot_t *slot = &iter->slots[nchunk % iter->nslots];
+        while (slot->nchunk != nchunk && iter->rc == CATERVA_SUCCEED) {
+            pthread_cond_wait(&iter->cond, &iter->mutex);
+        }
+        int rc = slot->nchunk == nchunk ? CATERVA_SUCCEED : iter->rc;
+        pthread_mutex_unlock(&iter->mutex);
+        CATERVA_ERROR(rc);
+        buffer = slot->buffer;
+    } else {
+        buffer = iter->slots[0].buffer;
+        CATERVA_ERROR(caterva_iter_read(iter, nchunk, buffer));
+    }
+
+    region->nchunk = nchunk;
+    caterva_iter_coords(array, nchunk, region->coords);
+    region->buffersize = array->itemsize;
+    for (int i = 0; i < array->ndim; ++i) {
+        region->start[i] = region->coords[i] * array->chunkshape[i];
+        region->shape[i] = array->chunkshape[i];
+        if (region->start[i] + region->shape[i] > array->shape[i]) {
+            region->shape[i] = array->shape[i] - region->start[i];
+        }
+        region->buffersize *= region->shape[i];
+    }
+    region->buffer = buffer;
+    iter->next_chunk++;
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_iter_free(caterva_iter_t **iter) {
+    CATERVA_ERROR_NULL(iter);
+
+    caterva_iter_t *iter_ = *iter;
+    if (iter_ == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    caterva_ctx_t *ctx = iter_->ctx;
+
+    int rc = CATERVA_SUCCEED;
+    if (iter_->prefetch) {
+        pthread_mutex_lock(&iter_->mutex);
+        iter_->stop = true;
+        pthread_cond_broadcast(&iter_->cond);
+        pthread_mutex_unlock(&iter_->mutex);
+        if (pthread_join(iter_->thread, NULL) != 0) {
+            rc = CATERVA_ERR_THREADS_FAILED;
+        }
+        pthread_mutex_destroy(&iter_->mutex);
+        pthread_cond_destroy(&iter_->cond);
+    }
+    if (iter_->array->storage == CATERVA_STORAGE_BLOSC) {
+        caterva_blosc_reader_destroy(ctx, &iter_->reader);
+    }
+    if (iter_->slots != NULL) {
+        for (int i = 0; i < iter_->nslots; ++i) {
+            caterva_pool_release(ctx, iter_->slots[i].buffer);
+        }
+        ctx->cfg->free(iter_->slots);
+    }
+    ctx->cfg->free(iter_);
+    *iter = NULL;
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "caterva_mmap.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Read-only memory mappings of contiguous frames. The mapping is shared, so every process mapping
+ * the same file uses the same pages of the page cache, and the chunks are decompressed straight
+ * out of them.
+ *
+ * With CATERVA_ACCESS_AUTO, the access pattern advised to the kernel follows the slice reads: it
+ * switches to sequential after a few reads starting where the previous one stopped, and to random
+ * after a few reads starting somewhere else.
+ *
+ * Plain buffers stored on disk use read-write mappings instead, which keep the file open so that
+ * it can be resized (and mapped again) when the shape of the array changes.
+ */
+
+// Number of consecutive reads with the same pattern needed to change the advice
+#define CATERVA_MMAP_STREAK 2
+
+#if !defined(_WIN32)
+static int caterva_mmap_flags(caterva_access_t access) {
+    switch (access) {
+        case CATERVA_ACCESS_SEQUENTIAL:
+            return MADV_SEQUENTIAL;
+        case CATERVA_ACCESS_RANDOM:
+            return MADV_RANDOM;
+        default:
+            return MADV_NORMAL;
+    }
+}
+#endif
+
+static void caterva_mmap_advise(caterva_mmap_t *map, caterva_access_t advice) {
+#if !defined(_WIN32)
+    madvise(map->addr, (size_t) map->len, caterva_mmap_flags(advice));
+#endif
+    map->advice = advice;
+}
+
+int caterva_mmap_new(caterva_ctx_t *ctx, const char *urlpath, caterva_access_t access,
+                     caterva_mmap_t **map) {
+    *map = NULL;
+
+#if defined(_WIN32)
+    DWORD attributes = GetFileAttributesA(urlpath);
+    if (attributes == INVALID_FILE_ATTRIBUTES) {
+        DEBUG_PRINT("Can not open the file");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    if (attributes & FILE_ATTRIBUTE_DIRECTORY) {
+        // Sparse frames are stored in a directory and can not be mapped
+        return CATERVA_SUCCEED;
+    }
+    HANDLE file = CreateFileA(urlpath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        DEBUG_PRINT("Can not open the file");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    uint8_t *addr = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    if (mapping != NULL) {
+        addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+    if (addr == NULL) {
+        if (mapping != NULL) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        DEBUG_PRINT("Can not map the file");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    int64_t len = size.QuadPart;
+#else
+    struct stat st;
+    if (stat(urlpath, &st) != 0) {
+        DEBUG_PRINT("Can not open the file");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    if (S_ISDIR(st.st_mode)) {
+        // Sparse frames are stored in a directory and can not be mapped
+        return CATERVA_SUCCEED;
+    }
+    int fd = open(urlpath, O_RDONLY);
+    if (fd < 0) {
+        DEBUG_PRINT("Can not open the file");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    int64_t len = (int64_t) st.st_size;
+    uint8_t *addr = NULL;
+    if (len > 0) {
+        addr = mmap(NULL, (size_t) len, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    // The mapping keeps its own reference to the file
+    close(fd);
+    if (addr == NULL || addr == MAP_FAILED) {
+        DEBUG_PRINT("Can not map the file");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+#endif
+
+    caterva_mmap_t *map_ = ctx->cfg->alloc(sizeof(caterva_mmap_t));
+    char *path = ctx->cfg->alloc(strlen(urlpath) + 1);
+    if (map_ == NULL || path == NULL || pthread_mutex_init(&map_->mutex, NULL) != 0) {
+#if defined(_WIN32)
+        UnmapViewOfFile(addr);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        munmap(addr, (size_t) len);
+#endif
+        if (map_ != NULL) {
+            ctx->cfg->free(map_);
+        }
+        if (path != NULL) {
+            ctx->cfg->free(path);
+        }
+        CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+    }
+    strcpy(path, urlpath);
+    map_->path = path;
+    map_->addr = addr;
+    map_->len = len;
+    map_->writable = false;
+#if defined(_WIN32)
+    map_->file = file;
+    map_->mapping = mapping;
+#else
+    map_->pagesize = sysconf(_SC_PAGESIZE);
+    map_->fd = -1;
+#endif
+    map_->access = access;
+    map_->next_nchunk = 0;
+    map_->nsequential = 0;
+    map_->nrandom = 0;
+    caterva_mmap_advise(map_, access == CATERVA_ACCESS_AUTO ? CATERVA_ACCESS_NORMAL : access);
+
+    *map = map_;
+    return CATERVA_SUCCEED;
+}
+
+// Map the first `map->len` bytes of the (already open) file of a writable mapping
+static int caterva_mmap_map_rw(caterva_mmap_t *map) {
+#if defined(_WIN32)
+    map->mapping = CreateFileMappingA((HANDLE) map->file, NULL, PAGE_READWRITE, 0, 0, NULL);
+    map->addr = NULL;
+    if (map->mapping != NULL) {
+        map->addr = MapViewOfFile((HANDLE) map->mapping, FILE_MAP_WRITE, 0, 0, 0);
+        if (map->addr == NULL) {
+            CloseHandle((HANDLE) map->mapping);
+            map->mapping = NULL;
+        }
+    }
+    if (map->addr == NULL) {
+        DEBUG_PRINT("Can not map the file");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+#else
+    uint8_t *addr = mmap(NULL, (size_t) map->len, PROT_READ | PROT_WRITE, MAP_SHARED, map->fd, 0);
+    if (addr == MAP_FAILED) {
+        map->addr = NULL;
+        DEBUG_PRINT("Can not map the file");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    map->addr = addr;
+#endif
+    return CATERVA_SUCCEED;
+}
+
+static void caterva_mmap_unmap(caterva_mmap_t *map) {
+    if (map->addr == NULL) {
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(map->addr);
+    CloseHandle((HANDLE) map->mapping);
+    map->mapping = NULL;
+#else
+    munmap(map->addr, (size_t) map->len);
+#endif
+    map->addr = NULL;
+}
+
+// Set the size of the file of a writable mapping to `len` bytes
+static int caterva_mmap_truncate(caterva_mmap_t *map, int64_t len) {
+#if defined(_WIN32)
+    LARGE_INTEGER size;
+    size.QuadPart = len;
+    if (!SetFilePointerEx((HANDLE) map->file, size, NULL, FILE_BEGIN) ||
+        !SetEndOfFile((HANDLE) map->file)) {
+        DEBUG_PRINT("Can not resize the file");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+#else
+    if (ftruncate(map->fd, (off_t) len) != 0) {
+        DEBUG_PRINT("Can not resize the file");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+#endif
+    map->len = len;
+    return CATERVA_SUCCEED;
+}
+
+// Map a file for reading and writing. If `len` is not negative, the file is created (or
+// truncated) with `len` bytes, which read as zeros; otherwise, the existing file is mapped whole.
+int caterva_mmap_new_rw(caterva_ctx_t *ctx, const char *urlpath, int64_t len,
+                        caterva_mmap_t **map) {
+    *map = NULL;
+
+    caterva_mmap_t *map_ = ctx->cfg->alloc(sizeof(caterva_mmap_t));
+    CATERVA_ERROR_NULL(map_);
+    memset(map_, 0, sizeof(caterva_mmap_t));
+    map_->writable = true;
+    map_->access = CATERVA_ACCESS_NORMAL;
+    map_->advice = CATERVA_ACCESS_NORMAL;
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(urlpath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                              len < 0 ? OPEN_EXISTING : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+                              NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        ctx->cfg->free(map_);
+        DEBUG_PRINT("Can not open the file");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    map_->file = file;
+    LARGE_INTEGER size;
+    if (len < 0 && GetFileSizeEx(file, &size)) {
+        map_->len = size.QuadPart;
+    }
+#else
+    map_->pagesize = sysconf(_SC_PAGESIZE);
+    map_->fd = open(urlpath, len < 0 ? O_RDWR : O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (map_->fd < 0) {
+        ctx->cfg->free(map_);
+        DEBUG_PRINT("Can not open the file");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    struct stat st;
+    if (len < 0 && fstat(map_->fd, &st) == 0) {
+        map_->len = (int64_t) st.st_size;
+    }
+#endif
+
+    int rc = CATERVA_SUCCEED;
+    if (len >= 0) {
+        rc = caterva_mmap_truncate(map_, len);
+    } else if (map_->len <= 0) {
+        DEBUG_PRINT("Can not map an empty file");
+        rc = CATERVA_ERR_INVALID_ARGUMENT;
+    }
+    if (rc == CATERVA_SUCCEED) {
+        rc = caterva_mmap_map_rw(map_);
+    }
+    if (rc != CATERVA_SUCCEED || pthread_mutex_init(&map_->mutex, NULL) != 0) {
+        caterva_mmap_unmap(map_);
+#if defined(_WIN32)
+        CloseHandle(file);
+#else
+        close(map_->fd);
+#endif
+        ctx->cfg->free(map_);
+        CATERVA_ERROR(rc != CATERVA_SUCCEED ? rc : CATERVA_ERR_NULL_POINTER);
+    }
+
+    *map = map_;
+    return CATERVA_SUCCEED;
+}
+
+// Resize the file of a writable mapping to `len` bytes and map it again. The contents up to the
+// smallest size are kept, but the address of the mapping may change.
+int caterva_mmap_resize(caterva_mmap_t *map, int64_t len) {
+    if (!map->writable) {
+        CATERVA_ERROR(CATERVA_ERR_READ_ONLY);
+    }
+    caterva_mmap_unmap(map);
+    CATERVA_ERROR(caterva_mmap_truncate(map, len));
+    CATERVA_ERROR(caterva_mmap_map_rw(map));
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_mmap_free(caterva_ctx_t *ctx, caterva_mmap_t **map) {
+    if (*map == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    caterva_mmap_unmap(*map);
+#if defined(_WIN32)
+    CloseHandle((HANDLE) (*map)->file);
+#else
+    if ((*map)->fd >= 0) {
+        close((*map)->fd);
+    }
+#endif
+    pthread_mutex_destroy(&(*map)->mutex);
+    if ((*map)->path != NULL) {
+        ctx->cfg->free((*map)->path);
+    }
+    ctx->cfg->free(*map);
+    *map = NULL;
+
+    return CATERVA_SUCCEED;
+}
+
+// Ask the kernel to read the pages of `data` (a chunk about to be decompressed) in one go. This is
+// only needed when the read-ahead may be disabled, i.e. with random (or adaptive) accesses.
+void caterva_mmap_willneed(caterva_mmap_t *map, const uint8_t *data, int64_t len) {
+    if (map->access != CATERVA_ACCESS_RANDOM && map->access != CATERVA_ACCESS_AUTO) {
+        return;
+    }
+    if (data < map->addr || data + len > map->addr + map->len) {
+        return;
+    }
+#if !defined(_WIN32)
+    uintptr_t start = (uintptr_t) data & ~((uintptr_t) map->pagesize - 1);
+    madvise((void *) start, (size_t) ((uintptr_t) data + len - start), MADV_WILLNEED);
+#endif
+}
+
+// Record a slice read touching the chunks from `first_nchunk` to `last_nchunk`, and update the
+// advice if the access pattern has changed
+void caterva_mmap_track(caterva_mmap_t *map, int64_t first_nchunk, int64_t last_nchunk) {
+    if (map->access != CATERVA_ACCESS_AUTO) {
+        return;
+    }
+
+    pthread_mutex_lock(&map->mutex);
+    if (first_nchunk == map->next_nchunk || first_nchunk == map->next_nchunk - 1) {
+        map->nsequential++;
+        map->nrandom = 0;
+    } else {
+        map->nrandom++;
+        map->nsequential = 0;
+    }
+    map->next_nchunk = last_nchunk + 1;
+
+    if (map->nsequential >= CATERVA_MMAP_STREAK && map->advice != CATERVA_ACCESS_SEQUENTIAL) {
+        caterva_mmap_advise(map, CATERVA_ACCESS_SEQUENTIAL);
+    } else if (map->nrandom >= CATERVA_MMAP_STREAK && map->advice != CATERVA_ACCESS_RANDOM) {
+        caterva_mmap_advise(map, CATERVA_ACCESS_RANDOM);
+    }
+    pthread_mutex_unlock(&map->mutex);
+}
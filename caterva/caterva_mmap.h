@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef CATERVA_CATERVA_MMAP_H_
+#define CATERVA_CATERVA_MMAP_H_
+
+#include <caterva.h>
+
+#include "caterva_threads.h"
+
+struct caterva_mmap_s {
+    uint8_t *addr;
+    //!< The start of the mapping.
+    int64_t len;
+    //!< The length (in bytes) of the mapping.
+    caterva_access_t access;
+    //!< The access pattern requested when the file was mapped.
+    caterva_access_t advice;
+    //!< The access pattern currently advised to the kernel.
+    int64_t next_nchunk;
+    //!< The chunk following the last one read (used by @p CATERVA_ACCESS_AUTO).
+    int nsequential;
+    //!< Number of consecutive reads starting where the previous one stopped.
+    int nrandom;
+    //!< Number of consecutive reads starting somewhere else.
+    pthread_mutex_t mutex;
+    bool writable;
+    //!< Indicate that the mapping can be written (and resized).
+    char *path;
+    //!< The path of the mapped file (only for read-only mappings; NULL otherwise).
+#if defined(_WIN32)
+    void *file;
+    void *mapping;
+#else
+    int64_t pagesize;
+    int fd;
+    //!< The descriptor of the file, kept open for writable mappings (-1 otherwise).
+#endif
+};
+
+int caterva_mmap_new(caterva_ctx_t *ctx, const char *urlpath, caterva_access_t access,
+                     caterva_mmap_t **map);
+
+int caterva_mmap_new_rw(caterva_ctx_t *ctx, const char *urlpath, int64_t len,
+                        caterva_mmap_t **map);
+
+int caterva_mmap_resize(caterva_mmap_t *map, int64_t len);
+
+int caterva_mmap_free(caterva_ctx_t *ctx, caterva_mmap_t **map);
+
+void caterva_mmap_willneed(caterva_mmap_t *map, const uint8_t *data, int64_t len);
+
+void caterva_mmap_track(caterva_mmap_t *map, int64_t first_nchunk, int64_t last_nchunk);
+
+#endif  // CATERVA_CATERVA_MMAP_H_
@@ -11,6 +11,46 @@
 
 #include <caterva.h>
 
+#include "caterva_copy.h"
+#include "caterva_instr.h"
+#include "caterva_mmap.h"
+
+/*
+ * A plain buffer stored on disk is a raw file made of a header with the metadata of the array,
+ * followed by its items in C order. The file is mapped for reading and writing and @p buf points
+ * to the items in the mapping, so the slices are read and written straight from and to the page
+ * cache, and the array does not need to fit in memory.
+ */
+
+#define CATERVA_PLAINBUFFER_MAGIC "catpbuf"
+#define CATERVA_PLAINBUFFER_VERSION 0
+
+// The size of the header, which keeps the items aligned to a cache line
+#define CATERVA_PLAINBUFFER_HEADER_SIZE 128
+
+typedef struct {
+    char magic[8];
+    uint8_t version;
+    int8_t ndim;
+    int8_t itemsize;
+    uint8_t reserved[5];
+    int64_t shape[CATERVA_MAX_DIM];
+} caterva_plainbuffer_header_t;
+
+// Store the metadata of an array in the header of its file
+static void caterva_plainbuffer_header_write(caterva_array_t *array) {
+    caterva_plainbuffer_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CATERVA_PLAINBUFFER_MAGIC, sizeof(header.magic));
+    header.version = CATERVA_PLAINBUFFER_VERSION;
+    header.ndim = array->ndim;
+    header.itemsize = array->itemsize;
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        header.shape[i] = array->shape[i];
+    }
+    memcpy(array->bufmap->addr, &header, sizeof(header));
+}
+
 static void index_unidim_to_multidim(int8_t ndim, int64_t *shape, int64_t i, int64_t *index) {
     int64_t strides[CATERVA_MAX_DIM];
     strides[ndim - 1] = 1;
@@ -25,7 +65,9 @@ static void index_unidim_to_multidim(int8_t ndim, int64_t *shape, int64_t i, int
 }
 
 int caterva_plainbuffer_array_free(caterva_ctx_t *ctx, caterva_array_t **array) {
-    if ((*array)->buf != NULL) {
+    if ((*array)->bufmap != NULL) {
+        CATERVA_ERROR(caterva_mmap_free(ctx, &(*array)->bufmap));
+    } else if ((*array)->buf != NULL) {
         ctx->cfg->free((*array)->buf);
     }
     return CATERVA_SUCCEED;
@@ -54,7 +96,10 @@ int caterva_plainbuffer_array_from_buffer(caterva_ctx_t *ctx, caterva_array_t *a
 int caterva_plainbuffer_array_to_buffer(caterva_ctx_t *ctx, caterva_array_t *array,
                                         void *buffer) {
     CATERVA_UNUSED_PARAM(ctx);
-    memcpy(buffer, array->buf, (size_t) array->nitems * array->itemsize);
+    // Nothing to do if the caller reads the items in place (e.g. straight from the mapping)
+    if (buffer != array->buf) {
+        memcpy(buffer, array->buf, (size_t) array->nitems * array->itemsize);
+    }
     return CATERVA_SUCCEED;
 }
 
@@ -93,12 +138,17 @@ int caterva_plainbuffer_array_get_slice_buffer(caterva_ctx_t *ctx, caterva_array
     }
     int64_t start_copy[CATERVA_MAX_DIM];
     start_copy[CATERVA_MAX_DIM - 1] = start_[CATERVA_MAX_DIM - 1];
+    // The buffer may be larger than the slice, so the rows are enumerated inside the slice
+    int64_t slice_shape_[CATERVA_MAX_DIM];
     int64_t ncopies = 1;
     for (int i = 0; i < CATERVA_MAX_DIM - 1; ++i) {
-        ncopies *= stop_[i] - start_[i];
+        slice_shape_[i] = stop_[i] - start_[i];
+        ncopies *= slice_shape_[i];
     }
+    blosc_timestamp_t tstart;
+    caterva_instr_start(array, &tstart);
     for (int ncopy = 0; ncopy < ncopies; ++ncopy) {
-        index_unidim_to_multidim(CATERVA_MAX_DIM - 1, d_pshape_, ncopy, start_copy);
+        index_unidim_to_multidim(CATERVA_MAX_DIM - 1, slice_shape_, ncopy, start_copy);
         for (int i = 0; i < CATERVA_MAX_DIM - 1; ++i) {
             start_copy[i] += start_[i];
         }
@@ -118,6 +168,8 @@ int caterva_plainbuffer_array_get_slice_buffer(caterva_ctx_t *ctx, caterva_array
         memcpy(&bdest[buf_pointer * array->itemsize], &array->buf[chunk_pointer * array->itemsize],
                (size_t)(stop_[7] - start_[7]) * array->itemsize);
     }
+    caterva_instr_phase(array, CATERVA_PHASE_COPY, &tstart,
+                        ncopies * (stop_[7] - start_[7]) * array->itemsize);
     return CATERVA_SUCCEED;
 }
 
@@ -151,6 +203,8 @@ int caterva_plainbuffer_array_set_slice_buffer(caterva_ctx_t *ctx, void *buffer,
     for (int i = 0; i < CATERVA_MAX_DIM - 1; ++i) {
         ncopies *= stop_[i] - start_[i];
     }
+    blosc_timestamp_t tstart;
+    caterva_instr_start(array, &tstart);
     for (int ncopy = 0; ncopy < ncopies; ++ncopy) {
         index_unidim_to_multidim(CATERVA_MAX_DIM - 1, d_shape, ncopy, start_copy);
         for (int i = 0; i < CATERVA_MAX_DIM - 1; ++i) {
@@ -173,6 +227,42 @@ int caterva_plainbuffer_array_set_slice_buffer(caterva_ctx_t *ctx, void *buffer,
                &bbuffer[buf_pointer * array->itemsize],
                (size_t)(stop_[7] - start_[7]) * array->itemsize);
     }
+    caterva_instr_phase(array, CATERVA_PHASE_COPY, &tstart,
+                        ncopies * (stop_[7] - start_[7]) * array->itemsize);
+    return CATERVA_SUCCEED;
+}
+
+// Get the position (in items) of a point in the buffer of an array
+static int64_t caterva_plainbuffer_point(caterva_array_t *array, const int64_t *coords) {
+    int64_t offset = 0;
+    for (int i = 0; i < array->ndim; ++i) {
+        offset = offset * array->shape[i] + coords[i];
+    }
+    return offset;
+}
+
+int caterva_plainbuffer_array_get_points(caterva_ctx_t *ctx, caterva_array_t *array,
+                                         const int64_t *coords, int64_t npoints, void *buffer) {
+    CATERVA_UNUSED_PARAM(ctx);
+    uint8_t *bbuffer = buffer;
+    for (int64_t n = 0; n < npoints; ++n) {
+        int64_t offset = caterva_plainbuffer_point(array, &coords[n * array->ndim]);
+        memcpy(&bbuffer[n * array->itemsize], &array->buf[offset * array->itemsize],
+               array->itemsize);
+    }
+    return CATERVA_SUCCEED;
+}
+
+int caterva_plainbuffer_array_set_points(caterva_ctx_t *ctx, caterva_array_t *array,
+                                         const int64_t *coords, int64_t npoints,
+                                         const void *buffer) {
+    CATERVA_UNUSED_PARAM(ctx);
+    const uint8_t *bbuffer = buffer;
+    for (int64_t n = 0; n < npoints; ++n) {
+        int64_t offset = caterva_plainbuffer_point(array, &coords[n * array->ndim]);
+        memcpy(&array->buf[offset * array->itemsize], &bbuffer[n * array->itemsize],
+               array->itemsize);
+    }
     return CATERVA_SUCCEED;
 }
 
@@ -211,6 +301,9 @@ int caterva_plainbuffer_update_shape(caterva_array_t *array, int8_t ndim, int64_
         array->extnitems *= array->extshape[i];
         array->chunknitems *= array->chunkshape[i];
     }
+    if (array->bufmap != NULL) {
+        caterva_plainbuffer_header_write(array);
+    }
 
     return CATERVA_SUCCEED;
 }
@@ -257,6 +350,57 @@ int caterva_plainbuffer_array_squeeze(caterva_ctx_t *ctx, caterva_array_t *array
 }
 
 
+int caterva_plainbuffer_array_resize(caterva_ctx_t *ctx, caterva_array_t *array,
+                                     int64_t *new_shape) {
+    int8_t ndim = array->ndim;
+    int64_t nitems = 1;
+    for (int i = 0; i < ndim; ++i) {
+        nitems *= new_shape[i];
+    }
+    uint8_t *buf = ctx->cfg->alloc((size_t) (nitems > 0 ? nitems : 1) * array->itemsize);
+    CATERVA_ERROR_NULL(buf);
+    caterva_copy_fill(array->itemsize, buf, nitems, array->fillvalue);
+
+    // Copy the items that are in both shapes
+    int64_t shape[CATERVA_MAX_DIM];
+    int64_t old_shape[CATERVA_MAX_DIM];
+    int64_t box[CATERVA_MAX_DIM];
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        int j = (CATERVA_MAX_DIM - ndim + i) % CATERVA_MAX_DIM;
+        shape[j] = i < ndim ? new_shape[i] : 1;
+        old_shape[j] = array->shape[i];
+        box[j] = shape[j] < old_shape[j] ? shape[j] : old_shape[j];
+    }
+    if (nitems > 0 && array->nitems > 0) {
+        int64_t src_strides[CATERVA_MAX_DIM];
+        int64_t dest_strides[CATERVA_MAX_DIM];
+        caterva_copy_strides(CATERVA_MAX_DIM, old_shape, src_strides);
+        caterva_copy_strides(CATERVA_MAX_DIM, shape, dest_strides);
+        caterva_copy_box(CATERVA_MAX_DIM, array->itemsize, box, array->buf, src_strides, buf,
+                         dest_strides);
+    }
+    if (array->bufmap != NULL) {
+        // The file is resized and the items are moved back into it
+        int rc = caterva_mmap_resize(array->bufmap, CATERVA_PLAINBUFFER_HEADER_SIZE +
+                                                    nitems * array->itemsize);
+        if (rc == CATERVA_SUCCEED) {
+            array->buf = array->bufmap->addr + CATERVA_PLAINBUFFER_HEADER_SIZE;
+            memcpy(array->buf, buf, (size_t) nitems * array->itemsize);
+        } else {
+            array->buf = NULL;
+        }
+        ctx->cfg->free(buf);
+        CATERVA_ERROR(rc);
+    } else {
+        ctx->cfg->free(array->buf);
+        array->buf = buf;
+    }
+    CATERVA_ERROR(caterva_plainbuffer_update_shape(array, ndim, new_shape));
+
+    return CATERVA_SUCCEED;
+}
+
+
 int caterva_plainbuffer_array_copy(caterva_ctx_t *ctx, caterva_params_t *params,
                                    caterva_storage_t *storage, caterva_array_t *src,
                                    caterva_array_t **dest) {
@@ -269,8 +413,9 @@ int caterva_plainbuffer_array_copy(caterva_ctx_t *ctx, caterva_params_t *params,
     return CATERVA_SUCCEED;
 }
 
-int caterva_plainbuffer_array_empty(caterva_ctx_t *ctx, caterva_params_t *params,
-                                    caterva_storage_t *storage, caterva_array_t **array) {
+// Create an array with the metadata of a plain buffer, without its buffer
+static int caterva_plainbuffer_array_new(caterva_ctx_t *ctx, int8_t ndim, int8_t itemsize,
+                                         const int64_t *shape, caterva_array_t **array) {
     /* Create a caterva_array_t buffer */
     (*array) = (caterva_array_t *) ctx->cfg->alloc(sizeof(caterva_array_t));
     if ((*array) == NULL) {
@@ -278,17 +423,15 @@ int caterva_plainbuffer_array_empty(caterva_ctx_t *ctx, caterva_params_t *params
         return CATERVA_ERR_NULL_POINTER;
     }
 
-    (*array)->storage = storage->backend;
-    (*array)->ndim = params->ndim;
-    (*array)->itemsize = params->itemsize;
-
-    int64_t *shape = params->shape;
+    (*array)->storage = CATERVA_STORAGE_PLAINBUFFER;
+    (*array)->ndim = ndim;
+    (*array)->itemsize = itemsize;
 
     (*array)->nitems = 1;
     (*array)->chunknitems = 1;
     (*array)->extnitems = 1;
 
-    for (int i = 0; i < params->ndim; ++i) {
+    for (int i = 0; i < ndim; ++i) {
         (*array)->shape[i] = shape[i];
         (*array)->chunkshape[i] = (uint32_t) shape[i];
         (*array)->extshape[i] = shape[i];
@@ -298,21 +441,100 @@ int caterva_plainbuffer_array_empty(caterva_ctx_t *ctx, caterva_params_t *params
         (*array)->extnitems *= shape[i];
     }
 
-    for (int i = params->ndim; i < CATERVA_MAX_DIM; ++i) {
+    for (int i = ndim; i < CATERVA_MAX_DIM; ++i) {
         (*array)->shape[i] = 1;
         (*array)->chunkshape[i] = 1;
         (*array)->extshape[i] = 1;
     }
 
-    // The partition cache (empty initially)
-    (*array)->chunk_cache.data = NULL;
-    (*array)->chunk_cache.nchunk = -1;  // means no valid cache yet
+    // The decompressed-chunk cache (disabled initially)
+    (*array)->cache = NULL;
+    (*array)->mmap = NULL;
+    (*array)->stats = NULL;
+    (*array)->lock = NULL;
+    (*array)->bufmap = NULL;
+    (*array)->instr = NULL;
+    (*array)->fillvalue = NULL;
+    (*array)->versions = NULL;
+    (*array)->shared = NULL;
+    (*array)->pyramid = NULL;
 
     (*array)->sc = NULL;
+    (*array)->buf = NULL;
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_plainbuffer_array_empty(caterva_ctx_t *ctx, caterva_params_t *params,
+                                    caterva_storage_t *storage, caterva_array_t **array) {
+    CATERVA_ERROR(caterva_plainbuffer_array_new(ctx, params->ndim, (int8_t) params->itemsize,
+                                                params->shape, array));
+
+    int64_t nbytes = (*array)->extnitems * params->itemsize;
+    char *urlpath = storage->properties.plainbuffer.urlpath;
+    if (urlpath != NULL) {
+        // The new file reads as zeros, but its pages are not allocated until they are written
+        int rc = caterva_mmap_new_rw(ctx, urlpath, CATERVA_PLAINBUFFER_HEADER_SIZE + nbytes,
+                                     &(*array)->bufmap);
+        if (rc != CATERVA_SUCCEED) {
+            ctx->cfg->free(*array);
+            *array = NULL;
+            CATERVA_ERROR(rc);
+        }
+        (*array)->buf = (*array)->bufmap->addr + CATERVA_PLAINBUFFER_HEADER_SIZE;
+        caterva_plainbuffer_header_write(*array);
+        return CATERVA_SUCCEED;
+    }
 
-    uint8_t *buf = ctx->cfg->alloc((size_t)(*array)->extnitems * params->itemsize);
+    uint8_t *buf = ctx->cfg->alloc((size_t) nbytes);
 
     (*array)->buf = buf;
 
     return CATERVA_SUCCEED;
 }
+
+int caterva_plainbuffer_array_open(caterva_ctx_t *ctx, const char *urlpath,
+                                   caterva_array_t **array) {
+    *array = NULL;
+
+    // Other files (e.g. Blosc frames) are left to the caller
+    caterva_plainbuffer_header_t header;
+    FILE *file = fopen(urlpath, "rb");
+    if (file == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    size_t nread = fread(&header, sizeof(header), 1, file);
+    fclose(file);
+    if (nread != 1 || memcmp(header.magic, CATERVA_PLAINBUFFER_MAGIC, sizeof(header.magic)) != 0) {
+        return CATERVA_SUCCEED;
+    }
+    if (header.version > CATERVA_PLAINBUFFER_VERSION || header.ndim < 0 ||
+        header.ndim > CATERVA_MAX_DIM || header.itemsize <= 0) {
+        DEBUG_PRINT("The header of the plain buffer is not valid");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    caterva_array_t *array_;
+    CATERVA_ERROR(caterva_plainbuffer_array_new(ctx, header.ndim, header.itemsize, header.shape,
+                                                &array_));
+    int rc = caterva_mmap_new_rw(ctx, urlpath, -1, &array_->bufmap);
+    if (rc == CATERVA_SUCCEED && array_->bufmap->len < CATERVA_PLAINBUFFER_HEADER_SIZE +
+                                                       array_->extnitems * array_->itemsize) {
+        DEBUG_PRINT("The file of the plain buffer is truncated");
+        caterva_mmap_free(ctx, &array_->bufmap);
+        rc = CATERVA_ERR_INVALID_ARGUMENT;
+    }
+    if (rc != CATERVA_SUCCEED) {
+        ctx->cfg->free(array_);
+        CATERVA_ERROR(rc);
+    }
+    array_->buf = array_->bufmap->addr + CATERVA_PLAINBUFFER_HEADER_SIZE;
+
+    // The items in the file are taken as they are
+    array_->nchunks = 1;
+    array_->filled = true;
+    array_->empty = false;
+
+    *array = array_;
+    return CATERVA_SUCCEED;
+}
@@ -9,6 +9,9 @@
 int caterva_plainbuffer_array_empty(caterva_ctx_t *ctx, caterva_params_t *params,
                                     caterva_storage_t *storage, caterva_array_t **array);
 
+int caterva_plainbuffer_array_open(caterva_ctx_t *ctx, const char *urlpath,
+                                   caterva_array_t **array);
+
 int caterva_plainbuffer_array_free(caterva_ctx_t *ctx, caterva_array_t **array);
 
 int caterva_plainbuffer_array_append(caterva_ctx_t *ctx, caterva_array_t *array, void *chunk,
@@ -28,6 +31,13 @@ int caterva_plainbuffer_array_set_slice_buffer(caterva_ctx_t *ctx, void *buffer,
                                                int64_t buffersize, int64_t *start, int64_t *stop,
                                                caterva_array_t *array);
 
+int caterva_plainbuffer_array_get_points(caterva_ctx_t *ctx, caterva_array_t *array,
+                                         const int64_t *coords, int64_t npoints, void *buffer);
+
+int caterva_plainbuffer_array_set_points(caterva_ctx_t *ctx, caterva_array_t *array,
+                                         const int64_t *coords, int64_t npoints,
+                                         const void *buffer);
+
 int caterva_plainbuffer_array_get_slice(caterva_ctx_t *ctx, caterva_array_t *src,
                                         int64_t *start, int64_t *stop, caterva_array_t *array);
 
@@ -36,6 +46,9 @@ int caterva_plainbuffer_array_squeeze_index(caterva_ctx_t *ctx, caterva_array_t
 
 int caterva_plainbuffer_array_squeeze(caterva_ctx_t *ctx, caterva_array_t *array);
 
+int caterva_plainbuffer_array_resize(caterva_ctx_t *ctx, caterva_array_t *array,
+                                     int64_t *new_shape);
+
 int caterva_plainbuffer_array_copy(caterva_ctx_t *ctx, caterva_params_t *params,
                                    caterva_storage_t *storage, caterva_array_t *src,
                                    caterva_array_t **dest);
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "caterva_pool.h"
+
+#include "caterva_threadpool.h"
+#include "caterva_threads.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+/*
+ * A pool of scratch buffers shared by all the threads using a context. Buffers are rounded up to
+ * size classes (four per power of two, so at most 25% is wasted) and, when released, they are
+ * kept in a free list per class for later calls, as long as the idle buffers do not exceed the
+ * `poolsize` of the configuration. Every buffer is preceded by a header, padded to keep the
+ * buffer aligned to a cache line (or to a huge page, for the largest ones).
+ *
+ * The pages of a new buffer are placed on the NUMA node of the thread touching them first, which
+ * is the one that allocated it. The idle buffers are kept in free lists per node, so the threads
+ * (e.g. the pinned workers of a thread pool) reuse buffers placed on their own node.
+ */
+
+/* The smallest size class */
+#define CATERVA_POOL_MIN_SIZE 64
+
+/* The number of size classes; larger buffers are not pooled */
+#define CATERVA_POOL_NCLASSES 168
+
+typedef struct caterva_pool_header_s caterva_pool_header_t;
+
+struct caterva_pool_header_s {
+    void *base;
+    //!< The pointer returned by the allocation function.
+    caterva_pool_header_t *next;
+    //!< The next idle buffer of the same class.
+    size_t size;
+    //!< The size (in bytes) of the buffer.
+    int sclass;
+    //!< The size class of the buffer. If it is -1, the buffer is not pooled.
+    int node;
+    //!< The NUMA node of the thread that allocated the buffer.
+};
+
+struct caterva_pool_s {
+    void *(*alloc)(size_t);
+    void (*free)(void *);
+    int64_t maxbytes;
+    //!< The maximum memory (in bytes) of the idle buffers.
+    caterva_pool_header_t *lists[CATERVA_THREADPOOL_MAXNODES][CATERVA_POOL_NCLASSES];
+    caterva_pool_stats_t stats;
+    pthread_mutex_t mutex;
+};
+
+// Get the size class of `size` and the size of its buffers (or -1 if it is too large)
+static int caterva_pool_class(size_t size, size_t *class_size) {
+    if (size <= CATERVA_POOL_MIN_SIZE) {
+        *class_size = CATERVA_POOL_MIN_SIZE;
+        return 0;
+    }
+    // 2^p < size <= 2^(p + 1)
+    int p = 0;
+    while (((size - 1) >> (p + 1)) != 0) {
+        p++;
+    }
+    size_t step = ((size_t) 1 << p) / 4;
+    size_t j = (size - ((size_t) 1 << p) + step - 1) / step;
+    int sclass = (p - 6) * 4 + (int) j;
+    if (sclass >= CATERVA_POOL_NCLASSES) {
+        return -1;
+    }
+    *class_size = ((size_t) 1 << p) + j * step;
+    return sclass;
+}
+
+int caterva_pool_new(caterva_config_t *cfg, caterva_pool_t **pool) {
+    caterva_pool_t *pool_ = cfg->alloc(sizeof(caterva_pool_t));
+    CATERVA_ERROR_NULL(pool_);
+    pool_->alloc = cfg->alloc;
+    pool_->free = cfg->free;
+    pool_->maxbytes = cfg->poolsize;
+    for (int node = 0; node < CATERVA_THREADPOOL_MAXNODES; ++node) {
+        for (int i = 0; i < CATERVA_POOL_NCLASSES; ++i) {
+            pool_->lists[node][i] = NULL;
+        }
+    }
+    memset(&pool_->stats, 0, sizeof(caterva_pool_stats_t));
+    pthread_mutex_init(&pool_->mutex, NULL);
+
+    *pool = pool_;
+    return CATERVA_SUCCEED;
+}
+
+int caterva_pool_free(caterva_pool_t **pool) {
+    caterva_pool_t *pool_ = *pool;
+    if (pool_ == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    for (int node = 0; node < CATERVA_THREADPOOL_MAXNODES; ++node) {
+        for (int i = 0; i < CATERVA_POOL_NCLASSES; ++i) {
+            caterva_pool_header_t *header = pool_->lists[node][i];
+            while (header != NULL) {
+                caterva_pool_header_t *next = header->next;
+                pool_->free(header->base);
+                header = next;
+            }
+        }
+    }
+    pthread_mutex_destroy(&pool_->mutex);
+    pool_->free(pool_);
+    *pool = NULL;
+
+    return CATERVA_SUCCEED;
+}
+
+/*
+ * Get a buffer of (at least) `size` bytes. It must be released with caterva_pool_release.
+ */
+void *caterva_pool_alloc(caterva_ctx_t *ctx, size_t size) {
+    caterva_pool_t *pool = ctx->pool;
+    size_t class_size;
+    int sclass = caterva_pool_class(size, &class_size);
+    if (sclass < 0) {
+        class_size = size;
+    }
+
+    int node = caterva_threadpool_node();
+    caterva_pool_header_t *header = NULL;
+    pthread_mutex_lock(&pool->mutex);
+    if (sclass >= 0 && pool->lists[node][sclass] != NULL) {
+        header = pool->lists[node][sclass];
+        pool->lists[node][sclass] = header->next;
+        pool->stats.nbytes -= (int64_t) class_size;
+        pool->stats.hits++;
+    } else {
+        pool->stats.misses++;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    if (header != NULL) {
+        return (uint8_t *) header + CATERVA_POOL_ALIGNMENT;
+    }
+
+    size_t alignment = CATERVA_POOL_ALIGNMENT;
+    if (class_size >= 4 * CATERVA_POOL_HUGE_PAGE) {
+        alignment = CATERVA_POOL_HUGE_PAGE;
+    }
+    uint8_t *base = pool->alloc(class_size + CATERVA_POOL_ALIGNMENT + alignment - 1);
+    if (base == NULL) {
+        DEBUG_PRINT("Allocation fails");
+        return NULL;
+    }
+    uintptr_t buffer = ((uintptr_t) base + CATERVA_POOL_ALIGNMENT + alignment - 1) &
+                       ~((uintptr_t) alignment - 1);
+    header = (caterva_pool_header_t *) (buffer - CATERVA_POOL_ALIGNMENT);
+    header->base = base;
+    header->next = NULL;
+    header->size = class_size;
+    header->sclass = sclass;
+    header->node = node;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (alignment == CATERVA_POOL_HUGE_PAGE) {
+        madvise((void *) buffer, class_size & ~((size_t) CATERVA_POOL_HUGE_PAGE - 1),
+                MADV_HUGEPAGE);
+    }
+#endif
+
+    return (void *) buffer;
+}
+
+/*
+ * Give back a buffer obtained with caterva_pool_alloc. It is kept for later calls unless the
+ * pool is full.
+ */
+void caterva_pool_release(caterva_ctx_t *ctx, void *buffer) {
+    if (buffer == NULL) {
+        return;
+    }
+    caterva_pool_t *pool = ctx->pool;
+    caterva_pool_header_t *header =
+        (caterva_pool_header_t *) ((uint8_t *) buffer - CATERVA_POOL_ALIGNMENT);
+
+    bool kept = false;
+    if (header->sclass >= 0) {
+        pthread_mutex_lock(&pool->mutex);
+        if (pool->stats.nbytes + (int64_t) header->size <= pool->maxbytes) {
+            header->next = pool->lists[header->node][header->sclass];
+            pool->lists[header->node][header->sclass] = header;
+            pool->stats.nbytes += (int64_t) header->size;
+            kept = true;
+        } else {
+            pool->stats.drops++;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    if (!kept) {
+        pool->free(header->base);
+    }
+}
+
+void caterva_pool_get_stats(caterva_pool_t *pool, caterva_pool_stats_t *stats) {
+    pthread_mutex_lock(&pool->mutex);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->mutex);
+}
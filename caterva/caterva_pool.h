@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef CATERVA_CATERVA_POOL_H_
+#define CATERVA_CATERVA_POOL_H_
+
+#include <caterva.h>
+
+/* The alignment of the scratch buffers (a cache line) */
+#define CATERVA_POOL_ALIGNMENT 64
+
+/* The alignment of the largest scratch buffers (a huge page) */
+#define CATERVA_POOL_HUGE_PAGE (2 * 1024 * 1024)
+
+int caterva_pool_new(caterva_config_t *cfg, caterva_pool_t **pool);
+
+int caterva_pool_free(caterva_pool_t **pool);
+
+void *caterva_pool_alloc(caterva_ctx_t *ctx, size_t size);
+
+void caterva_pool_release(caterva_ctx_t *ctx, void *buffer);
+
+void caterva_pool_get_stats(caterva_pool_t *pool, caterva_pool_stats_t *stats);
+
+#endif  // CATERVA_CATERVA_POOL_H_
@@ -0,0 +1,873 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "caterva_pyramid.h"
+
+#include <math.h>
+
+#include "caterva_blosc.h"
+#include "caterva_copy.h"
+#include "caterva_mmap.h"
+#include "caterva_pool.h"
+#include "caterva_stats.h"
+
+/*
+ * The pyramid of an array is a series of downsampled copies of it (the levels), so that an
+ * overview of a large region is read from a level with about as many items as the overview,
+ * instead of decompressing the whole region. Every level is a regular Blosc array computed from
+ * the previous one by the append pipeline: every chunk of a level reads the region of the previous
+ * level that it covers and reduces its boxes of items.
+ *
+ * The levels of an array stored on disk are stored next to it (in `<urlpath>.level<k>`) and the
+ * pyramid is recorded in a variable-length metalayer, as an array with 5 entries (format, method,
+ * dtype, nlevels, factors). The factors are stored in a bin entry, as big-endian 4-byte values.
+ * The levels are opened the first time that they are needed.
+ */
+
+int caterva_pyramid_free(caterva_ctx_t *ctx, caterva_pyramid_t **pyramid) {
+    if (*pyramid == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    for (int i = 0; i < (*pyramid)->params.nlevels; ++i) {
+        caterva_free(ctx, &(*pyramid)->levels[i]);
+    }
+    ctx->cfg->free(*pyramid);
+    *pyramid = NULL;
+
+    return CATERVA_SUCCEED;
+}
+
+static int caterva_pyramid_new(caterva_ctx_t *ctx, caterva_pyramid_t **pyramid) {
+    caterva_pyramid_t *pyramid_ = ctx->cfg->alloc(sizeof(caterva_pyramid_t));
+    CATERVA_ERROR_NULL(pyramid_);
+    memset(pyramid_, 0, sizeof(caterva_pyramid_t));
+
+    *pyramid = pyramid_;
+    return CATERVA_SUCCEED;
+}
+
+static int caterva_pyramid_serialize(const caterva_pyramid_params_t *params, int8_t ndim,
+                                     uint8_t **content, int32_t *len) {
+    *content = malloc((size_t) (1 + 4 + (1 + 4) + ndim * 4));
+    CATERVA_ERROR_NULL(*content);
+    uint8_t *p = *content;
+
+    // An array with 5 entries (format, method, dtype, nlevels, factors)
+    *p++ = 0x90 + 5;
+    *p++ = CATERVA_PYRAMID_FORMAT;  // positive fixnum
+    *p++ = (uint8_t) params->method;  // positive fixnum
+    *p++ = (uint8_t) params->dtype;  // positive fixnum
+    *p++ = (uint8_t) params->nlevels;  // positive fixnum
+    *p++ = 0xc6;  // bin32
+    uint32_t binlen = (uint32_t) (ndim * 4);
+    for (int i = 3; i >= 0; --i) {
+        p[i] = (uint8_t) (binlen & 0xff);
+        binlen >>= 8;
+    }
+    p += 4;
+    for (int i = 0; i < ndim; ++i) {
+        uint32_t factor = (uint32_t) params->factors[i];
+        for (int j = 3; j >= 0; --j) {
+            p[j] = (uint8_t) (factor & 0xff);
+            factor >>= 8;
+        }
+        p += 4;
+    }
+
+    *len = (int32_t) (p - *content);
+    return CATERVA_SUCCEED;
+}
+
+static int caterva_pyramid_deserialize(const uint8_t *content, int32_t len, int8_t ndim,
+                                       caterva_pyramid_params_t *params) {
+    const uint8_t *p = content;
+    if (len < 1 + 4 + (1 + 4) || p[0] != 0x90 + 5 || p[1] > CATERVA_PYRAMID_FORMAT ||
+        p[2] > CATERVA_DOWNSAMPLE_MAX || p[3] > CATERVA_DTYPE_FLOAT64 ||
+        p[4] > CATERVA_MAX_PYRAMID_LEVELS || p[5] != 0xc6) {
+        DEBUG_PRINT("The pyramid metalayer is corrupted");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    int64_t binlen = (int64_t) (((uint32_t) p[6] << 24) | ((uint32_t) p[7] << 16) |
+                                ((uint32_t) p[8] << 8) | p[9]);
+    if (binlen != ndim * 4 || binlen > len - 10) {
+        DEBUG_PRINT("The pyramid metalayer is corrupted");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    params->method = (caterva_downsample_t) p[2];
+    params->dtype = (caterva_dtype_t) p[3];
+    params->nlevels = p[4];
+    p += 10;
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        params->factors[i] = 1;
+    }
+    for (int i = 0; i < ndim; ++i) {
+        int32_t factor = (int32_t) (((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+                                    ((uint32_t) p[2] << 8) | p[3]);
+        if (factor < 1) {
+            DEBUG_PRINT("The pyramid metalayer is corrupted");
+            CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+        }
+        params->factors[i] = factor;
+        p += 4;
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+// Store the pyramid in its metalayer
+static int caterva_pyramid_record(caterva_array_t *array, const caterva_pyramid_params_t *params) {
+    uint8_t *content;
+    int32_t content_len;
+    CATERVA_ERROR(caterva_pyramid_serialize(params, array->ndim, &content, &content_len));
+    int rc;
+    if (blosc2_vlmeta_exists(array->sc, CATERVA_PYRAMID_METALAYER) < 0) {
+        rc = blosc2_vlmeta_add(array->sc, CATERVA_PYRAMID_METALAYER, content,
+                               (uint32_t) content_len, NULL);
+    } else {
+        rc = blosc2_vlmeta_update(array->sc, CATERVA_PYRAMID_METALAYER, content,
+                                  (uint32_t) content_len, NULL);
+    }
+    free(content);
+    if (rc < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+// The path of the file where a (Blosc) array is stored, or NULL if it is held in memory
+static const char *caterva_pyramid_urlpath(caterva_array_t *array) {
+    // The frames read out of a mapping do not know their file
+    if (array->mmap != NULL) {
+        return array->mmap->path;
+    }
+    return array->sc->storage->urlpath;
+}
+
+// The path of the file of a level of the array stored in `urlpath`
+static char *caterva_pyramid_level_path(caterva_ctx_t *ctx, const char *urlpath, int level) {
+    size_t len = strlen(urlpath) + 16;
+    char *path = ctx->cfg->alloc(len);
+    if (path != NULL) {
+        snprintf(path, len, "%s.level%d", urlpath, level);
+    }
+    return path;
+}
+
+// Open the level `level` of `array`, in the same way as the array
+static int caterva_pyramid_open_level(caterva_ctx_t *ctx, caterva_array_t *array,
+                                      const char *urlpath, int level, caterva_array_t **dest) {
+    char *path = caterva_pyramid_level_path(ctx, urlpath, level);
+    CATERVA_ERROR_NULL(path);
+    int rc;
+    if (array->shared != NULL) {
+        rc = caterva_open_shared(ctx, path, dest);
+    } else if (array->mmap != NULL) {
+        rc = caterva_open_mmap(ctx, path, array->mmap->access, dest);
+    } else {
+        rc = caterva_open(ctx, path, dest);
+    }
+    ctx->cfg->free(path);
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+// Open the levels recorded in the metalayer of `array` (if any). A pyramid that does not match
+// the array anymore (e.g. its files are missing or were written for another shape) is ignored.
+static int caterva_pyramid_open(caterva_ctx_t *ctx, caterva_array_t *array,
+                                caterva_pyramid_t **pyramid) {
+    const char *urlpath = caterva_pyramid_urlpath(array);
+    CATERVA_ERROR(caterva_pyramid_new(ctx, pyramid));
+    if (urlpath == NULL || blosc2_vlmeta_exists(array->sc, CATERVA_PYRAMID_METALAYER) < 0) {
+        return CATERVA_SUCCEED;
+    }
+
+    uint8_t *content;
+    uint32_t content_len;
+    if (blosc2_vlmeta_get(array->sc, CATERVA_PYRAMID_METALAYER, &content, &content_len) < 0) {
+        caterva_pyramid_free(ctx, pyramid);
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+    int rc = caterva_pyramid_deserialize(content, (int32_t) content_len, array->ndim,
+                                         &(*pyramid)->params);
+    free(content);
+    bool matches = rc == CATERVA_SUCCEED;
+    caterva_array_t *prev = array;
+    for (int level = 1; matches && level <= (*pyramid)->params.nlevels; ++level) {
+        caterva_array_t **level_array = &(*pyramid)->levels[level - 1];
+        if (caterva_pyramid_open_level(ctx, array, urlpath, level, level_array) !=
+            CATERVA_SUCCEED) {
+            matches = false;
+            break;
+        }
+        matches = (*level_array)->ndim == array->ndim &&
+                  (*level_array)->itemsize == array->itemsize;
+        for (int i = 0; matches && i < array->ndim; ++i) {
+            int32_t factor = (*pyramid)->params.factors[i];
+            matches = (*level_array)->shape[i] == (prev->shape[i] + factor - 1) / factor;
+        }
+        prev = *level_array;
+    }
+    if (!matches) {
+        DEBUG_PRINT("The pyramid does not match the array, so it is ignored");
+        caterva_pyramid_free(ctx, pyramid);
+        CATERVA_ERROR(caterva_pyramid_new(ctx, pyramid));
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_pyramid_drop(caterva_ctx_t *ctx, caterva_array_t *array) {
+    CATERVA_ERROR(caterva_pyramid_free(ctx, &array->pyramid));
+    if (array->storage != CATERVA_STORAGE_BLOSC) {
+        return CATERVA_SUCCEED;
+    }
+    const char *urlpath = caterva_pyramid_urlpath(array);
+    if (urlpath == NULL || blosc2_vlmeta_exists(array->sc, CATERVA_PYRAMID_METALAYER) < 0) {
+        return CATERVA_SUCCEED;
+    }
+
+    // If the metalayer can not be read, every file that a level could have is removed
+    caterva_pyramid_params_t params;
+    uint8_t *content;
+    uint32_t content_len;
+    if (blosc2_vlmeta_get(array->sc, CATERVA_PYRAMID_METALAYER, &content, &content_len) < 0) {
+        CATERVA_ERROR(CATERVA_ERR_BLOSC_FAILED);
+    }
+    int rc = caterva_pyramid_deserialize(content, (int32_t) content_len, array->ndim, &params);
+    free(content);
+    int nlevels = rc == CATERVA_SUCCEED ? params.nlevels : CATERVA_MAX_PYRAMID_LEVELS;
+
+    // Blosc can not delete a variable-length metalayer, so a pyramid without levels is recorded
+    caterva_pyramid_params_t none = {0};
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        none.factors[i] = 1;
+    }
+    CATERVA_ERROR(caterva_pyramid_record(array, &none));
+    for (int level = 1; level <= nlevels; ++level) {
+        char *path = caterva_pyramid_level_path(ctx, urlpath, level);
+        CATERVA_ERROR_NULL(path);
+        remove(path);
+        ctx->cfg->free(path);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+// Make sure that the pyramid of an array stored on disk has been opened. Several threads reading
+// from the array may need it at once, so it is opened under the array lock.
+static int caterva_pyramid_load(caterva_ctx_t *ctx, caterva_array_t *array) {
+    if (array->storage != CATERVA_STORAGE_BLOSC) {
+        return CATERVA_SUCCEED;
+    }
+    int rc = CATERVA_SUCCEED;
+    pthread_mutex_lock(&array->lock->mutex);
+    if (array->pyramid == NULL) {
+        rc = caterva_pyramid_open(ctx, array, &array->pyramid);
+    }
+    pthread_mutex_unlock(&array->lock->mutex);
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+#define CATERVA_PYRAMID_LOAD(type, item)     \
+    do {                                     \
+        type value_;                         \
+        memcpy(&value_, item, sizeof(type)); \
+        return (double) value_;              \
+    } while (0)
+
+// The value of `item` (this is called for every item of the array, so it is kept inline)
+static inline double caterva_pyramid_value(caterva_dtype_t dtype, const uint8_t *item) {
+    switch (dtype) {
+        case CATERVA_DTYPE_INT8:
+            CATERVA_PYRAMID_LOAD(int8_t, item);
+        case CATERVA_DTYPE_INT16:
+            CATERVA_PYRAMID_LOAD(int16_t, item);
+        case CATERVA_DTYPE_INT32:
+            CATERVA_PYRAMID_LOAD(int32_t, item);
+        case CATERVA_DTYPE_INT64:
+            CATERVA_PYRAMID_LOAD(int64_t, item);
+        case CATERVA_DTYPE_UINT8:
+            CATERVA_PYRAMID_LOAD(uint8_t, item);
+        case CATERVA_DTYPE_UINT16:
+            CATERVA_PYRAMID_LOAD(uint16_t, item);
+        case CATERVA_DTYPE_UINT32:
+            CATERVA_PYRAMID_LOAD(uint32_t, item);
+        case CATERVA_DTYPE_UINT64:
+            CATERVA_PYRAMID_LOAD(uint64_t, item);
+        case CATERVA_DTYPE_FLOAT32:
+            CATERVA_PYRAMID_LOAD(float, item);
+        case CATERVA_DTYPE_FLOAT64:
+            CATERVA_PYRAMID_LOAD(double, item);
+        default:
+            return 0;
+    }
+}
+
+#define CATERVA_PYRAMID_STORE(type, value, item) \
+    do {                                         \
+        type value_ = (type) (value);            \
+        memcpy(item, &value_, sizeof(type));     \
+    } while (0)
+
+// Store `value` in `item`, rounded to the nearest integer for integer types
+static void caterva_pyramid_store(caterva_dtype_t dtype, double value, uint8_t *item) {
+    switch (dtype) {
+        case CATERVA_DTYPE_INT8:
+            CATERVA_PYRAMID_STORE(int8_t, round(value), item);
+            break;
+        case CATERVA_DTYPE_INT16:
+            CATERVA_PYRAMID_STORE(int16_t, round(value), item);
+            break;
+        case CATERVA_DTYPE_INT32:
+            CATERVA_PYRAMID_STORE(int32_t, round(value), item);
+            break;
+        case CATERVA_DTYPE_INT64:
+            CATERVA_PYRAMID_STORE(int64_t, round(value), item);
+            break;
+        case CATERVA_DTYPE_UINT8:
+            CATERVA_PYRAMID_STORE(uint8_t, round(value), item);
+            break;
+        case CATERVA_DTYPE_UINT16:
+            CATERVA_PYRAMID_STORE(uint16_t, round(value), item);
+            break;
+        case CATERVA_DTYPE_UINT32:
+            CATERVA_PYRAMID_STORE(uint32_t, round(value), item);
+            break;
+        case CATERVA_DTYPE_UINT64:
+            CATERVA_PYRAMID_STORE(uint64_t, round(value), item);
+            break;
+        case CATERVA_DTYPE_FLOAT32:
+            CATERVA_PYRAMID_STORE(float, value, item);
+            break;
+        case CATERVA_DTYPE_FLOAT64:
+            CATERVA_PYRAMID_STORE(double, value, item);
+            break;
+        default:
+            break;
+    }
+}
+
+// Reduce the box with shape `box` starting at `src` (whose strides are `strides`, in items) into
+// `dest`. The maximum is copied from its item instead of being converted back from a double; a
+// NaN wins over any other value.
+static void caterva_pyramid_reduce(const caterva_pyramid_params_t *params, int8_t ndim,
+                                   uint8_t itemsize, const int64_t *box, const int64_t *strides,
+                                   const uint8_t *src, uint8_t *dest) {
+    int64_t coords[CATERVA_MAX_DIM] = {0};
+    int64_t nlines = 1;
+    for (int i = 0; i < ndim - 1; ++i) {
+        nlines *= box[i];
+    }
+    int64_t n = box[ndim - 1];
+    double sum = 0;
+    double max = -INFINITY;
+    const uint8_t *max_item = src;
+    for (int64_t line = 0; line < nlines; ++line) {
+        int64_t offset = 0;
+        for (int i = 0; i < ndim - 1; ++i) {
+            offset += coords[i] * strides[i];
+        }
+        const uint8_t *item = src + offset * itemsize;
+        for (int64_t j = 0; j < n; ++j, item += itemsize) {
+            double value = caterva_pyramid_value(params->dtype, item);
+            if (params->method == CATERVA_DOWNSAMPLE_MEAN) {
+                sum += value;
+            } else if (value > max || (value != value && max == max)) {
+                max = value;
+                max_item = item;
+            }
+        }
+        for (int i = ndim - 2; i >= 0; --i) {
+            if (++coords[i] < box[i]) {
+                break;
+            }
+            coords[i] = 0;
+        }
+    }
+    if (params->method == CATERVA_DOWNSAMPLE_MEAN) {
+        caterva_pyramid_store(params->dtype, sum / (double) (nlines * n), dest);
+    } else {
+        memcpy(dest, max_item, itemsize);
+    }
+}
+
+// Downsample `src` (a C-ordered region with shape `sshape`) into the `dshape` items of `dest`,
+// whose strides are `dstrides` (in items). Every item of `dest` reduces a box of `factors` items
+// of the region, clipped to it.
+static void caterva_pyramid_downsample(const caterva_pyramid_params_t *params, int8_t ndim,
+                                       uint8_t itemsize, const int64_t *sshape,
+                                       const uint8_t *src, const int64_t *dshape,
+                                       const int64_t *dstrides, uint8_t *dest) {
+    int64_t sstrides[CATERVA_MAX_DIM];
+    caterva_copy_strides(ndim, sshape, sstrides);
+    int64_t nitems = 1;
+    for (int i = 0; i < ndim; ++i) {
+        nitems *= dshape[i];
+    }
+
+    int64_t coords[CATERVA_MAX_DIM] = {0};
+    for (int64_t n = 0; n < nitems; ++n) {
+        int64_t soffset = 0;
+        int64_t doffset = 0;
+        int64_t box[CATERVA_MAX_DIM];
+        for (int i = 0; i < ndim; ++i) {
+            int64_t first = coords[i] * params->factors[i];
+            soffset += first * sstrides[i];
+            doffset += coords[i] * dstrides[i];
+            box[i] = sshape[i] - first < params->factors[i] ? sshape[i] - first :
+                     params->factors[i];
+        }
+        const uint8_t *item = src + soffset * itemsize;
+        if (params->method == CATERVA_DOWNSAMPLE_STRIDE) {
+            memcpy(dest + doffset * itemsize, item, itemsize);
+        } else {
+            caterva_pyramid_reduce(params, ndim, itemsize, box, sstrides, item,
+                                   dest + doffset * itemsize);
+        }
+        for (int i = ndim - 1; i >= 0; --i) {
+            if (++coords[i] < dshape[i]) {
+                break;
+            }
+            coords[i] = 0;
+        }
+    }
+}
+
+typedef struct {
+    caterva_ctx_t *ctx;
+    caterva_array_t *src;
+    //!< The previous level (or the array itself).
+    const caterva_pyramid_params_t *params;
+} caterva_pyramid_fill_t;
+
+// The fill function of the append pipeline, which downsamples the region of the previous level
+// covered by the chunk `nchunk` of a level
+static int caterva_pyramid_fill(void *fill_arg, caterva_blosc_reader_t *reader,
+                                caterva_array_t *array, int64_t nchunk, int8_t *chunk,
+                                int8_t *rchunk, bool *zeros) {
+    caterva_pyramid_fill_t *fill = (caterva_pyramid_fill_t *) fill_arg;
+    caterva_array_t *src = fill->src;
+    const int32_t *factors = fill->params->factors;
+    int8_t ndim = array->ndim;
+    uint8_t itemsize = (uint8_t) array->itemsize;
+
+    int64_t coords[CATERVA_MAX_DIM];
+    int64_t index = nchunk;
+    for (int i = ndim - 1; i >= 0; --i) {
+        int64_t grid = array->extshape[i] / array->chunkshape[i];
+        coords[i] = index % grid;
+        index /= grid;
+    }
+    int64_t chunkshape[CATERVA_MAX_DIM] = {0};
+    int64_t dshape[CATERVA_MAX_DIM];
+    int64_t sstart[CATERVA_MAX_DIM];
+    int64_t sstop[CATERVA_MAX_DIM];
+    int64_t sshape[CATERVA_MAX_DIM];
+    int64_t snitems = 1;
+    bool partial = false;
+    for (int i = 0; i < ndim; ++i) {
+        chunkshape[i] = array->chunkshape[i];
+        int64_t start = coords[i] * chunkshape[i];
+        int64_t stop = start + chunkshape[i];
+        if (stop > array->shape[i]) {
+            stop = array->shape[i];
+            partial = true;
+        }
+        dshape[i] = stop - start;
+        sstart[i] = start * factors[i];
+        sstop[i] = stop * factors[i] < src->shape[i] ? stop * factors[i] : src->shape[i];
+        sshape[i] = sstop[i] - sstart[i];
+        snitems *= sshape[i];
+    }
+    int64_t dstrides[CATERVA_MAX_DIM];
+    caterva_copy_strides(ndim, chunkshape, dstrides);
+    if (partial) {
+        caterva_copy_fill(itemsize, (uint8_t *) chunk, array->chunknitems, array->fillvalue);
+    }
+
+    uint8_t *region = caterva_pool_alloc(fill->ctx, (size_t) (snitems * itemsize));
+    CATERVA_ERROR_NULL(region);
+    int rc = caterva_blosc_reader_get_slice_buffer(reader, src, sstart, sstop, sshape, region);
+    if (rc == CATERVA_SUCCEED) {
+        caterva_pyramid_downsample(fill->params, ndim, itemsize, sshape, region, dshape, dstrides,
+                                   (uint8_t *) chunk);
+    }
+    caterva_pool_release(fill->ctx, region);
+    CATERVA_ERROR(rc);
+
+    if (caterva_copy_is_constant(itemsize, (uint8_t *) chunk, array->chunknitems, NULL)) {
+        *zeros = true;
+        return CATERVA_SUCCEED;
+    }
+    CATERVA_ERROR(caterva_blosc_array_repart_chunk(rchunk, array->extchunknitems * itemsize,
+                                                   chunk, array->chunknitems * itemsize, array));
+
+    return CATERVA_SUCCEED;
+}
+
+// Build the level `level` of `array` from the previous one, `prev`
+static int caterva_pyramid_build_level(caterva_ctx_t *ctx, caterva_array_t *array,
+                                       caterva_array_t *prev,
+                                       const caterva_pyramid_params_t *params, int level,
+                                       caterva_array_t **dest) {
+    caterva_params_t lparams = {0};
+    lparams.itemsize = (uint8_t) array->itemsize;
+    lparams.ndim = (uint8_t) array->ndim;
+    caterva_storage_t storage = {0};
+    storage.backend = CATERVA_STORAGE_BLOSC;
+    storage.properties.blosc.sequencial = true;
+    storage.properties.blosc.stats = CATERVA_DTYPE_NONE;
+    // The partitions of the array are kept, unless the level is smaller
+    for (int i = 0; i < array->ndim; ++i) {
+        int64_t shape = (prev->shape[i] + params->factors[i] - 1) / params->factors[i];
+        int32_t chunkshape = array->chunkshape[i];
+        if (shape > 0 && shape < chunkshape) {
+            chunkshape = (int32_t) shape;
+        }
+        lparams.shape[i] = shape;
+        storage.properties.blosc.chunkshape[i] = chunkshape;
+        storage.properties.blosc.blockshape[i] = array->blockshape[i] < chunkshape ?
+                                                 array->blockshape[i] : chunkshape;
+    }
+
+    // The levels of an array on disk are stored next to it, replacing any previous ones
+    const char *urlpath = caterva_pyramid_urlpath(array);
+    char *path = NULL;
+    if (urlpath != NULL) {
+        path = caterva_pyramid_level_path(ctx, urlpath, level);
+        CATERVA_ERROR_NULL(path);
+        remove(path);
+        storage.properties.blosc.urlpath = path;
+    }
+    int rc = caterva_empty(ctx, &lparams, &storage, dest);
+    if (path != NULL) {
+        ctx->cfg->free(path);
+    }
+    CATERVA_ERROR(rc);
+    if (array->fillvalue != NULL) {
+        rc = caterva_set_fillvalue(ctx, *dest, array->fillvalue);
+        if (rc != CATERVA_SUCCEED) {
+            caterva_free(ctx, dest);
+            CATERVA_ERROR(rc);
+        }
+    }
+
+    caterva_pyramid_fill_t fill;
+    fill.ctx = ctx;
+    fill.src = prev;
+    fill.params = params;
+    rc = caterva_blosc_array_fill(ctx, *dest, prev, caterva_pyramid_fill, &fill);
+    if (rc != CATERVA_SUCCEED) {
+        caterva_free(ctx, dest);
+        CATERVA_ERROR(rc);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_pyramid_build(caterva_ctx_t *ctx, caterva_array_t *array,
+                          caterva_pyramid_params_t *params) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(params);
+
+    if (array->storage != CATERVA_STORAGE_BLOSC) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+    if (array->mmap != NULL || array->shared != NULL) {
+        CATERVA_ERROR(CATERVA_ERR_READ_ONLY);
+    }
+    if (!array->filled || array->ndim == 0 || params->nlevels < 1 ||
+        params->nlevels > CATERVA_MAX_PYRAMID_LEVELS) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    caterva_pyramid_params_t params_ = *params;
+    switch (params->method) {
+        case CATERVA_DOWNSAMPLE_STRIDE:
+            params_.dtype = CATERVA_DTYPE_NONE;
+            break;
+        case CATERVA_DOWNSAMPLE_MEAN:
+        case CATERVA_DOWNSAMPLE_MAX:
+            if (caterva_stats_dtype_size(params->dtype) != array->itemsize) {
+                DEBUG_PRINT("The size of the type does not match the itemsize");
+                CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+            }
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    for (int i = 0; i < CATERVA_MAX_DIM; ++i) {
+        if (i >= array->ndim) {
+            params_.factors[i] = 1;
+        } else if (params->factors[i] == 0) {
+            params_.factors[i] = 2;
+        } else if (params->factors[i] < 0) {
+            CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+        }
+    }
+
+    // The previous pyramid is dropped first (and so recorded), as its files are overwritten
+    CATERVA_ERROR(caterva_pyramid_free(ctx, &array->pyramid));
+    bool persistent = caterva_pyramid_urlpath(array) != NULL;
+    if (persistent && blosc2_vlmeta_exists(array->sc, CATERVA_PYRAMID_METALAYER) >= 0) {
+        caterva_pyramid_params_t none = params_;
+        none.nlevels = 0;
+        CATERVA_ERROR(caterva_pyramid_record(array, &none));
+    }
+
+    caterva_pyramid_t *pyramid;
+    CATERVA_ERROR(caterva_pyramid_new(ctx, &pyramid));
+    pyramid->params = params_;
+    int rc = CATERVA_SUCCEED;
+    caterva_array_t *prev = array;
+    for (int level = 1; rc == CATERVA_SUCCEED && level <= params_.nlevels; ++level) {
+        rc = caterva_pyramid_build_level(ctx, array, prev, &params_, level,
+                                         &pyramid->levels[level - 1]);
+        prev = pyramid->levels[level - 1];
+    }
+    if (rc == CATERVA_SUCCEED && persistent) {
+        rc = caterva_pyramid_record(array, &params_);
+    }
+    if (rc != CATERVA_SUCCEED) {
+        caterva_pyramid_free(ctx, &pyramid);
+        CATERVA_ERROR(rc);
+    }
+    array->pyramid = pyramid;
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_pyramid_get_params(caterva_ctx_t *ctx, caterva_array_t *array,
+                               caterva_pyramid_params_t *params) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(params);
+
+    CATERVA_ERROR(caterva_pyramid_load(ctx, array));
+    if (array->pyramid != NULL) {
+        *params = array->pyramid->params;
+    } else {
+        memset(params, 0, sizeof(caterva_pyramid_params_t));
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_pyramid_get_level(caterva_ctx_t *ctx, caterva_array_t *array, int level,
+                              caterva_array_t **level_array) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(level_array);
+
+    CATERVA_ERROR(caterva_pyramid_load(ctx, array));
+    caterva_pyramid_t *pyramid = array->pyramid;
+    if (pyramid == NULL || level < 1 || level > pyramid->params.nlevels) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    *level_array = pyramid->levels[level - 1];
+
+    return CATERVA_SUCCEED;
+}
+
+// Copy into the box with shape `shape` of `dest` (whose strides are `dstrides`) the items of `src`,
+// a C-ordered region with shape `rshape` starting at `rstart`, at the coordinates of `table`
+static void caterva_pyramid_gather(int8_t ndim, uint8_t itemsize, const int64_t *shape,
+                                   int64_t **table, const int64_t *rstart, const int64_t *rshape,
+                                   const uint8_t *src, const int64_t *dstrides, uint8_t *dest) {
+    int64_t rstrides[CATERVA_MAX_DIM];
+    caterva_copy_strides(ndim, rshape, rstrides);
+    int64_t coords[CATERVA_MAX_DIM] = {0};
+    int64_t nlines = 1;
+    for (int i = 0; i < ndim - 1; ++i) {
+        nlines *= shape[i];
+    }
+    int64_t n = shape[ndim - 1];
+    const int64_t *inner = table[ndim - 1];
+    for (int64_t line = 0; line < nlines; ++line) {
+        int64_t soffset = -rstart[ndim - 1];
+        int64_t doffset = 0;
+        for (int i = 0; i < ndim - 1; ++i) {
+            soffset += (table[i][coords[i]] - rstart[i]) * rstrides[i];
+            doffset += coords[i] * dstrides[i];
+        }
+        uint8_t *item = dest + doffset * itemsize;
+        for (int64_t j = 0; j < n; ++j, item += itemsize) {
+            memcpy(item, src + (soffset + inner[j]) * itemsize, itemsize);
+        }
+        for (int i = ndim - 2; i >= 0; --i) {
+            if (++coords[i] < shape[i]) {
+                break;
+            }
+            coords[i] = 0;
+        }
+    }
+}
+
+int caterva_get_slice_buffer_scaled(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *start,
+                                    int64_t *stop, int64_t *shape, void *buffer,
+                                    int64_t buffersize, int *level) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(start);
+    CATERVA_ERROR_NULL(stop);
+    CATERVA_ERROR_NULL(shape);
+    CATERVA_ERROR_NULL(buffer);
+
+    int8_t ndim = array->ndim;
+    uint8_t itemsize = (uint8_t) array->itemsize;
+    int64_t nitems = 1;
+    bool resampled = false;
+    for (int i = 0; i < ndim; ++i) {
+        int64_t extent = stop[i] - start[i];
+        if (start[i] < 0 || extent < 0 || stop[i] > array->shape[i] || shape[i] > extent ||
+            shape[i] < (extent > 0 ? 1 : 0)) {
+            CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+        }
+        nitems *= shape[i];
+        resampled = resampled || shape[i] != extent;
+    }
+    if (buffersize < nitems * itemsize) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    if (level != NULL) {
+        *level = 0;
+    }
+    if (!resampled || nitems == 0) {
+        CATERVA_ERROR(caterva_get_slice_buffer(ctx, array, start, stop, shape, buffer,
+                                               buffersize));
+        return CATERVA_SUCCEED;
+    }
+
+    // The coarsest level with at least as many items in the slice as the buffer, along every
+    // dimension. The scale of a level is the number of items of the array per item of the level.
+    CATERVA_ERROR(caterva_pyramid_load(ctx, array));
+    caterva_pyramid_t *pyramid = array->pyramid;
+    int nlevels = pyramid != NULL ? pyramid->params.nlevels : 0;
+    int level_ = 0;
+    int64_t scale[CATERVA_MAX_DIM];
+    int64_t next_scale[CATERVA_MAX_DIM];
+    for (int i = 0; i < ndim; ++i) {
+        scale[i] = 1;
+        next_scale[i] = 1;
+    }
+    for (int l = 1; l <= nlevels; ++l) {
+        bool enough = true;
+        for (int i = 0; i < ndim; ++i) {
+            next_scale[i] *= pyramid->params.factors[i];
+            if ((stop[i] - start[i]) / next_scale[i] < shape[i]) {
+                enough = false;
+            }
+        }
+        if (!enough) {
+            break;
+        }
+        level_ = l;
+        memcpy(scale, next_scale, sizeof(scale));
+    }
+    caterva_array_t *source = level_ == 0 ? array : pyramid->levels[level_ - 1];
+
+    // The level is read tile by tile, so that only a tile of it is held in memory at once: a chunk
+    // for Blosc arrays and a line for plain buffers
+    int64_t tshape[CATERVA_MAX_DIM];
+    int64_t tnitems = 1;
+    int64_t ntable = 0;
+    for (int i = 0; i < ndim; ++i) {
+        if (source->storage == CATERVA_STORAGE_BLOSC) {
+            tshape[i] = source->chunkshape[i];
+        } else {
+            tshape[i] = i == ndim - 1 ? source->shape[i] : 1;
+        }
+        tnitems *= tshape[i] < source->shape[i] ? tshape[i] : source->shape[i];
+        ntable += shape[i];
+    }
+
+    // Every item of the buffer takes the item of the level nearest to its center. The items of
+    // the buffer along a dimension are split in segments, one per tile of the level.
+    int64_t *tables = ctx->cfg->alloc((size_t) (2 * ntable + ndim) * sizeof(int64_t));
+    CATERVA_ERROR_NULL(tables);
+    int64_t *table[CATERVA_MAX_DIM];
+    int64_t *segments[CATERVA_MAX_DIM];
+    int64_t nsegments[CATERVA_MAX_DIM];
+    int64_t ntiles = 1;
+    int64_t *p = tables;
+    for (int i = 0; i < ndim; ++i) {
+        double step = (double) (stop[i] - start[i]) / (double) shape[i];
+        table[i] = p;
+        segments[i] = p + shape[i];
+        nsegments[i] = 0;
+        for (int64_t j = 0; j < shape[i]; ++j) {
+            int64_t x = start[i] + (int64_t) (((double) j + 0.5) * step);
+            int64_t lx = (x < stop[i] ? x : stop[i] - 1) / scale[i];
+            table[i][j] = lx < source->shape[i] ? lx : source->shape[i] - 1;
+            if (j == 0 || table[i][j] / tshape[i] != table[i][j - 1] / tshape[i]) {
+                segments[i][nsegments[i]++] = j;
+            }
+        }
+        segments[i][nsegments[i]] = shape[i];
+        ntiles *= nsegments[i];
+        p = segments[i] + nsegments[i] + 1;
+    }
+
+    uint8_t *region = caterva_pool_alloc(ctx, (size_t) (tnitems * itemsize));
+    if (region == NULL) {
+        ctx->cfg->free(tables);
+        CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+    }
+    int64_t dstrides[CATERVA_MAX_DIM];
+    caterva_copy_strides(ndim, shape, dstrides);
+    int64_t segment[CATERVA_MAX_DIM] = {0};
+    int rc = CATERVA_SUCCEED;
+    for (int64_t n = 0; rc == CATERVA_SUCCEED && n < ntiles; ++n) {
+        // Only the part of the tile spanned by the items picked from it is read
+        int64_t rstart[CATERVA_MAX_DIM];
+        int64_t rstop[CATERVA_MAX_DIM];
+        int64_t rshape[CATERVA_MAX_DIM];
+        int64_t bshape[CATERVA_MAX_DIM];
+        int64_t *btable[CATERVA_MAX_DIM];
+        int64_t rnitems = 1;
+        int64_t doffset = 0;
+        for (int i = 0; i < ndim; ++i) {
+            int64_t first = segments[i][segment[i]];
+            int64_t last = segments[i][segment[i] + 1];
+            rstart[i] = table[i][first];
+            rstop[i] = table[i][last - 1] + 1;
+            rshape[i] = rstop[i] - rstart[i];
+            rnitems *= rshape[i];
+            bshape[i] = last - first;
+            btable[i] = table[i] + first;
+            doffset += first * dstrides[i];
+        }
+        rc = caterva_get_slice_buffer(ctx, source, rstart, rstop, rshape, region,
+                                      rnitems * itemsize);
+        if (rc == CATERVA_SUCCEED) {
+            caterva_pyramid_gather(ndim, itemsize, bshape, btable, rstart, rshape, region,
+                                   dstrides, (uint8_t *) buffer + doffset * itemsize);
+        }
+        for (int i = ndim - 1; i >= 0; --i) {
+            if (++segment[i] < nsegments[i]) {
+                break;
+            }
+            segment[i] = 0;
+        }
+    }
+    caterva_pool_release(ctx, region);
+    ctx->cfg->free(tables);
+    CATERVA_ERROR(rc);
+    if (level != NULL) {
+        *level = level_;
+    }
+
+    return CATERVA_SUCCEED;
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef CATERVA_CATERVA_PYRAMID_H_
+#define CATERVA_CATERVA_PYRAMID_H_
+
+#include <caterva.h>
+
+/* The name of the variable-length metalayer where the pyramid is recorded */
+#define CATERVA_PYRAMID_METALAYER "caterva_pyramid"
+
+/* The version for the pyramid format; starts from 0 and it must not exceed 127 */
+#define CATERVA_PYRAMID_FORMAT 0
+
+struct caterva_pyramid_s {
+    caterva_pyramid_params_t params;
+    //!< The parameters of the pyramid, with the actual factors. It has no levels if the array
+    //!< has no pyramid.
+    caterva_array_t *levels[CATERVA_MAX_PYRAMID_LEVELS];
+    //!< The levels, from the finest to the coarsest one.
+};
+
+int caterva_pyramid_free(caterva_ctx_t *ctx, caterva_pyramid_t **pyramid);
+
+// Drop the pyramid of `array` (e.g. because its shape changes), along with the files of its levels
+int caterva_pyramid_drop(caterva_ctx_t *ctx, caterva_array_t *array);
+
+#endif  // CATERVA_CATERVA_PYRAMID_H_
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <caterva.h>
+
+#include "caterva_blosc.h"
+#include "caterva_plainbuffer.h"
+
+/*
+ * A reader wraps the per-thread state of the slice reads (the decompression context, the block
+ * mask and the scratch chunk), so that it is created once instead of in every call. Everything
+ * else is shared with the array: the frame offsets are loaded before the first reader is created,
+ * and the chunk cache and the mmap tracking are protected by their own mutexes.
+ */
+
+struct caterva_reader_s {
+    caterva_ctx_t *ctx;
+    caterva_array_t *array;
+    caterva_blosc_reader_t reader;
+    //!< The state used to decompress the chunks (only for Blosc backed arrays).
+};
+
+int caterva_reader_new(caterva_ctx_t *ctx, caterva_array_t *array, caterva_reader_t **reader) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(reader);
+
+    if (!array->filled) {
+        DEBUG_PRINT("The array must be filled before reading from it");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    caterva_reader_t *reader_ = ctx->cfg->alloc(sizeof(caterva_reader_t));
+    CATERVA_ERROR_NULL(reader_);
+    memset(reader_, 0, sizeof(caterva_reader_t));
+    reader_->ctx = ctx;
+    reader_->array = array;
+
+    if (array->storage == CATERVA_STORAGE_BLOSC && array->nitems > 0) {
+        int rc = caterva_blosc_reader_init(ctx, array, 1, true, &reader_->reader);
+        if (rc != CATERVA_SUCCEED) {
+            caterva_reader_free(&reader_);
+            CATERVA_ERROR(rc);
+        }
+    }
+
+    *reader = reader_;
+    return CATERVA_SUCCEED;
+}
+
+int caterva_reader_get_slice_buffer(caterva_reader_t *reader, int64_t *start, int64_t *stop,
+                                    int64_t *shape, void *buffer, int64_t buffersize) {
+    CATERVA_ERROR_NULL(reader);
+    CATERVA_ERROR_NULL(start);
+    CATERVA_ERROR_NULL(stop);
+    CATERVA_ERROR_NULL(shape);
+    CATERVA_ERROR_NULL(buffer);
+    caterva_array_t *array = reader->array;
+
+    int64_t size = 1;
+    for (int i = 0; i < array->ndim; ++i) {
+        if (stop[i] - start[i] > shape[i]) {
+            DEBUG_PRINT("The buffer shape can not be smaller than the slice shape");
+            return CATERVA_ERR_INVALID_ARGUMENT;
+        }
+        size *= shape[i];
+    }
+
+    if (array->nitems == 0) {
+        return CATERVA_SUCCEED;
+    }
+
+    if (buffersize < size * array->itemsize) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    switch (array->storage) {
+        case CATERVA_STORAGE_BLOSC:
+            CATERVA_ERROR(caterva_blosc_reader_get_slice_buffer(&reader->reader, array, start,
+                                                                stop, shape, buffer));
+            break;
+        case CATERVA_STORAGE_PLAINBUFFER:
+            CATERVA_ERROR(caterva_plainbuffer_array_get_slice_buffer(reader->ctx, array, start,
+                                                                     stop, shape, buffer));
+            break;
+        default:
+            CATERVA_ERROR(CATERVA_ERR_INVALID_STORAGE);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_reader_free(caterva_reader_t **reader) {
+    CATERVA_ERROR_NULL(reader);
+
+    caterva_reader_t *reader_ = *reader;
+    if (reader_ == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    caterva_ctx_t *ctx = reader_->ctx;
+    if (reader_->array->storage == CATERVA_STORAGE_BLOSC) {
+        caterva_blosc_reader_destroy(ctx, &reader_->reader);
+    }
+    ctx->cfg->free(reader_);
+    *reader = NULL;
+
+    return CATERVA_SUCCEED;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "caterva_shared.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "caterva_blosc.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/*
+ * A process-wide registry of the arrays opened with caterva_open_shared, keyed by the canonical
+ * path of their files. The first handle opens the array as caterva_open_mmap does (so contiguous
+ * frames are mapped and their chunk offsets are read straight out of the mapping), and the next
+ * ones just copy its members: the super-chunk, its lock, the mapping, the statistics and the
+ * versions are shared, so the chunk offsets are loaded once for all of them. Every handle has its
+ * own cache, counters and fill value. The array is closed when its last handle is freed.
+ *
+ * Opening a new array holds the registry lock, so concurrent opens of the same file never open it
+ * twice.
+ */
+
+#if defined(_WIN32)
+static SRWLOCK caterva_shared_lock = SRWLOCK_INIT;
+#define CATERVA_SHARED_LOCK() AcquireSRWLockExclusive(&caterva_shared_lock)
+#define CATERVA_SHARED_UNLOCK() ReleaseSRWLockExclusive(&caterva_shared_lock)
+#else
+static pthread_mutex_t caterva_shared_lock = PTHREAD_MUTEX_INITIALIZER;
+#define CATERVA_SHARED_LOCK() pthread_mutex_lock(&caterva_shared_lock)
+#define CATERVA_SHARED_UNLOCK() pthread_mutex_unlock(&caterva_shared_lock)
+#endif
+
+static caterva_shared_t *caterva_shared_registry = NULL;
+
+// Return the canonical path of an existing file (allocated with malloc), or NULL
+static char *caterva_shared_path(const char *urlpath) {
+#if defined(_WIN32)
+    if (GetFileAttributesA(urlpath) == INVALID_FILE_ATTRIBUTES) {
+        return NULL;
+    }
+    return _fullpath(NULL, urlpath, 0);
+#else
+    return realpath(urlpath, NULL);
+#endif
+}
+
+// Open the array of an entry that is not in the registry yet
+static int caterva_shared_new(caterva_ctx_t *ctx, const char *urlpath, caterva_shared_t **shared) {
+    caterva_ctx_t *ctx_;
+    CATERVA_ERROR(caterva_ctx_new(ctx->cfg, &ctx_));
+    caterva_shared_t *shared_ = ctx_->cfg->alloc(sizeof(caterva_shared_t));
+    if (shared_ == NULL) {
+        caterva_ctx_free(&ctx_);
+        CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+    }
+    int rc = caterva_blosc_open_mmap(ctx_, urlpath, CATERVA_ACCESS_NORMAL, &shared_->array);
+    if (rc != CATERVA_SUCCEED) {
+        ctx_->cfg->free(shared_);
+        caterva_ctx_free(&ctx_);
+        CATERVA_ERROR(rc);
+    }
+    shared_->ctx = ctx_;
+    shared_->path = NULL;
+    shared_->nhandles = 0;
+    shared_->next = NULL;
+
+    *shared = shared_;
+    return CATERVA_SUCCEED;
+}
+
+static void caterva_shared_free(caterva_shared_t **shared) {
+    caterva_ctx_t *ctx = (*shared)->ctx;
+    caterva_free(ctx, &(*shared)->array);
+    free((*shared)->path);
+    ctx->cfg->free(*shared);
+    caterva_ctx_free(&ctx);
+    *shared = NULL;
+}
+
+// Create a handle of a shared array
+static int caterva_shared_handle(caterva_ctx_t *ctx, caterva_shared_t *shared,
+                                 caterva_array_t **array) {
+    caterva_array_t *array_ = ctx->cfg->alloc(sizeof(caterva_array_t));
+    CATERVA_ERROR_NULL(array_);
+    memcpy(array_, shared->array, sizeof(caterva_array_t));
+    array_->cache = NULL;
+    array_->instr = NULL;
+    array_->shared = shared;
+    array_->pyramid = NULL;
+    if (shared->array->fillvalue != NULL) {
+        array_->fillvalue = ctx->cfg->alloc(array_->itemsize);
+        if (array_->fillvalue == NULL) {
+            ctx->cfg->free(array_);
+            CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+        }
+        memcpy(array_->fillvalue, shared->array->fillvalue, array_->itemsize);
+    }
+
+    *array = array_;
+    return CATERVA_SUCCEED;
+}
+
+int caterva_shared_open(caterva_ctx_t *ctx, const char *urlpath, caterva_array_t **array) {
+    *array = NULL;
+    char *path = caterva_shared_path(urlpath);
+    if (path == NULL) {
+        DEBUG_PRINT("Can not open the file");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    CATERVA_SHARED_LOCK();
+    caterva_shared_t *shared = caterva_shared_registry;
+    while (shared != NULL && strcmp(shared->path, path) != 0) {
+        shared = shared->next;
+    }
+    int rc = CATERVA_SUCCEED;
+    if (shared == NULL) {
+        rc = caterva_shared_new(ctx, urlpath, &shared);
+        if (rc == CATERVA_SUCCEED) {
+            shared->path = path;
+            path = NULL;
+            shared->next = caterva_shared_registry;
+            caterva_shared_registry = shared;
+        }
+    }
+    if (rc == CATERVA_SUCCEED) {
+        shared->nhandles++;
+    }
+    CATERVA_SHARED_UNLOCK();
+    free(path);
+    CATERVA_ERROR(rc);
+
+    rc = caterva_shared_handle(ctx, shared, array);
+    if (rc != CATERVA_SUCCEED) {
+        caterva_shared_release(&shared);
+        CATERVA_ERROR(rc);
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_shared_release(caterva_shared_t **shared) {
+    CATERVA_SHARED_LOCK();
+    bool last = --(*shared)->nhandles == 0;
+    if (last) {
+        caterva_shared_t **prev = &caterva_shared_registry;
+        while (*prev != *shared) {
+            prev = &(*prev)->next;
+        }
+        *prev = (*shared)->next;
+    }
+    CATERVA_SHARED_UNLOCK();
+
+    if (last) {
+        caterva_shared_free(shared);
+    }
+    *shared = NULL;
+
+    return CATERVA_SUCCEED;
+}
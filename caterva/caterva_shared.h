@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef CATERVA_CATERVA_SHARED_H_
+#define CATERVA_CATERVA_SHARED_H_
+
+#include <caterva.h>
+
+struct caterva_shared_s {
+    char *path;
+    //!< The canonical path of the file, which identifies the array in the registry.
+    caterva_ctx_t *ctx;
+    //!< The context owning the array, so that it outlives the context of the handles.
+    caterva_array_t *array;
+    //!< The array opened once, whose members are copied by the handles.
+    int64_t nhandles;
+    //!< Number of handles still referencing the array.
+    caterva_shared_t *next;
+};
+
+int caterva_shared_open(caterva_ctx_t *ctx, const char *urlpath, caterva_array_t **array);
+
+int caterva_shared_release(caterva_shared_t **shared);
+
+#endif  // CATERVA_CATERVA_SHARED_H_
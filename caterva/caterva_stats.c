@@ -0,0 +1,404 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "caterva_stats.h"
+
+#include <float.h>
+#include <math.h>
+
+/*
+ * An index with the minimum, the maximum and the number of NaNs of every chunk and every block of
+ * an array. The statistics are computed from the chunks in their blocked order (right before they
+ * are compressed), skipping the padding.
+ *
+ * The index is serialized in a variable-length metalayer, because its size depends on the number
+ * of chunks, as an array with 5 entries (version, dtype, nchunks, nblocks, records). The records
+ * are stored in a bin entry, as 4 big-endian 8-byte values (min, max, nnan, nitems) each.
+ */
+
+#define CATERVA_STATS_RECORD_SIZE 32
+
+int caterva_stats_dtype_size(caterva_dtype_t dtype) {
+    switch (dtype) {
+        case CATERVA_DTYPE_INT8:
+        case CATERVA_DTYPE_UINT8:
+            return 1;
+        case CATERVA_DTYPE_INT16:
+        case CATERVA_DTYPE_UINT16:
+            return 2;
+        case CATERVA_DTYPE_INT32:
+        case CATERVA_DTYPE_UINT32:
+        case CATERVA_DTYPE_FLOAT32:
+            return 4;
+        case CATERVA_DTYPE_INT64:
+        case CATERVA_DTYPE_UINT64:
+        case CATERVA_DTYPE_FLOAT64:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+static void caterva_stats_reset(caterva_stats_t *stats) {
+    stats->min = INFINITY;
+    stats->max = -INFINITY;
+    stats->nnan = 0;
+    stats->nitems = 0;
+}
+
+static void caterva_stats_merge(caterva_stats_t *dest, const caterva_stats_t *src) {
+    dest->min = src->min < dest->min ? src->min : dest->min;
+    dest->max = src->max > dest->max ? src->max : dest->max;
+    dest->nnan += src->nnan;
+    dest->nitems += src->nitems;
+}
+
+int caterva_stats_new(caterva_ctx_t *ctx, caterva_dtype_t dtype, int64_t nchunks, int nblocks,
+                      caterva_stats_index_t **index) {
+    caterva_stats_index_t *index_ = ctx->cfg->alloc(sizeof(caterva_stats_index_t));
+    CATERVA_ERROR_NULL(index_);
+    index_->dtype = dtype;
+    index_->nchunks = nchunks;
+    index_->nblocks = nblocks;
+    index_->dirty = true;
+    int64_t nrecords = nchunks * (1 + nblocks);
+    index_->records = ctx->cfg->alloc((size_t) (nrecords > 0 ? nrecords : 1) *
+                                      sizeof(caterva_stats_t));
+    if (index_->records == NULL) {
+        ctx->cfg->free(index_);
+        CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+    }
+    // Chunks not written yet do not have any item
+    for (int64_t i = 0; i < nrecords; ++i) {
+        caterva_stats_reset(&index_->records[i]);
+    }
+
+    *index = index_;
+    return CATERVA_SUCCEED;
+}
+
+int caterva_stats_free(caterva_ctx_t *ctx, caterva_stats_index_t **index) {
+    if (*index == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    ctx->cfg->free((*index)->records);
+    ctx->cfg->free(*index);
+    *index = NULL;
+
+    return CATERVA_SUCCEED;
+}
+
+// The statistics of the chunk `nchunk`, followed by the ones of its blocks
+caterva_stats_t *caterva_stats_chunk(caterva_stats_index_t *index, int64_t nchunk) {
+    return &index->records[nchunk * (1 + index->nblocks)];
+}
+
+// Get the shape of the chunk `nchunk` inside the array (i.e. without padding)
+static void caterva_stats_chunk_shape(caterva_array_t *array, int64_t nchunk, int64_t *shape) {
+    for (int i = array->ndim - 1; i >= 0; --i) {
+        int64_t nchunks = array->extshape[i] / array->chunkshape[i];
+        int64_t start = (nchunk % nchunks) * array->chunkshape[i];
+        nchunk /= nchunks;
+        shape[i] = array->chunkshape[i];
+        if (start + shape[i] > array->shape[i]) {
+            shape[i] = array->shape[i] - start;
+        }
+    }
+}
+
+// Get the shape of the part of the block `nblock` inside a chunk of shape `chunkshape`, and
+// return its number of items
+static int64_t caterva_stats_block_shape(caterva_array_t *array, const int64_t *chunkshape,
+                                         int64_t nblock, int64_t *shape) {
+    int64_t nitems = 1;
+    for (int i = array->ndim - 1; i >= 0; --i) {
+        int64_t nblocks = array->extchunkshape[i] / array->blockshape[i];
+        int64_t start = (nblock % nblocks) * array->blockshape[i];
+        nblock /= nblocks;
+        shape[i] = array->blockshape[i];
+        if (start + shape[i] > chunkshape[i]) {
+            shape[i] = chunkshape[i] > start ? chunkshape[i] - start : 0;
+        }
+        nitems *= shape[i];
+    }
+    return nitems;
+}
+
+#define CATERVA_STATS_SCAN(type, items, n, stats)           \
+    do {                                                    \
+        const type *items_ = (const type *) (items);        \
+        double min_ = (stats)->min;                         \
+        double max_ = (stats)->max;                         \
+        int64_t nnan_ = 0;                                  \
+        for (int64_t i_ = 0; i_ < (n); ++i_) {              \
+            double value_ = (double) items_[i_];            \
+            if (value_ != value_) {                         \
+                nnan_++;                                    \
+            } else {                                        \
+                min_ = value_ < min_ ? value_ : min_;       \
+                max_ = value_ > max_ ? value_ : max_;       \
+            }                                               \
+        }                                                   \
+        (stats)->min = min_;                                \
+        (stats)->max = max_;                                \
+        (stats)->nnan += nnan_;                             \
+        (stats)->nitems += (n);                             \
+    } while (0)
+
+// Summarize `n` contiguous items into `stats`
+static void caterva_stats_scan(caterva_dtype_t dtype, const uint8_t *items, int64_t n,
+                               caterva_stats_t *stats) {
+    switch (dtype) {
+        case CATERVA_DTYPE_INT8:
+            CATERVA_STATS_SCAN(int8_t, items, n, stats);
+            break;
+        case CATERVA_DTYPE_INT16:
+            CATERVA_STATS_SCAN(int16_t, items, n, stats);
+            break;
+        case CATERVA_DTYPE_INT32:
+            CATERVA_STATS_SCAN(int32_t, items, n, stats);
+            break;
+        case CATERVA_DTYPE_INT64:
+            CATERVA_STATS_SCAN(int64_t, items, n, stats);
+            break;
+        case CATERVA_DTYPE_UINT8:
+            CATERVA_STATS_SCAN(uint8_t, items, n, stats);
+            break;
+        case CATERVA_DTYPE_UINT16:
+            CATERVA_STATS_SCAN(uint16_t, items, n, stats);
+            break;
+        case CATERVA_DTYPE_UINT32:
+            CATERVA_STATS_SCAN(uint32_t, items, n, stats);
+            break;
+        case CATERVA_DTYPE_UINT64:
+            CATERVA_STATS_SCAN(uint64_t, items, n, stats);
+            break;
+        case CATERVA_DTYPE_FLOAT32:
+            CATERVA_STATS_SCAN(float, items, n, stats);
+            break;
+        case CATERVA_DTYPE_FLOAT64:
+            CATERVA_STATS_SCAN(double, items, n, stats);
+            break;
+        default:
+            break;
+    }
+}
+
+// 64-bit integers above 2^53 are rounded when converted to double, so their bounds are widened
+// to keep them conservative
+static void caterva_stats_widen(caterva_dtype_t dtype, caterva_stats_t *stats) {
+    if (dtype != CATERVA_DTYPE_INT64 && dtype != CATERVA_DTYPE_UINT64) {
+        return;
+    }
+    if (stats->min < -9007199254740992. || stats->min > 9007199254740992.) {
+        stats->min -= (stats->min < 0 ? -stats->min : stats->min) * DBL_EPSILON;
+    }
+    if (stats->max < -9007199254740992. || stats->max > 9007199254740992.) {
+        stats->max += (stats->max < 0 ? -stats->max : stats->max) * DBL_EPSILON;
+    }
+}
+
+// Compute the statistics of the chunk `nchunk` (and its blocks) from its blocked items in `chunk`
+void caterva_stats_update(caterva_stats_index_t *index, caterva_array_t *array, int64_t nchunk,
+                          const uint8_t *chunk) {
+    int8_t ndim = array->ndim;
+    int64_t chunkshape[CATERVA_MAX_DIM];
+    caterva_stats_chunk_shape(array, nchunk, chunkshape);
+
+    int64_t strides[CATERVA_MAX_DIM];
+    int64_t stride = 1;
+    for (int i = ndim - 1; i >= 0; --i) {
+        strides[i] = stride;
+        stride *= array->blockshape[i];
+    }
+
+    caterva_stats_t *chunkstats = caterva_stats_chunk(index, nchunk);
+    caterva_stats_t *blockstats = chunkstats + 1;
+    caterva_stats_reset(chunkstats);
+    for (int nblock = 0; nblock < index->nblocks; ++nblock) {
+        caterva_stats_reset(&blockstats[nblock]);
+        int64_t shape[CATERVA_MAX_DIM];
+        int64_t nitems = caterva_stats_block_shape(array, chunkshape, nblock, shape);
+        if (nitems == 0) {
+            continue;
+        }
+
+        // Scan the rows (along the last dimension) of the part of the block inside the array
+        const uint8_t *block = chunk + (int64_t) nblock * array->blocknitems * array->itemsize;
+        int64_t rowlen = ndim > 0 ? shape[ndim - 1] : 1;
+        int64_t nrows = nitems / rowlen;
+        for (int64_t row = 0; row < nrows; ++row) {
+            int64_t offset = 0;
+            int64_t r = row;
+            for (int i = ndim - 2; i >= 0; --i) {
+                offset += (r % shape[i]) * strides[i];
+                r /= shape[i];
+            }
+            caterva_stats_scan(index->dtype, block + offset * array->itemsize, rowlen,
+                               &blockstats[nblock]);
+        }
+        caterva_stats_widen(index->dtype, &blockstats[nblock]);
+        caterva_stats_merge(chunkstats, &blockstats[nblock]);
+    }
+}
+
+// Set the statistics of the chunk `nchunk` when all its items are equal to `value`
+void caterva_stats_update_constant(caterva_stats_index_t *index, caterva_array_t *array,
+                                   int64_t nchunk, double value) {
+    int64_t chunkshape[CATERVA_MAX_DIM];
+    caterva_stats_chunk_shape(array, nchunk, chunkshape);
+
+    caterva_stats_t *chunkstats = caterva_stats_chunk(index, nchunk);
+    caterva_stats_t *blockstats = chunkstats + 1;
+    caterva_stats_reset(chunkstats);
+    for (int nblock = 0; nblock < index->nblocks; ++nblock) {
+        caterva_stats_reset(&blockstats[nblock]);
+        int64_t shape[CATERVA_MAX_DIM];
+        int64_t nitems = caterva_stats_block_shape(array, chunkshape, nblock, shape);
+        if (nitems == 0) {
+            continue;
+        }
+        blockstats[nblock].nitems = nitems;
+        if (value != value) {
+            blockstats[nblock].nnan = nitems;
+        } else {
+            blockstats[nblock].min = value;
+            blockstats[nblock].max = value;
+        }
+        caterva_stats_merge(chunkstats, &blockstats[nblock]);
+    }
+}
+
+// The value of the single item `item` as it is summarized (0 if `item` is NULL)
+double caterva_stats_item_value(caterva_dtype_t dtype, const uint8_t *item) {
+    if (item == NULL) {
+        return 0;
+    }
+    caterva_stats_t stats;
+    caterva_stats_reset(&stats);
+    caterva_stats_scan(dtype, item, 1, &stats);
+    return stats.nnan > 0 ? NAN : stats.min;
+}
+
+// Whether the items summarized by `stats` may have some value in the range of `filter`
+bool caterva_stats_match(const caterva_stats_t *stats, const caterva_filter_t *filter) {
+    return stats->nitems > stats->nnan && stats->max >= filter->low &&
+           stats->min <= filter->high;
+}
+
+static void caterva_stats_store64(uint8_t *dest, uint64_t value) {
+    for (int i = 7; i >= 0; --i) {
+        dest[i] = (uint8_t) (value & 0xff);
+        value >>= 8;
+    }
+}
+
+static uint64_t caterva_stats_load64(const uint8_t *src) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = (value << 8) | src[i];
+    }
+    return value;
+}
+
+static void caterva_stats_store_double(uint8_t *dest, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    caterva_stats_store64(dest, bits);
+}
+
+static double caterva_stats_load_double(const uint8_t *src) {
+    uint64_t bits = caterva_stats_load64(src);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+int caterva_stats_serialize(caterva_stats_index_t *index, uint8_t **content, int32_t *len) {
+    int64_t nrecords = index->nchunks * (1 + index->nblocks);
+    int64_t len_ = 1 + 1 + 1 + (1 + 8) + (1 + 4) + (1 + 4) + nrecords * CATERVA_STATS_RECORD_SIZE;
+    if (len_ > INT32_MAX) {
+        DEBUG_PRINT("The index is too large to be stored in a metalayer");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    *content = malloc((size_t) len_);
+    CATERVA_ERROR_NULL(*content);
+    uint8_t *p = *content;
+
+    // An array with 5 entries (version, dtype, nchunks, nblocks, records)
+    *p++ = 0x90 + 5;
+    *p++ = CATERVA_STATS_VERSION;  // positive fixnum
+    *p++ = (uint8_t) index->dtype;  // positive fixnum
+    *p++ = 0xd3;  // int64
+    caterva_stats_store64(p, (uint64_t) index->nchunks);
+    p += 8;
+    *p++ = 0xd2;  // int32
+    uint32_t nblocks = (uint32_t) index->nblocks;
+    for (int i = 3; i >= 0; --i) {
+        p[i] = (uint8_t) (nblocks & 0xff);
+        nblocks >>= 8;
+    }
+    p += 4;
+    *p++ = 0xc6;  // bin32
+    uint32_t binlen = (uint32_t) (nrecords * CATERVA_STATS_RECORD_SIZE);
+    for (int i = 3; i >= 0; --i) {
+        p[i] = (uint8_t) (binlen & 0xff);
+        binlen >>= 8;
+    }
+    p += 4;
+    for (int64_t i = 0; i < nrecords; ++i) {
+        caterva_stats_t *stats = &index->records[i];
+        caterva_stats_store_double(p, stats->min);
+        caterva_stats_store_double(p + 8, stats->max);
+        caterva_stats_store64(p + 16, (uint64_t) stats->nnan);
+        caterva_stats_store64(p + 24, (uint64_t) stats->nitems);
+        p += CATERVA_STATS_RECORD_SIZE;
+    }
+
+    *len = (int32_t) (p - *content);
+    return CATERVA_SUCCEED;
+}
+
+int caterva_stats_deserialize(caterva_ctx_t *ctx, const uint8_t *content, int32_t len,
+                              caterva_stats_index_t **index) {
+    const uint8_t *p = content;
+    if (len < 1 + 1 + 1 + (1 + 8) + (1 + 4) + (1 + 4) || p[0] != 0x90 + 5 ||
+        p[1] > CATERVA_STATS_VERSION || p[3] != 0xd3 || p[12] != 0xd2 || p[17] != 0xc6) {
+        DEBUG_PRINT("The statistics metalayer is corrupted");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    caterva_dtype_t dtype = (caterva_dtype_t) p[2];
+    int64_t nchunks = (int64_t) caterva_stats_load64(&p[4]);
+    int32_t nblocks = (int32_t) (((uint32_t) p[13] << 24) | ((uint32_t) p[14] << 16) |
+                                 ((uint32_t) p[15] << 8) | p[16]);
+    int64_t binlen = (int64_t) (((uint32_t) p[18] << 24) | ((uint32_t) p[19] << 16) |
+                                ((uint32_t) p[20] << 8) | p[21]);
+    p += 22;
+    int64_t nrecords = nchunks * (1 + nblocks);
+    if (nchunks < 0 || nblocks < 0 || binlen != nrecords * CATERVA_STATS_RECORD_SIZE ||
+        binlen > len - (p - content)) {
+        DEBUG_PRINT("The statistics metalayer is corrupted");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    CATERVA_ERROR(caterva_stats_new(ctx, dtype, nchunks, nblocks, index));
+    for (int64_t i = 0; i < nrecords; ++i) {
+        caterva_stats_t *stats = &(*index)->records[i];
+        stats->min = caterva_stats_load_double(p);
+        stats->max = caterva_stats_load_double(p + 8);
+        stats->nnan = (int64_t) caterva_stats_load64(p + 16);
+        stats->nitems = (int64_t) caterva_stats_load64(p + 24);
+        p += CATERVA_STATS_RECORD_SIZE;
+    }
+    (*index)->dirty = false;
+
+    return CATERVA_SUCCEED;
+}
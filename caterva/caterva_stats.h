@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef CATERVA_CATERVA_STATS_H_
+#define CATERVA_CATERVA_STATS_H_
+
+#include <caterva.h>
+
+/* The name of the variable-length metalayer where the index is stored */
+#define CATERVA_STATS_METALAYER "caterva_stats"
+
+/* The version for the index format; starts from 0 and it must not exceed 127 */
+#define CATERVA_STATS_VERSION 0
+
+struct caterva_stats_index_s {
+    caterva_dtype_t dtype;
+    int64_t nchunks;
+    int nblocks;
+    caterva_stats_t *records;
+    //!< For every chunk, the statistics of the chunk followed by the ones of its blocks.
+    bool dirty;
+    //!< Indicate if the records have changed since they were stored in the metalayer.
+};
+
+int caterva_stats_dtype_size(caterva_dtype_t dtype);
+
+int caterva_stats_new(caterva_ctx_t *ctx, caterva_dtype_t dtype, int64_t nchunks, int nblocks,
+                      caterva_stats_index_t **index);
+
+int caterva_stats_free(caterva_ctx_t *ctx, caterva_stats_index_t **index);
+
+caterva_stats_t *caterva_stats_chunk(caterva_stats_index_t *index, int64_t nchunk);
+
+void caterva_stats_update(caterva_stats_index_t *index, caterva_array_t *array, int64_t nchunk,
+                          const uint8_t *chunk);
+
+void caterva_stats_update_constant(caterva_stats_index_t *index, caterva_array_t *array,
+                                   int64_t nchunk, double value);
+
+double caterva_stats_item_value(caterva_dtype_t dtype, const uint8_t *item);
+
+bool caterva_stats_match(const caterva_stats_t *stats, const caterva_filter_t *filter);
+
+int caterva_stats_serialize(caterva_stats_index_t *index, uint8_t **content, int32_t *len);
+
+int caterva_stats_deserialize(caterva_ctx_t *ctx, const uint8_t *content, int32_t len,
+                              caterva_stats_index_t **index);
+
+#endif  // CATERVA_CATERVA_STATS_H_
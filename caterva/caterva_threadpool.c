@@ -0,0 +1,531 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "caterva_threadpool.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#include <stdio.h>
+#endif
+
+/*
+ * A pool of workers shared by several contexts. Every worker has its own queue, protected by its
+ * own mutex. Tasks are queued in turn to the workers of the NUMA node of the submitting thread
+ * (or to all of them, if there is none), and a worker with an empty queue takes the most recent
+ * task of another queue, trying the workers of its node first. Workers run their own queue in
+ * order, so the tasks submitted earlier are not delayed by the later ones.
+ *
+ * Tasks are submitted in groups (one per parallel region), and the submitter waits for its
+ * group. Tasks must not wait for tasks of the same pool, so nested regions are run by their own
+ * threads (see caterva_threads_fork).
+ *
+ * The NUMA topology is only known on Linux, where it is read from sysfs; elsewhere, there is a
+ * single node and the workers are not pinned.
+ */
+
+/* The number of CPUs whose NUMA node is kept */
+#define CATERVA_THREADPOOL_MAXCPUS 1024
+
+typedef struct {
+    void *(*fn)(void *);
+    void *arg;
+    caterva_threadpool_group_t *group;
+} caterva_threadpool_task_t;
+
+struct caterva_threadpool_group_s {
+    int64_t npending;
+    //!< Number of tasks of the group that have not finished yet.
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+};
+
+typedef struct {
+    caterva_threadpool_t *pool;
+    pthread_t thread;
+    int cpu;
+    //!< The CPU where the worker is pinned (or -1).
+    int node;
+    //!< The NUMA node of the CPU (or -1 if the worker is not pinned).
+    caterva_threadpool_task_t *tasks;
+    //!< The queued tasks, stored as a ring of @p capacity tasks.
+    int64_t capacity;
+    int64_t head;
+    int64_t count;
+    pthread_mutex_t mutex;
+} caterva_threadpool_worker_t;
+
+struct caterva_threadpool_s {
+    int nthreads;
+    //!< Number of workers.
+    int nstarted;
+    //!< Number of workers whose thread is running.
+    caterva_threadpool_worker_t *workers;
+    int nnodes;
+    int *node_workers;
+    //!< The indexes of the pinned workers, grouped by NUMA node.
+    int node_first[CATERVA_THREADPOOL_MAXNODES];
+    int node_nworkers[CATERVA_THREADPOOL_MAXNODES];
+    //!< The range of @p node_workers of every NUMA node.
+    int64_t next;
+    //!< The cursor used to queue the tasks in turn.
+    bool stop;
+    caterva_threadpool_stats_t stats;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    //!< Signalled when tasks are queued or the pool is stopped.
+};
+
+#if defined(__linux__)
+static int caterva_threadpool_cpu_node[CATERVA_THREADPOOL_MAXCPUS];
+static int caterva_threadpool_nnodes = 1;
+static pthread_once_t caterva_threadpool_once = PTHREAD_ONCE_INIT;
+
+// Read the NUMA node of every CPU from sysfs
+static void caterva_threadpool_topology(void) {
+    for (int node = 0;; ++node) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE *file = fopen(path, "r");
+        if (file == NULL) {
+            break;
+        }
+        // The list is made of ranges (e.g. 0-7,16-23)
+        int first;
+        while (fscanf(file, "%d", &first) == 1) {
+            int last = first;
+            int c = fgetc(file);
+            if (c == '-') {
+                if (fscanf(file, "%d", &last) != 1) {
+                    break;
+                }
+                c = fgetc(file);
+            }
+            for (int cpu = first; cpu <= last && cpu < CATERVA_THREADPOOL_MAXCPUS; ++cpu) {
+                caterva_threadpool_cpu_node[cpu] = node % CATERVA_THREADPOOL_MAXNODES;
+            }
+            if (c != ',') {
+                break;
+            }
+        }
+        fclose(file);
+        if (node + 1 <= CATERVA_THREADPOOL_MAXNODES) {
+            caterva_threadpool_nnodes = node + 1;
+        }
+    }
+}
+
+static int caterva_threadpool_cpu_to_node(int cpu) {
+    pthread_once(&caterva_threadpool_once, caterva_threadpool_topology);
+    if (cpu < 0 || cpu >= CATERVA_THREADPOOL_MAXCPUS) {
+        return 0;
+    }
+    return caterva_threadpool_cpu_node[cpu];
+}
+#endif
+
+/*
+ * Get the NUMA node where the calling thread is running (0 if it is unknown).
+ */
+int caterva_threadpool_node(void) {
+#if defined(__linux__)
+    return caterva_threadpool_cpu_to_node(sched_getcpu());
+#else
+    return 0;
+#endif
+}
+
+// Get the CPUs where the workers are pinned, in the order given by the affinity
+static int caterva_threadpool_placement(caterva_threadpool_params_t *params, int *cpus) {
+    int ncpus = 0;
+#if defined(__linux__)
+    if (params->affinity == CATERVA_AFFINITY_LIST) {
+        for (int i = 0; i < params->ncpus && i < CATERVA_THREADPOOL_MAXCPUS; ++i) {
+            cpus[ncpus++] = params->cpus[i];
+        }
+        return ncpus;
+    }
+    cpu_set_t allowed;
+    if (params->affinity == CATERVA_AFFINITY_NONE ||
+        sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return 0;
+    }
+    pthread_once(&caterva_threadpool_once, caterva_threadpool_topology);
+    int nnodes = caterva_threadpool_nnodes;
+    if (params->affinity == CATERVA_AFFINITY_COMPACT) {
+        for (int node = 0; node < nnodes; ++node) {
+            for (int cpu = 0; cpu < CATERVA_THREADPOOL_MAXCPUS && cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &allowed) && caterva_threadpool_cpu_node[cpu] == node) {
+                    cpus[ncpus++] = cpu;
+                }
+            }
+        }
+    } else {
+        // Take the next CPU of every node in turn
+        int start[CATERVA_THREADPOOL_MAXNODES] = {0};
+        bool found = true;
+        while (found) {
+            found = false;
+            for (int node = 0; node < nnodes; ++node) {
+                int cpu = start[node];
+                while (cpu < CATERVA_THREADPOOL_MAXCPUS && cpu < CPU_SETSIZE &&
+                       !(CPU_ISSET(cpu, &allowed) && caterva_threadpool_cpu_node[cpu] == node)) {
+                    cpu++;
+                }
+                if (cpu < CATERVA_THREADPOOL_MAXCPUS && cpu < CPU_SETSIZE) {
+                    cpus[ncpus++] = cpu;
+                    start[node] = cpu + 1;
+                    found = true;
+                } else {
+                    start[node] = cpu;
+                }
+            }
+        }
+    }
+#else
+    CATERVA_UNUSED_PARAM(params);
+    CATERVA_UNUSED_PARAM(cpus);
+#endif
+    return ncpus;
+}
+
+// Take a task of the queue of `victim` (the oldest one if it is `worker`, the newest otherwise)
+static bool caterva_threadpool_pop(caterva_threadpool_worker_t *worker,
+                                   caterva_threadpool_worker_t *victim,
+                                   caterva_threadpool_task_t *task) {
+    bool found = false;
+    pthread_mutex_lock(&victim->mutex);
+    if (victim->count > 0) {
+        if (victim == worker) {
+            *task = victim->tasks[victim->head];
+            victim->head = (victim->head + 1) % victim->capacity;
+        } else {
+            *task = victim->tasks[(victim->head + victim->count - 1) % victim->capacity];
+        }
+        victim->count--;
+        found = true;
+    }
+    pthread_mutex_unlock(&victim->mutex);
+    return found;
+}
+
+static bool caterva_threadpool_take(caterva_threadpool_worker_t *worker,
+                                    caterva_threadpool_task_t *task, bool *stolen) {
+    caterva_threadpool_t *pool = worker->pool;
+    *stolen = false;
+    if (caterva_threadpool_pop(worker, worker, task)) {
+        return true;
+    }
+    int index = (int) (worker - pool->workers);
+    // The workers of the same node first, then the others
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 1; i < pool->nthreads; ++i) {
+            caterva_threadpool_worker_t *victim = &pool->workers[(index + i) % pool->nthreads];
+            if ((victim->node == worker->node) != (pass == 0)) {
+                continue;
+            }
+            if (caterva_threadpool_pop(worker, victim, task)) {
+                *stolen = true;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void caterva_threadpool_done(caterva_threadpool_group_t *group) {
+    pthread_mutex_lock(&group->mutex);
+    if (--group->npending == 0) {
+        pthread_cond_broadcast(&group->cond);
+    }
+    pthread_mutex_unlock(&group->mutex);
+}
+
+static void *caterva_threadpool_worker(void *arg) {
+    caterva_threadpool_worker_t *worker = (caterva_threadpool_worker_t *) arg;
+    caterva_threadpool_t *pool = worker->pool;
+
+#if defined(__linux__)
+    // Pinned before running anything, so the memory it touches first is allocated on its node
+    if (worker->cpu >= 0 && worker->cpu < CPU_SETSIZE) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(worker->cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            DEBUG_PRINT("The worker can not be pinned");
+        }
+    }
+#endif
+
+    while (true) {
+        caterva_threadpool_task_t task;
+        bool stolen;
+        if (!caterva_threadpool_take(worker, &task, &stolen)) {
+            pthread_mutex_lock(&pool->mutex);
+            while (!pool->stop && pool->stats.queued == 0) {
+                pthread_cond_wait(&pool->cond, &pool->mutex);
+            }
+            bool stop = pool->stop && pool->stats.queued == 0;
+            pthread_mutex_unlock(&pool->mutex);
+            if (stop) {
+                break;
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->stats.queued--;
+        pool->stats.running++;
+        if (stolen) {
+            pool->stats.nsteals++;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+
+        task.fn(task.arg);
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->stats.running--;
+        pool->stats.ntasks++;
+        pthread_mutex_unlock(&pool->mutex);
+        caterva_threadpool_done(task.group);
+    }
+
+    return NULL;
+}
+
+static int caterva_threadpool_push(caterva_threadpool_worker_t *worker,
+                                   caterva_threadpool_task_t *task) {
+    pthread_mutex_lock(&worker->mutex);
+    if (worker->count == worker->capacity) {
+        int64_t capacity = worker->capacity > 0 ? 2 * worker->capacity : 16;
+        caterva_threadpool_task_t *tasks = malloc((size_t) capacity *
+                                                  sizeof(caterva_threadpool_task_t));
+        if (tasks == NULL) {
+            pthread_mutex_unlock(&worker->mutex);
+            CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+        }
+        for (int64_t i = 0; i < worker->count; ++i) {
+            tasks[i] = worker->tasks[(worker->head + i) % worker->capacity];
+        }
+        free(worker->tasks);
+        worker->tasks = tasks;
+        worker->capacity = capacity;
+        worker->head = 0;
+    }
+    worker->tasks[(worker->head + worker->count) % worker->capacity] = *task;
+    worker->count++;
+    pthread_mutex_unlock(&worker->mutex);
+
+    return CATERVA_SUCCEED;
+}
+
+/*
+ * Run `fn(arg)` in `ntasks` tasks of the pool. The caller must wait for them with
+ * caterva_threadpool_wait, even if an error is returned (some tasks may be queued).
+ */
+int caterva_threadpool_submit(caterva_threadpool_t *pool, int ntasks, void *(*fn)(void *),
+                              void *arg, caterva_threadpool_group_t **group) {
+    *group = NULL;
+    caterva_threadpool_group_t *group_ = malloc(sizeof(caterva_threadpool_group_t));
+    CATERVA_ERROR_NULL(group_);
+    group_->npending = ntasks;
+    pthread_mutex_init(&group_->mutex, NULL);
+    pthread_cond_init(&group_->cond, NULL);
+    *group = group_;
+
+    // The tasks are queued to the workers of the node of the caller, if any
+    int node = caterva_threadpool_node();
+    int nworkers = pool->node_nworkers[node];
+    int *workers = pool->node_workers + pool->node_first[node];
+
+    pthread_mutex_lock(&pool->mutex);
+    int64_t next = pool->next;
+    pool->next += ntasks;
+    pthread_mutex_unlock(&pool->mutex);
+
+    caterva_threadpool_task_t task = {fn, arg, group_};
+    int nqueued = 0;
+    int rc = CATERVA_SUCCEED;
+    for (; nqueued < ntasks; ++nqueued) {
+        int index = nworkers > 0 ? workers[(next + nqueued) % nworkers] :
+                    (int) ((next + nqueued) % pool->nthreads);
+        rc = caterva_threadpool_push(&pool->workers[index], &task);
+        if (rc != CATERVA_SUCCEED) {
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->stats.queued += nqueued;
+    if (pool->stats.queued > pool->stats.maxqueued) {
+        pool->stats.maxqueued = pool->stats.queued;
+    }
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    // The tasks that could not be queued are done
+    for (int i = nqueued; i < ntasks; ++i) {
+        caterva_threadpool_done(group_);
+    }
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_threadpool_wait(caterva_threadpool_group_t **group) {
+    caterva_threadpool_group_t *group_ = *group;
+    pthread_mutex_lock(&group_->mutex);
+    while (group_->npending > 0) {
+        pthread_cond_wait(&group_->cond, &group_->mutex);
+    }
+    pthread_mutex_unlock(&group_->mutex);
+    pthread_mutex_destroy(&group_->mutex);
+    pthread_cond_destroy(&group_->cond);
+    free(group_);
+    *group = NULL;
+
+    return CATERVA_SUCCEED;
+}
+
+/*
+ * Tell whether the calling thread is a worker of `pool`.
+ */
+bool caterva_threadpool_is_worker(caterva_threadpool_t *pool) {
+    pthread_t self = pthread_self();
+    for (int i = 0; i < pool->nstarted; ++i) {
+        if (pthread_equal(pool->workers[i].thread, self)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int caterva_threadpool_new(caterva_threadpool_params_t *params, caterva_threadpool_t **pool) {
+    CATERVA_ERROR_NULL(params);
+    CATERVA_ERROR_NULL(pool);
+    if (params->nthreads <= 0 || (params->affinity == CATERVA_AFFINITY_LIST &&
+                                  (params->cpus == NULL || params->ncpus <= 0))) {
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    caterva_threadpool_t *pool_ = calloc(1, sizeof(caterva_threadpool_t));
+    CATERVA_ERROR_NULL(pool_);
+    pool_->nthreads = params->nthreads;
+    pool_->workers = calloc((size_t) params->nthreads, sizeof(caterva_threadpool_worker_t));
+    pool_->node_workers = malloc((size_t) params->nthreads * sizeof(int));
+    int *cpus = malloc(CATERVA_THREADPOOL_MAXCPUS * sizeof(int));
+    if (pool_->workers == NULL || pool_->node_workers == NULL || cpus == NULL) {
+        free(cpus);
+        free(pool_->node_workers);
+        free(pool_->workers);
+        free(pool_);
+        CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+    }
+    pthread_mutex_init(&pool_->mutex, NULL);
+    pthread_cond_init(&pool_->cond, NULL);
+
+    // Place the workers and group the pinned ones by node
+    int ncpus = caterva_threadpool_placement(params, cpus);
+    for (int i = 0; i < pool_->nthreads; ++i) {
+        caterva_threadpool_worker_t *worker = &pool_->workers[i];
+        worker->pool = pool_;
+        worker->cpu = ncpus > 0 ? cpus[i % ncpus] : -1;
+        worker->node = -1;
+#if defined(__linux__)
+        if (worker->cpu >= 0) {
+            worker->node = caterva_threadpool_cpu_to_node(worker->cpu);
+        }
+#endif
+        if (worker->node >= 0) {
+            pool_->node_nworkers[worker->node]++;
+        }
+        pthread_mutex_init(&worker->mutex, NULL);
+    }
+    free(cpus);
+    int first = 0;
+    for (int node = 0; node < CATERVA_THREADPOOL_MAXNODES; ++node) {
+        pool_->node_first[node] = first;
+        first += pool_->node_nworkers[node];
+        pool_->nnodes += pool_->node_nworkers[node] > 0;
+        pool_->node_nworkers[node] = 0;
+    }
+    for (int i = 0; i < pool_->nthreads; ++i) {
+        int node = pool_->workers[i].node;
+        if (node >= 0) {
+            pool_->node_workers[pool_->node_first[node] + pool_->node_nworkers[node]++] = i;
+        }
+    }
+    if (pool_->nnodes == 0) {
+        pool_->nnodes = 1;
+    }
+    pool_->stats.nthreads = pool_->nthreads;
+    pool_->stats.nnodes = pool_->nnodes;
+
+    *pool = pool_;
+    for (int i = 0; i < pool_->nthreads; ++i) {
+        if (pthread_create(&pool_->workers[i].thread, NULL, caterva_threadpool_worker,
+                           &pool_->workers[i]) != 0) {
+            DEBUG_PRINT("Error creating the worker threads");
+            caterva_threadpool_free(pool);
+            CATERVA_ERROR(CATERVA_ERR_THREADS_FAILED);
+        }
+        pool_->nstarted++;
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_threadpool_free(caterva_threadpool_t **pool) {
+    CATERVA_ERROR_NULL(pool);
+    caterva_threadpool_t *pool_ = *pool;
+    if (pool_ == NULL) {
+        return CATERVA_SUCCEED;
+    }
+
+    pthread_mutex_lock(&pool_->mutex);
+    pool_->stop = true;
+    pthread_cond_broadcast(&pool_->cond);
+    pthread_mutex_unlock(&pool_->mutex);
+    int rc = CATERVA_SUCCEED;
+    for (int i = 0; i < pool_->nstarted; ++i) {
+        if (pthread_join(pool_->workers[i].thread, NULL) != 0) {
+            rc = CATERVA_ERR_THREADS_FAILED;
+        }
+    }
+
+    for (int i = 0; i < pool_->nthreads; ++i) {
+        pthread_mutex_destroy(&pool_->workers[i].mutex);
+        free(pool_->workers[i].tasks);
+    }
+    pthread_mutex_destroy(&pool_->mutex);
+    pthread_cond_destroy(&pool_->cond);
+    free(pool_->node_workers);
+    free(pool_->workers);
+    free(pool_);
+    *pool = NULL;
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_threadpool_get_stats(caterva_threadpool_t *pool, caterva_threadpool_stats_t *stats) {
+    CATERVA_ERROR_NULL(pool);
+    CATERVA_ERROR_NULL(stats);
+
+    pthread_mutex_lock(&pool->mutex);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->mutex);
+
+    return CATERVA_SUCCEED;
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef CATERVA_CATERVA_THREADPOOL_H_
+#define CATERVA_CATERVA_THREADPOOL_H_
+
+#include <caterva.h>
+
+#include "caterva_threads.h"
+
+/* The maximum number of NUMA nodes told apart (the others are folded onto them) */
+#define CATERVA_THREADPOOL_MAXNODES 8
+
+typedef struct caterva_threadpool_group_s caterva_threadpool_group_t;
+
+int caterva_threadpool_submit(caterva_threadpool_t *pool, int ntasks, void *(*fn)(void *),
+                              void *arg, caterva_threadpool_group_t **group);
+
+int caterva_threadpool_wait(caterva_threadpool_group_t **group);
+
+bool caterva_threadpool_is_worker(caterva_threadpool_t *pool);
+
+int caterva_threadpool_node(void);
+
+#endif  // CATERVA_CATERVA_THREADPOOL_H_
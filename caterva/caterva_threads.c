@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "caterva_threads.h"
+
+#include "caterva_threadpool.h"
+
+int caterva_threads_start(caterva_ctx_t *ctx, int nthreads, void *(*worker)(void *),
+                          void *arg, pthread_t **threads, int *nstarted) {
+    *nstarted = 0;
+    *threads = ctx->cfg->alloc(nthreads * sizeof(pthread_t));
+    CATERVA_ERROR_NULL(*threads);
+
+    // On failure, the threads already started keep running and must be joined by the caller
+    for (int i = 0; i < nthreads; ++i) {
+        if (pthread_create(&(*threads)[i], NULL, worker, arg) != 0) {
+            DEBUG_PRINT("Error creating the worker threads");
+            return CATERVA_ERR_THREADS_FAILED;
+        }
+        (*nstarted)++;
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_threads_join(caterva_ctx_t *ctx, int nthreads, pthread_t *threads) {
+    int rc = CATERVA_SUCCEED;
+    for (int i = 0; i < nthreads; ++i) {
+        if (pthread_join(threads[i], NULL) != 0) {
+            rc = CATERVA_ERR_THREADS_FAILED;
+        }
+    }
+    ctx->cfg->free(threads);
+
+    return rc;
+}
+
+struct caterva_threads_s {
+    caterva_threadpool_group_t *group;
+    //!< The tasks queued to the thread pool of the context (if it has one).
+    pthread_t *threads;
+    int nstarted;
+};
+
+/*
+ * Run `worker(arg)` in `nthreads` threads, which must be waited for with caterva_threads_wait
+ * (even if an error is returned, when `*threads` is not NULL). The workers are tasks of the
+ * thread pool of the context, if it has one, unless the caller is a worker of the pool itself:
+ * then they are run by new threads, so that the caller does not wait for a busy pool.
+ */
+int caterva_threads_fork(caterva_ctx_t *ctx, int nthreads, void *(*worker)(void *), void *arg,
+                         caterva_threads_t **threads) {
+    caterva_threads_t *threads_ = ctx->cfg->alloc(sizeof(caterva_threads_t));
+    *threads = threads_;
+    CATERVA_ERROR_NULL(threads_);
+    threads_->group = NULL;
+    threads_->threads = NULL;
+    threads_->nstarted = 0;
+
+    caterva_threadpool_t *pool = ctx->cfg->threadpool;
+    if (pool != NULL && !caterva_threadpool_is_worker(pool)) {
+        CATERVA_ERROR(caterva_threadpool_submit(pool, nthreads, worker, arg, &threads_->group));
+    } else {
+        CATERVA_ERROR(caterva_threads_start(ctx, nthreads, worker, arg, &threads_->threads,
+                                            &threads_->nstarted));
+    }
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_threads_wait(caterva_ctx_t *ctx, caterva_threads_t **threads) {
+    caterva_threads_t *threads_ = *threads;
+    int rc = CATERVA_SUCCEED;
+    if (threads_->group != NULL) {
+        rc = caterva_threadpool_wait(&threads_->group);
+    }
+    if (threads_->threads != NULL) {
+        rc = caterva_threads_join(ctx, threads_->nstarted, threads_->threads);
+    }
+    ctx->cfg->free(threads_);
+    *threads = NULL;
+    CATERVA_ERROR(rc);
+
+    return CATERVA_SUCCEED;
+}
+
+/*
+ * Get the number of threads of the Blosc contexts. When the context has a thread pool, the
+ * parallelism comes from its workers, so Blosc does not start threads of its own.
+ */
+int caterva_threads_blosc(caterva_ctx_t *ctx) {
+    return ctx->cfg->threadpool != NULL ? 1 : ctx->cfg->nthreads;
+}
+
+int caterva_lock_new(caterva_ctx_t *ctx, caterva_lock_t **lock) {
+    *lock = ctx->cfg->alloc(sizeof(caterva_lock_t));
+    CATERVA_ERROR_NULL(*lock);
+    if (pthread_mutex_init(&(*lock)->mutex, NULL) != 0) {
+        ctx->cfg->free(*lock);
+        *lock = NULL;
+        CATERVA_ERROR(CATERVA_ERR_THREADS_FAILED);
+    }
+    (*lock)->loaded = false;
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_lock_free(caterva_ctx_t *ctx, caterva_lock_t **lock) {
+    if (*lock == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    pthread_mutex_destroy(&(*lock)->mutex);
+    ctx->cfg->free(*lock);
+    *lock = NULL;
+
+    return CATERVA_SUCCEED;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef CATERVA_CATERVA_THREADS_H_
+#define CATERVA_CATERVA_THREADS_H_
+
+#include <caterva.h>
+
+// Use the pthread wrapper shipped (and compiled) with c-blosc2 on Windows
+#if defined(_WIN32) && !defined(__GNUC__)
+#include "win32/pthread.h"
+#else
+#include <pthread.h>
+#endif
+
+int caterva_threads_start(caterva_ctx_t *ctx, int nthreads, void *(*worker)(void *),
+                          void *arg, pthread_t **threads, int *nstarted);
+
+int caterva_threads_join(caterva_ctx_t *ctx, int nthreads, pthread_t *threads);
+
+typedef struct caterva_threads_s caterva_threads_t;
+
+int caterva_threads_fork(caterva_ctx_t *ctx, int nthreads, void *(*worker)(void *), void *arg,
+                         caterva_threads_t **threads);
+
+int caterva_threads_wait(caterva_ctx_t *ctx, caterva_threads_t **threads);
+
+int caterva_threads_blosc(caterva_ctx_t *ctx);
+
+struct caterva_lock_s {
+    pthread_mutex_t mutex;
+    bool loaded;
+    //!< Indicate that the frame of the array has loaded its chunk offsets.
+};
+
+int caterva_lock_new(caterva_ctx_t *ctx, caterva_lock_t **lock);
+
+int caterva_lock_free(caterva_ctx_t *ctx, caterva_lock_t **lock);
+
+#endif  // CATERVA_CATERVA_THREADS_H_
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "caterva_versions.h"
+
+/*
+ * The version of every chunk of an array, so that the chunks written since a given version of the
+ * array can be enumerated (e.g. to replicate an array incrementally). The array starts at version
+ * 0 when the versions begin to be tracked, and every chunk write increases it by one.
+ *
+ * The versions are serialized in a variable-length metalayer, because their size depends on the
+ * number of chunks, as an array with 3 entries (format, version, chunks). The versions of the
+ * chunks are stored in a bin entry, as big-endian 8-byte values.
+ */
+
+int caterva_versions_new(caterva_ctx_t *ctx, int64_t nchunks, caterva_versions_t **versions) {
+    caterva_versions_t *versions_ = ctx->cfg->alloc(sizeof(caterva_versions_t));
+    CATERVA_ERROR_NULL(versions_);
+    versions_->version = 0;
+    versions_->nchunks = nchunks;
+    versions_->dirty = true;
+    versions_->chunks = ctx->cfg->alloc((size_t) (nchunks > 0 ? nchunks : 1) * sizeof(int64_t));
+    if (versions_->chunks == NULL) {
+        ctx->cfg->free(versions_);
+        CATERVA_ERROR(CATERVA_ERR_NULL_POINTER);
+    }
+    memset(versions_->chunks, 0, (size_t) (nchunks > 0 ? nchunks : 1) * sizeof(int64_t));
+
+    *versions = versions_;
+    return CATERVA_SUCCEED;
+}
+
+int caterva_versions_free(caterva_ctx_t *ctx, caterva_versions_t **versions) {
+    if (*versions == NULL) {
+        return CATERVA_SUCCEED;
+    }
+    ctx->cfg->free((*versions)->chunks);
+    ctx->cfg->free(*versions);
+    *versions = NULL;
+
+    return CATERVA_SUCCEED;
+}
+
+// Record that the chunk `nchunk` has just been written. Writers running at once must serialize
+// their calls (e.g. with the lock of the array).
+void caterva_versions_touch(caterva_versions_t *versions, int64_t nchunk) {
+    if (versions == NULL || nchunk < 0 || nchunk >= versions->nchunks) {
+        return;
+    }
+    versions->chunks[nchunk] = ++versions->version;
+    versions->dirty = true;
+}
+
+static void caterva_versions_store64(uint8_t *dest, uint64_t value) {
+    for (int i = 7; i >= 0; --i) {
+        dest[i] = (uint8_t) (value & 0xff);
+        value >>= 8;
+    }
+}
+
+static uint64_t caterva_versions_load64(const uint8_t *src) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = (value << 8) | src[i];
+    }
+    return value;
+}
+
+int caterva_versions_serialize(caterva_versions_t *versions, uint8_t **content, int32_t *len) {
+    int64_t len_ = 1 + 1 + (1 + 8) + (1 + 4) + versions->nchunks * 8;
+    if (len_ > INT32_MAX) {
+        DEBUG_PRINT("The versions are too large to be stored in a metalayer");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    *content = malloc((size_t) len_);
+    CATERVA_ERROR_NULL(*content);
+    uint8_t *p = *content;
+
+    // An array with 3 entries (format, version, chunks)
+    *p++ = 0x90 + 3;
+    *p++ = CATERVA_VERSIONS_FORMAT;  // positive fixnum
+    *p++ = 0xd3;  // int64
+    caterva_versions_store64(p, (uint64_t) versions->version);
+    p += 8;
+    *p++ = 0xc6;  // bin32
+    uint32_t binlen = (uint32_t) (versions->nchunks * 8);
+    for (int i = 3; i >= 0; --i) {
+        p[i] = (uint8_t) (binlen & 0xff);
+        binlen >>= 8;
+    }
+    p += 4;
+    for (int64_t i = 0; i < versions->nchunks; ++i) {
+        caterva_versions_store64(p, (uint64_t) versions->chunks[i]);
+        p += 8;
+    }
+
+    *len = (int32_t) (p - *content);
+    return CATERVA_SUCCEED;
+}
+
+int caterva_versions_deserialize(caterva_ctx_t *ctx, const uint8_t *content, int32_t len,
+                                 caterva_versions_t **versions) {
+    const uint8_t *p = content;
+    if (len < 1 + 1 + (1 + 8) + (1 + 4) || p[0] != 0x90 + 3 || p[1] > CATERVA_VERSIONS_FORMAT ||
+        p[2] != 0xd3 || p[11] != 0xc6) {
+        DEBUG_PRINT("The versions metalayer is corrupted");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    int64_t version = (int64_t) caterva_versions_load64(&p[3]);
+    int64_t binlen = (int64_t) (((uint32_t) p[12] << 24) | ((uint32_t) p[13] << 16) |
+                                ((uint32_t) p[14] << 8) | p[15]);
+    p += 16;
+    if (version < 0 || binlen % 8 != 0 || binlen > len - (p - content)) {
+        DEBUG_PRINT("The versions metalayer is corrupted");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    CATERVA_ERROR(caterva_versions_new(ctx, binlen / 8, versions));
+    (*versions)->version = version;
+    for (int64_t i = 0; i < (*versions)->nchunks; ++i) {
+        (*versions)->chunks[i] = (int64_t) caterva_versions_load64(p);
+        p += 8;
+    }
+    (*versions)->dirty = false;
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_get_version(caterva_ctx_t *ctx, caterva_array_t *array, int64_t *version) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(version);
+
+    if (array->versions == NULL) {
+        DEBUG_PRINT("The versions of the array are not tracked");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+    *version = array->versions->version;
+
+    return CATERVA_SUCCEED;
+}
+
+int caterva_get_changed_chunks(caterva_ctx_t *ctx, caterva_array_t *array, int64_t since,
+                               int64_t *coords, int64_t maxchunks, int64_t *nchunks) {
+    CATERVA_ERROR_NULL(ctx);
+    CATERVA_ERROR_NULL(array);
+    CATERVA_ERROR_NULL(nchunks);
+
+    caterva_versions_t *versions = array->versions;
+    if (versions == NULL) {
+        DEBUG_PRINT("The versions of the array are not tracked");
+        CATERVA_ERROR(CATERVA_ERR_INVALID_ARGUMENT);
+    }
+
+    int8_t ndim = array->ndim;
+    int64_t nchunks_ = 0;
+    for (int64_t nchunk = 0; nchunk < versions->nchunks; ++nchunk) {
+        if (versions->chunks[nchunk] <= since) {
+            continue;
+        }
+        if (coords != NULL && nchunks_ < maxchunks) {
+            // The chunks are in C order in the grid of chunks
+            int64_t *chunk_coords = &coords[nchunks_ * ndim];
+            int64_t index = nchunk;
+            for (int i = ndim - 1; i >= 0; --i) {
+                int64_t grid = array->extshape[i] / array->chunkshape[i];
+                chunk_coords[i] = index % grid;
+                index /= grid;
+            }
+        }
+        nchunks_++;
+    }
+    *nchunks = nchunks_;
+
+    return CATERVA_SUCCEED;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2018-present Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef CATERVA_CATERVA_VERSIONS_H_
+#define CATERVA_CATERVA_VERSIONS_H_
+
+#include <caterva.h>
+
+/* The name of the variable-length metalayer where the versions are stored */
+#define CATERVA_VERSIONS_METALAYER "caterva_versions"
+
+/* The version for the versions format; starts from 0 and it must not exceed 127 */
+#define CATERVA_VERSIONS_FORMAT 0
+
+struct caterva_versions_s {
+    int64_t version;
+    //!< The version of the array, which is increased every time that a chunk is written.
+    int64_t nchunks;
+    int64_t *chunks;
+    //!< For every chunk, the version of the array when it was written for the last time.
+    bool dirty;
+    //!< Indicate if the versions have changed since they were stored in the metalayer.
+};
+
+int caterva_versions_new(caterva_ctx_t *ctx, int64_t nchunks, caterva_versions_t **versions);
+
+int caterva_versions_free(caterva_ctx_t *ctx, caterva_versions_t **versions);
+
+void caterva_versions_touch(caterva_versions_t *versions, int64_t nchunk);
+
+int caterva_versions_serialize(caterva_versions_t *versions, uint8_t **content, int32_t *len);
+
+int caterva_versions_deserialize(caterva_ctx_t *ctx, const uint8_t *content, int32_t len,
+                                 caterva_versions_t **versions);
+
+#endif  // CATERVA_CATERVA_VERSIONS_H_
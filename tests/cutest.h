@@ -94,16 +94,16 @@ typedef struct {
     int32_t param_size;
 } _cutest_param_t;
 
-static _cutest_param_t _cutest_params[_CUTEST_PARAMS_MAX] = {0};
+static _cutest_param_t _cutest_params[_CUTEST_PARAMS_MAX] = {{NULL, NULL, 0, 0}};
 static int32_t _cutest_params_ind[_CUTEST_PARAMS_MAX] = {0};
 
 
-void _cutest_parametrize(char* name, void *params, int32_t params_len, int32_t param_size) {
+void _cutest_parametrize(const char* name, void *params, int32_t params_len, int32_t param_size) {
     int i = 0;
     while(_cutest_params[i].name != NULL) {
         i++;
     }
-    uint8_t *new_params = malloc(param_size * params_len);
+    uint8_t *new_params = (uint8_t *) malloc(param_size * params_len);
     char *new_name = strdup(name);
     memcpy(new_params, params, param_size * params_len);
     _cutest_params[i].name = new_name;
@@ -112,7 +112,7 @@ void _cutest_parametrize(char* name, void *params, int32_t params_len, int32_t p
     _cutest_params[i].params_len = params_len;
 }
 
-uint8_t *_cutest_get_parameter(char *name) {
+uint8_t *_cutest_get_parameter(const char *name) {
     int i = 0;
     while(strcmp(_cutest_params[i].name, name) != 0) {
         i++;
@@ -141,7 +141,7 @@ void _cutest_teardown() {
 char _cutest_error_msg[1024];
 
 
-int _cutest_run(int (*test)(void *), void *test_data, char *name) {
+int _cutest_run(int (*test)(void *), void *test_data, const char *name) {
     int cutest_ok = 0;
     int cutest_failed = 0;
     int cutest_total = 0;
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+
+static bool test_advise_check(caterva_params_t *params, caterva_advice_t *advice,
+                              caterva_storage_t *storage) {
+    int64_t chunknitems = 1;
+    int64_t blocknitems = 1;
+    int64_t nchunks = 1;
+    for (int i = 0; i < params->ndim; ++i) {
+        int32_t chunk = storage->properties.blosc.chunkshape[i];
+        int32_t block = storage->properties.blosc.blockshape[i];
+        if (block < 1 || block > chunk || chunk > params->shape[i]) {
+            return false;
+        }
+        chunknitems *= chunk;
+        blocknitems *= block;
+        nchunks *= (params->shape[i] + chunk - 1) / chunk;
+    }
+    if (blocknitems * params->itemsize > advice->l2size / 2) {
+        return false;
+    }
+    if (chunknitems > blocknitems &&
+        chunknitems * params->itemsize > advice->l3size / advice->nreaders) {
+        return false;
+    }
+    return nchunks >= advice->nreaders;
+}
+
+
+CUTEST_TEST_DATA(advise) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(advise) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 8));
+    CUTEST_PARAMETRIZE(pattern, caterva_pattern_t, CUTEST_DATA(
+            CATERVA_PATTERN_BOXES,
+            CATERVA_PATTERN_ROWS,
+            CATERVA_PATTERN_COLUMNS,
+    ));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {10000}, {0}, {0}},
+            {2, {300, 250}, {0}, {0}},
+            {3, {40, 60, 30}, {0}, {0}},
+            {4, {11, 7, 23, 19}, {0}, {0}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(advise) {
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+    CUTEST_GET_PARAMETER(pattern, caterva_pattern_t);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    int64_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+        buffersize *= shapes.shape[i];
+    }
+
+    caterva_advice_t advice = {0};
+    advice.l1size = 1024;
+    advice.l2size = 8 * 1024;
+    advice.l3size = 64 * 1024;
+    advice.nreaders = 2;
+    advice.pattern = pattern;
+    for (int i = 0; i < params.ndim; ++i) {
+        advice.boxshape[i] = 5;
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = CATERVA_STORAGE_BLOSC;
+    CATERVA_TEST_ASSERT(caterva_advise_shapes(data->ctx, &params, &advice, &storage));
+    CUTEST_ASSERT("Shapes are not correct", test_advise_check(&params, &advice, &storage));
+
+    /* Rows are kept whole in the chunks as long as they fit */
+    int8_t last = (int8_t) (params.ndim - 1);
+    if (pattern == CATERVA_PATTERN_ROWS && params.shape[last] * itemsize <= advice.l2size / 2) {
+        CUTEST_ASSERT("Rows are split", storage.properties.blosc.chunkshape[last] ==
+                                        params.shape[last]);
+    }
+    if (pattern == CATERVA_PATTERN_COLUMNS && params.shape[0] * itemsize <= advice.l2size / 2) {
+        CUTEST_ASSERT("Columns are split", storage.properties.blosc.chunkshape[0] ==
+                                           params.shape[0]);
+    }
+
+    /* Benchmark the candidates against the data itself */
+    uint8_t *buffer = malloc((size_t) buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+    advice.sample = buffer;
+    advice.samplesize = buffersize;
+    for (int i = 0; i < params.ndim; ++i) {
+        advice.sampleshape[i] = params.shape[i];
+    }
+    CATERVA_TEST_ASSERT(caterva_advise_shapes(data->ctx, &params, &advice, &storage));
+    for (int i = 0; i < params.ndim; ++i) {
+        CUTEST_ASSERT("Shapes are not correct", storage.properties.blosc.blockshape[i] >= 1 &&
+            storage.properties.blosc.blockshape[i] <= storage.properties.blosc.chunkshape[i] &&
+            storage.properties.blosc.chunkshape[i] <= params.shape[i]);
+    }
+
+    /* The advised shapes can be used to store the data */
+    caterva_array_t *array;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &array));
+    uint8_t *buffer_dest = malloc((size_t) buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, array, buffer_dest, buffersize));
+    CUTEST_ASSERT("Elements are not equals!", memcmp(buffer, buffer_dest, buffersize) == 0);
+
+    /* The sample must match its shape */
+    advice.samplesize = buffersize - 1;
+    CUTEST_ASSERT("A wrong sample size must fail",
+                  caterva_advise_shapes(data->ctx, &params, &advice, &storage) ==
+                  CATERVA_ERR_INVALID_ARGUMENT);
+
+    /* Free mallocs */
+    free(buffer);
+    free(buffer_dest);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(advise) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(advise);
+}
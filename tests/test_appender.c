@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+
+// Copy the chunk `nchunk` of `array` (without the padding) from a C buffer with its shape
+static int64_t test_appender_chunk(caterva_array_t *array, const uint8_t *buffer, int64_t nchunk,
+                                   uint8_t *chunk) {
+    int64_t start[CATERVA_MAX_DIM];
+    int64_t shape[CATERVA_MAX_DIM];
+    int64_t nitems = 1;
+    for (int i = array->ndim - 1; i >= 0; --i) {
+        int64_t nchunks = array->extshape[i] / array->chunkshape[i];
+        start[i] = nchunk % nchunks * array->chunkshape[i];
+        nchunk /= nchunks;
+        int64_t extent = array->shape[i] - start[i];
+        shape[i] = extent < array->chunkshape[i] ? extent : array->chunkshape[i];
+        nitems *= shape[i];
+    }
+    for (int64_t n = 0; n < nitems; ++n) {
+        int64_t index = 0;
+        int64_t rem = n;
+        int64_t stride = 1;
+        for (int i = array->ndim - 1; i >= 0; --i) {
+            index += (start[i] + rem % shape[i]) * stride;
+            rem /= shape[i];
+            stride *= array->shape[i];
+        }
+        memcpy(chunk + n * array->itemsize, buffer + index * array->itemsize, array->itemsize);
+    }
+    return nitems * array->itemsize;
+}
+
+
+CUTEST_TEST_DATA(appender) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(appender) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 3;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 8));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, true},
+    ));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {1000}, {100}, {25}},
+            {2, {101, 77}, {20, 30}, {10, 10}},
+            {3, {43, 60, 31}, {10, 20, 10}, {5, 5, 5}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(appender) {
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+
+    char *urlpath = "test_appender.b2frame";
+    remove(urlpath);
+
+    caterva_params_t params = {0};
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    storage.properties.blosc.sequencial = backend.sequential;
+    int64_t nitems = 1;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+        nitems *= shapes.shape[i];
+    }
+    int64_t buffersize = nitems * itemsize;
+    int64_t rowsize = buffersize / shapes.shape[0];
+    uint8_t *buffer = malloc((size_t) buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, nitems));
+    /* Some chunks of zeros, to be stored as special chunks */
+    memset(buffer, 0, (size_t) (rowsize * shapes.chunkshape[0]));
+    uint8_t *buffer_dest = malloc((size_t) buffersize);
+
+    /* The rows are appended in uneven batches, with a budget of a row of chunks */
+    if (backend.persistent) {
+        storage.properties.blosc.urlpath = urlpath;
+    }
+    caterva_array_t *array;
+    CATERVA_TEST_ASSERT(caterva_empty(data->ctx, &params, &storage, &array));
+    caterva_appender_t *appender;
+    CATERVA_TEST_ASSERT(caterva_appender_new(data->ctx, array, 1, &appender));
+    int64_t row = 0;
+    for (int64_t nrows = 1; row < shapes.shape[0]; nrows = nrows % 7 + 1) {
+        if (row + nrows > shapes.shape[0]) {
+            nrows = shapes.shape[0] - row;
+        }
+        CATERVA_TEST_ASSERT(caterva_appender_append_rows(appender, buffer + row * rowsize,
+                                                         nrows * rowsize));
+        row += nrows;
+        if (row % 11 == 0) {
+            CATERVA_TEST_ASSERT(caterva_appender_flush(appender));
+        }
+    }
+    CUTEST_ASSERT("Appending beyond the shape must fail",
+                  caterva_appender_append_rows(appender, buffer, rowsize) ==
+                  CATERVA_ERR_CONTAINER_FILLED);
+    CATERVA_TEST_ASSERT(caterva_appender_free(&appender));
+    CUTEST_ASSERT("The array is not filled", array->filled);
+    if (backend.persistent) {
+        CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+        CATERVA_TEST_ASSERT(caterva_open(data->ctx, urlpath, &array));
+    }
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, array, buffer_dest, buffersize));
+    CUTEST_ASSERT("Elements are not equals!", memcmp(buffer, buffer_dest, buffersize) == 0);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+    remove(urlpath);
+
+    /* The chunks appended through an appender are the same as with caterva_append */
+    storage.properties.blosc.urlpath = NULL;
+    caterva_array_t *expected;
+    CATERVA_TEST_ASSERT(caterva_empty(data->ctx, &params, &storage, &expected));
+    CATERVA_TEST_ASSERT(caterva_empty(data->ctx, &params, &storage, &array));
+    CATERVA_TEST_ASSERT(caterva_appender_new(data->ctx, array, INT64_MAX, &appender));
+    uint8_t *chunk = malloc((size_t) (array->chunknitems * itemsize));
+    int64_t nchunks = array->extnitems / array->chunknitems;
+    for (int64_t nchunk = 0; nchunk < nchunks; ++nchunk) {
+        int64_t chunksize = test_appender_chunk(array, buffer, nchunk, chunk);
+        CATERVA_TEST_ASSERT(caterva_append(data->ctx, expected, chunk, chunksize));
+        CATERVA_TEST_ASSERT(caterva_appender_append_chunk(appender, chunk, chunksize));
+    }
+    CATERVA_TEST_ASSERT(caterva_appender_flush(appender));
+    CUTEST_ASSERT("The chunks are not written", array->nchunks == nchunks);
+    CATERVA_TEST_ASSERT(caterva_appender_free(&appender));
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, array, buffer_dest, buffersize));
+    CUTEST_ASSERT("Elements are not equals!", memcmp(buffer, buffer_dest, buffersize) == 0);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &expected));
+
+    /* Closing an appender writes the incomplete row of chunks, padded with the fill value */
+    CATERVA_TEST_ASSERT(caterva_empty(data->ctx, &params, &storage, &array));
+    CATERVA_TEST_ASSERT(caterva_appender_new(data->ctx, array, INT64_MAX, &appender));
+    int64_t nrows = shapes.chunkshape[0] + shapes.chunkshape[0] / 2;
+    CATERVA_TEST_ASSERT(caterva_appender_append_rows(appender, buffer, nrows * rowsize));
+    CUTEST_ASSERT("Chunks can not be appended in the middle of a row of chunks",
+                  caterva_appender_append_chunk(appender, chunk, array->chunknitems * itemsize) ==
+                  CATERVA_ERR_INVALID_ARGUMENT);
+    CUTEST_ASSERT("The rows must be whole",
+                  caterva_appender_append_rows(appender, buffer, rowsize - 1) ==
+                  CATERVA_ERR_INVALID_ARGUMENT);
+    CATERVA_TEST_ASSERT(caterva_appender_free(&appender));
+    int64_t slabchunks = nchunks / (array->extshape[0] / array->chunkshape[0]);
+    CUTEST_ASSERT("The incomplete row of chunks is not written", array->nchunks == 2 * slabchunks);
+    int64_t start[CATERVA_MAX_DIM] = {0};
+    int64_t stop[CATERVA_MAX_DIM];
+    for (int i = 0; i < params.ndim; ++i) {
+        stop[i] = shapes.shape[i];
+    }
+    stop[0] = 2 * shapes.chunkshape[0];
+    memset(buffer_dest, 0xff, (size_t) buffersize);
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, array, start, stop, stop, buffer_dest,
+                                                 stop[0] * rowsize));
+    CUTEST_ASSERT("Elements are not equals!", memcmp(buffer, buffer_dest, nrows * rowsize) == 0);
+    for (int64_t n = nrows * rowsize; n < stop[0] * rowsize; ++n) {
+        CUTEST_ASSERT("The padding does not hold the fill value", buffer_dest[n] == 0);
+    }
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+
+    /* Plain buffers are written in place, so they have no appenders */
+    storage.backend = CATERVA_STORAGE_PLAINBUFFER;
+    CATERVA_TEST_ASSERT(caterva_empty(data->ctx, &params, &storage, &array));
+    CUTEST_ASSERT("Plain buffers can not have appenders",
+                  caterva_appender_new(data->ctx, array, INT64_MAX, &appender) ==
+                  CATERVA_ERR_INVALID_STORAGE);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+
+    /* Free mallocs */
+    free(buffer);
+    free(buffer_dest);
+    free(chunk);
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(appender) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(appender);
+}
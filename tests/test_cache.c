@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+typedef struct {
+    int8_t ndim;
+    int64_t shape[CATERVA_MAX_DIM];
+    int32_t chunkshape[CATERVA_MAX_DIM];
+    int32_t blockshape[CATERVA_MAX_DIM];
+    int64_t start[CATERVA_MAX_DIM];
+    int64_t stop[CATERVA_MAX_DIM];
+} test_cache_shapes_t;
+
+
+CUTEST_TEST_DATA(cache) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(cache) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 8));
+    CUTEST_PARAMETRIZE(nchunks_cached, int, CUTEST_DATA(1, 1000));
+    CUTEST_PARAMETRIZE(shapes, test_cache_shapes_t, CUTEST_DATA(
+            {1, {100}, {20}, {5}, {20}, {40}}, // 1-idim aligned
+            {2, {100, 100}, {20, 20}, {10, 10}, {5, 13}, {87, 100}},
+            {3, {100, 55, 123}, {31, 5, 22}, {4, 4, 4}, {10, 0, 31}, {99, 55, 70}},
+            {2, {100, 100}, {20, 20}, {10, 10}, {21, 21}, {29, 29}}, // one block
+    ));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, false},
+    ));
+}
+
+
+CUTEST_TEST_TEST(cache) {
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, test_cache_shapes_t);
+    CUTEST_GET_PARAMETER(nchunks_cached, int);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    if (backend.persistent) {
+        storage.properties.blosc.urlpath = "test_cache.b2frame";
+    }
+    storage.properties.blosc.sequencial = backend.sequential;
+    for (int i = 0; i < params.ndim; ++i) {
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+    }
+
+    /* Create original data */
+    size_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        buffersize *= (size_t) params.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &src));
+
+    int64_t destshape[CATERVA_MAX_DIM] = {0};
+    int64_t destbuffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        destshape[i] = shapes.stop[i] - shapes.start[i];
+        destbuffersize *= destshape[i];
+    }
+    uint8_t *destbuffer_ref = malloc((size_t) destbuffersize);
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, src, shapes.start, shapes.stop,
+                                                 destshape, destbuffer_ref, destbuffersize));
+
+    /* Enable the cache */
+    int64_t chunkbytes = src->extchunknitems * src->itemsize;
+    CATERVA_TEST_ASSERT(caterva_set_cache_size(data->ctx, src, nchunks_cached * chunkbytes));
+    caterva_cache_stats_t stats;
+    CATERVA_TEST_ASSERT(caterva_get_cache_stats(data->ctx, src, &stats));
+    CUTEST_ASSERT("Statistics are not empty", stats.hits == 0 && stats.misses == 0);
+
+    /* Read the slice twice */
+    uint8_t *destbuffer = malloc((size_t) destbuffersize);
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, src, shapes.start, shapes.stop,
+                                                 destshape, destbuffer, destbuffersize));
+    CATERVA_TEST_ASSERT_BUFFER(destbuffer_ref, destbuffer, (int) destbuffersize);
+    CATERVA_TEST_ASSERT(caterva_get_cache_stats(data->ctx, src, &stats));
+    int64_t misses = stats.misses;
+    CUTEST_ASSERT("The first read must miss", misses > 0 && stats.hits == 0);
+
+    memset(destbuffer, 0, (size_t) destbuffersize);
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, src, shapes.start, shapes.stop,
+                                                 destshape, destbuffer, destbuffersize));
+    CATERVA_TEST_ASSERT_BUFFER(destbuffer_ref, destbuffer, (int) destbuffersize);
+    CATERVA_TEST_ASSERT(caterva_get_cache_stats(data->ctx, src, &stats));
+    if (misses <= nchunks_cached) {
+        CUTEST_ASSERT("The second read must hit", stats.hits == misses && stats.misses == misses);
+        CUTEST_ASSERT("Cache memory is wrong", stats.nbytes == misses * chunkbytes);
+    } else {
+        CUTEST_ASSERT("Chunks must be evicted", stats.evictions > 0);
+        CUTEST_ASSERT("Cache memory is wrong", stats.nbytes == nchunks_cached * chunkbytes);
+    }
+
+    /* Read the whole array, which completes the partially decompressed chunks */
+    uint8_t *buffer_dest = malloc(buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, src, buffer_dest, buffersize));
+    CATERVA_TEST_ASSERT_BUFFER(buffer, buffer_dest, (int) buffersize);
+    memset(buffer_dest, 0, buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, src, buffer_dest, buffersize));
+    CATERVA_TEST_ASSERT_BUFFER(buffer, buffer_dest, (int) buffersize);
+
+    /* Disable the cache */
+    CATERVA_TEST_ASSERT(caterva_set_cache_size(data->ctx, src, 0));
+    CATERVA_TEST_ASSERT(caterva_get_cache_stats(data->ctx, src, &stats));
+    CUTEST_ASSERT("Statistics are not empty", stats.hits == 0 && stats.nbytes == 0);
+
+    /* Free mallocs */
+    free(buffer);
+    free(buffer_dest);
+    free(destbuffer);
+    free(destbuffer_ref);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(cache) {
+    caterva_ctx_free(&data->ctx);
+}
+
+int main() {
+    CUTEST_TEST_RUN(cache);
+}
@@ -23,6 +23,7 @@ typedef struct {
 
 CUTEST_TEST_DATA(copy) {
     caterva_ctx_t *ctx;
+    caterva_ctx_t *ctx2;
 };
 
 
@@ -31,6 +32,10 @@ CUTEST_TEST_SETUP(copy) {
     cfg.nthreads = 2;
     cfg.compcodec = BLOSC_BLOSCLZ;
     caterva_ctx_new(&cfg, &data->ctx);
+    // The same, but compressing with different parameters
+    cfg.compcodec = BLOSC_LZ4;
+    cfg.complevel = 9;
+    caterva_ctx_new(&cfg, &data->ctx2);
 
     // Add parametrizations
     CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 2, 4, 8));
@@ -47,6 +52,10 @@ CUTEST_TEST_SETUP(copy) {
                 {1, 1, 300, 1, 1}, {1, 1, 50, 1, 1}},
             {6, {5, 1, 100, 3, 1, 2}, {5, 1, 50, 2, 1, 2}, {2, 1, 20, 2, 1, 2},
                 {4, 1, 50, 2, 1, 1}, {2, 1, 20, 2, 1, 1}},
+            {2, {100, 100}, {20, 20}, {10, 10},
+                {40, 10}, {10, 10}}, // same blocks
+            {3, {30, 25, 17}, {12, 10, 8}, {4, 5, 4},
+                {4, 20, 16}, {4, 5, 4}}, // same blocks, partial chunks
     ));
     CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
             {CATERVA_STORAGE_PLAINBUFFER, false, false},
@@ -162,6 +171,31 @@ CUTEST_TEST_TEST(copy) {
     /* Testing */
     CATERVA_TEST_ASSERT_BUFFER(buffer, buffer_dest, (int) buffersize);
 
+    /* Copying with other compression parameters recompresses the chunks */
+    if (storage2.backend == CATERVA_STORAGE_BLOSC) {
+        caterva_array_t *dest2;
+        if (backend2.persistent) {
+            storage2.properties.blosc.urlpath = "test_copy3.b2frame";
+        }
+        CATERVA_TEST_ASSERT(caterva_copy(data->ctx2, src, &storage2, &dest2));
+        memset(buffer_dest, 0, buffersize);
+        CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx2, dest2, buffer_dest, buffersize));
+        CATERVA_TEST_ASSERT_BUFFER(buffer, buffer_dest, (int) buffersize);
+        // The metalayers are kept when the chunks are only recompressed
+        bool same_shapes = storage.backend == CATERVA_STORAGE_BLOSC;
+        for (int i = 0; i < shapes.ndim; ++i) {
+            same_shapes = same_shapes && shapes.chunkshape[i] == shapes.chunkshape2[i] &&
+                          shapes.blockshape[i] == shapes.blockshape2[i];
+        }
+        if (same_shapes) {
+            CUTEST_ASSERT("Metalayer not copied", blosc2_meta_exists(dest2->sc, "random") >= 0);
+        }
+        CATERVA_TEST_ASSERT(caterva_free(data->ctx2, &dest2));
+        if (backend2.persistent) {
+            remove("test_copy3.b2frame");
+        }
+    }
+
     /* Free mallocs */
     free(buffer);
     free(buffer_dest);
@@ -173,6 +207,7 @@ CUTEST_TEST_TEST(copy) {
 
 CUTEST_TEST_TEARDOWN(copy) {
     caterva_ctx_free(&data->ctx);
+    caterva_ctx_free(&data->ctx2);
 }
 
 int main() {
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+#include "caterva_copy.h"
+
+typedef struct {
+    int8_t ndim;
+    int64_t src_shape[CATERVA_MAX_DIM];
+    int64_t src_start[CATERVA_MAX_DIM];
+    int64_t dest_shape[CATERVA_MAX_DIM];
+    int64_t dest_start[CATERVA_MAX_DIM];
+    int64_t box_shape[CATERVA_MAX_DIM];
+} test_copy_box_shapes_t;
+
+
+CUTEST_TEST_DATA(copy_box) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(copy_box) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 2, 3, 4, 8));
+    CUTEST_PARAMETRIZE(shapes, test_copy_box_shapes_t, CUTEST_DATA(
+            {0, {0}, {0}, {0}, {0}, {0}}, // 0-dim
+            {1, {100}, {3}, {50}, {7}, {40}},
+            {2, {20, 30}, {0, 0}, {20, 30}, {0, 0}, {20, 30}}, // fully contiguous
+            {2, {20, 30}, {2, 5}, {10, 100}, {1, 30}, {7, 25}}, // long lines
+            {3, {10, 12, 14}, {1, 0, 2}, {8, 12, 9}, {0, 0, 1}, {6, 12, 7}},
+            {3, {10, 1, 14}, {1, 0, 2}, {8, 1, 9}, {0, 0, 1}, {6, 1, 7}}, // size-1 dim
+            {4, {6, 7, 8, 9}, {1, 2, 3, 4}, {5, 6, 7, 8}, {0, 1, 2, 3}, {4, 3, 2, 5}},
+            {6, {4, 5, 3, 6, 4, 5}, {1, 1, 0, 2, 1, 0}, {3, 4, 3, 5, 3, 7},
+                {0, 1, 0, 1, 0, 2}, {2, 3, 3, 3, 2, 5}},
+            {8, {3, 3, 3, 3, 3, 3, 3, 6}, {1, 0, 1, 0, 1, 0, 1, 2}, {2, 3, 2, 3, 2, 3, 2, 5},
+                {0, 0, 0, 0, 0, 0, 0, 1}, {2, 3, 2, 3, 2, 3, 2, 4}},
+            {2, {20, 30}, {2, 5}, {10, 100}, {1, 30}, {0, 25}}, // empty box
+            {2, {40, 64}, {1, 3}, {50, 70}, {2, 1}, {30, 17}}, // short lines
+            {3, {16, 16, 16}, {0, 0, 0}, {32, 32, 32}, {8, 8, 8}, {16, 16, 16}}, // block lines
+    ));
+}
+
+
+CUTEST_TEST_TEST(copy_box) {
+    CUTEST_GET_PARAMETER(shapes, test_copy_box_shapes_t);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+
+    int8_t ndim = shapes.ndim;
+    int64_t src_strides[CATERVA_MAX_DIM];
+    int64_t dest_strides[CATERVA_MAX_DIM];
+    caterva_copy_strides(ndim, shapes.src_shape, src_strides);
+    caterva_copy_strides(ndim, shapes.dest_shape, dest_strides);
+
+    int64_t src_nitems = 1;
+    int64_t dest_nitems = 1;
+    int64_t box_nitems = 1;
+    int64_t src_offset = 0;
+    int64_t dest_offset = 0;
+    for (int i = 0; i < ndim; ++i) {
+        src_nitems *= shapes.src_shape[i];
+        dest_nitems *= shapes.dest_shape[i];
+        box_nitems *= shapes.box_shape[i];
+        src_offset += shapes.src_start[i] * src_strides[i];
+        dest_offset += shapes.dest_start[i] * dest_strides[i];
+    }
+
+    uint8_t *src = malloc(src_nitems * itemsize);
+    uint8_t *dest = malloc(dest_nitems * itemsize);
+    uint8_t *expected = malloc(dest_nitems * itemsize);
+    for (int64_t i = 0; i < src_nitems * itemsize; ++i) {
+        src[i] = (uint8_t) (i * 7 + 1);
+    }
+    memset(dest, 0xff, dest_nitems * itemsize);
+    memset(expected, 0xff, dest_nitems * itemsize);
+
+    /* Copy the box item by item */
+    for (int64_t n = 0; n < box_nitems; ++n) {
+        int64_t index[CATERVA_MAX_DIM];
+        int64_t rem = n;
+        for (int i = ndim - 1; i >= 0; --i) {
+            index[i] = rem % shapes.box_shape[i];
+            rem /= shapes.box_shape[i];
+        }
+        int64_t s = src_offset;
+        int64_t d = dest_offset;
+        for (int i = 0; i < ndim; ++i) {
+            s += index[i] * src_strides[i];
+            d += index[i] * dest_strides[i];
+        }
+        memcpy(&expected[d * itemsize], &src[s * itemsize], itemsize);
+    }
+
+    /* Every instruction set supported by the machine gives the same result */
+    caterva_copy_isa_t isas[] = {CATERVA_COPY_ISA_SCALAR, CATERVA_COPY_ISA_SSE2,
+                                 CATERVA_COPY_ISA_AVX2, CATERVA_COPY_ISA_NEON};
+    for (size_t i = 0; i < sizeof(isas) / sizeof(isas[0]); ++i) {
+        if (!caterva_copy_isa_supported(isas[i])) {
+            continue;
+        }
+        CATERVA_TEST_ASSERT(caterva_copy_set_isa(isas[i]));
+        memset(dest, 0xff, dest_nitems * itemsize);
+        caterva_copy_box(ndim, itemsize, shapes.box_shape, &src[src_offset * itemsize],
+                         src_strides, &dest[dest_offset * itemsize], dest_strides);
+        CUTEST_ASSERT("Box copied incorrectly",
+                      memcmp(dest, expected, dest_nitems * itemsize) == 0);
+    }
+    CATERVA_TEST_ASSERT(caterva_copy_set_isa(CATERVA_COPY_ISA_AUTO));
+
+    free(src);
+    free(dest);
+    free(expected);
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(copy_box) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(copy_box);
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+
+typedef struct {
+    int64_t ncalls[CATERVA_NPHASES];
+    int64_t nbytes[CATERVA_NPHASES];
+    caterva_array_t *array;
+} test_counters_trace_t;
+
+
+// The slices are read from a single thread, so the trace does not need any lock
+static void test_counters_trace(void *arg, caterva_array_t *array, caterva_phase_t phase,
+                                int64_t start, int64_t nsecs, int64_t nbytes) {
+    test_counters_trace_t *trace = arg;
+    if (array != trace->array || start < 0 || nsecs < 0) {
+        return;
+    }
+    trace->ncalls[phase]++;
+    trace->nbytes[phase] += nbytes;
+}
+
+
+CUTEST_TEST_DATA(counters) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(counters) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 1;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 8));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_PLAINBUFFER, false, false},
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, false},
+    ));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {1000}, {100}, {25}},
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {40, 60, 30}, {20, 20, 10}, {10, 5, 5}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(counters) {
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    storage.properties.blosc.sequencial = backend.sequential;
+    for (int i = 0; i < params.ndim; ++i) {
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+    }
+
+    caterva_array_t *array;
+    CATERVA_TEST_ASSERT(caterva_empty(data->ctx, &params, &storage, &array));
+
+    /* The counters are disabled by default */
+    caterva_counters_t counters;
+    CATERVA_TEST_ASSERT(caterva_get_counters(data->ctx, array, &counters));
+    CUTEST_ASSERT("Counters must be disabled", array->instr == NULL &&
+                                               counters.ncalls[CATERVA_PHASE_COPY] == 0);
+
+    test_counters_trace_t trace = {0};
+    trace.array = array;
+    CATERVA_TEST_ASSERT(caterva_set_counters(data->ctx, array, true));
+    CATERVA_TEST_ASSERT(caterva_set_trace(data->ctx, array, test_counters_trace, &trace));
+
+    /* Append the chunks (they all have the same shape) */
+    int64_t nchunks = array->extnitems / array->chunknitems;
+    int64_t chunksize = array->chunknitems * itemsize;
+    uint8_t *chunk = malloc((size_t) chunksize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(chunk, itemsize, chunksize / itemsize));
+    for (int64_t nchunk = 0; nchunk < nchunks; ++nchunk) {
+        CATERVA_TEST_ASSERT(caterva_append(data->ctx, array, chunk, chunksize));
+    }
+    CATERVA_TEST_ASSERT(caterva_get_counters(data->ctx, array, &counters));
+    if (backend.backend == CATERVA_STORAGE_BLOSC) {
+        CUTEST_ASSERT("Appends are not counted",
+                      counters.ncalls[CATERVA_PHASE_APPEND] == nchunks &&
+                      counters.nbytes_written > 0 &&
+                      counters.nbytes_written <= array->sc->cbytes);
+        CUTEST_ASSERT("Repartitions are not counted",
+                      counters.ncalls[CATERVA_PHASE_COPY] == nchunks);
+    } else {
+        CUTEST_ASSERT("Copies are not counted", counters.nbytes_copied == chunksize);
+    }
+
+    /* Read the whole array */
+    CATERVA_TEST_ASSERT(caterva_reset_counters(data->ctx, array));
+    int64_t start[CATERVA_MAX_DIM] = {0};
+    int64_t buffersize = array->nitems * itemsize;
+    uint8_t *buffer = malloc((size_t) buffersize);
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, array, start, array->shape,
+                                                 array->shape, buffer, buffersize));
+    CATERVA_TEST_ASSERT(caterva_get_counters(data->ctx, array, &counters));
+    CUTEST_ASSERT("Copied bytes are not correct", counters.nbytes_copied == buffersize);
+    if (backend.backend == CATERVA_STORAGE_BLOSC) {
+        int64_t nblocks = array->extnitems / array->blocknitems;
+        CUTEST_ASSERT("Requested chunks are not correct",
+                      counters.nchunks_requested == nchunks &&
+                      counters.nblocks_requested == nblocks);
+        CUTEST_ASSERT("Decompressed chunks are not correct",
+                      counters.nchunks_decompressed == nchunks &&
+                      counters.nblocks_decompressed == nblocks &&
+                      counters.nbytes_decompressed == array->extnitems * itemsize);
+        CUTEST_ASSERT("Read bytes are not correct", counters.nbytes_read > 0 &&
+                                                    counters.ncalls[CATERVA_PHASE_READ] ==
+                                                    nchunks);
+
+        /* The second read is served by the cache */
+        CATERVA_TEST_ASSERT(caterva_set_cache_size(data->ctx, array,
+                                                   nchunks * array->extchunknitems * itemsize));
+        CATERVA_TEST_ASSERT(caterva_reset_counters(data->ctx, array));
+        for (int n = 0; n < 2; ++n) {
+            CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, array, start, array->shape,
+                                                         array->shape, buffer, buffersize));
+        }
+        CATERVA_TEST_ASSERT(caterva_get_counters(data->ctx, array, &counters));
+        CUTEST_ASSERT("Cache reads are not correct",
+                      counters.cache_misses + counters.cache_hits == 2 * nchunks &&
+                      counters.cache_hits > 0 &&
+                      counters.nchunks_decompressed == counters.cache_misses);
+    }
+
+    /* The trace sees every phase counted since it was set */
+    CUTEST_ASSERT("Trace is not called", trace.ncalls[CATERVA_PHASE_COPY] > 0);
+
+    /* Disabling the counters drops them */
+    CATERVA_TEST_ASSERT(caterva_set_counters(data->ctx, array, false));
+    CATERVA_TEST_ASSERT(caterva_get_counters(data->ctx, array, &counters));
+    CUTEST_ASSERT("Counters must be dropped", counters.nbytes_copied == 0);
+    int64_t ncalls = trace.ncalls[CATERVA_PHASE_COPY];
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, array, start, array->shape,
+                                                 array->shape, buffer, buffersize));
+    CUTEST_ASSERT("Trace must not be called", trace.ncalls[CATERVA_PHASE_COPY] == ncalls);
+
+    /* Free mallocs */
+    free(chunk);
+    free(buffer);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(counters) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(counters);
+}
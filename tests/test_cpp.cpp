@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <caterva.hpp>
+#include "cutest.h"
+
+#include <numeric>
+
+
+typedef struct {
+    caterva_storage_backend_t backend;
+    bool persistent;
+} test_cpp_backend_t;
+
+
+// Read and write the slice [shape / 4, 3 * shape / 4) through views that are regions of larger
+// buffers, and check them against the whole array read through the C API
+template <typename T, int N>
+static int test_cpp_slices(caterva::context &ctx, const test_cpp_backend_t &backend,
+                           const std::array<int64_t, N> &shape,
+                           const std::array<int32_t, N> &chunkshape,
+                           const std::array<int32_t, N> &blockshape) {
+    const char *urlpath = "test_cpp.b2frame";
+    remove(urlpath);
+    caterva_storage_t storage = caterva::plainbuffer_storage();
+    if (backend.backend == CATERVA_STORAGE_BLOSC) {
+        storage = caterva::blosc_storage<N>(chunkshape, blockshape,
+                                            backend.persistent ? urlpath : nullptr, true);
+    }
+
+    int64_t nitems = 1;
+    for (int i = 0; i < N; ++i) {
+        nitems *= shape[i];
+    }
+    std::vector<T> buffer(nitems);
+    std::iota(buffer.begin(), buffer.end(), T(0));
+    caterva::array<T, N> array = caterva::array<T, N>::from_buffer(
+        ctx, caterva::view<const T, N>(buffer.data(), shape), storage);
+
+    /* The slice is read into a region of a larger buffer, keeping its border */
+    std::array<int64_t, N> start;
+    std::array<int64_t, N> stop;
+    std::array<int64_t, N> slice_shape;
+    std::array<int64_t, N> outer_shape;
+    int64_t outer_nitems = 1;
+    for (int i = 0; i < N; ++i) {
+        start[i] = shape[i] / 4;
+        stop[i] = 3 * shape[i] / 4;
+        slice_shape[i] = stop[i] - start[i];
+        outer_shape[i] = slice_shape[i] + 2;
+        outer_nitems *= outer_shape[i];
+    }
+    std::array<int64_t, N> strides = caterva::detail::c_strides<N>(outer_shape);
+    int64_t offset = 0;
+    for (int i = 0; i < N; ++i) {
+        offset += strides[i];
+    }
+    std::vector<T> outer(outer_nitems, T(-1));
+    caterva::view<T, N> slice(outer.data() + offset, slice_shape, strides);
+    array.get_slice(start, stop, slice);
+
+    std::array<int64_t, N> coords = start;
+    int64_t nwrong = 0;
+    do {
+        int64_t index = 0;
+        int64_t outer_index = offset;
+        for (int i = 0; i < N; ++i) {
+            index = index * shape[i] + coords[i];
+            outer_index += (coords[i] - start[i]) * strides[i];
+        }
+        nwrong += outer[outer_index] != buffer[index];
+    } while (caterva::detail::next<N>(coords, start, stop));
+    CUTEST_ASSERT("Slice is not correct", nwrong == 0);
+    CUTEST_ASSERT("The border is overwritten", outer[0] == T(-1) && outer.back() == T(-1));
+
+    /* The slice is written back negated, from the same region */
+    for (T &item : outer) {
+        item = -item;
+    }
+    array.set_slice(start, stop, slice);
+    coords = start;
+    do {
+        int64_t index = 0;
+        for (int i = 0; i < N; ++i) {
+            index = index * shape[i] + coords[i];
+        }
+        buffer[index] = -buffer[index];
+    } while (caterva::detail::next<N>(coords, start, stop));
+
+    /* The array is moved, not copied */
+    caterva::array<T, N> moved = std::move(array);
+    CUTEST_ASSERT("The array is not moved", array.get() == nullptr && moved.get() != nullptr);
+
+    /* The C API sees the same data */
+    if (backend.persistent) {
+        moved = caterva::array<T, N>::open(ctx, urlpath);
+        bool failed = false;
+        try {
+            caterva::array<int8_t, N>::open(ctx, urlpath);
+        } catch (const caterva::error &err) {
+            failed = err.code() == CATERVA_ERR_INVALID_ARGUMENT;
+        }
+        CUTEST_ASSERT("Opening with another type must fail", failed);
+    }
+    std::vector<T> dest(nitems);
+    int64_t start_[CATERVA_MAX_DIM] = {0};
+    int64_t stop_[CATERVA_MAX_DIM];
+    std::copy(shape.begin(), shape.end(), stop_);
+    int rc = caterva_get_slice_buffer(ctx.get(), moved.get(), start_, stop_, stop_, dest.data(),
+                                      nitems * static_cast<int64_t>(sizeof(T)));
+    CUTEST_ASSERT(print_error(rc), rc == CATERVA_SUCCEED);
+    CUTEST_ASSERT("Elements are not equals!", dest == buffer);
+
+    /* And the specialized read agrees with it */
+    std::fill(dest.begin(), dest.end(), T(0));
+    moved.to_buffer(caterva::view<T, N>(dest.data(), shape));
+    CUTEST_ASSERT("Elements are not equals!", dest == buffer);
+
+    remove(urlpath);
+    return 0;
+}
+
+
+CUTEST_TEST_DATA(cpp) {
+    caterva::context *ctx;
+};
+
+
+CUTEST_TEST_SETUP(cpp) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    data->ctx = new caterva::context(cfg);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(backend, test_cpp_backend_t, CUTEST_DATA(
+            {CATERVA_STORAGE_PLAINBUFFER, false},
+            {CATERVA_STORAGE_BLOSC, false},
+            {CATERVA_STORAGE_BLOSC, true},
+    ));
+}
+
+
+CUTEST_TEST_TEST(cpp) {
+    CUTEST_GET_PARAMETER(backend, test_cpp_backend_t);
+
+    try {
+        int rc = test_cpp_slices<double, 1>(*data->ctx, backend, {{1000}}, {{100}}, {{30}});
+        if (rc != 0) {
+            return rc;
+        }
+        rc = test_cpp_slices<float, 2>(*data->ctx, backend, {{100, 77}}, {{20, 30}}, {{7, 10}});
+        if (rc != 0) {
+            return rc;
+        }
+        rc = test_cpp_slices<int32_t, 3>(*data->ctx, backend, {{40, 61, 30}}, {{10, 20, 11}},
+                                         {{5, 5, 4}});
+        if (rc != 0) {
+            return rc;
+        }
+    } catch (const caterva::error &err) {
+        CUTEST_ASSERT(err.what(), false);
+    }
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(cpp) {
+    delete data->ctx;
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(cpp);
+}
@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+#define TEST_EXECUTOR_NSLICES 40
+
+
+typedef struct {
+#if !defined(_WIN32)
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#endif
+    int ncalls;
+    int nfailed;
+    bool entered;
+    bool open;
+} test_executor_state_t;
+
+
+static void test_executor_count(void *arg, int rc) {
+    test_executor_state_t *state = arg;
+#if !defined(_WIN32)
+    pthread_mutex_lock(&state->mutex);
+#endif
+    state->ncalls++;
+    if (rc != CATERVA_SUCCEED) {
+        state->nfailed++;
+    }
+#if !defined(_WIN32)
+    pthread_mutex_unlock(&state->mutex);
+#endif
+}
+
+
+#if !defined(_WIN32)
+// Keep the worker busy until the gate is opened
+static void test_executor_gate(void *arg, int rc) {
+    test_executor_state_t *state = arg;
+    (void) rc;
+    pthread_mutex_lock(&state->mutex);
+    state->entered = true;
+    pthread_cond_broadcast(&state->cond);
+    while (!state->open) {
+        pthread_cond_wait(&state->cond, &state->mutex);
+    }
+    pthread_mutex_unlock(&state->mutex);
+}
+#endif
+
+
+// Fill the next chunk of an array being appended (in order of chunks) with consecutive values
+static int64_t test_executor_chunk(caterva_array_t *array, int64_t nchunk, uint8_t *chunk,
+                                   int64_t *value) {
+    int64_t nitems = 1;
+    for (int i = array->ndim - 1; i >= 0; --i) {
+        int64_t nchunks = (array->shape[i] + array->chunkshape[i] - 1) / array->chunkshape[i];
+        int64_t coord = nchunk % nchunks;
+        nchunk /= nchunks;
+        int64_t extent = array->shape[i] - coord * array->chunkshape[i];
+        nitems *= extent < array->chunkshape[i] ? extent : array->chunkshape[i];
+    }
+    for (int64_t n = 0; n < nitems * array->itemsize; ++n) {
+        chunk[n] = (uint8_t) ((*value)++ % 251);
+    }
+    return nitems * array->itemsize;
+}
+
+
+CUTEST_TEST_DATA(executor) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(executor) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 3;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 8));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, false},
+    ));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {1000}, {120}, {40}},
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {40, 55, 23}, {11, 5, 22}, {4, 4, 4}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(executor) {
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    storage.properties.blosc.sequencial = backend.sequential;
+    for (int i = 0; i < params.ndim; ++i) {
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+    }
+
+    caterva_array_t *src;
+    caterva_array_t *ref;
+    CATERVA_TEST_ASSERT(caterva_empty(data->ctx, &params, &storage, &src));
+    CATERVA_TEST_ASSERT(caterva_empty(data->ctx, &params, &storage, &ref));
+    int64_t nchunks = src->extnitems / src->extchunknitems;
+
+    test_executor_state_t state = {0};
+#if !defined(_WIN32)
+    pthread_mutex_init(&state.mutex, NULL);
+    pthread_cond_init(&state.cond, NULL);
+#endif
+    caterva_executor_t *executor;
+    CATERVA_TEST_ASSERT(caterva_executor_new(data->ctx, 8, true, &executor));
+
+    /* Append the chunks asynchronously (the last one is tracked) and serially to the reference */
+    int64_t chunksize = src->chunknitems * src->itemsize;
+    uint8_t *chunks = malloc((size_t) (nchunks * chunksize));
+    int64_t value = 0;
+    caterva_future_t *future = NULL;
+    for (int64_t nchunk = 0; nchunk < nchunks; ++nchunk) {
+        uint8_t *chunk = &chunks[nchunk * chunksize];
+        int64_t size = test_executor_chunk(src, nchunk, chunk, &value);
+        CATERVA_TEST_ASSERT(caterva_append(data->ctx, ref, chunk, size));
+        CATERVA_TEST_ASSERT(caterva_append_async(executor, src, chunk, size, test_executor_count,
+                                                 &state,
+                                                 nchunk == nchunks - 1 ? &future : NULL));
+    }
+    int rc;
+    CATERVA_TEST_ASSERT(caterva_future_wait(future, &rc));
+    CATERVA_TEST_ASSERT(rc);
+    CATERVA_TEST_ASSERT(caterva_future_free(&future));
+    CUTEST_ASSERT("Future is not freed", future == NULL);
+    CUTEST_ASSERT("Callbacks are not called", state.ncalls == nchunks && state.nfailed == 0);
+    CUTEST_ASSERT("Array is not filled", src->filled);
+
+    size_t buffersize = (size_t) (src->nitems * itemsize);
+    uint8_t *buffer = malloc(buffersize);
+    uint8_t *result = malloc(buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, ref, buffer, (int64_t) buffersize));
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, src, result, (int64_t) buffersize));
+    CUTEST_ASSERT("Appended array is not correct", memcmp(result, buffer, buffersize) == 0);
+
+    /* Read many (overlapping) slices asynchronously, and compare them with serial reads */
+    caterva_future_t *futures[TEST_EXECUTOR_NSLICES];
+    caterva_slice_request_t slices[TEST_EXECUTOR_NSLICES];
+    uint8_t *expected[TEST_EXECUTOR_NSLICES];
+    uint32_t seed = 12345;
+    for (int n = 0; n < TEST_EXECUTOR_NSLICES; ++n) {
+        caterva_slice_request_t *slice = &slices[n];
+        slice->buffersize = itemsize;
+        for (int i = 0; i < params.ndim; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            int64_t start = (seed >> 8) % shapes.shape[i];
+            seed = seed * 1103515245u + 12345u;
+            int64_t stop = start + 1 + (seed >> 8) % shapes.chunkshape[i];
+            slice->start[i] = start;
+            slice->stop[i] = stop > shapes.shape[i] ? shapes.shape[i] : stop;
+            slice->shape[i] = slice->stop[i] - slice->start[i];
+            slice->buffersize *= slice->shape[i];
+        }
+        slice->buffer = malloc((size_t) slice->buffersize);
+        expected[n] = malloc((size_t) slice->buffersize);
+        CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, ref, slice->start, slice->stop,
+                                                     slice->shape, expected[n],
+                                                     slice->buffersize));
+        CATERVA_TEST_ASSERT(caterva_get_slice_buffer_async(executor, src, slice->start,
+                                                           slice->stop, slice->shape,
+                                                           slice->buffer, slice->buffersize,
+                                                           NULL, NULL, &futures[n]));
+    }
+    for (int n = 0; n < TEST_EXECUTOR_NSLICES; ++n) {
+        CATERVA_TEST_ASSERT(caterva_future_wait(futures[n], &rc));
+        CATERVA_TEST_ASSERT(rc);
+        bool done = false;
+        CATERVA_TEST_ASSERT(caterva_future_test(futures[n], &done, NULL));
+        CUTEST_ASSERT("Future is not done", done);
+        CATERVA_TEST_ASSERT(caterva_future_free(&futures[n]));
+        CUTEST_ASSERT("Slice is not correct",
+                      memcmp(slices[n].buffer, expected[n], (size_t) slices[n].buffersize) == 0);
+    }
+
+    /* An update followed by a read of the same array waits for it */
+    caterva_slice_request_t *slice = &slices[0];
+    for (int64_t n = 0; n < slice->buffersize; ++n) {
+        ((uint8_t *) slice->buffer)[n] = (uint8_t) (n * 7 + 3);
+    }
+    CATERVA_TEST_ASSERT(caterva_set_slice_buffer_async(executor, src, slice->start, slice->stop,
+                                                       slice->buffer, slice->buffersize, NULL,
+                                                       NULL, NULL));
+    memset(expected[0], 0, (size_t) slice->buffersize);
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer_async(executor, src, slice->start, slice->stop,
+                                                       slice->shape, expected[0],
+                                                       slice->buffersize, NULL, NULL, &future));
+    CATERVA_TEST_ASSERT(caterva_future_free(&future));
+    CUTEST_ASSERT("Updated slice is not correct",
+                  memcmp(slice->buffer, expected[0], (size_t) slice->buffersize) == 0);
+
+    /* Failures are reported through the future */
+    slice->stop[0] = shapes.shape[0] + 1;
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer_async(executor, src, slice->start, slice->stop,
+                                                       slice->shape, expected[0],
+                                                       slice->buffersize, NULL, NULL, &future));
+    CATERVA_TEST_ASSERT(caterva_future_wait(future, &rc));
+    CUTEST_ASSERT("Failures must be reported", rc != CATERVA_SUCCEED);
+    CATERVA_TEST_ASSERT(caterva_future_free(&future));
+    CATERVA_TEST_ASSERT(caterva_executor_free(&executor));
+    CUTEST_ASSERT("Executor is not freed", executor == NULL);
+
+#if !defined(_WIN32)
+    /* A non blocking executor rejects the requests once its queue is full */
+    caterva_config_t cfg = *data->ctx->cfg;
+    cfg.nthreads = 1;
+    caterva_ctx_t *ctx;
+    CATERVA_TEST_ASSERT(caterva_ctx_new(&cfg, &ctx));
+    CATERVA_TEST_ASSERT(caterva_executor_new(ctx, 1, false, &executor));
+    slice = &slices[1];
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer_async(executor, src, slice->start, slice->stop,
+                                                       slice->shape, slice->buffer,
+                                                       slice->buffersize, test_executor_gate,
+                                                       &state, NULL));
+    pthread_mutex_lock(&state.mutex);
+    while (!state.entered) {
+        pthread_cond_wait(&state.cond, &state.mutex);
+    }
+    pthread_mutex_unlock(&state.mutex);
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer_async(executor, src, slice->start, slice->stop,
+                                                       slice->shape, slice->buffer,
+                                                       slice->buffersize, NULL, NULL, &future));
+    CUTEST_ASSERT("Requests must be rejected when the queue is full",
+                  caterva_get_slice_buffer_async(executor, src, slice->start, slice->stop,
+                                                 slice->shape, slice->buffer, slice->buffersize,
+                                                 NULL, NULL, NULL) == CATERVA_ERR_QUEUE_FULL);
+    pthread_mutex_lock(&state.mutex);
+    state.open = true;
+    pthread_cond_broadcast(&state.cond);
+    pthread_mutex_unlock(&state.mutex);
+    CATERVA_TEST_ASSERT(caterva_future_free(&future));
+    CATERVA_TEST_ASSERT(caterva_executor_free(&executor));
+    CATERVA_TEST_ASSERT(caterva_ctx_free(&ctx));
+
+    pthread_mutex_destroy(&state.mutex);
+    pthread_cond_destroy(&state.cond);
+#endif
+
+    /* Free mallocs */
+    for (int n = 0; n < TEST_EXECUTOR_NSLICES; ++n) {
+        free(slices[n].buffer);
+        free(expected[n]);
+    }
+    free(chunks);
+    free(buffer);
+    free(result);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &ref));
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(executor) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(executor);
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+#include <math.h>
+
+
+CUTEST_TEST_DATA(expr) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(expr) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {1000}, {100}, {25}},
+            {2, {100, 77}, {20, 30}, {7, 10}},
+            {3, {40, 61, 30}, {10, 20, 11}, {5, 5, 4}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(expr) {
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+
+    caterva_params_t params = {0};
+    params.ndim = shapes.ndim;
+    caterva_storage_t storage = {0};
+    storage.backend = CATERVA_STORAGE_BLOSC;
+    int64_t nitems = 1;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+        nitems *= shapes.shape[i];
+    }
+
+    /* The operands have different types */
+    double *a_buffer = malloc((size_t) nitems * sizeof(double));
+    int32_t *b_buffer = malloc((size_t) nitems * sizeof(int32_t));
+    for (int64_t i = 0; i < nitems; ++i) {
+        a_buffer[i] = (double) i;
+        b_buffer[i] = (int32_t) (i % 7) - 3;
+    }
+    caterva_array_t *a;
+    params.itemsize = sizeof(double);
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, a_buffer, nitems * sizeof(double), &params,
+                                            &storage, &a));
+    caterva_array_t *b;
+    params.itemsize = sizeof(int32_t);
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, b_buffer, nitems * sizeof(int32_t),
+                                            &params, &storage, &b));
+
+    /* a * b + 2 */
+    caterva_expr_t *ea;
+    caterva_expr_t *eb;
+    caterva_expr_t *two;
+    caterva_expr_t *mul;
+    caterva_expr_t *expr;
+    CATERVA_TEST_ASSERT(caterva_expr_array(data->ctx, a, CATERVA_DTYPE_FLOAT64, &ea));
+    CATERVA_TEST_ASSERT(caterva_expr_array(data->ctx, b, CATERVA_DTYPE_INT32, &eb));
+    CATERVA_TEST_ASSERT(caterva_expr_scalar(data->ctx, 2, &two));
+    CATERVA_TEST_ASSERT(caterva_expr_op(data->ctx, CATERVA_OP_MUL, ea, eb, &mul));
+    CATERVA_TEST_ASSERT(caterva_expr_op(data->ctx, CATERVA_OP_ADD, mul, two, &expr));
+
+    caterva_storage_t result_storage = {0};
+    result_storage.backend = CATERVA_STORAGE_BLOSC;
+    caterva_array_t *result;
+    CATERVA_TEST_ASSERT(caterva_expr_eval(data->ctx, expr, CATERVA_DTYPE_FLOAT64,
+                                          &result_storage, &result));
+    double *expected = malloc((size_t) nitems * sizeof(double));
+    for (int64_t i = 0; i < nitems; ++i) {
+        expected[i] = a_buffer[i] * b_buffer[i] + 2;
+    }
+    double *dest = malloc((size_t) nitems * sizeof(double));
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, result, dest, nitems * sizeof(double)));
+    CUTEST_ASSERT("Elements are not equals!",
+                  memcmp(expected, dest, (size_t) nitems * sizeof(double)) == 0);
+
+    /* The sum of all the items, and the maximum along the first and the last axes */
+    double sum;
+    CATERVA_TEST_ASSERT(caterva_expr_reduce(data->ctx, expr, CATERVA_REDUCE_SUM, -1, &sum,
+                                            sizeof(double)));
+    double expected_sum = 0;
+    for (int64_t i = 0; i < nitems; ++i) {
+        expected_sum += expected[i];
+    }
+    CUTEST_ASSERT("Sum is not correct", sum == expected_sum);
+
+    int8_t axes[2] = {0, (int8_t) (params.ndim - 1)};
+    for (int n = 0; n < 2; ++n) {
+        int8_t axis = axes[n];
+        int64_t inner = 1;
+        for (int i = axis + 1; i < params.ndim; ++i) {
+            inner *= params.shape[i];
+        }
+        int64_t nresult = nitems / params.shape[axis];
+        for (int64_t i = 0; i < nresult; ++i) {
+            dest[i] = -INFINITY;
+        }
+        for (int64_t i = 0; i < nitems; ++i) {
+            int64_t index = i / (inner * params.shape[axis]) * inner + i % inner;
+            dest[index] = expected[i] > dest[index] ? expected[i] : dest[index];
+        }
+        double *maxima = malloc((size_t) nresult * sizeof(double));
+        CATERVA_TEST_ASSERT(caterva_expr_reduce(data->ctx, expr, CATERVA_REDUCE_MAX, axis,
+                                                maxima, nresult * sizeof(double)));
+        CUTEST_ASSERT("Maxima are not correct",
+                      memcmp(maxima, dest, (size_t) nresult * sizeof(double)) == 0);
+        free(maxima);
+    }
+
+    /* The arrays must have the same chunks */
+    caterva_array_t *c;
+    params.itemsize = sizeof(double);
+    storage.properties.blosc.chunkshape[0] = shapes.chunkshape[0] / 2;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, a_buffer, nitems * sizeof(double), &params,
+                                            &storage, &c));
+    caterva_expr_t *ec;
+    CATERVA_TEST_ASSERT(caterva_expr_array(data->ctx, c, CATERVA_DTYPE_FLOAT64, &ec));
+    caterva_expr_t *wrong = NULL;
+    CUTEST_ASSERT("Arrays with other chunks must fail",
+                  caterva_expr_op(data->ctx, CATERVA_OP_ADD, expr, ec, &wrong) ==
+                  CATERVA_ERR_INVALID_ARGUMENT);
+
+    /* Free mallocs */
+    free(a_buffer);
+    free(b_buffer);
+    free(expected);
+    free(dest);
+    CATERVA_TEST_ASSERT(caterva_expr_free(&expr));
+    CATERVA_TEST_ASSERT(caterva_expr_free(&ec));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &a));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &b));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &c));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &result));
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(expr) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(expr);
+}
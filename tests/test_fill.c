@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+#ifdef __GNUC__
+#include <unistd.h>
+#define FILE_EXISTS(urlpath) access(urlpath, F_OK)
+#else
+#include <io.h>
+#define FILE_EXISTS(urlpath) _access(urlpath, 0)
+#endif
+
+
+CUTEST_TEST_DATA(fill) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(fill) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 8));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_PLAINBUFFER, false, false},
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, true},
+    ));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {1000}, {100}, {25}},
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {40, 60, 30}, {10, 20, 10}, {5, 5, 5}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(fill) {
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+
+    char *urlpath = "test_fill.b2frame";
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+
+    uint8_t fillvalue[8] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x08};
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    if (backend.backend == CATERVA_STORAGE_BLOSC) {
+        storage.properties.blosc.sequencial = backend.sequential;
+        if (backend.persistent) {
+            storage.properties.blosc.urlpath = urlpath;
+        }
+        for (int i = 0; i < params.ndim; ++i) {
+            storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+            storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+        }
+    }
+
+    /* Only the first quarter of the items are not zero */
+    int64_t nitems = 1;
+    for (int i = 0; i < params.ndim; ++i) {
+        nitems *= shapes.shape[i];
+    }
+    int64_t buffersize = nitems * itemsize;
+    uint8_t *buffer = malloc((size_t) buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, nitems / 4));
+    memset(buffer + nitems / 4 * itemsize, 0, (size_t) (buffersize - nitems / 4 * itemsize));
+
+    caterva_array_t *array;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &array));
+    CUTEST_ASSERT("Fill value is not 0 by default", array->fillvalue == NULL);
+    CATERVA_TEST_ASSERT(caterva_set_fillvalue(data->ctx, array, fillvalue));
+    CUTEST_ASSERT("Fill value is not correct", array->fillvalue != NULL &&
+                                               memcmp(array->fillvalue, fillvalue, itemsize) == 0);
+
+    /* The chunks of zeros are not decompressed */
+    CATERVA_TEST_ASSERT(caterva_set_counters(data->ctx, array, true));
+    uint8_t *buffer_dest = malloc((size_t) buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, array, buffer_dest, buffersize));
+    CUTEST_ASSERT("Elements are not equals!", memcmp(buffer, buffer_dest, buffersize) == 0);
+    if (backend.backend == CATERVA_STORAGE_BLOSC) {
+        caterva_counters_t counters;
+        CATERVA_TEST_ASSERT(caterva_get_counters(data->ctx, array, &counters));
+        int64_t nchunks = array->extnitems / array->chunknitems;
+        CUTEST_ASSERT("Chunks of zeros are decompressed",
+                      counters.nchunks_decompressed > 0 &&
+                      counters.nchunks_decompressed < nchunks);
+    }
+
+    /* The items added by a resize hold the fill value */
+    int64_t new_shape[CATERVA_MAX_DIM];
+    for (int i = 0; i < params.ndim; ++i) {
+        new_shape[i] = shapes.shape[i];
+    }
+    new_shape[0] += shapes.chunkshape[0] + 3;
+    CATERVA_TEST_ASSERT(caterva_resize(data->ctx, array, new_shape));
+    if (backend.persistent) {
+        CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+        CATERVA_TEST_ASSERT(caterva_open(data->ctx, urlpath, &array));
+        CUTEST_ASSERT("Fill value is not kept", array->fillvalue != NULL &&
+                      memcmp(array->fillvalue, fillvalue, itemsize) == 0);
+    }
+
+    int64_t new_nitems = array->nitems;
+    uint8_t *resized = malloc((size_t) (new_nitems * itemsize));
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, array, resized, new_nitems * itemsize));
+    CUTEST_ASSERT("Elements are not equals!", memcmp(buffer, resized, buffersize) == 0);
+    for (int64_t i = nitems; i < new_nitems; ++i) {
+        CUTEST_ASSERT("New items do not hold the fill value",
+                      memcmp(resized + i * itemsize, fillvalue, itemsize) == 0);
+    }
+
+    /* The fill value goes back to 0 */
+    CATERVA_TEST_ASSERT(caterva_set_fillvalue(data->ctx, array, NULL));
+    CUTEST_ASSERT("Fill value is not reset", array->fillvalue == NULL);
+    if (backend.persistent) {
+        CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+        CATERVA_TEST_ASSERT(caterva_open(data->ctx, urlpath, &array));
+        CUTEST_ASSERT("Fill value is not reset", array->fillvalue == NULL);
+    }
+
+    /* Free mallocs */
+    free(buffer);
+    free(buffer_dest);
+    free(resized);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(fill) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(fill);
+}
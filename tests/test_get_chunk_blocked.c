@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+
+CUTEST_TEST_DATA(get_chunk_blocked) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(get_chunk_blocked) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 8));
+    CUTEST_PARAMETRIZE(cached, bool, CUTEST_DATA(false, true));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {100}, {20}, {5}},
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {100, 55, 123}, {31, 5, 22}, {4, 4, 4}},
+            {3, {40, 30, 20}, {10, 6, 20}, {5, 6, 20}}, // contiguous
+            {3, {40, 30, 20}, {10, 6, 20}, {1, 3, 20}}, // contiguous
+            {4, {50, 16, 31, 12}, {25, 8, 20, 10}, {5, 5, 5, 10}},
+    ));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, false},
+    ));
+}
+
+
+CUTEST_TEST_TEST(get_chunk_blocked) {
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+    CUTEST_GET_PARAMETER(cached, bool);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    storage.properties.blosc.sequencial = backend.sequential;
+    for (int i = 0; i < params.ndim; ++i) {
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+    }
+
+    /* Create original data */
+    int64_t strides[CATERVA_MAX_DIM];
+    size_t buffersize = itemsize;
+    for (int i = params.ndim - 1; i >= 0; --i) {
+        strides[i] = (int64_t) (buffersize / itemsize);
+        buffersize *= (size_t) params.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &src));
+    if (cached) {
+        CATERVA_TEST_ASSERT(caterva_set_cache_size(data->ctx, src, INT32_MAX));
+    }
+
+    int64_t nchunks = 1;
+    int64_t chunks_shape[CATERVA_MAX_DIM];
+    size_t chunksize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        chunks_shape[i] = (src->shape[i] + src->chunkshape[i] - 1) / src->chunkshape[i];
+        nchunks *= chunks_shape[i];
+        chunksize *= src->chunkshape[i];
+    }
+
+    caterva_chunk_layout_t layout;
+    int64_t coords[CATERVA_MAX_DIM] = {0};
+    CATERVA_TEST_ASSERT(caterva_get_chunk_blocked(data->ctx, src, coords, NULL, 0, &layout));
+    uint8_t *blocked = malloc(layout.nbytes);
+    uint8_t *chunk = malloc(chunksize);
+
+    // Read every chunk twice, so that the second read comes from the cache (if any)
+    for (int64_t n = 0; n < 2 * nchunks; ++n) {
+        int64_t rem = n % nchunks;
+        for (int i = params.ndim - 1; i >= 0; --i) {
+            coords[i] = rem % chunks_shape[i];
+            rem /= chunks_shape[i];
+        }
+        CATERVA_TEST_ASSERT(caterva_get_chunk_blocked(data->ctx, src, coords, blocked,
+                                                      layout.nbytes, &layout));
+        CUTEST_ASSERT("Layout is not correct", layout.nblocks * layout.blocknitems * itemsize ==
+                                               layout.nbytes);
+
+        /* Check every item of the blocked chunk against the original data */
+        int64_t nblocks_shape[CATERVA_MAX_DIM];
+        for (int i = 0; i < layout.ndim; ++i) {
+            nblocks_shape[i] = layout.extchunkshape[i] / layout.blockshape[i];
+        }
+        for (int64_t nitem = 0; nitem < layout.nblocks * layout.blocknitems; ++nitem) {
+            int64_t block_rem = nitem / layout.blocknitems;
+            int64_t item_rem = nitem % layout.blocknitems;
+            bool inside = true;
+            int64_t offset = 0;
+            for (int i = layout.ndim - 1; i >= 0; --i) {
+                int64_t index = layout.start[i] +
+                                (block_rem % nblocks_shape[i]) * layout.blockshape[i] +
+                                item_rem % layout.blockshape[i];
+                block_rem /= nblocks_shape[i];
+                item_rem /= layout.blockshape[i];
+                if (index >= layout.start[i] + layout.shape[i]) {
+                    inside = false;
+                }
+                offset += index * strides[i];
+            }
+            if (inside) {
+                CUTEST_ASSERT("Blocked chunk is not correct",
+                              memcmp(&blocked[nitem * itemsize], &buffer[offset * itemsize],
+                                     itemsize) == 0);
+            }
+        }
+
+        /* Chunks fully inside the array can be read directly into a buffer */
+        int64_t start[CATERVA_MAX_DIM];
+        int64_t stop[CATERVA_MAX_DIM];
+        int64_t shape[CATERVA_MAX_DIM];
+        bool full = true;
+        for (int i = 0; i < params.ndim; ++i) {
+            start[i] = layout.start[i];
+            stop[i] = start[i] + layout.shape[i];
+            shape[i] = layout.shape[i];
+            full = full && layout.shape[i] == src->chunkshape[i];
+        }
+        if (!full) {
+            continue;
+        }
+        CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, src, start, stop, shape, chunk,
+                                                     (int64_t) chunksize));
+        if (layout.contiguous) {
+            CUTEST_ASSERT("Contiguous chunk is not correct",
+                          memcmp(chunk, blocked, chunksize) == 0);
+        }
+        for (int64_t nitem = 0; nitem < (int64_t) (chunksize / itemsize); ++nitem) {
+            int64_t item_rem = nitem;
+            int64_t offset = 0;
+            for (int i = params.ndim - 1; i >= 0; --i) {
+                offset += (start[i] + item_rem % shape[i]) * strides[i];
+                item_rem /= shape[i];
+            }
+            CUTEST_ASSERT("Chunk is not correct", memcmp(&chunk[nitem * itemsize],
+                                                         &buffer[offset * itemsize],
+                                                         itemsize) == 0);
+        }
+    }
+
+    /* Plain buffers have no blocks */
+    caterva_array_t *plain;
+    caterva_storage_t plain_storage = {0};
+    plain_storage.backend = CATERVA_STORAGE_PLAINBUFFER;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &plain_storage,
+                                            &plain));
+    for (int i = 0; i < params.ndim; ++i) {
+        coords[i] = 0;
+    }
+    CUTEST_ASSERT("Plain buffers have no blocked layout",
+                  caterva_get_chunk_blocked(data->ctx, plain, coords, NULL, 0, &layout) ==
+                  CATERVA_ERR_INVALID_STORAGE);
+
+    /* Free mallocs */
+    free(buffer);
+    free(blocked);
+    free(chunk);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &plain));
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(get_chunk_blocked) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(get_chunk_blocked);
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+#define TEST_NREQUESTS 50
+
+
+CUTEST_TEST_DATA(get_slice_buffers) {
+    void *unused;
+};
+
+
+CUTEST_TEST_SETUP(get_slice_buffers) {
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 4, 8));
+    CUTEST_PARAMETRIZE(nthreads, int16_t, CUTEST_DATA(1, 3));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_PLAINBUFFER, false, false},
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, false},
+    ));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {1000}, {120}, {40}},
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {40, 55, 23}, {11, 5, 22}, {4, 4, 4}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(get_slice_buffers) {
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+    CUTEST_GET_PARAMETER(nthreads, int16_t);
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = nthreads;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_t *ctx;
+    CATERVA_TEST_ASSERT(caterva_ctx_new(&cfg, &ctx));
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    if (backend.backend == CATERVA_STORAGE_BLOSC) {
+        storage.properties.blosc.sequencial = backend.sequential;
+        for (int i = 0; i < params.ndim; ++i) {
+            storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+            storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+        }
+    }
+
+    /* Create original data */
+    size_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        buffersize *= (size_t) params.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(ctx, buffer, buffersize, &params, &storage, &src));
+
+    /* Small overlapping boxes around a few centers, plus some larger ones and an empty one */
+    caterva_slice_request_t requests[TEST_NREQUESTS];
+    uint8_t *expected[TEST_NREQUESTS];
+    uint32_t seed = 12345;
+    for (int n = 0; n < TEST_NREQUESTS; ++n) {
+        caterva_slice_request_t *request = &requests[n];
+        request->buffersize = itemsize;
+        for (int i = 0; i < params.ndim; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            int64_t extent = n % 10 == 0 ? shapes.shape[i] / 2 : 1 + (seed >> 16) % 8;
+            int64_t center = (n % 3 + 1) * shapes.shape[i] / 4;
+            seed = seed * 1103515245u + 12345u;
+            int64_t start = center - (int64_t) ((seed >> 16) % 8);
+            start = start < 0 ? 0 : start;
+            int64_t stop = start + extent;
+            stop = stop > shapes.shape[i] ? shapes.shape[i] : stop;
+            if (n == TEST_NREQUESTS - 1) {
+                stop = start;
+            }
+            request->start[i] = start;
+            request->stop[i] = stop;
+            // Some of the buffers are larger than their slices
+            request->shape[i] = stop - start + (n % 4 == 1 ? 1 : 0);
+            request->buffersize *= request->shape[i];
+        }
+        request->buffer = malloc((size_t) request->buffersize + 1);
+        memset(request->buffer, 0, (size_t) request->buffersize);
+        expected[n] = malloc((size_t) request->buffersize + 1);
+        memset(expected[n], 0, (size_t) request->buffersize);
+        CATERVA_TEST_ASSERT(caterva_get_slice_buffer(ctx, src, request->start, request->stop,
+                                                     request->shape, expected[n],
+                                                     request->buffersize));
+    }
+
+    /* The batch must give the same results as the separate reads */
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffers(ctx, src, requests, TEST_NREQUESTS));
+    for (int n = 0; n < TEST_NREQUESTS; ++n) {
+        CUTEST_ASSERT("Slice is not correct",
+                      memcmp(requests[n].buffer, expected[n],
+                             (size_t) requests[n].buffersize) == 0);
+    }
+
+    /* Slices outside the array are rejected */
+    requests[0].stop[0] = shapes.shape[0] + 1;
+    requests[0].shape[0] = requests[0].stop[0] - requests[0].start[0];
+    CUTEST_ASSERT("Slices outside the array must be rejected",
+                  caterva_get_slice_buffers(ctx, src, requests, TEST_NREQUESTS) ==
+                  CATERVA_ERR_INVALID_ARGUMENT);
+
+    /* Free mallocs */
+    for (int n = 0; n < TEST_NREQUESTS; ++n) {
+        free(requests[n].buffer);
+        free(expected[n]);
+    }
+    free(buffer);
+    CATERVA_TEST_ASSERT(caterva_free(ctx, &src));
+    CATERVA_TEST_ASSERT(caterva_ctx_free(&ctx));
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(get_slice_buffers) {
+    (void) data;
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(get_slice_buffers);
+}
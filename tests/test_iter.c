@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+
+CUTEST_TEST_DATA(iter) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(iter) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 8));
+    CUTEST_PARAMETRIZE(prefetch, int, CUTEST_DATA(0, 1, 3));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {100}, {20}, {5}},
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {100, 55, 123}, {31, 5, 22}, {4, 4, 4}},
+            {3, {100, 0, 12}, {31, 0, 12}, {10, 0, 12}},
+            {3, {40, 30, 20}, {10, 6, 20}, {5, 6, 20}}, // contiguous chunks
+    ));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_PLAINBUFFER, false, false},
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, false},
+    ));
+}
+
+
+CUTEST_TEST_TEST(iter) {
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+    CUTEST_GET_PARAMETER(prefetch, int);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    storage.properties.blosc.sequencial = backend.sequential;
+    for (int i = 0; i < params.ndim; ++i) {
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+    }
+
+    /* Create original data */
+    int64_t strides[CATERVA_MAX_DIM];
+    int64_t buffersize = itemsize;
+    for (int i = params.ndim - 1; i >= 0; --i) {
+        strides[i] = buffersize / itemsize;
+        buffersize *= shapes.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &src));
+
+    /* Rebuild the array from the regions and check that every item is visited once */
+    uint8_t *dest = malloc(buffersize);
+    memset(dest, 0, buffersize);
+    int64_t nvisited = 0;
+    int64_t nregions = 0;
+
+    caterva_iter_t *iter;
+    CATERVA_TEST_ASSERT(caterva_iter_new(data->ctx, src, prefetch, &iter));
+    caterva_iter_region_t region;
+    bool done;
+    while (true) {
+        CATERVA_TEST_ASSERT(caterva_iter_next(iter, &region, &done));
+        if (done) {
+            break;
+        }
+        CUTEST_ASSERT("Regions are not in storage order", region.nchunk == nregions);
+        nregions++;
+
+        int64_t nitems = region.buffersize / itemsize;
+        uint8_t *bregion = region.buffer;
+        for (int64_t nitem = 0; nitem < nitems; ++nitem) {
+            int64_t item_rem = nitem;
+            int64_t offset = 0;
+            for (int i = params.ndim - 1; i >= 0; --i) {
+                offset += (region.start[i] + item_rem % region.shape[i]) * strides[i];
+                item_rem /= region.shape[i];
+            }
+            memcpy(&dest[offset * itemsize], &bregion[nitem * itemsize], itemsize);
+        }
+        nvisited += nitems;
+    }
+    CATERVA_TEST_ASSERT(caterva_iter_free(&iter));
+
+    CUTEST_ASSERT("Items visited more than once", nvisited == buffersize / itemsize);
+    CUTEST_ASSERT("Regions are not correct", memcmp(buffer, dest, buffersize) == 0);
+
+    /* Stop iterating in the middle */
+    CATERVA_TEST_ASSERT(caterva_iter_new(data->ctx, src, prefetch, &iter));
+    CATERVA_TEST_ASSERT(caterva_iter_next(iter, &region, &done));
+    CATERVA_TEST_ASSERT(caterva_iter_free(&iter));
+
+    /* Free mallocs */
+    free(buffer);
+    free(dest);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(iter) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(iter);
+}
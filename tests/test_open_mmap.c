@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+#ifdef __GNUC__
+#include <unistd.h>
+#define FILE_EXISTS(urlpath) access(urlpath, F_OK)
+#else
+#include <io.h>
+#define FILE_EXISTS(urlpath) _access(urlpath, 0)
+#endif
+
+
+CUTEST_TEST_DATA(open_mmap) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(open_mmap) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 8));
+    CUTEST_PARAMETRIZE(pattern, caterva_access_t, CUTEST_DATA(
+            CATERVA_ACCESS_NORMAL,
+            CATERVA_ACCESS_SEQUENTIAL,
+            CATERVA_ACCESS_RANDOM,
+            CATERVA_ACCESS_AUTO,
+    ));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {100}, {20}, {5}},
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {100, 55, 123}, {31, 5, 22}, {4, 4, 4}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(open_mmap) {
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+    CUTEST_GET_PARAMETER(pattern, caterva_access_t);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+
+    char *urlpath = "test_open_mmap.b2frame";
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = CATERVA_STORAGE_BLOSC;
+    storage.properties.blosc.urlpath = urlpath;
+    storage.properties.blosc.sequencial = true;
+    for (int i = 0; i < params.ndim; ++i) {
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+    }
+
+    /* Create original data */
+    int64_t strides[CATERVA_MAX_DIM];
+    int64_t buffersize = itemsize;
+    for (int i = params.ndim - 1; i >= 0; --i) {
+        strides[i] = buffersize / itemsize;
+        buffersize *= shapes.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &src));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+
+    caterva_array_t *array;
+    CATERVA_TEST_ASSERT(caterva_open_mmap(data->ctx, urlpath, pattern, &array));
+    CUTEST_ASSERT("The array is not mapped", array->mmap != NULL);
+
+    /* Read the chunks forwards and then backwards */
+    int64_t nchunks = 1;
+    int64_t chunks_shape[CATERVA_MAX_DIM];
+    int64_t chunksize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        chunks_shape[i] = (shapes.shape[i] + shapes.chunkshape[i] - 1) / shapes.chunkshape[i];
+        nchunks *= chunks_shape[i];
+        chunksize *= shapes.chunkshape[i];
+    }
+    uint8_t *chunk = malloc(chunksize);
+    for (int64_t n = 0; n < 2 * nchunks; ++n) {
+        int64_t rem = n < nchunks ? n : 2 * nchunks - 1 - n;
+        int64_t start[CATERVA_MAX_DIM];
+        int64_t stop[CATERVA_MAX_DIM];
+        int64_t shape[CATERVA_MAX_DIM];
+        int64_t nitems = 1;
+        for (int i = params.ndim - 1; i >= 0; --i) {
+            start[i] = (rem % chunks_shape[i]) * shapes.chunkshape[i];
+            rem /= chunks_shape[i];
+            stop[i] = start[i] + shapes.chunkshape[i];
+            if (stop[i] > shapes.shape[i]) {
+                stop[i] = shapes.shape[i];
+            }
+            shape[i] = stop[i] - start[i];
+            nitems *= shape[i];
+        }
+        CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, array, start, stop, shape, chunk,
+                                                     chunksize));
+        for (int64_t nitem = 0; nitem < nitems; ++nitem) {
+            int64_t item_rem = nitem;
+            int64_t offset = 0;
+            for (int i = params.ndim - 1; i >= 0; --i) {
+                offset += (start[i] + item_rem % shape[i]) * strides[i];
+                item_rem /= shape[i];
+            }
+            CUTEST_ASSERT("Chunk is not correct", memcmp(&chunk[nitem * itemsize],
+                                                         &buffer[offset * itemsize],
+                                                         itemsize) == 0);
+        }
+    }
+
+    uint8_t *buffer_dest = malloc(buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, array, buffer_dest, buffersize));
+    CUTEST_ASSERT("Elements are not equals!", memcmp(buffer, buffer_dest, buffersize) == 0);
+
+    /* Mapped arrays can not be modified */
+    int64_t start[CATERVA_MAX_DIM] = {0};
+    int64_t stop[CATERVA_MAX_DIM];
+    for (int i = 0; i < params.ndim; ++i) {
+        stop[i] = shapes.shape[i];
+    }
+    CUTEST_ASSERT("Mapped arrays must be read-only",
+                  caterva_set_slice_buffer(data->ctx, buffer, buffersize, start, stop, array) ==
+                  CATERVA_ERR_READ_ONLY);
+
+    /* Free mallocs */
+    free(buffer);
+    free(buffer_dest);
+    free(chunk);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(open_mmap) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(open_mmap);
+}
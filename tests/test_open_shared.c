@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+#ifdef __GNUC__
+#include <unistd.h>
+#define FILE_EXISTS(urlpath) access(urlpath, F_OK)
+#else
+#include <io.h>
+#define FILE_EXISTS(urlpath) _access(urlpath, 0)
+#endif
+
+
+CUTEST_TEST_DATA(open_shared) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(open_shared) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 8));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {100}, {20}, {5}},
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {100, 55, 123}, {31, 5, 22}, {4, 4, 4}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(open_shared) {
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+
+    char *urlpath = "test_open_shared.b2frame";
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+
+    caterva_params_t params = {0};
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = CATERVA_STORAGE_BLOSC;
+    storage.properties.blosc.urlpath = urlpath;
+    storage.properties.blosc.sequencial = true;
+    for (int i = 0; i < params.ndim; ++i) {
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+    }
+
+    /* Create original data */
+    int64_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        buffersize *= shapes.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &src));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+
+    /* The handles of the same file share the super-chunk, even with other contexts and paths */
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    caterva_ctx_t *ctx;
+    CATERVA_TEST_ASSERT(caterva_ctx_new(&cfg, &ctx));
+    caterva_array_t *array;
+    CATERVA_TEST_ASSERT(caterva_open_shared(data->ctx, urlpath, &array));
+    caterva_array_t *array2;
+    CATERVA_TEST_ASSERT(caterva_open_shared(ctx, "./test_open_shared.b2frame", &array2));
+    CUTEST_ASSERT("The super-chunk is not shared", array->sc == array2->sc);
+    CUTEST_ASSERT("The arrays are not the same", array->shared == array2->shared);
+
+    /* Every handle has its own cache */
+    CATERVA_TEST_ASSERT(caterva_set_cache_size(data->ctx, array,
+                                               2 * array->extchunknitems * itemsize));
+    CUTEST_ASSERT("The cache is shared", array2->cache == NULL);
+
+    uint8_t *buffer_dest = malloc(buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, array, buffer_dest, buffersize));
+    CUTEST_ASSERT("Elements are not equals!", memcmp(buffer, buffer_dest, buffersize) == 0);
+
+    /* Shared arrays can not be modified */
+    int64_t start[CATERVA_MAX_DIM] = {0};
+    int64_t stop[CATERVA_MAX_DIM];
+    for (int i = 0; i < params.ndim; ++i) {
+        stop[i] = shapes.shape[i];
+    }
+    CUTEST_ASSERT("Shared arrays must be read-only",
+                  caterva_set_slice_buffer(data->ctx, buffer, buffersize, start, stop, array) ==
+                  CATERVA_ERR_READ_ONLY);
+
+    /* The array is kept open while a handle is alive, and opened again afterwards */
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+    memset(buffer_dest, 0, buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(ctx, array2, buffer_dest, buffersize));
+    CUTEST_ASSERT("Elements are not equals!", memcmp(buffer, buffer_dest, buffersize) == 0);
+    CATERVA_TEST_ASSERT(caterva_free(ctx, &array2));
+    CATERVA_TEST_ASSERT(caterva_ctx_free(&ctx));
+
+    CATERVA_TEST_ASSERT(caterva_open_shared(data->ctx, urlpath, &array));
+    memset(buffer_dest, 0, buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, array, buffer_dest, buffersize));
+    CUTEST_ASSERT("Elements are not equals!", memcmp(buffer, buffer_dest, buffersize) == 0);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+
+    CUTEST_ASSERT("Missing files can not be opened",
+                  caterva_open_shared(data->ctx, "test_open_shared_missing.b2frame", &array) ==
+                  CATERVA_ERR_INVALID_ARGUMENT);
+
+    /* Free mallocs */
+    free(buffer);
+    free(buffer_dest);
+
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(open_shared) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(open_shared);
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+
+CUTEST_TEST_DATA(parallel_from_buffer) {
+    caterva_ctx_t *ctx;
+    caterva_ctx_t *ctx_serial;
+};
+
+
+CUTEST_TEST_SETUP(parallel_from_buffer) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 4;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+    cfg.nthreads = 1;
+    caterva_ctx_new(&cfg, &data->ctx_serial);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 2, 4, 8));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {10}, {7}, {2}}, // 1-idim
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {100, 55, 123}, {31, 5, 22}, {4, 4, 4}},
+            {4, {50, 160, 31, 12}, {25, 20, 20, 10}, {5, 5, 5, 10}},
+            {6, {5, 1, 200, 3, 1, 2}, {5, 1, 50, 2, 1, 2}, {2, 1, 20, 2, 1, 2}}
+    ));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, false},
+            {CATERVA_STORAGE_BLOSC, true, true},
+    ));
+}
+
+
+CUTEST_TEST_TEST(parallel_from_buffer) {
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    if (backend.persistent) {
+        storage.properties.blosc.urlpath = "test_parallel_from_buffer.b2frame";
+    }
+    storage.properties.blosc.sequencial = backend.sequential;
+    for (int i = 0; i < params.ndim; ++i) {
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+    }
+
+    /* Create original data */
+    size_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        buffersize *= (size_t) params.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    /* Create the same array using the parallel and the serial path */
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &src));
+    storage.properties.blosc.urlpath = NULL;
+    caterva_array_t *src_serial;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx_serial, buffer, buffersize, &params,
+                                            &storage, &src_serial));
+
+    CUTEST_ASSERT("Array is not filled", src->filled);
+    CUTEST_ASSERT("Number of chunks are not equals", src->nchunks == src_serial->nchunks);
+    CUTEST_ASSERT("Number of chunks are not equals", src->sc->nchunks == src_serial->sc->nchunks);
+
+    /* The compressed chunks must be identical */
+    for (int nchunk = 0; nchunk < src->sc->nchunks; ++nchunk) {
+        uint8_t *chunk;
+        bool needs_free;
+        int cbytes = blosc2_schunk_get_chunk(src->sc, nchunk, &chunk, &needs_free);
+        uint8_t *chunk_serial;
+        bool needs_free_serial;
+        int cbytes_serial = blosc2_schunk_get_chunk(src_serial->sc, nchunk, &chunk_serial,
+                                                    &needs_free_serial);
+        CUTEST_ASSERT("Compressed sizes are not equals", cbytes == cbytes_serial);
+        CATERVA_TEST_ASSERT_BUFFER(chunk, chunk_serial, cbytes);
+        if (needs_free) {
+            free(chunk);
+        }
+        if (needs_free_serial) {
+            free(chunk_serial);
+        }
+    }
+
+    /* Fill dest array with caterva_array_t data */
+    uint8_t *buffer_dest = malloc(buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, src, buffer_dest, buffersize));
+    CATERVA_TEST_ASSERT_BUFFER(buffer, buffer_dest, (int) buffersize);
+
+    /* Free mallocs */
+    free(buffer);
+    free(buffer_dest);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx_serial, &src_serial));
+
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(parallel_from_buffer) {
+    caterva_ctx_free(&data->ctx);
+    caterva_ctx_free(&data->ctx_serial);
+}
+
+int main() {
+    CUTEST_TEST_RUN(parallel_from_buffer);
+}
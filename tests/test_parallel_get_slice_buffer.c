@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+typedef struct {
+    int8_t ndim;
+    int64_t shape[CATERVA_MAX_DIM];
+    int32_t chunkshape[CATERVA_MAX_DIM];
+    int32_t blockshape[CATERVA_MAX_DIM];
+    int64_t start[CATERVA_MAX_DIM];
+    int64_t stop[CATERVA_MAX_DIM];
+} test_parallel_shapes_t;
+
+
+CUTEST_TEST_DATA(parallel_get_slice_buffer) {
+    caterva_ctx_t *ctx;
+    caterva_ctx_t *ctx_serial;
+};
+
+
+CUTEST_TEST_SETUP(parallel_get_slice_buffer) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 4;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+    cfg.nthreads = 1;
+    caterva_ctx_new(&cfg, &data->ctx_serial);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 8));
+    CUTEST_PARAMETRIZE(shapes, test_parallel_shapes_t, CUTEST_DATA(
+            {1, {100}, {7}, {2}, {3}, {95}}, // 1-idim
+            {2, {100, 100}, {20, 20}, {10, 10}, {5, 13}, {87, 100}},
+            {3, {100, 55, 123}, {31, 5, 22}, {4, 4, 4}, {10, 0, 31}, {99, 55, 70}},
+            {4, {50, 160, 31, 12}, {25, 20, 20, 10}, {5, 5, 5, 10}, {0, 7, 3, 1},
+             {50, 150, 30, 12}},
+            {2, {100, 100}, {20, 20}, {10, 10}, {21, 21}, {39, 39}}, // inside one chunk
+    ));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, false},
+            {CATERVA_STORAGE_BLOSC, true, true},
+    ));
+}
+
+
+CUTEST_TEST_TEST(parallel_get_slice_buffer) {
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, test_parallel_shapes_t);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    if (backend.persistent) {
+        storage.properties.blosc.urlpath = "test_parallel_get_slice_buffer.b2frame";
+    }
+    storage.properties.blosc.sequencial = backend.sequential;
+    for (int i = 0; i < params.ndim; ++i) {
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+    }
+
+    /* Create original data */
+    size_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        buffersize *= (size_t) params.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &src));
+
+    /* Read the same slice using the parallel and the serial path */
+    int64_t destshape[CATERVA_MAX_DIM] = {0};
+    int64_t destbuffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        destshape[i] = shapes.stop[i] - shapes.start[i];
+        destbuffersize *= destshape[i];
+    }
+    uint8_t *destbuffer = malloc((size_t) destbuffersize);
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, src, shapes.start, shapes.stop,
+                                                 destshape, destbuffer, destbuffersize));
+    uint8_t *destbuffer_serial = malloc((size_t) destbuffersize);
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx_serial, src, shapes.start,
+                                                 shapes.stop, destshape, destbuffer_serial,
+                                                 destbuffersize));
+    CATERVA_TEST_ASSERT_BUFFER(destbuffer, destbuffer_serial, (int) destbuffersize);
+
+    /* Check a full read against the original data */
+    uint8_t *buffer_dest = malloc(buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, src, buffer_dest, buffersize));
+    CATERVA_TEST_ASSERT_BUFFER(buffer, buffer_dest, (int) buffersize);
+
+    /* Free mallocs */
+    free(buffer);
+    free(buffer_dest);
+    free(destbuffer);
+    free(destbuffer_serial);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(parallel_get_slice_buffer) {
+    caterva_ctx_free(&data->ctx);
+    caterva_ctx_free(&data->ctx_serial);
+}
+
+int main() {
+    CUTEST_TEST_RUN(parallel_get_slice_buffer);
+}
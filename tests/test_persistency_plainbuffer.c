@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+#ifdef __GNUC__
+#include <unistd.h>
+#define FILE_EXISTS(urlpath) access(urlpath, F_OK)
+#else
+#include <io.h>
+#define FILE_EXISTS(urlpath) _access(urlpath, 0)
+#endif
+
+
+CUTEST_TEST_DATA(persistency_plainbuffer) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(persistency_plainbuffer) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 2, 4, 8));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {0, {0}, {0}, {0}}, // 0-dim
+            {1, {10}, {0}, {0}},
+            {2, {100, 100}, {0}, {0}},
+            {3, {100, 55, 123}, {0}, {0}},
+            {3, {100, 0, 12}, {0}, {0}},
+            {6, {5, 1, 200, 3, 1, 2}, {0}, {0}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(persistency_plainbuffer) {
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+
+    char *urlpath = "test_persistency_plainbuffer.cat";
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = CATERVA_STORAGE_PLAINBUFFER;
+    storage.properties.plainbuffer.urlpath = urlpath;
+
+    /* Create original data */
+    int64_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        buffersize *= shapes.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize > 0 ? buffersize : 1);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &src));
+    CUTEST_ASSERT("The plain buffer is not mapped", src->bufmap != NULL);
+
+    /* Update a slice in place, through the mapping */
+    int64_t start[CATERVA_MAX_DIM] = {0};
+    int64_t stop[CATERVA_MAX_DIM];
+    int64_t slicesize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        start[i] = shapes.shape[i] / 2;
+        stop[i] = shapes.shape[i];
+        slicesize *= stop[i] - start[i];
+    }
+    uint8_t *slice = malloc(slicesize > 0 ? slicesize : 1);
+    for (int64_t n = 0; n < slicesize; ++n) {
+        slice[n] = (uint8_t) (n * 13 + 1);
+    }
+    CATERVA_TEST_ASSERT(caterva_set_slice_buffer(data->ctx, slice, slicesize, start, stop, src));
+    uint8_t *expected = malloc(buffersize > 0 ? buffersize : 1);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, src, expected, buffersize));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+
+    /* The file is mapped again when it is opened */
+    caterva_array_t *dest;
+    CATERVA_TEST_ASSERT(caterva_open(data->ctx, urlpath, &dest));
+    CUTEST_ASSERT("Storage is not correct", dest->storage == CATERVA_STORAGE_PLAINBUFFER);
+    CUTEST_ASSERT("The plain buffer is not mapped", dest->bufmap != NULL);
+    CUTEST_ASSERT("Ndim is not correct", dest->ndim == params.ndim);
+    CUTEST_ASSERT("Itemsize is not correct", dest->itemsize == itemsize);
+    for (int i = 0; i < params.ndim; ++i) {
+        CUTEST_ASSERT("Shape is not correct", dest->shape[i] == shapes.shape[i]);
+    }
+    CUTEST_ASSERT("The array must be filled", dest->filled);
+
+    uint8_t *buffer_dest = malloc(buffersize > 0 ? buffersize : 1);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, dest, buffer_dest, buffersize));
+    CUTEST_ASSERT("Elements are not equals!", memcmp(expected, buffer_dest, buffersize) == 0);
+
+    uint8_t *slice_dest = malloc(slicesize > 0 ? slicesize : 1);
+    int64_t shape[CATERVA_MAX_DIM];
+    for (int i = 0; i < params.ndim; ++i) {
+        shape[i] = stop[i] - start[i];
+    }
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, dest, start, stop, shape, slice_dest,
+                                                 slicesize));
+    CUTEST_ASSERT("Slice is not correct", memcmp(slice, slice_dest, slicesize) == 0);
+
+    /* Resizing rewrites the file and its header */
+    if (params.ndim > 0) {
+        int64_t new_shape[CATERVA_MAX_DIM];
+        for (int i = 0; i < params.ndim; ++i) {
+            new_shape[i] = shapes.shape[i];
+        }
+        new_shape[0] += 3;
+        CATERVA_TEST_ASSERT(caterva_resize(data->ctx, dest, new_shape));
+        CATERVA_TEST_ASSERT(caterva_free(data->ctx, &dest));
+        CATERVA_TEST_ASSERT(caterva_open(data->ctx, urlpath, &dest));
+        CUTEST_ASSERT("Shape is not correct", dest->shape[0] == shapes.shape[0] + 3);
+        int64_t stop_[CATERVA_MAX_DIM];
+        for (int i = 0; i < params.ndim; ++i) {
+            stop_[i] = shapes.shape[i];
+        }
+        int64_t start_[CATERVA_MAX_DIM] = {0};
+        CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, dest, start_, stop_, stop_,
+                                                     buffer_dest, buffersize));
+        CUTEST_ASSERT("Resized elements are not correct",
+                      memcmp(expected, buffer_dest, buffersize) == 0);
+    }
+
+    /* Free mallocs */
+    free(buffer);
+    free(buffer_dest);
+    free(expected);
+    free(slice);
+    free(slice_dest);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &dest));
+
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(persistency_plainbuffer) {
+    caterva_ctx_free(&data->ctx);
+}
+
+int main() {
+    CUTEST_TEST_RUN(persistency_plainbuffer);
+}
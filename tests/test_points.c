@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+#define TEST_NPOINTS 500
+
+
+CUTEST_TEST_DATA(points) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(points) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 2, 8));
+    CUTEST_PARAMETRIZE(cache, bool, CUTEST_DATA(false, true));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_PLAINBUFFER, false, false},
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, false},
+    ));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {1000}, {120}, {40}},
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {40, 55, 23}, {11, 5, 22}, {4, 4, 4}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(points) {
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+    CUTEST_GET_PARAMETER(cache, bool);
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    if (backend.backend == CATERVA_STORAGE_BLOSC) {
+        storage.properties.blosc.sequencial = backend.sequential;
+        for (int i = 0; i < params.ndim; ++i) {
+            storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+            storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+        }
+    }
+
+    /* Create original data */
+    size_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        buffersize *= (size_t) params.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &src));
+    if (cache && backend.backend == CATERVA_STORAGE_BLOSC) {
+        int64_t chunkbytes = src->extchunknitems * src->itemsize;
+        CATERVA_TEST_ASSERT(caterva_set_cache_size(data->ctx, src, 2 * chunkbytes));
+    }
+
+    /* Random points (some of them repeated) and their offsets in the buffer */
+    int64_t coords[TEST_NPOINTS * CATERVA_MAX_DIM];
+    int64_t offsets[TEST_NPOINTS];
+    uint32_t seed = 12345;
+    for (int n = 0; n < TEST_NPOINTS; ++n) {
+        offsets[n] = 0;
+        for (int i = 0; i < params.ndim; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            int64_t coord = (seed >> 8) % shapes.shape[i];
+            if (n % 7 == 6) {
+                coord = coords[(n - 1) * params.ndim + i];
+            }
+            coords[n * params.ndim + i] = coord;
+            offsets[n] = offsets[n] * shapes.shape[i] + coord;
+        }
+    }
+
+    /* Gather */
+    uint8_t *values = malloc(TEST_NPOINTS * itemsize);
+    CATERVA_TEST_ASSERT(caterva_get_points(data->ctx, src, coords, TEST_NPOINTS, values,
+                                           TEST_NPOINTS * itemsize));
+    for (int n = 0; n < TEST_NPOINTS; ++n) {
+        CUTEST_ASSERT("Point is not correct",
+                      memcmp(&values[n * itemsize], &buffer[offsets[n] * itemsize],
+                             itemsize) == 0);
+    }
+
+    /* Scatter new values and check them (repeated points keep the last value) */
+    for (int n = 0; n < TEST_NPOINTS * itemsize; ++n) {
+        values[n] = (uint8_t) (n * 31 + 7);
+    }
+    CATERVA_TEST_ASSERT(caterva_set_points(data->ctx, src, coords, TEST_NPOINTS, values,
+                                           TEST_NPOINTS * itemsize));
+    for (int n = 0; n < TEST_NPOINTS; ++n) {
+        memcpy(&buffer[offsets[n] * itemsize], &values[n * itemsize], itemsize);
+    }
+    uint8_t *result = malloc(buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, src, result, (int64_t) buffersize));
+    CUTEST_ASSERT("Scattered points are not correct", memcmp(result, buffer, buffersize) == 0);
+
+    /* Points outside the array are rejected */
+    coords[0] = shapes.shape[0];
+    CUTEST_ASSERT("Points outside the array must be rejected",
+                  caterva_get_points(data->ctx, src, coords, TEST_NPOINTS, values,
+                                     TEST_NPOINTS * itemsize) == CATERVA_ERR_INVALID_INDEX);
+
+    /* Free mallocs */
+    free(buffer);
+    free(values);
+    free(result);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(points) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(points);
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+
+CUTEST_TEST_DATA(pool) {
+    void *unused;
+};
+
+
+CUTEST_TEST_SETUP(pool) {
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(poolsize, int64_t, CUTEST_DATA(0, 1024, 64 * 1024 * 1024));
+    CUTEST_PARAMETRIZE(nthreads, int16_t, CUTEST_DATA(1, 2));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {100, 55, 123}, {31, 5, 22}, {4, 4, 4}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(pool) {
+    CUTEST_GET_PARAMETER(poolsize, int64_t);
+    CUTEST_GET_PARAMETER(nthreads, int16_t);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = nthreads;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    cfg.poolsize = poolsize;
+    caterva_ctx_t *ctx;
+    CATERVA_TEST_ASSERT(caterva_ctx_new(&cfg, &ctx));
+
+    uint8_t itemsize = 8;
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = CATERVA_STORAGE_BLOSC;
+    for (int i = 0; i < params.ndim; ++i) {
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+    }
+
+    /* Create original data */
+    size_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        buffersize *= (size_t) params.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(ctx, buffer, buffersize, &params, &storage, &src));
+
+    /* Repeated reads must give the same result, reusing the scratch buffers if allowed */
+    uint8_t *result = malloc(buffersize);
+    caterva_pool_stats_t stats_ref;
+    CATERVA_TEST_ASSERT(caterva_ctx_get_pool_stats(ctx, &stats_ref));
+    for (int n = 0; n < 3; ++n) {
+        memset(result, 0, buffersize);
+        CATERVA_TEST_ASSERT(caterva_to_buffer(ctx, src, result, (int64_t) buffersize));
+        CUTEST_ASSERT("Elements are not equal", memcmp(buffer, result, buffersize) == 0);
+    }
+    caterva_pool_stats_t stats;
+    CATERVA_TEST_ASSERT(caterva_ctx_get_pool_stats(ctx, &stats));
+    CUTEST_ASSERT("Pool exceeds its size", stats.nbytes <= poolsize);
+    CUTEST_ASSERT("Pool requests are not counted",
+                  stats.hits + stats.misses > stats_ref.hits + stats_ref.misses);
+    if (poolsize >= 64 * 1024 * 1024) {
+        CUTEST_ASSERT("Pool does not reuse buffers", stats.hits > stats_ref.hits);
+    }
+    if (poolsize == 0) {
+        CUTEST_ASSERT("Empty pool reuses buffers", stats.hits == 0 && stats.nbytes == 0);
+    }
+
+    /* Free mallocs */
+    free(buffer);
+    free(result);
+    CATERVA_TEST_ASSERT(caterva_free(ctx, &src));
+    CATERVA_TEST_ASSERT(caterva_ctx_free(&ctx));
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(pool) {
+    (void) data;
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(pool);
+}
@@ -0,0 +1,349 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+#include <math.h>
+#ifdef __GNUC__
+#include <unistd.h>
+#define FILE_EXISTS(urlpath) access(urlpath, F_OK)
+#else
+#include <io.h>
+#define FILE_EXISTS(urlpath) _access(urlpath, 0)
+#endif
+
+#define NLEVELS 3
+
+
+/* Downsample a C buffer of doubles, as the levels of a pyramid are expected to be */
+static void downsample(int8_t ndim, const int64_t *shape, const int32_t *factors,
+                       caterva_downsample_t method, const double *src, int64_t *dshape,
+                       double *dest) {
+    int64_t strides[CATERVA_MAX_DIM];
+    int64_t dnitems = 1;
+    for (int i = ndim - 1; i >= 0; --i) {
+        strides[i] = i == ndim - 1 ? 1 : strides[i + 1] * shape[i + 1];
+        dshape[i] = (shape[i] + factors[i] - 1) / factors[i];
+        dnitems *= dshape[i];
+    }
+    for (int64_t n = 0; n < dnitems; ++n) {
+        int64_t first[CATERVA_MAX_DIM];
+        int64_t box[CATERVA_MAX_DIM];
+        int64_t boxnitems = 1;
+        int64_t index = n;
+        for (int i = ndim - 1; i >= 0; --i) {
+            first[i] = (index % dshape[i]) * factors[i];
+            index /= dshape[i];
+            box[i] = shape[i] - first[i] < factors[i] ? shape[i] - first[i] : factors[i];
+            boxnitems *= box[i];
+        }
+        double sum = 0;
+        double max = -INFINITY;
+        for (int64_t m = 0; m < boxnitems; ++m) {
+            int64_t offset = 0;
+            int64_t bindex = m;
+            for (int i = ndim - 1; i >= 0; --i) {
+                offset += (first[i] + bindex % box[i]) * strides[i];
+                bindex /= box[i];
+            }
+            sum += src[offset];
+            max = src[offset] > max ? src[offset] : max;
+            if (m == 0 && method == CATERVA_DOWNSAMPLE_STRIDE) {
+                break;
+            }
+        }
+        switch (method) {
+            case CATERVA_DOWNSAMPLE_STRIDE:
+                dest[n] = sum;
+                break;
+            case CATERVA_DOWNSAMPLE_MEAN:
+                dest[n] = sum / (double) boxnitems;
+                break;
+            case CATERVA_DOWNSAMPLE_MAX:
+                dest[n] = max;
+                break;
+        }
+    }
+}
+
+
+/* Pick the items nearest to the centers of the items of a scaled slice */
+static void pick(int8_t ndim, const int64_t *start, const int64_t *stop, const int64_t *shape,
+                 const int64_t *scale, const int64_t *lshape, const double *level,
+                 double *dest) {
+    int64_t nitems = 1;
+    for (int i = 0; i < ndim; ++i) {
+        nitems *= shape[i];
+    }
+    for (int64_t n = 0; n < nitems; ++n) {
+        int64_t offset = 0;
+        int64_t index = n;
+        int64_t stride = 1;
+        for (int i = ndim - 1; i >= 0; --i) {
+            int64_t j = index % shape[i];
+            index /= shape[i];
+            double step = (double) (stop[i] - start[i]) / (double) shape[i];
+            int64_t x = start[i] + (int64_t) (((double) j + 0.5) * step);
+            int64_t lx = x / scale[i];
+            offset += (lx < lshape[i] ? lx : lshape[i] - 1) * stride;
+            stride *= lshape[i];
+        }
+        dest[n] = level[offset];
+    }
+}
+
+
+static void remove_files(const char *urlpath) {
+    char path[64];
+    for (int level = 0; level <= NLEVELS; ++level) {
+        if (level == 0) {
+            snprintf(path, sizeof(path), "%s", urlpath);
+        } else {
+            snprintf(path, sizeof(path), "%s.level%d", urlpath, level);
+        }
+        if (FILE_EXISTS(path) != -1) {
+            remove(path);
+        }
+    }
+}
+
+
+CUTEST_TEST_DATA(pyramid) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(pyramid) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(method, caterva_downsample_t, CUTEST_DATA(
+            CATERVA_DOWNSAMPLE_STRIDE,
+            CATERVA_DOWNSAMPLE_MEAN,
+            CATERVA_DOWNSAMPLE_MAX,
+    ));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {100}, {20}, {5}},
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {60, 55, 90}, {31, 5, 22}, {4, 4, 4}},
+    ));
+    CUTEST_PARAMETRIZE(persistent, bool, CUTEST_DATA(false, true));
+}
+
+
+CUTEST_TEST_TEST(pyramid) {
+    CUTEST_GET_PARAMETER(method, caterva_downsample_t);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+    CUTEST_GET_PARAMETER(persistent, bool);
+
+    char *urlpath = "test_pyramid.b2frame";
+    remove_files(urlpath);
+
+    uint8_t itemsize = sizeof(double);
+    caterva_params_t params = {0};
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = CATERVA_STORAGE_BLOSC;
+    if (persistent) {
+        storage.properties.blosc.urlpath = urlpath;
+    }
+    storage.properties.blosc.sequencial = true;
+    for (int i = 0; i < params.ndim; ++i) {
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+    }
+
+    /* Create original data */
+    int64_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        buffersize *= shapes.shape[i];
+    }
+    double *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    caterva_array_t *array;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &array));
+
+    /* Build the pyramid (the last dimension is downsampled by 3 and the other ones by 2) */
+    caterva_pyramid_params_t pparams = {0};
+    pparams.nlevels = NLEVELS;
+    pparams.method = method;
+    pparams.dtype = CATERVA_DTYPE_FLOAT64;
+    pparams.factors[params.ndim - 1] = 3;
+    CATERVA_TEST_ASSERT(caterva_pyramid_build(data->ctx, array, &pparams));
+
+    caterva_pyramid_params_t pparams2;
+    CATERVA_TEST_ASSERT(caterva_pyramid_get_params(data->ctx, array, &pparams2));
+    CUTEST_ASSERT("The pyramid has a wrong number of levels", pparams2.nlevels == NLEVELS);
+    for (int i = 0; i < params.ndim; ++i) {
+        CUTEST_ASSERT("The factors are wrong",
+                      pparams2.factors[i] == (i == params.ndim - 1 ? 3 : 2));
+    }
+
+    /* Every level is the downsampled previous one */
+    double *levels[NLEVELS + 1];
+    int64_t lshapes[NLEVELS + 1][CATERVA_MAX_DIM];
+    levels[0] = buffer;
+    for (int i = 0; i < params.ndim; ++i) {
+        lshapes[0][i] = shapes.shape[i];
+    }
+    for (int level = 1; level <= NLEVELS; ++level) {
+        levels[level] = malloc(buffersize);
+        downsample(params.ndim, lshapes[level - 1], pparams2.factors, method, levels[level - 1],
+                   lshapes[level], levels[level]);
+
+        caterva_array_t *level_array;
+        CATERVA_TEST_ASSERT(caterva_pyramid_get_level(data->ctx, array, level, &level_array));
+        int64_t lsize = itemsize;
+        for (int i = 0; i < params.ndim; ++i) {
+            CUTEST_ASSERT("The level has a wrong shape",
+                          level_array->shape[i] == lshapes[level][i]);
+            lsize *= lshapes[level][i];
+        }
+        double *buffer_dest = malloc(lsize);
+        CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, level_array, buffer_dest, lsize));
+        for (int64_t n = 0; n < lsize / itemsize; ++n) {
+            CUTEST_ASSERT("The level is wrong", fabs(buffer_dest[n] - levels[level][n]) < 1e-9);
+        }
+        free(buffer_dest);
+    }
+    caterva_array_t *level_array;
+    CUTEST_ASSERT("Missing levels can not be got",
+                  caterva_pyramid_get_level(data->ctx, array, NLEVELS + 1, &level_array) ==
+                  CATERVA_ERR_INVALID_ARGUMENT);
+
+    if (persistent) {
+        /* The pyramid is found again when the array is opened */
+        CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+        CATERVA_TEST_ASSERT(caterva_open_mmap(data->ctx, urlpath, CATERVA_ACCESS_AUTO, &array));
+        CATERVA_TEST_ASSERT(caterva_pyramid_get_params(data->ctx, array, &pparams2));
+        CUTEST_ASSERT("The pyramid has not been opened", pparams2.nlevels == NLEVELS);
+        CUTEST_ASSERT("Read-only arrays can not build pyramids",
+                      caterva_pyramid_build(data->ctx, array, &pparams) ==
+                      CATERVA_ERR_READ_ONLY);
+        CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+        CATERVA_TEST_ASSERT(caterva_open(data->ctx, urlpath, &array));
+    }
+
+    /* Scaled reads come from the coarsest level with enough items, and every level is used */
+    int64_t start[CATERVA_MAX_DIM] = {0};
+    int64_t stop[CATERVA_MAX_DIM];
+    int64_t shape[CATERVA_MAX_DIM];
+    int64_t scale[CATERVA_MAX_DIM];
+    double *buffer_dest = malloc(buffersize);
+    double *buffer_ref = malloc(buffersize);
+    for (int level = 0; level <= NLEVELS; ++level) {
+        int64_t nitems = 1;
+        for (int i = 0; i < params.ndim; ++i) {
+            start[i] = level == 0 ? 0 : shapes.shape[i] / 10;
+            stop[i] = shapes.shape[i];
+            scale[i] = 1;
+            for (int l = 0; l < level; ++l) {
+                scale[i] *= pparams2.factors[i];
+            }
+            shape[i] = (stop[i] - start[i]) / scale[i];
+            nitems *= shape[i];
+        }
+        int level_read;
+        CATERVA_TEST_ASSERT(caterva_get_slice_buffer_scaled(data->ctx, array, start, stop, shape,
+                                                            buffer_dest, buffersize,
+                                                            &level_read));
+        CUTEST_ASSERT("The level read is wrong", level_read == level);
+        pick(params.ndim, start, stop, shape, scale, lshapes[level], levels[level], buffer_ref);
+        for (int64_t n = 0; n < nitems; ++n) {
+            CUTEST_ASSERT("Elements are not equals!", fabs(buffer_dest[n] - buffer_ref[n]) < 1e-9);
+        }
+    }
+
+    /* The buffer can not be larger than the slice */
+    for (int i = 0; i < params.ndim; ++i) {
+        shape[i] = stop[i] - start[i];
+    }
+    shape[0]++;
+    CUTEST_ASSERT("Slices can not be upsampled",
+                  caterva_get_slice_buffer_scaled(data->ctx, array, start, stop, shape,
+                                                  buffer_dest, buffersize, NULL) ==
+                  CATERVA_ERR_INVALID_ARGUMENT);
+
+    if (persistent) {
+        /* A pyramid with missing levels is ignored */
+        CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+        char path[64];
+        snprintf(path, sizeof(path), "%s.level%d", urlpath, NLEVELS);
+        remove(path);
+        CATERVA_TEST_ASSERT(caterva_open(data->ctx, urlpath, &array));
+        CATERVA_TEST_ASSERT(caterva_pyramid_get_params(data->ctx, array, &pparams2));
+        CUTEST_ASSERT("A broken pyramid has not been ignored", pparams2.nlevels == 0);
+    }
+
+    /* Resizing drops the pyramid, so scaled reads come from the array itself */
+    int64_t new_shape[CATERVA_MAX_DIM];
+    for (int i = 0; i < params.ndim; ++i) {
+        new_shape[i] = shapes.shape[i];
+    }
+    new_shape[0] /= 2;
+    CATERVA_TEST_ASSERT(caterva_resize(data->ctx, array, new_shape));
+    if (persistent) {
+        CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+        CATERVA_TEST_ASSERT(caterva_open(data->ctx, urlpath, &array));
+        char path[64];
+        snprintf(path, sizeof(path), "%s.level1", urlpath);
+        CUTEST_ASSERT("The levels have not been removed", FILE_EXISTS(path) == -1);
+    }
+    CATERVA_TEST_ASSERT(caterva_pyramid_get_params(data->ctx, array, &pparams2));
+    CUTEST_ASSERT("The pyramid has not been dropped", pparams2.nlevels == 0);
+    int64_t nitems = 1;
+    for (int i = 0; i < params.ndim; ++i) {
+        start[i] = 0;
+        stop[i] = new_shape[i];
+        scale[i] = 1;
+        shape[i] = (stop[i] + 2) / 3;
+        nitems *= shape[i];
+    }
+    int level_read;
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer_scaled(data->ctx, array, start, stop, shape,
+                                                        buffer_dest, buffersize, &level_read));
+    CUTEST_ASSERT("The level read is wrong", level_read == 0);
+    pick(params.ndim, start, stop, shape, scale, lshapes[0], levels[0], buffer_ref);
+    for (int64_t n = 0; n < nitems; ++n) {
+        CUTEST_ASSERT("Elements are not equals!", fabs(buffer_dest[n] - buffer_ref[n]) < 1e-9);
+    }
+
+    /* Free mallocs */
+    for (int level = 1; level <= NLEVELS; ++level) {
+        free(levels[level]);
+    }
+    free(buffer);
+    free(buffer_dest);
+    free(buffer_ref);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+
+    remove_files(urlpath);
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(pyramid) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(pyramid);
+}
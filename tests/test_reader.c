@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+#ifdef __GNUC__
+#include <unistd.h>
+#define FILE_EXISTS(urlpath) access(urlpath, F_OK)
+#else
+#include <io.h>
+#define FILE_EXISTS(urlpath) _access(urlpath, 0)
+#endif
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#define TEST_READER_THREADS 4
+#else
+#define TEST_READER_THREADS 1
+#endif
+
+#define TEST_READER_NSLICES 4
+#define TEST_READER_ROUNDS 8
+
+
+typedef struct {
+    int8_t ndim;
+    int64_t shape[CATERVA_MAX_DIM];
+    int32_t chunkshape[CATERVA_MAX_DIM];
+    int32_t blockshape[CATERVA_MAX_DIM];
+    int64_t start[TEST_READER_NSLICES][CATERVA_MAX_DIM];
+    int64_t stop[TEST_READER_NSLICES][CATERVA_MAX_DIM];
+} test_reader_shapes_t;
+
+
+typedef struct {
+    caterva_ctx_t *ctx;
+    caterva_array_t *array;
+    test_reader_shapes_t *shapes;
+    uint8_t **expected;
+    int64_t *sizes;
+    int nthread;
+    int rc;
+    bool equal;
+} test_reader_job_t;
+
+
+// Read all the slices several times, each thread starting at a different one. The last thread
+// does not use a reader handle, to check that plain reads can also run concurrently.
+static void *test_reader_worker(void *arg) {
+    test_reader_job_t *job = arg;
+    job->rc = CATERVA_SUCCEED;
+    job->equal = true;
+
+    caterva_reader_t *reader = NULL;
+    bool handle = job->nthread < TEST_READER_THREADS - 1 || TEST_READER_THREADS == 1;
+    if (handle) {
+        job->rc = caterva_reader_new(job->ctx, job->array, &reader);
+    }
+    uint8_t *result = malloc((size_t) job->sizes[0]);
+    for (int round = 0; job->rc == CATERVA_SUCCEED && round < TEST_READER_ROUNDS; ++round) {
+        int n = (round + job->nthread) % TEST_READER_NSLICES;
+        int64_t *start = job->shapes->start[n];
+        int64_t *stop = job->shapes->stop[n];
+        int64_t shape[CATERVA_MAX_DIM];
+        for (int i = 0; i < job->array->ndim; ++i) {
+            shape[i] = stop[i] - start[i];
+        }
+        memset(result, 0, (size_t) job->sizes[n]);
+        if (handle) {
+            job->rc = caterva_reader_get_slice_buffer(reader, start, stop, shape, result,
+                                                      job->sizes[n]);
+        } else {
+            job->rc = caterva_get_slice_buffer(job->ctx, job->array, start, stop, shape, result,
+                                               job->sizes[n]);
+        }
+        if (job->rc == CATERVA_SUCCEED &&
+            memcmp(result, job->expected[n], (size_t) job->sizes[n]) != 0) {
+            job->equal = false;
+        }
+    }
+    free(result);
+    if (reader != NULL) {
+        caterva_reader_free(&reader);
+    }
+
+    return NULL;
+}
+
+
+CUTEST_TEST_DATA(reader) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(reader) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 8));
+    CUTEST_PARAMETRIZE(cache, bool, CUTEST_DATA(false, true));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_PLAINBUFFER, false, false},
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, false},
+            {CATERVA_STORAGE_BLOSC, true, true},
+    ));
+    CUTEST_PARAMETRIZE(shapes, test_reader_shapes_t, CUTEST_DATA(
+            {2, {100, 100}, {20, 20}, {10, 10},
+             {{0, 0}, {20, 40}, {5, 7}, {0, 0}},
+             {{100, 100}, {40, 60}, {93, 81}, {1, 100}}},
+            {3, {40, 55, 23}, {11, 5, 22}, {4, 4, 4},
+             {{0, 0, 0}, {11, 5, 0}, {3, 12, 7}, {39, 0, 22}},
+             {{40, 55, 23}, {22, 10, 22}, {30, 50, 20}, {40, 55, 23}}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(reader) {
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, test_reader_shapes_t);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+    CUTEST_GET_PARAMETER(cache, bool);
+
+    char *urlpath = "test_reader.b2frame";
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    if (backend.backend == CATERVA_STORAGE_BLOSC) {
+        if (backend.persistent) {
+            storage.properties.blosc.urlpath = urlpath;
+        }
+        storage.properties.blosc.sequencial = backend.sequential;
+        for (int i = 0; i < params.ndim; ++i) {
+            storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+            storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+        }
+    }
+
+    /* Create original data */
+    size_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        buffersize *= (size_t) params.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &src));
+    caterva_array_t *ref = src;
+    if (backend.persistent) {
+        // Open the frame again, so that the threads are the first ones loading its chunk offsets
+        CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+        CATERVA_TEST_ASSERT(caterva_open(data->ctx, urlpath, &src));
+        CATERVA_TEST_ASSERT(caterva_open(data->ctx, urlpath, &ref));
+    }
+    if (cache && backend.backend == CATERVA_STORAGE_BLOSC) {
+        int64_t chunkbytes = src->extchunknitems * src->itemsize;
+        CATERVA_TEST_ASSERT(caterva_set_cache_size(data->ctx, src, 3 * chunkbytes));
+    }
+
+    /* The expected slices are read serially beforehand */
+    uint8_t *expected[TEST_READER_NSLICES];
+    int64_t sizes[TEST_READER_NSLICES];
+    for (int n = 0; n < TEST_READER_NSLICES; ++n) {
+        int64_t shape[CATERVA_MAX_DIM];
+        sizes[n] = itemsize;
+        for (int i = 0; i < params.ndim; ++i) {
+            shape[i] = shapes.stop[n][i] - shapes.start[n][i];
+            sizes[n] *= shape[i];
+        }
+        expected[n] = malloc((size_t) sizes[n]);
+        CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, ref, shapes.start[n],
+                                                     shapes.stop[n], shape, expected[n],
+                                                     sizes[n]));
+    }
+    // The first slice is the whole array
+    CUTEST_ASSERT("Slice is not correct", memcmp(expected[0], buffer, buffersize) == 0);
+
+    /* Read the slices from several threads at the same time */
+    test_reader_job_t jobs[TEST_READER_THREADS];
+    for (int i = 0; i < TEST_READER_THREADS; ++i) {
+        jobs[i].ctx = data->ctx;
+        jobs[i].array = src;
+        jobs[i].shapes = &shapes;
+        jobs[i].expected = expected;
+        jobs[i].sizes = sizes;
+        jobs[i].nthread = i;
+    }
+#if TEST_READER_THREADS > 1
+    pthread_t threads[TEST_READER_THREADS];
+    for (int i = 0; i < TEST_READER_THREADS; ++i) {
+        pthread_create(&threads[i], NULL, test_reader_worker, &jobs[i]);
+    }
+    for (int i = 0; i < TEST_READER_THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+#else
+    test_reader_worker(&jobs[0]);
+#endif
+    for (int i = 0; i < TEST_READER_THREADS; ++i) {
+        CATERVA_TEST_ASSERT(jobs[i].rc);
+        CUTEST_ASSERT("Concurrent slice is not correct", jobs[i].equal);
+    }
+
+    /* Buffers smaller than the slice are rejected */
+    caterva_reader_t *reader;
+    CATERVA_TEST_ASSERT(caterva_reader_new(data->ctx, src, &reader));
+    int64_t shape[CATERVA_MAX_DIM];
+    for (int i = 0; i < params.ndim; ++i) {
+        shape[i] = shapes.stop[1][i] - shapes.start[1][i];
+    }
+    CUTEST_ASSERT("Small buffers must be rejected",
+                  caterva_reader_get_slice_buffer(reader, shapes.start[1], shapes.stop[1], shape,
+                                                  expected[1], sizes[1] - 1) ==
+                  CATERVA_ERR_INVALID_ARGUMENT);
+    CATERVA_TEST_ASSERT(caterva_reader_free(&reader));
+    CUTEST_ASSERT("Reader is not freed", reader == NULL);
+
+    /* Free mallocs */
+    free(buffer);
+    for (int n = 0; n < TEST_READER_NSLICES; ++n) {
+        free(expected[n]);
+    }
+    if (ref != src) {
+        CATERVA_TEST_ASSERT(caterva_free(data->ctx, &ref));
+    }
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(reader) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(reader);
+}
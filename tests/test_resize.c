@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+#include <math.h>
+#ifdef __GNUC__
+#include <unistd.h>
+#define FILE_EXISTS(urlpath) access(urlpath, F_OK)
+#else
+#include <io.h>
+#define FILE_EXISTS(urlpath) _access(urlpath, 0)
+#endif
+
+typedef struct {
+    int8_t ndim;
+    int64_t shape[CATERVA_MAX_DIM];
+    int32_t chunkshape[CATERVA_MAX_DIM];
+    int32_t blockshape[CATERVA_MAX_DIM];
+    int64_t new_shape[CATERVA_MAX_DIM];
+} test_resize_shapes_t;
+
+
+// Check that the array holds the items of `buffer` (with shape `shape`) that are inside
+// `inner` and zeros elsewhere
+static int test_resize_check(caterva_ctx_t *ctx, caterva_array_t *array, const uint8_t *buffer,
+                             const int64_t *shape, const int64_t *inner) {
+    int8_t ndim = array->ndim;
+    uint8_t itemsize = array->itemsize;
+    size_t size = (size_t) array->nitems * itemsize;
+    uint8_t *result = malloc(size > 0 ? size : 1);
+    uint8_t *zeros = calloc(1, itemsize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(ctx, array, result, (int64_t) size));
+
+    for (int64_t nitem = 0; nitem < array->nitems; ++nitem) {
+        int64_t rem = nitem;
+        int64_t offset = 0;
+        int64_t stride = 1;
+        bool inside = true;
+        for (int i = ndim - 1; i >= 0; --i) {
+            int64_t coord = rem % array->shape[i];
+            rem /= array->shape[i];
+            inside = inside && coord < inner[i];
+            offset += coord * stride;
+            stride *= shape[i];
+        }
+        const uint8_t *expected = inside ? &buffer[offset * itemsize] : zeros;
+        CUTEST_ASSERT("Resized array is not correct",
+                      memcmp(&result[nitem * itemsize], expected, itemsize) == 0);
+    }
+
+    free(result);
+    free(zeros);
+    return 0;
+}
+
+
+// Check that the statistics of every chunk of `array` (made of doubles) match its items and that a
+// filtered read returns every item that is zero
+static int test_resize_check_stats(caterva_ctx_t *ctx, caterva_array_t *array) {
+    int8_t ndim = array->ndim;
+    size_t size = (size_t) array->nitems * sizeof(double);
+    double *result = malloc(size > 0 ? size : 1);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(ctx, array, result, (int64_t) size));
+
+    int64_t nchunks = 1;
+    int64_t grid[CATERVA_MAX_DIM];
+    for (int i = 0; i < ndim; ++i) {
+        grid[i] = array->extshape[i] / array->chunkshape[i];
+        nchunks *= grid[i];
+    }
+    int64_t nitems = 0;
+    for (int64_t nchunk = 0; nchunk < nchunks; ++nchunk) {
+        int64_t coords[CATERVA_MAX_DIM];
+        int64_t rem = nchunk;
+        for (int i = ndim - 1; i >= 0; --i) {
+            coords[i] = rem % grid[i];
+            rem /= grid[i];
+        }
+        double min = INFINITY;
+        double max = -INFINITY;
+        for (int64_t nitem = 0; nitem < array->nitems; ++nitem) {
+            int64_t item_rem = nitem;
+            bool inside = true;
+            for (int i = ndim - 1; i >= 0; --i) {
+                inside = inside && (item_rem % array->shape[i]) / array->chunkshape[i] == coords[i];
+                item_rem /= array->shape[i];
+            }
+            if (inside) {
+                min = result[nitem] < min ? result[nitem] : min;
+                max = result[nitem] > max ? result[nitem] : max;
+            }
+        }
+        caterva_stats_t stats;
+        CATERVA_TEST_ASSERT(caterva_get_chunk_stats(ctx, array, coords, &stats, NULL));
+        if (stats.nitems > 0) {
+            CUTEST_ASSERT("Chunk min is not correct", stats.min == min);
+            CUTEST_ASSERT("Chunk max is not correct", stats.max == max);
+        }
+        nitems += stats.nitems;
+    }
+    CUTEST_ASSERT("Chunk stats do not cover the array", nitems == array->nitems);
+
+    /* The items that entered the array again are zeros and must not be skipped */
+    if (array->nitems > 0) {
+        int64_t start[CATERVA_MAX_DIM];
+        for (int i = 0; i < ndim; ++i) {
+            start[i] = 0;
+        }
+        caterva_filter_t filter;
+        filter.low = 0;
+        filter.high = 0;
+        double *filtered = malloc(size);
+        memset(filtered, 0xff, size);
+        CATERVA_TEST_ASSERT(caterva_get_slice_buffer_filtered(ctx, array, start, array->shape,
+                                                              array->shape, &filter, filtered,
+                                                              (int64_t) size, NULL));
+        for (int64_t nitem = 0; nitem < array->nitems; ++nitem) {
+            if (result[nitem] == 0) {
+                CUTEST_ASSERT("Filtered slice is not correct", filtered[nitem] == 0);
+            }
+        }
+        free(filtered);
+    }
+
+    free(result);
+    return 0;
+}
+
+
+CUTEST_TEST_DATA(resize) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(resize) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(2, 8));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_PLAINBUFFER, false, false},
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, false},
+            {CATERVA_STORAGE_BLOSC, true, true},
+    ));
+    CUTEST_PARAMETRIZE(shapes, test_resize_shapes_t, CUTEST_DATA(
+            {1, {100}, {30}, {7}, {250}}, // grow
+            {1, {100}, {30}, {7}, {45}}, // shrink
+            {2, {40, 40}, {10, 10}, {5, 5}, {75, 40}}, // outermost dimension
+            {2, {40, 40}, {10, 10}, {5, 5}, {40, 63}}, // innermost dimension
+            {3, {20, 15, 12}, {6, 5, 4}, {3, 2, 4}, {31, 9, 17}}, // general
+            {3, {20, 15, 12}, {6, 5, 4}, {3, 2, 4}, {20, 0, 12}}, // 0-shape
+    ));
+}
+
+
+CUTEST_TEST_TEST(resize) {
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, test_resize_shapes_t);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+
+    char *urlpath = "test_resize.b2frame";
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    if (backend.backend == CATERVA_STORAGE_BLOSC) {
+        if (backend.persistent) {
+            storage.properties.blosc.urlpath = urlpath;
+        }
+        storage.properties.blosc.sequencial = backend.sequential;
+        if (itemsize == 8) {
+            storage.properties.blosc.stats = CATERVA_DTYPE_FLOAT64;
+        }
+        for (int i = 0; i < params.ndim; ++i) {
+            storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+            storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+        }
+    }
+
+    /* Create original data */
+    size_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        buffersize *= (size_t) params.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &src));
+
+    /* Resize the array */
+    int64_t inner[CATERVA_MAX_DIM];
+    for (int i = 0; i < params.ndim; ++i) {
+        inner[i] = shapes.shape[i] < shapes.new_shape[i] ? shapes.shape[i] : shapes.new_shape[i];
+    }
+    CATERVA_TEST_ASSERT(caterva_resize(data->ctx, src, shapes.new_shape));
+    for (int i = 0; i < params.ndim; ++i) {
+        CUTEST_ASSERT("Shape is not correct", src->shape[i] == shapes.new_shape[i]);
+    }
+    CATERVA_TEST_ASSERT(test_resize_check(data->ctx, src, buffer, shapes.shape, inner));
+
+    /* Going back to the original shape fills the dropped items with zeros */
+    CATERVA_TEST_ASSERT(caterva_resize(data->ctx, src, shapes.shape));
+    CATERVA_TEST_ASSERT(test_resize_check(data->ctx, src, buffer, shapes.shape, inner));
+
+    /* The statistics follow the chunks, also for the items that entered the array again */
+    if (src->stats != NULL) {
+        CATERVA_TEST_ASSERT(test_resize_check_stats(data->ctx, src));
+    }
+
+    /* The new shape is stored with the array */
+    if (backend.persistent) {
+        CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+        CATERVA_TEST_ASSERT(caterva_open(data->ctx, urlpath, &src));
+        for (int i = 0; i < params.ndim; ++i) {
+            CUTEST_ASSERT("Stored shape is not correct", src->shape[i] == shapes.shape[i]);
+        }
+        CATERVA_TEST_ASSERT(test_resize_check(data->ctx, src, buffer, shapes.shape, inner));
+    }
+
+    /* Free mallocs */
+    free(buffer);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(resize) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(resize);
+}
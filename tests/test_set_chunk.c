@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#define TEST_SET_CHUNK_THREADS 4
+#else
+#define TEST_SET_CHUNK_THREADS 1
+#endif
+
+
+typedef struct {
+    caterva_ctx_t *ctx;
+    caterva_array_t *array;
+    caterva_array_t *src;
+    int64_t nchunks;
+    int nthread;
+    int rc;
+} test_set_chunk_job_t;
+
+
+// Write (in reverse order) the chunks assigned to a thread, taking their data from `src`
+static void *test_set_chunk_worker(void *arg) {
+    test_set_chunk_job_t *job = arg;
+    caterva_array_t *array = job->array;
+    uint8_t *chunk = malloc((size_t) array->chunknitems * array->itemsize);
+    job->rc = CATERVA_SUCCEED;
+
+    int64_t chunks_shape[CATERVA_MAX_DIM];
+    for (int i = 0; i < array->ndim; ++i) {
+        chunks_shape[i] = array->extshape[i] / array->chunkshape[i];
+    }
+    for (int64_t nchunk = job->nchunks - 1; nchunk >= 0; --nchunk) {
+        if (nchunk % TEST_SET_CHUNK_THREADS != job->nthread) {
+            continue;
+        }
+        int64_t coords[CATERVA_MAX_DIM];
+        int64_t start[CATERVA_MAX_DIM];
+        int64_t stop[CATERVA_MAX_DIM];
+        int64_t shape[CATERVA_MAX_DIM];
+        int64_t chunksize = array->itemsize;
+        int64_t index = nchunk;
+        for (int i = array->ndim - 1; i >= 0; --i) {
+            coords[i] = index % chunks_shape[i];
+            index /= chunks_shape[i];
+        }
+        for (int i = 0; i < array->ndim; ++i) {
+            start[i] = coords[i] * array->chunkshape[i];
+            stop[i] = start[i] + array->chunkshape[i];
+            if (stop[i] > array->shape[i]) {
+                stop[i] = array->shape[i];
+            }
+            shape[i] = stop[i] - start[i];
+            chunksize *= shape[i];
+        }
+        job->rc = caterva_get_slice_buffer(job->ctx, job->src, start, stop, shape, chunk,
+                                           chunksize);
+        if (job->rc != CATERVA_SUCCEED) {
+            break;
+        }
+        job->rc = caterva_set_chunk(job->ctx, array, coords, chunk, chunksize);
+        if (job->rc != CATERVA_SUCCEED) {
+            break;
+        }
+    }
+    free(chunk);
+
+    return NULL;
+}
+
+
+CUTEST_TEST_DATA(set_chunk) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(set_chunk) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 1;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 2, 4, 8));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {0, {0}, {0}, {0}}, // 0-dim
+            {1, {10}, {7}, {2}}, // 1-idim
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {100, 55, 123}, {31, 5, 22}, {4, 4, 4}},
+            {3, {100, 0, 12}, {31, 0, 12}, {10, 0, 12}},
+            {4, {50, 160, 31, 12}, {25, 20, 20, 10}, {5, 5, 5, 10}},
+    ));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_PLAINBUFFER, false, false},
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, false},
+            {CATERVA_STORAGE_BLOSC, true, true},
+    ));
+}
+
+
+CUTEST_TEST_TEST(set_chunk) {
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    if (storage.backend == CATERVA_STORAGE_BLOSC) {
+        if (backend.persistent) {
+            storage.properties.blosc.urlpath = "test_set_chunk.b2frame";
+        }
+        storage.properties.blosc.sequencial = backend.sequential;
+        for (int i = 0; i < params.ndim; ++i) {
+            storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+            storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+        }
+    }
+    caterva_storage_t storage_src = {0};
+    storage_src.backend = CATERVA_STORAGE_PLAINBUFFER;
+
+    /* Create original data */
+    size_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        buffersize *= (size_t) params.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage_src,
+                                            &src));
+
+    /* A new array must only contain zeros */
+    caterva_array_t *array;
+    CATERVA_TEST_ASSERT(caterva_zeros(data->ctx, &params, &storage, &array));
+    CUTEST_ASSERT("Array is not filled", array->filled);
+    uint8_t *buffer_dest = malloc(buffersize);
+    if (buffersize > 0) {
+        memset(buffer_dest, 1, buffersize);
+    }
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, array, buffer_dest, buffersize));
+    for (size_t i = 0; i < buffersize; ++i) {
+        CUTEST_ASSERT("Elements are not zeros!", buffer_dest[i] == 0);
+    }
+
+    /* Write the chunks in any order from different threads */
+    if (array->nitems != 0) {
+        test_set_chunk_job_t jobs[TEST_SET_CHUNK_THREADS];
+        for (int i = 0; i < TEST_SET_CHUNK_THREADS; ++i) {
+            jobs[i].ctx = data->ctx;
+            jobs[i].array = array;
+            jobs[i].src = src;
+            jobs[i].nchunks = array->extnitems / array->chunknitems;
+            jobs[i].nthread = i;
+        }
+#if TEST_SET_CHUNK_THREADS > 1
+        pthread_t threads[TEST_SET_CHUNK_THREADS];
+        for (int i = 0; i < TEST_SET_CHUNK_THREADS; ++i) {
+            pthread_create(&threads[i], NULL, test_set_chunk_worker, &jobs[i]);
+        }
+        for (int i = 0; i < TEST_SET_CHUNK_THREADS; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+#else
+        test_set_chunk_worker(&jobs[0]);
+#endif
+        for (int i = 0; i < TEST_SET_CHUNK_THREADS; ++i) {
+            CATERVA_TEST_ASSERT(jobs[i].rc);
+        }
+    }
+
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, array, buffer_dest, buffersize));
+    CATERVA_TEST_ASSERT_BUFFER(buffer, buffer_dest, (int) buffersize);
+
+    /* Free mallocs */
+    free(buffer);
+    free(buffer_dest);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &array));
+
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(set_chunk) {
+    caterva_ctx_free(&data->ctx);
+}
+
+int main() {
+    CUTEST_TEST_RUN(set_chunk);
+}
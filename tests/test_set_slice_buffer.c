@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+typedef struct {
+    int8_t ndim;
+    int64_t shape[CATERVA_MAX_DIM];
+    int32_t chunkshape[CATERVA_MAX_DIM];
+    int32_t blockshape[CATERVA_MAX_DIM];
+    int64_t start[CATERVA_MAX_DIM];
+    int64_t stop[CATERVA_MAX_DIM];
+} test_set_slice_shapes_t;
+
+
+CUTEST_TEST_DATA(set_slice_buffer) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(set_slice_buffer) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 2, 4, 8));
+    CUTEST_PARAMETRIZE(shapes, test_set_slice_shapes_t, CUTEST_DATA(
+            {1, {100}, {7}, {2}, {3}, {95}}, // 1-idim
+            {2, {100, 100}, {20, 20}, {10, 10}, {5, 13}, {87, 100}},
+            {2, {100, 100}, {20, 20}, {10, 10}, {20, 40}, {40, 60}}, // overwritten chunk
+            {2, {100, 100}, {20, 20}, {10, 10}, {0, 0}, {100, 100}}, // whole array
+            {3, {100, 55, 123}, {31, 5, 22}, {4, 4, 4}, {10, 0, 31}, {99, 55, 70}},
+            {4, {50, 160, 31, 12}, {25, 20, 20, 10}, {5, 5, 5, 10}, {0, 7, 3, 1},
+             {50, 150, 30, 12}},
+    ));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_PLAINBUFFER, false, false},
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, false},
+            {CATERVA_STORAGE_BLOSC, true, true},
+    ));
+}
+
+
+CUTEST_TEST_TEST(set_slice_buffer) {
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, test_set_slice_shapes_t);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    if (storage.backend == CATERVA_STORAGE_BLOSC) {
+        if (backend.persistent) {
+            storage.properties.blosc.urlpath = "test_set_slice_buffer.b2frame";
+        }
+        storage.properties.blosc.sequencial = backend.sequential;
+        for (int i = 0; i < params.ndim; ++i) {
+            storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+            storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+        }
+    }
+    caterva_storage_t storage_ref = {0};
+    storage_ref.backend = CATERVA_STORAGE_PLAINBUFFER;
+
+    /* Create original data */
+    size_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        buffersize *= (size_t) params.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &src));
+    caterva_array_t *src_ref;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage_ref,
+                                            &src_ref));
+    if (src->storage == CATERVA_STORAGE_BLOSC) {
+        // Cached chunks must be invalidated by the update
+        CATERVA_TEST_ASSERT(caterva_set_cache_size(data->ctx, src, INT32_MAX));
+        CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, src, buffer, buffersize));
+    }
+
+    /* Create the slice data */
+    int64_t slicesize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        slicesize *= shapes.stop[i] - shapes.start[i];
+    }
+    uint8_t *slicebuffer = malloc((size_t) slicesize);
+    for (int64_t i = 0; i < slicesize; ++i) {
+        slicebuffer[i] = (uint8_t) (255 - i % 251);
+    }
+
+    /* Update both arrays and compare them */
+    CATERVA_TEST_ASSERT(caterva_set_slice_buffer(data->ctx, slicebuffer, slicesize, shapes.start,
+                                                 shapes.stop, src));
+    CATERVA_TEST_ASSERT(caterva_set_slice_buffer(data->ctx, slicebuffer, slicesize, shapes.start,
+                                                 shapes.stop, src_ref));
+
+    uint8_t *buffer_dest = malloc(buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, src, buffer_dest, buffersize));
+    uint8_t *buffer_ref = malloc(buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, src_ref, buffer_ref, buffersize));
+    CATERVA_TEST_ASSERT_BUFFER(buffer_ref, buffer_dest, (int) buffersize);
+
+    /* Read back the slice */
+    memset(slicebuffer, 0, (size_t) slicesize);
+    int64_t sliceshape[CATERVA_MAX_DIM] = {0};
+    for (int i = 0; i < params.ndim; ++i) {
+        sliceshape[i] = shapes.stop[i] - shapes.start[i];
+    }
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer(data->ctx, src, shapes.start, shapes.stop,
+                                                 sliceshape, slicebuffer, slicesize));
+    for (int64_t i = 0; i < slicesize; ++i) {
+        CUTEST_ASSERT("Elements are not equals!", slicebuffer[i] == (uint8_t) (255 - i % 251));
+    }
+
+    /* Slices outside the array or with a negative size are rejected */
+    int64_t bad_start[CATERVA_MAX_DIM];
+    int64_t bad_stop[CATERVA_MAX_DIM];
+    for (int nbad = 0; nbad < 3; ++nbad) {
+        for (int i = 0; i < params.ndim; ++i) {
+            bad_start[i] = shapes.start[i];
+            bad_stop[i] = shapes.stop[i];
+        }
+        int i = params.ndim - 1;
+        switch (nbad) {
+            case 0:
+                bad_start[i] = -1;
+                break;
+            case 1:
+                bad_stop[i] = shapes.shape[i] + 1;
+                break;
+            default:
+                bad_start[i] = shapes.stop[i];
+                bad_stop[i] = shapes.start[i] - 1;
+        }
+        CUTEST_ASSERT("Invalid slice was not rejected",
+                      caterva_set_slice_buffer(data->ctx, buffer_ref, (int64_t) buffersize,
+                                               bad_start, bad_stop, src) ==
+                      CATERVA_ERR_INVALID_INDEX);
+    }
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, src, buffer_dest, buffersize));
+    CATERVA_TEST_ASSERT_BUFFER(buffer_ref, buffer_dest, (int) buffersize);
+
+    /* Free mallocs */
+    free(buffer);
+    free(buffer_dest);
+    free(buffer_ref);
+    free(slicebuffer);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src_ref));
+
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(set_slice_buffer) {
+    caterva_ctx_free(&data->ctx);
+}
+
+int main() {
+    CUTEST_TEST_RUN(set_slice_buffer);
+}
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+#include <math.h>
+#ifdef __GNUC__
+#include <unistd.h>
+#define FILE_EXISTS(urlpath) access(urlpath, F_OK)
+#else
+#include <io.h>
+#define FILE_EXISTS(urlpath) _access(urlpath, 0)
+#endif
+
+
+// The types of the items written by fill_buf
+static caterva_dtype_t test_stats_dtype(uint8_t itemsize) {
+    switch (itemsize) {
+        case 8:
+            return CATERVA_DTYPE_FLOAT64;
+        case 4:
+            return CATERVA_DTYPE_FLOAT32;
+        case 2:
+            return CATERVA_DTYPE_UINT16;
+        default:
+            return CATERVA_DTYPE_UINT8;
+    }
+}
+
+static double test_stats_value(const uint8_t *item, uint8_t itemsize) {
+    switch (itemsize) {
+        case 8:
+            return *(const double *) item;
+        case 4:
+            return *(const float *) item;
+        case 2:
+            return *(const uint16_t *) item;
+        default:
+            return *item;
+    }
+}
+
+
+CUTEST_TEST_DATA(stats) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(stats) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 2, 4, 8));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {1000}, {200}, {30}},
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {100, 55, 123}, {31, 5, 22}, {4, 4, 4}},
+            {4, {50, 16, 31, 12}, {25, 8, 20, 10}, {5, 5, 5, 10}},
+    ));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, false},
+            {CATERVA_STORAGE_BLOSC, true, true},
+    ));
+}
+
+
+CUTEST_TEST_TEST(stats) {
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+
+    char *urlpath = "test_stats.b2frame";
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+
+    caterva_params_t params;
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    storage.properties.blosc.sequencial = backend.sequential;
+    storage.properties.blosc.stats = test_stats_dtype(itemsize);
+    if (backend.persistent) {
+        storage.properties.blosc.urlpath = urlpath;
+    }
+    for (int i = 0; i < params.ndim; ++i) {
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+    }
+
+    /* Create original data */
+    int64_t strides[CATERVA_MAX_DIM];
+    size_t buffersize = itemsize;
+    for (int i = params.ndim - 1; i >= 0; --i) {
+        strides[i] = (int64_t) (buffersize / itemsize);
+        buffersize *= (size_t) params.shape[i];
+    }
+    int64_t nitems = (int64_t) (buffersize / itemsize);
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, (size_t) nitems));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &src));
+
+    /* The statistics of every chunk must match the original data */
+    int64_t nchunks = 1;
+    int64_t chunks_shape[CATERVA_MAX_DIM];
+    for (int i = 0; i < params.ndim; ++i) {
+        chunks_shape[i] = (src->shape[i] + src->chunkshape[i] - 1) / src->chunkshape[i];
+        nchunks *= chunks_shape[i];
+    }
+    int nblocks = (int) (src->extchunknitems / src->blocknitems);
+    caterva_stats_t *blockstats = malloc(nblocks * sizeof(caterva_stats_t));
+    int64_t coords[CATERVA_MAX_DIM];
+    for (int64_t n = 0; n < nchunks; ++n) {
+        int64_t rem = n;
+        int64_t chunk_nitems = 1;
+        for (int i = params.ndim - 1; i >= 0; --i) {
+            coords[i] = rem % chunks_shape[i];
+            rem /= chunks_shape[i];
+        }
+        double min = INFINITY;
+        double max = -INFINITY;
+        int64_t shape[CATERVA_MAX_DIM];
+        for (int i = 0; i < params.ndim; ++i) {
+            shape[i] = src->chunkshape[i];
+            if ((coords[i] + 1) * shape[i] > src->shape[i]) {
+                shape[i] = src->shape[i] - coords[i] * shape[i];
+            }
+            chunk_nitems *= shape[i];
+        }
+        for (int64_t nitem = 0; nitem < chunk_nitems; ++nitem) {
+            int64_t item_rem = nitem;
+            int64_t offset = 0;
+            for (int i = params.ndim - 1; i >= 0; --i) {
+                offset += (coords[i] * src->chunkshape[i] + item_rem % shape[i]) * strides[i];
+                item_rem /= shape[i];
+            }
+            double value = test_stats_value(&buffer[offset * itemsize], itemsize);
+            min = value < min ? value : min;
+            max = value > max ? value : max;
+        }
+
+        caterva_stats_t stats;
+        CATERVA_TEST_ASSERT(caterva_get_chunk_stats(data->ctx, src, coords, &stats, blockstats));
+        CUTEST_ASSERT("Chunk items are not correct", stats.nitems == chunk_nitems);
+        CUTEST_ASSERT("Chunk min is not correct", stats.min == min);
+        CUTEST_ASSERT("Chunk max is not correct", stats.max == max);
+        CUTEST_ASSERT("Chunk NaNs are not correct", stats.nnan == 0);
+        int64_t blocks_nitems = 0;
+        for (int nblock = 0; nblock < nblocks; ++nblock) {
+            blocks_nitems += blockstats[nblock].nitems;
+            if (blockstats[nblock].nitems > 0) {
+                CUTEST_ASSERT("Block stats are not inside the chunk ones",
+                              blockstats[nblock].min >= min && blockstats[nblock].max <= max);
+            }
+        }
+        CUTEST_ASSERT("Block items are not correct", blocks_nitems == chunk_nitems);
+    }
+
+    /* A filtered read must return (at least) every item in the range */
+    int64_t start[CATERVA_MAX_DIM];
+    int64_t stop[CATERVA_MAX_DIM];
+    int64_t shape[CATERVA_MAX_DIM];
+    for (int i = 0; i < params.ndim; ++i) {
+        start[i] = 0;
+        stop[i] = src->shape[i];
+        shape[i] = src->shape[i];
+    }
+    caterva_filter_t filter;
+    filter.low = test_stats_value(&buffer[(nitems / 2) * itemsize], itemsize);
+    filter.high = filter.low + 3;
+    uint8_t *filtered = malloc(buffersize);
+    memset(filtered, 0xff, buffersize);
+    int64_t nskipped;
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer_filtered(data->ctx, src, start, stop, shape,
+                                                          &filter, filtered,
+                                                          (int64_t) buffersize, &nskipped));
+    for (int64_t nitem = 0; nitem < nitems; ++nitem) {
+        double value = test_stats_value(&buffer[nitem * itemsize], itemsize);
+        if (value >= filter.low && value <= filter.high) {
+            CUTEST_ASSERT("Filtered slice is not correct",
+                          memcmp(&filtered[nitem * itemsize], &buffer[nitem * itemsize],
+                                 itemsize) == 0);
+        }
+    }
+    // The data of wider types is sorted, so most blocks can not match
+    if (itemsize >= 4 && nchunks > 1) {
+        CUTEST_ASSERT("Filtered slice did not skip any block", nskipped > 0);
+    }
+
+    /* The statistics are stored with the array */
+    if (backend.persistent) {
+        caterva_stats_t stats;
+        caterva_stats_t stats_ref;
+        for (int i = 0; i < params.ndim; ++i) {
+            coords[i] = chunks_shape[i] - 1;
+        }
+        CATERVA_TEST_ASSERT(caterva_get_chunk_stats(data->ctx, src, coords, &stats_ref, NULL));
+        CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+        CATERVA_TEST_ASSERT(caterva_open(data->ctx, urlpath, &src));
+        CATERVA_TEST_ASSERT(caterva_get_chunk_stats(data->ctx, src, coords, &stats, NULL));
+        CUTEST_ASSERT("Stored statistics are not correct",
+                      memcmp(&stats, &stats_ref, sizeof(caterva_stats_t)) == 0);
+    }
+
+    /* Arrays without statistics can not be filtered */
+    caterva_array_t *plain;
+    storage.properties.blosc.stats = CATERVA_DTYPE_NONE;
+    storage.properties.blosc.urlpath = NULL;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &plain));
+    CUTEST_ASSERT("Arrays without statistics can not be filtered",
+                  caterva_get_slice_buffer_filtered(data->ctx, plain, start, stop, shape,
+                                                    &filter, filtered, (int64_t) buffersize,
+                                                    NULL) == CATERVA_ERR_INVALID_ARGUMENT);
+
+    /* Free mallocs */
+    free(buffer);
+    free(blockstats);
+    free(filtered);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &plain));
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(stats) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(stats);
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+
+
+CUTEST_TEST_DATA(threadpool) {
+    caterva_ctx_t *ctx_serial;
+};
+
+
+CUTEST_TEST_SETUP(threadpool) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 1;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx_serial);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(affinity, caterva_affinity_t, CUTEST_DATA(
+            CATERVA_AFFINITY_NONE,
+            CATERVA_AFFINITY_COMPACT,
+            CATERVA_AFFINITY_SCATTER,
+            CATERVA_AFFINITY_LIST,
+    ));
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 8));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {100, 55, 123}, {31, 5, 22}, {4, 4, 4}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(threadpool) {
+    CUTEST_GET_PARAMETER(affinity, caterva_affinity_t);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+
+    /* Two contexts share the workers of a pool */
+    int cpus[] = {0};
+    caterva_threadpool_params_t pool_params = {3, affinity, cpus, 1};
+    caterva_threadpool_t *pool;
+    CATERVA_TEST_ASSERT(caterva_threadpool_new(&pool_params, &pool));
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    cfg.threadpool = pool;
+    cfg.nthreads = 4;
+    caterva_ctx_t *ctx;
+    CATERVA_TEST_ASSERT(caterva_ctx_new(&cfg, &ctx));
+    cfg.nthreads = 2;
+    caterva_ctx_t *ctx2;
+    CATERVA_TEST_ASSERT(caterva_ctx_new(&cfg, &ctx2));
+
+    caterva_params_t params = {0};
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    caterva_storage_t storage = {0};
+    storage.backend = CATERVA_STORAGE_BLOSC;
+    int64_t buffersize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+        buffersize *= shapes.shape[i];
+    }
+    uint8_t *buffer = malloc(buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, buffersize / itemsize));
+
+    /* The chunks compressed by the pool are the same as the serial ones */
+    caterva_array_t *array;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(ctx, buffer, buffersize, &params, &storage, &array));
+    caterva_array_t *array_serial;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx_serial, buffer, buffersize, &params,
+                                            &storage, &array_serial));
+    CUTEST_ASSERT("Number of chunks are not equals",
+                  array->sc->nchunks == array_serial->sc->nchunks);
+    for (int nchunk = 0; nchunk < array->sc->nchunks; ++nchunk) {
+        uint8_t *chunk;
+        bool needs_free;
+        int cbytes = blosc2_schunk_get_chunk(array->sc, nchunk, &chunk, &needs_free);
+        uint8_t *chunk_serial;
+        bool needs_free_serial;
+        int cbytes_serial = blosc2_schunk_get_chunk(array_serial->sc, nchunk, &chunk_serial,
+                                                    &needs_free_serial);
+        CUTEST_ASSERT("Compressed sizes are not equals", cbytes == cbytes_serial);
+        CATERVA_TEST_ASSERT_BUFFER(chunk, chunk_serial, cbytes);
+        if (needs_free) {
+            free(chunk);
+        }
+        if (needs_free_serial) {
+            free(chunk_serial);
+        }
+    }
+
+    /* Slices and copies from the other context */
+    uint8_t *buffer_dest = malloc(buffersize);
+    int64_t start[CATERVA_MAX_DIM] = {0};
+    int64_t stop[CATERVA_MAX_DIM];
+    for (int i = 0; i < params.ndim; ++i) {
+        stop[i] = shapes.shape[i];
+    }
+    CATERVA_TEST_ASSERT(caterva_get_slice_buffer(ctx2, array, start, stop, stop, buffer_dest,
+                                                 buffersize));
+    CATERVA_TEST_ASSERT_BUFFER(buffer, buffer_dest, (int) buffersize);
+    caterva_array_t *copy;
+    CATERVA_TEST_ASSERT(caterva_copy(ctx2, array, &storage, &copy));
+    memset(buffer_dest, 0, buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(ctx, copy, buffer_dest, buffersize));
+    CATERVA_TEST_ASSERT_BUFFER(buffer, buffer_dest, (int) buffersize);
+
+    caterva_threadpool_stats_t stats;
+    CATERVA_TEST_ASSERT(caterva_threadpool_get_stats(pool, &stats));
+    CUTEST_ASSERT("The workers are not the ones requested", stats.nthreads == 3);
+    CUTEST_ASSERT("The pool has not run the tasks", stats.ntasks > 0);
+    CUTEST_ASSERT("Tasks are left in the queues", stats.queued == 0 && stats.running == 0);
+    CUTEST_ASSERT("The maximum depth is not kept", stats.maxqueued > 0);
+
+    /* Free mallocs */
+    free(buffer);
+    free(buffer_dest);
+    CATERVA_TEST_ASSERT(caterva_free(ctx, &array));
+    CATERVA_TEST_ASSERT(caterva_free(ctx2, &copy));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx_serial, &array_serial));
+    CATERVA_TEST_ASSERT(caterva_ctx_free(&ctx));
+    CATERVA_TEST_ASSERT(caterva_ctx_free(&ctx2));
+    CATERVA_TEST_ASSERT(caterva_threadpool_free(&pool));
+
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(threadpool) {
+    caterva_ctx_free(&data->ctx_serial);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(threadpool);
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2018 Francesc Alted, Aleix Alcacer.
+ * Copyright (C) 2019-present Blosc Development team <blosc@blosc.org>
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include "test_common.h"
+#ifdef __GNUC__
+#include <unistd.h>
+#define FILE_EXISTS(urlpath) access(urlpath, F_OK)
+#else
+#include <io.h>
+#define FILE_EXISTS(urlpath) _access(urlpath, 0)
+#endif
+
+
+// Copy the chunks of `src` in `coords` into `dest`, compressed
+static int test_transfer_chunks(caterva_ctx_t *ctx, caterva_array_t *src, caterva_array_t *dest,
+                                int64_t *coords, int64_t nchunks) {
+    int64_t buffersize = src->extchunknitems * src->itemsize + BLOSC_MAX_OVERHEAD;
+    uint8_t *cchunk = malloc((size_t) buffersize);
+    for (int64_t nchunk = 0; nchunk < nchunks; ++nchunk) {
+        int64_t *chunk_coords = &coords[nchunk * src->ndim];
+        int64_t cbytes;
+        CATERVA_TEST_ASSERT(caterva_get_chunk_compressed(ctx, src, chunk_coords, NULL, 0,
+                                                         &cbytes));
+        CUTEST_ASSERT("Compressed chunk is too large", cbytes <= buffersize);
+        CATERVA_TEST_ASSERT(caterva_get_chunk_compressed(ctx, src, chunk_coords, cchunk,
+                                                         buffersize, &cbytes));
+        CATERVA_TEST_ASSERT(caterva_set_chunk_compressed(ctx, dest, chunk_coords, cchunk,
+                                                         cbytes));
+    }
+    free(cchunk);
+    return 0;
+}
+
+
+CUTEST_TEST_DATA(transfer) {
+    caterva_ctx_t *ctx;
+};
+
+
+CUTEST_TEST_SETUP(transfer) {
+    caterva_config_t cfg = CATERVA_CONFIG_DEFAULTS;
+    cfg.nthreads = 2;
+    cfg.compcodec = BLOSC_BLOSCLZ;
+    caterva_ctx_new(&cfg, &data->ctx);
+
+    // Add parametrizations
+    CUTEST_PARAMETRIZE(itemsize, uint8_t, CUTEST_DATA(1, 8));
+    CUTEST_PARAMETRIZE(backend, _test_backend, CUTEST_DATA(
+            {CATERVA_STORAGE_BLOSC, false, false},
+            {CATERVA_STORAGE_BLOSC, true, true},
+    ));
+    CUTEST_PARAMETRIZE(shapes, _test_shapes, CUTEST_DATA(
+            {1, {1000}, {100}, {25}},
+            {2, {100, 100}, {20, 20}, {10, 10}},
+            {3, {40, 60, 30}, {10, 20, 10}, {5, 5, 5}},
+    ));
+}
+
+
+CUTEST_TEST_TEST(transfer) {
+    CUTEST_GET_PARAMETER(itemsize, uint8_t);
+    CUTEST_GET_PARAMETER(backend, _test_backend);
+    CUTEST_GET_PARAMETER(shapes, _test_shapes);
+
+    char *urlpath = "test_transfer.b2frame";
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+
+    caterva_params_t params = {0};
+    params.itemsize = itemsize;
+    params.ndim = shapes.ndim;
+    for (int i = 0; i < params.ndim; ++i) {
+        params.shape[i] = shapes.shape[i];
+    }
+
+    caterva_storage_t storage = {0};
+    storage.backend = backend.backend;
+    storage.properties.blosc.sequencial = backend.sequential;
+    for (int i = 0; i < params.ndim; ++i) {
+        storage.properties.blosc.chunkshape[i] = shapes.chunkshape[i];
+        storage.properties.blosc.blockshape[i] = shapes.blockshape[i];
+    }
+
+    int64_t nitems = 1;
+    int64_t nchunks = 1;
+    for (int i = 0; i < params.ndim; ++i) {
+        nitems *= shapes.shape[i];
+        nchunks *= (shapes.shape[i] + shapes.chunkshape[i] - 1) / shapes.chunkshape[i];
+    }
+    int64_t buffersize = nitems * itemsize;
+    uint8_t *buffer = malloc((size_t) buffersize);
+    CUTEST_ASSERT("Buffer filled incorrectly", fill_buf(buffer, itemsize, nitems));
+
+    caterva_array_t *src;
+    CATERVA_TEST_ASSERT(caterva_from_buffer(data->ctx, buffer, buffersize, &params, &storage,
+                                            &src));
+    CATERVA_TEST_ASSERT(caterva_track_versions(data->ctx, src));
+    if (backend.persistent) {
+        storage.properties.blosc.urlpath = urlpath;
+    }
+    caterva_array_t *dest;
+    CATERVA_TEST_ASSERT(caterva_zeros(data->ctx, &params, &storage, &dest));
+
+    /* The destination accepts the chunks of the source */
+    int32_t metalen;
+    CATERVA_TEST_ASSERT(caterva_get_meta(data->ctx, src, NULL, 0, &metalen));
+    uint8_t *meta = malloc((size_t) metalen);
+    CATERVA_TEST_ASSERT(caterva_get_meta(data->ctx, src, meta, metalen, &metalen));
+    bool compatible = false;
+    CATERVA_TEST_ASSERT(caterva_check_meta(data->ctx, dest, meta, metalen, &compatible));
+    CUTEST_ASSERT("Arrays are not compatible", compatible);
+    CUTEST_ASSERT("A truncated metalayer must fail",
+                  caterva_check_meta(data->ctx, dest, meta, metalen - 1, &compatible) ==
+                  CATERVA_ERR_INVALID_ARGUMENT);
+
+    /* A full copy, chunk by chunk */
+    int64_t version;
+    CATERVA_TEST_ASSERT(caterva_get_version(data->ctx, src, &version));
+    int64_t nchanged;
+    CATERVA_TEST_ASSERT(caterva_get_changed_chunks(data->ctx, src, -1, NULL, 0, &nchanged));
+    CUTEST_ASSERT("All the chunks must be listed", nchanged == nchunks);
+    int64_t *coords = malloc((size_t) (nchunks * params.ndim) * sizeof(int64_t));
+    CATERVA_TEST_ASSERT(caterva_get_changed_chunks(data->ctx, src, -1, coords, nchunks,
+                                                   &nchanged));
+    if (test_transfer_chunks(data->ctx, src, dest, coords, nchanged) != 0) {
+        return 1;
+    }
+    uint8_t *buffer_dest = malloc((size_t) buffersize);
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, dest, buffer_dest, buffersize));
+    CUTEST_ASSERT("Elements are not equals!", memcmp(buffer, buffer_dest, buffersize) == 0);
+
+    /* Only the chunk that is written afterwards is copied again */
+    int64_t start[CATERVA_MAX_DIM] = {0};
+    int64_t stop[CATERVA_MAX_DIM];
+    for (int i = 0; i < params.ndim; ++i) {
+        start[i] = shapes.chunkshape[i] + 1;
+        stop[i] = start[i] + 2;
+    }
+    int64_t slicesize = itemsize;
+    for (int i = 0; i < params.ndim; ++i) {
+        slicesize *= stop[i] - start[i];
+    }
+    uint8_t *slice = malloc((size_t) slicesize);
+    memset(slice, 0x5a, (size_t) slicesize);
+    CATERVA_TEST_ASSERT(caterva_set_slice_buffer(data->ctx, slice, slicesize, start, stop, src));
+    CATERVA_TEST_ASSERT(caterva_get_changed_chunks(data->ctx, src, version, coords, nchunks,
+                                                   &nchanged));
+    CUTEST_ASSERT("Only one chunk is changed", nchanged == 1);
+    for (int i = 0; i < params.ndim; ++i) {
+        CUTEST_ASSERT("The changed chunk is not correct", coords[i] == 1);
+    }
+    if (test_transfer_chunks(data->ctx, src, dest, coords, nchanged) != 0) {
+        return 1;
+    }
+    if (backend.persistent) {
+        CATERVA_TEST_ASSERT(caterva_free(data->ctx, &dest));
+        CATERVA_TEST_ASSERT(caterva_open(data->ctx, urlpath, &dest));
+    }
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, src, buffer, buffersize));
+    CATERVA_TEST_ASSERT(caterva_to_buffer(data->ctx, dest, buffer_dest, buffersize));
+    CUTEST_ASSERT("Elements are not equals!", memcmp(buffer, buffer_dest, buffersize) == 0);
+
+    /* Arrays with other chunkshapes are not compatible */
+    caterva_array_t *other;
+    storage.properties.blosc.urlpath = NULL;
+    storage.properties.blosc.chunkshape[0] = shapes.chunkshape[0] / 2;
+    storage.properties.blosc.blockshape[0] = shapes.blockshape[0] / 2;
+    CATERVA_TEST_ASSERT(caterva_zeros(data->ctx, &params, &storage, &other));
+    CATERVA_TEST_ASSERT(caterva_check_meta(data->ctx, other, meta, metalen, &compatible));
+    CUTEST_ASSERT("Arrays must not be compatible", !compatible);
+
+    /* Free mallocs */
+    free(buffer);
+    free(buffer_dest);
+    free(meta);
+    free(coords);
+    free(slice);
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &src));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &dest));
+    CATERVA_TEST_ASSERT(caterva_free(data->ctx, &other));
+
+    if (FILE_EXISTS(urlpath) != -1) {
+        remove(urlpath);
+    }
+    return 0;
+}
+
+
+CUTEST_TEST_TEARDOWN(transfer) {
+    caterva_ctx_free(&data->ctx);
+}
+
+
+int main() {
+    CUTEST_TEST_RUN(transfer);
+}